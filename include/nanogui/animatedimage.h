@@ -0,0 +1,140 @@
+/*
+    nanogui/animatedimage.h -- Frame-by-frame compositing of animated GIF
+    and PNG (APNG) files
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class AnimatedImage animatedimage.h nanogui/animatedimage.h
+ *
+ * \brief Composites the frames of an animated GIF or APNG file.
+ *
+ * The file is parsed once; its compressed data stays in memory and frames
+ * are decoded one at a time. Both formats store frames as changes to a
+ * canvas, so frames are composited in order: \ref nextFrame applies the
+ * disposal of the previous frame and blends the next one onto the canvas,
+ * wrapping around to the first frame after the last. Only the canvas (and a
+ * copy for frames disposed to the previous state) is held decoded.
+ *
+ * PNG files without an animation are treated as a single frame.
+ */
+class NANOGUI_EXPORT AnimatedImage : public Object {
+public:
+    /**
+     * \brief Open and parse a GIF or PNG file.
+     *
+     * \throws std::runtime_error
+     *     If the file cannot be read, is not a valid GIF or PNG file or
+     *     its canvas has more pixels than 8192x8192.
+     */
+    AnimatedImage(const std::string &fileName);
+
+    /// Return the path of the file
+    const std::string &fileName() const { return mFileName; }
+
+    /// Return the canvas width
+    int width() const { return mWidth; }
+
+    /// Return the canvas height
+    int height() const { return mHeight; }
+
+    /// Return the number of frames
+    int frameCount() const { return (int) mFrames.size(); }
+
+    /// Return how long frame \c index is shown, in seconds
+    double delay(int index) const { return mFrames[index].delay; }
+
+    /// Return the length of one pass through all frames, in seconds
+    double duration() const { return mFrameStart.back(); }
+
+    /// Return how often the animation plays (0: forever)
+    int loopCount() const { return mLoopCount; }
+
+    /**
+     * \brief Return the frame showing \c time seconds after the start.
+     *
+     * \param finished
+     *     Set when the last pass has ended; the last frame stays on
+     */
+    int frameAt(double time, bool &finished) const;
+
+    /// Composite the frame after \ref frameIndex and return the canvas
+    const std::vector<uint8_t> &nextFrame();
+
+    /// Return the index of the frame on the canvas (-1: none yet)
+    int frameIndex() const { return mFrameIndex; }
+
+    /// Return the RGBA canvas (straight alpha, top row first)
+    const std::vector<uint8_t> &canvas() const { return mCanvas; }
+
+    /// Clear the canvas, so that \ref nextFrame starts with the first frame
+    void rewind();
+
+protected:
+    enum Dispose { DisposeNone, DisposeBackground, DisposePrevious };
+
+    struct Frame {
+        int x = 0, y = 0, width = 0, height = 0;
+        double delay = 0;
+        Dispose dispose = DisposeNone;
+        /// Blend over the canvas (otherwise replace the rectangle)
+        bool blend = true;
+
+        /* GIF: position of the LZW data and the color table */
+        size_t dataOffset = 0;
+        size_t paletteOffset = 0;
+        int paletteSize = 0;
+        int transparent = -1;
+        bool interlaced = false;
+
+        /// APNG: positions and sizes of the compressed data
+        std::vector<std::pair<size_t, size_t>> chunks;
+    };
+
+    void parseGif();
+    void parsePng();
+
+    /// Decode frame \c index into \ref mFramePixels (width * height RGBA)
+    bool decodeGifFrame(const Frame &frame);
+    bool decodePngFrame(const Frame &frame);
+
+    void clearRect(const Frame &frame);
+    void blit(const Frame &frame);
+
+protected:
+    std::string mFileName;
+    std::vector<uint8_t> mData;
+    bool mIsGif;
+    int mWidth, mHeight;
+    int mLoopCount;
+    std::vector<Frame> mFrames;
+    /// Start time of every frame, followed by the duration
+    std::vector<double> mFrameStart;
+
+    /// PNG: the IHDR payload and the PLTE / tRNS chunks copied into every frame
+    std::vector<uint8_t> mPngHeader;
+    std::vector<std::pair<size_t, size_t>> mPngTables;
+
+    int mFrameIndex;
+    std::vector<uint8_t> mCanvas;
+    std::vector<uint8_t> mPrevious;
+    std::vector<uint8_t> mFramePixels;
+};
+
+NAMESPACE_END(nanogui)
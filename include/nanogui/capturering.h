@@ -0,0 +1,196 @@
+/*
+    nanogui/capturering.h -- Proof-of-play captures in a fixed-size
+    on-disk ring buffer
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/glutil.h>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class CaptureRing capturering.h nanogui/capturering.h
+ *
+ * \brief Records downscaled frames as proof that content was played.
+ *
+ * A capture is taken every \ref interval seconds and on every call to
+ * \ref slideChanged. Each capture stores a small RGB8 copy of the frame
+ * with its wall clock time and the id of the slide that was showing.
+ *
+ * The ring file is allocated once with a fixed number of slots. Once all
+ * slots are used, the oldest capture is overwritten, so disk usage never
+ * grows. When a ring file is reopened, recording resumes after the newest
+ * capture it contains.
+ *
+ * The render thread only issues blits and starts an asynchronous read of
+ * the result (see \ref GLReadback). A multisampled back buffer is first
+ * resolved at full size, since a multisampled framebuffer cannot be
+ * scaled by a blit. The GPU then halves the image with linear filtering,
+ * which averages 2x2 pixels per step, until it is at most twice the frame
+ * size, so that the final blit does not alias. The pixels are converted
+ * and written to disk on the readback worker thread. A capture is skipped
+ * rather than delaying the frame if earlier ones are still in flight.
+ *
+ * The time a capture costs the render thread and the GPU is measured, see
+ * \ref cpuTime and \ref gpuTime (also shown by \ref Screen::drawDebugHUD).
+ *
+ * \ref Screen drives the ring (see \ref Screen::setCaptureRing).
+ */
+class NANOGUI_EXPORT CaptureRing : public Object {
+public:
+    /// A stored capture
+    struct Entry {
+        /// Position of the capture in the ring file
+        int slot;
+        /// Number of the capture since the ring file was created
+        uint64_t sequence;
+        /// Wall clock time in microseconds since the UNIX epoch
+        uint64_t timestamp;
+        /// Id of the slide that was showing
+        std::string slideId;
+    };
+
+    /**
+     * \brief Open or create a ring file.
+     *
+     * An existing file with different dimensions is recreated.
+     *
+     * \param filename
+     *     Path of the ring file
+     *
+     * \param slotCount
+     *     Number of captures kept. The file size is about
+     *     <tt>slotCount * frameSize.prod() * 3</tt> bytes.
+     *
+     * \param frameSize
+     *     Size of the stored frames
+     */
+    CaptureRing(const std::string &filename, int slotCount,
+                const Vector2i &frameSize = Vector2i(320, 180));
+
+    /// Return the path of the ring file
+    const std::string &filename() const { return mFilename; }
+
+    /// Return the number of slots in the ring file
+    int slotCount() const { return mSlotCount; }
+
+    /// Return the size of the stored frames
+    const Vector2i &frameSize() const { return mFrameSize; }
+
+    /// Return the time between periodic captures in seconds
+    double interval() const { return mInterval; }
+
+    /// Set the time between periodic captures in seconds (0: only on slide changes)
+    void setInterval(double interval) { mInterval = interval; }
+
+    /// Record that a different slide is now showing; it is captured with the next frame
+    void slideChanged(const std::string &slideId);
+
+    /// Return the id of the slide that is showing
+    std::string slideId() const;
+
+    /**
+     * \brief Capture the back buffer if a capture is due.
+     *
+     * Called by \ref Screen after drawing each frame, with the window's
+     * context current.
+     *
+     * \param time
+     *     Monotonic time in seconds (e.g. \c glfwGetTime())
+     */
+    void frameDrawn(const Vector2i &framebufferSize, double time);
+
+    /// Return the number of captures written since the ring was opened
+    int captureCount() const;
+
+    /// Return the number of captures skipped because earlier ones were still in flight
+    int skippedCount() const;
+
+    /// Return the time the render thread spent issuing the most recent capture, in seconds
+    double cpuTime() const;
+
+    /// Return the GPU time of the most recent measured capture (resolve and downscale), in seconds
+    double gpuTime() const;
+
+    /// Return the stored captures, oldest first
+    std::vector<Entry> entries() const;
+
+    /// Read the RGB8 pixels (top row first) of the capture in \c slot
+    bool readFrame(int slot, std::vector<uint8_t> &rgb) const;
+
+    /// Finish the captures in flight and release the OpenGL resources (needs the context)
+    void free();
+
+protected:
+    virtual ~CaptureRing();
+
+    /// Write a capture into the next slot; runs on the readback worker thread
+    void store(const GLReadback::Image &image, uint64_t timestamp, const std::string &slideId);
+
+    /// A framebuffer with a single color renderbuffer
+    struct Target {
+        GLuint framebuffer, color;
+        Vector2i size;
+    };
+
+    static Target createTarget(const Vector2i &size, GLenum format);
+
+    /// Create the resolve and halving targets for a back buffer of the given size
+    void createSteps(const Vector2i &framebufferSize);
+
+    /// Blit the back buffer through \ref mSteps into \ref mFramebuffer
+    void downscale(const Vector2i &framebufferSize);
+
+    void releaseSteps();
+
+    /// Read the result of the GPU timer if it is available
+    void collectTimer();
+
+    size_t slotSize() const;
+    size_t slotOffset(int slot) const;
+    bool readSlotHeader(int slot, Entry &entry) const;
+
+protected:
+    std::string mFilename;
+    int mSlotCount;
+    Vector2i mFrameSize;
+    double mInterval;
+    double mLastCapture;
+    bool mSlideChanged;
+    std::string mSlideId;
+
+    /* OpenGL resources of the render thread */
+    GLuint mFramebuffer, mColor;
+    ref<GLReadback> mReadback;
+    /// Resolve (if the back buffer is multisampled) and halving steps
+    std::vector<Target> mSteps;
+    /// Back buffer size \ref mSteps were created for
+    Vector2i mStepsSize;
+    GLuint mTimer;
+    bool mTimerPending;
+
+    /* Guards everything below and the file */
+    mutable std::mutex mMutex;
+    FILE *mFile;
+    int mNextSlot;
+    uint64_t mNextSequence;
+    int mCaptureCount, mSkippedCount;
+    double mCpuTime, mGpuTime;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+NAMESPACE_END(nanogui)
@@ -425,6 +425,18 @@ extern NANOGUI_EXPORT void shutdown();
  *     once every ``refresh`` milliseconds. To disable the refresh timer,
  *     specify a negative value here.
  *
+ * \param parallel
+ *     Render every \c Screen on its own thread (see
+ *     \ref Screen::startRenderThread), so that screens on different
+ *     displays present independently instead of waiting for each other's
+ *     buffer swaps. Events are still dispatched on the calling thread, and
+ *     code running elsewhere must hold \ref Screen::lockWidgets while it
+ *     modifies widgets. The OpenGL context of a screen is only current on
+ *     its render thread: OpenGL calls made elsewhere, including in event
+ *     handlers (e.g. initializing a \ref GLShader), must go through
+ *     \ref Screen::runOnRenderThread. The render threads are stopped when
+ *     the main loop exits.
+ *
  * \param detach
  *     This parameter only exists in the Python bindings. When the active
  *     \c Screen instance is provided via the \c detach parameter, the
@@ -452,7 +464,7 @@ extern NANOGUI_EXPORT void shutdown();
  *     wait for the termination of the main loop and then swap the two thread
  *     environments back into their initial configuration.
  */
-extern NANOGUI_EXPORT void mainloop(int refresh = 50);
+extern NANOGUI_EXPORT void mainloop(int refresh = 50, bool parallel = false);
 
 /// Request the application main loop to terminate (e.g. if you detached mainloop).
 extern NANOGUI_EXPORT void leave();
@@ -521,10 +533,44 @@ extern NANOGUI_EXPORT std::array<char, 8> utf8(int c);
 extern NANOGUI_EXPORT std::vector<std::pair<int, std::string>>
     loadImageDirectory(NVGcontext *ctx, const std::string &path);
 
-/// Convenience function for instanting a PNG icon from the application's data segment (via bin2c)
+/**
+ * \brief List the image files (PNG, JPEG, GIF, BMP, TGA) in a directory
+ * without decoding them.
+ *
+ * Returns immediately even for very large directories. Pass the result to
+ * \ref ImagePanel::setImageFiles to decode the thumbnails in the background,
+ * and to \ref ImageInfo::probe for the image sizes.
+ */
+extern NANOGUI_EXPORT std::vector<std::string>
+    listImageDirectory(const std::string &path);
+
+/**
+ * \brief Return the per-user directory for cache files named \c name.
+ *
+ * That is <tt>%LOCALAPPDATA%\\nanogui\\name</tt> on Windows and
+ * <tt>$XDG_CACHE_HOME/nanogui/name</tt> or <tt>~/.cache/nanogui/name</tt>
+ * elsewhere. Returns an empty string if none of these variables is set.
+ * The directory may not exist yet, see \ref createDirectories.
+ */
+extern NANOGUI_EXPORT std::string userCacheDirectory(const std::string &name);
+
+/// Create a directory and its parents, like <tt>mkdir -p</tt> (returns \c false on failure)
+extern NANOGUI_EXPORT bool createDirectories(const std::string &path);
+
+/**
+ * \brief Convenience function for instanting a PNG icon from the application's
+ * data segment (via bin2c).
+ *
+ * Returns a regular NanoVG image of \c ctx. A copy is packed into a texture
+ * atlas (see \ref TextureAtlas); \ref nvgImageIconPattern draws from it,
+ * so that icons next to each other share draw calls.
+ */
 #define nvgImageIcon(ctx, name) nanogui::__nanogui_get_image(ctx, #name, name##_png, name##_png_size)
 
 /// Helper function used by nvgImageIcon
 extern NANOGUI_EXPORT int __nanogui_get_image(NVGcontext *ctx, const std::string &name, uint8_t *data, uint32_t size);
 
+/// Helper function used by Screen to release the image icons of a NanoVG context
+extern NANOGUI_EXPORT void __nanogui_release_images(NVGcontext *ctx);
+
 NAMESPACE_END(nanogui)
@@ -0,0 +1,168 @@
+/*
+    nanogui/contextgroup.h -- OpenGL share group for several Screens
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <nanogui/opengl.h>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+class ETC2Image;
+class WorkerPool;
+
+/**
+ * \class ContextGroup contextgroup.h nanogui/contextgroup.h
+ *
+ * \brief Lets several screens share OpenGL textures.
+ *
+ * Screens constructed with the same group create their windows with a
+ * shared OpenGL context, so a texture uploaded by one of them can be used
+ * by all of them. \ref image decodes and uploads every file once for the
+ * whole group and wraps the resulting texture into a NanoVG image handle
+ * for each requesting context. Texture memory and load time thus scale
+ * with the number of unique media files rather than with the number of
+ * displays.
+ *
+ * The textures are owned by the group and released once every context
+ * that referenced them has called \ref releaseImage (or has left the
+ * group). All methods are thread-safe, which matters when the member
+ * screens render on their own threads (see \ref Screen::startRenderThread).
+ * Files are decoded without holding the group's lock, so a large image
+ * loading for one member does not stall the others.
+ *
+ * Font glyph atlases and the NanoVG shader program remain private to each
+ * NanoVG context; they are small compared to slide media.
+ */
+class NANOGUI_EXPORT ContextGroup : public Object {
+public:
+    ContextGroup();
+
+    /**
+     * \brief Return the window whose context new members share with.
+     *
+     * This is the first window that joined the group and is still alive,
+     * or \c nullptr if the group is empty.
+     */
+    GLFWwindow *shareWindow() const;
+
+    /// Register the NanoVG context of a screen whose window shares with \ref shareWindow
+    void addContext(NVGcontext *ctx, GLFWwindow *window);
+
+    /**
+     * \brief Remove a NanoVG context from the group.
+     *
+     * Releases the image handles still held by \c ctx. Textures that are
+     * no longer referenced by any member are deleted, so \c ctx must be
+     * current on the calling thread.
+     */
+    void removeContext(NVGcontext *ctx);
+
+    /// Return the number of contexts in the group
+    int contextCount() const;
+
+    /**
+     * \brief Return a NanoVG image of \c ctx showing the given file.
+     *
+     * The file is decoded and uploaded only the first time any member asks
+     * for it (with the same \c imageFlags); later calls wrap the existing
+     * texture. KTX files holding an \ref ETC2Image stay compressed on
+     * the GPU. Every successful call must be balanced by \ref releaseImage.
+     * The context \c ctx must be current on the calling thread.
+     *
+     * When the texture was uploaded by another member, \c ctx waits for
+     * the upload on the GPU (through a fence) before sampling it.
+     *
+     * \param pool
+     *     Decode the file on this pool instead of the calling thread. Until
+     *     the pixels are ready, -1 is returned and the call should be
+     *     repeated in a later frame.
+     *
+     * \return The NanoVG image handle, -1 while decoding on \c pool, or 0
+     *     if NanoVG could not wrap the texture.
+     * \throws std::runtime_error if the file cannot be loaded
+     */
+    int image(NVGcontext *ctx, const std::string &filename, int imageFlags = 0,
+              WorkerPool *pool = nullptr);
+
+    /// Release an image handle returned by \ref image
+    void releaseImage(NVGcontext *ctx, int image);
+
+    /// Return the number of textures currently held by the group
+    int textureCount() const;
+
+    /// Return the number of bytes of texture memory held by the group
+    size_t memoryUsage() const;
+
+    /// Return the size of the texture behind an image handle returned by \ref image (0: unknown)
+    size_t textureBytes(NVGcontext *ctx, int image) const;
+
+protected:
+    struct Texture {
+        GLuint id;
+        int width, height, flags;
+        size_t bytes;
+        int refCount;
+        /// Signaled once the upload has completed (0: already known to be complete)
+        GLsync fence;
+    };
+
+    struct Handle {
+        int image;
+        int uses;
+    };
+
+    /// Decoded file, waiting to be uploaded
+    struct Pixels {
+        /// Set for KTX files, which stay compressed
+        ref<ETC2Image> compressed;
+        std::shared_ptr<uint8_t> rgba;
+        int width = 0, height = 0;
+    };
+
+    struct Member {
+        GLFWwindow *window;
+        /// NanoVG image of every texture referenced by this context
+        std::map<std::string, Handle> handles;
+        /// Inverse map from NanoVG image to texture key
+        std::map<int, std::string> keys;
+    };
+
+    virtual ~ContextGroup();
+
+    std::string textureKey(const std::string &filename, int imageFlags) const;
+    Member *member(NVGcontext *ctx);
+    /// Read \c filename (on any thread, without the lock)
+    static Pixels decode(const std::string &filename);
+    void createTexture(const Pixels &pixels, int imageFlags, Texture &texture);
+    void unreference(const std::string &key);
+    void collectGarbage();
+
+protected:
+    mutable std::mutex mMutex;
+    std::vector<std::pair<NVGcontext *, Member>> mMembers;
+    std::map<std::string, Texture> mTextures;
+    /// Files being decoded, by texture key
+    std::map<std::string, std::shared_future<Pixels>> mDecoding;
+    /// Textures which are no longer referenced, deleted when a member context is current
+    std::vector<GLuint> mGarbage;
+    /// Upload fences of deleted textures
+    std::vector<GLsync> mGarbageFences;
+};
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,140 @@
+/*
+    nanogui/displaylist.h -- Recorded NanoVG backend calls that can be
+    replayed without re-tessellating the paths
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/common.h>
+#include <memory>
+#include <string>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class DrawStateHash displaylist.h nanogui/displaylist.h
+ *
+ * \brief Accumulates everything a widget's appearance depends on.
+ *
+ * The widget constructor variant covers the placement of the widget and
+ * of all its ancestors (which determines the transform and scissor it is
+ * drawn with), its visibility, enabled and focus state, and its theme.
+ * Widgets add their own state on top, e.g. captions and colors.
+ */
+class NANOGUI_EXPORT DrawStateHash {
+public:
+    DrawStateHash() : mValue(0xcbf29ce484222325ull) { }
+    explicit DrawStateHash(const Widget *widget);
+
+    DrawStateHash &add(const void *data, size_t size);
+    DrawStateHash &add(int value) { return add(&value, sizeof(value)); }
+    DrawStateHash &add(bool value) { return add((int) value); }
+    DrawStateHash &add(float value) { return add(&value, sizeof(value)); }
+    DrawStateHash &add(const std::string &value) { add((int) value.size()); return add(value.data(), value.size()); }
+    DrawStateHash &add(const Vector2i &value) { add(value.x()); return add(value.y()); }
+    DrawStateHash &add(const Color &value) { return add(value.data(), sizeof(float) * 4); }
+    DrawStateHash &addPointer(const void *pointer) { return add(&pointer, sizeof(pointer)); }
+
+    uint64_t value() const { return mValue; }
+
+private:
+    uint64_t mValue;
+};
+
+/**
+ * \class DisplayList displaylist.h nanogui/displaylist.h
+ *
+ * \brief Replays the render backend calls of a static piece of drawing.
+ *
+ * NanoVG flattens and tessellates every path into vertex buffers before it
+ * hands them to the render backend. A display list stores those calls
+ * (paints, scissors and vertices) while a widget draws, and replays them
+ * directly into the backend in later frames, skipping path construction,
+ * flattening, tessellation and text layout entirely.
+ *
+ * A recording is tied to the hash passed by the widget, the current
+ * transform and the device pixel ratio. Typical use:
+ *
+ * \code
+ * DrawStateHash hash(this);
+ * hash.add(mCaption);
+ * if (!mDisplayList.replay(ctx, hash.value())) {
+ *     mDisplayList.begin(ctx, hash.value());
+ *     ... regular NanoVG drawing ...
+ *     mDisplayList.end(ctx);
+ * }
+ * \endcode
+ *
+ * The drawing between \ref begin and \ref end must not rely on state left
+ * behind by earlier widgets, and should restore the state it changes.
+ * Nested recordings are allowed: the outer list also captures what the
+ * inner widget draws. Display lists only work on contexts prepared with
+ * \ref nvgAttachDisplayLists (done by \ref Screen); elsewhere, \ref replay
+ * always returns \c false and the widget simply draws as usual.
+ *
+ * \c example_displaylist measures the CPU time per frame of a screen of
+ * windows, buttons, labels and color wheels with and without replaying.
+ */
+class NANOGUI_EXPORT DisplayList {
+public:
+    DisplayList();
+    ~DisplayList();
+
+    DisplayList(const DisplayList &) = delete;
+    DisplayList &operator=(const DisplayList &) = delete;
+
+    /**
+     * \brief Replay the recorded calls if they are still valid.
+     *
+     * \return \c false when nothing matching is recorded (or a referenced
+     *     image no longer exists), in which case the caller has to draw
+     *     and should record again.
+     */
+    bool replay(NVGcontext *ctx, uint64_t hash);
+
+    /// Start recording the backend calls; the previous recording is discarded
+    void begin(NVGcontext *ctx, uint64_t hash);
+
+    /// Stop recording
+    void end(NVGcontext *ctx);
+
+    /// Discard the recording
+    void clear();
+
+    /// Return the number of recorded backend calls
+    int commandCount() const;
+
+    /// Return the number of bytes used by the recording
+    size_t memoryUsage() const;
+
+    /// Globally enable or disable replaying (e.g. to measure its effect)
+    static void setEnabled(bool enabled);
+
+    /// Return whether replaying is enabled
+    static bool enabled();
+
+    /// Invalidate all recordings, e.g. after the values of a \ref Theme were changed in place
+    static void invalidateAll();
+
+    /// Storage of the recorded calls (opaque)
+    struct Recording;
+
+private:
+    std::unique_ptr<Recording> mRecording;
+};
+
+/// Prepare a NanoVG context so that \ref DisplayList instances can record and replay on it
+extern NANOGUI_EXPORT void nvgAttachDisplayLists(NVGcontext *ctx);
+
+/// Undo \ref nvgAttachDisplayLists (must be called before the context is deleted)
+extern NANOGUI_EXPORT void nvgDetachDisplayLists(NVGcontext *ctx);
+
+NAMESPACE_END(nanogui)
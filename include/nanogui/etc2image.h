@@ -0,0 +1,115 @@
+/*
+    nanogui/etc2image.h -- ETC2 / EAC compressed textures and KTX files
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <nanogui/opengl.h>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class ETC2Image etc2image.h nanogui/etc2image.h
+ *
+ * \brief An image compressed to ETC2, the texture format of OpenGL ES 3.
+ *
+ * ETC2 stores every 4x4 block of pixels in 8 bytes (RGB) or 16 bytes
+ * (RGBA, the alpha channel coded with EAC), a quarter or half of the
+ * memory of an RGBA8 texture. GPUs sample it directly, so compressed
+ * slides leave more of the Pi's small GPU memory for media.
+ *
+ * Images are compressed at publish time (see \ref SlideCanvas::flatten)
+ * and stored as KTX 1.1 files. The encoder picks, per block, the best of
+ * the individual, differential and planar modes; blocks are encoded on
+ * several threads, and the error of the candidate colors is evaluated with
+ * SIMD instructions where available. The decoder understands every ETC2
+ * mode, including the T and H modes written by other encoders.
+ *
+ * \ref upload uses \c glCompressedTexImage2D where the driver supports the
+ * format and falls back to uploading the decompressed pixels otherwise.
+ */
+class NANOGUI_EXPORT ETC2Image : public Object {
+public:
+    enum class Format {
+        RGB8,  ///< \c GL_COMPRESSED_RGB8_ETC2, 8 bytes per block
+        RGBA8  ///< \c GL_COMPRESSED_RGBA8_ETC2_EAC, 16 bytes per block
+    };
+
+    /**
+     * \brief Load a KTX file holding an ETC2 (or ETC1) image.
+     *
+     * Only the first mipmap level is kept.
+     *
+     * \throws std::runtime_error
+     *     If the file cannot be read or holds another format.
+     */
+    ETC2Image(const std::string &fileName);
+
+    /**
+     * \brief Compress RGBA8 pixels.
+     *
+     * \param rgba
+     *     <tt>4 * width * height</tt> bytes, top row first
+     *
+     * \param format
+     *     \ref Format::RGB8 ignores the alpha channel
+     *
+     * \param threadCount
+     *     Number of threads encoding blocks (0: one per hardware thread)
+     */
+    ETC2Image(const uint8_t *rgba, int width, int height, Format format,
+              int threadCount = 0);
+
+    /// Return whether the file starts with the KTX 1.1 identifier
+    static bool isKTX(const std::string &fileName);
+
+    /// Return whether any of the pixels is not fully opaque
+    static bool hasAlpha(const uint8_t *rgba, int width, int height);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    Format format() const { return mFormat; }
+
+    /// Return the OpenGL internal format of the blocks
+    GLenum internalFormat() const;
+
+    /// Return the compressed blocks, left to right and top to bottom
+    const std::vector<uint8_t> &data() const { return mData; }
+
+    /// Write the image to a KTX 1.1 file
+    void save(const std::string &fileName) const;
+
+    /// Decompress into <tt>4 * width * height</tt> bytes of RGBA8 (alpha 255 for RGB8)
+    void decode(uint8_t *rgba) const;
+
+    /**
+     * \brief Upload the image into the texture bound to \c GL_TEXTURE_2D.
+     *
+     * \return
+     *     The number of bytes of texture memory used: the size of the
+     *     blocks, or of the RGBA8 pixels if the driver does not support the
+     *     format.
+     */
+    size_t upload() const;
+
+    /// Return whether the driver of the current context lists \c internalFormat
+    static bool supported(GLenum internalFormat);
+
+protected:
+    int mWidth, mHeight;
+    Format mFormat;
+    std::vector<uint8_t> mData;
+};
+
+NAMESPACE_END(nanogui)
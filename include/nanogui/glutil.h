@@ -13,8 +13,18 @@
 #pragma once
 
 #include <nanogui/opengl.h>
+#include <nanogui/object.h>
 #include <Eigen/Geometry>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 namespace half_float { class half; }
@@ -42,6 +52,84 @@ template <> struct type_traits<double> { enum { type = GL_DOUBLE, integral = 0 }
 template <> struct type_traits<float> { enum { type = GL_FLOAT, integral = 0 }; };
 template <> struct type_traits<half_float::half> { enum { type = GL_HALF_FLOAT, integral = 0 }; };
 template <typename T> struct serialization_helper;
+
+/// Set the uniform at location \c id to a 4x4 matrix (float)
+template <typename T>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 4, 4> &mat) {
+    glUniformMatrix4fv(id, 1, GL_FALSE, mat.template cast<float>().data());
+}
+
+/// Set the uniform at location \c id to a 3x3 affine transform (float)
+template <typename T>
+void setUniformValue(GLint id, const Eigen::Transform<T, 3, 3> &affine) {
+    glUniformMatrix4fv(id, 1, GL_FALSE, affine.template cast<float>().data());
+}
+
+/// Set the uniform at location \c id to a 3x3 matrix (float)
+template <typename T>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 3, 3> &mat) {
+    glUniformMatrix3fv(id, 1, GL_FALSE, mat.template cast<float>().data());
+}
+
+/// Set the uniform at location \c id to a 2x2 affine transform (float)
+template <typename T>
+void setUniformValue(GLint id, const Eigen::Transform<T, 2, 2> &affine) {
+    glUniformMatrix3fv(id, 1, GL_FALSE, affine.template cast<float>().data());
+}
+
+/// Set the uniform at location \c id to a boolean value
+inline void setUniformValue(GLint id, bool value) {
+    glUniform1i(id, (int)value);
+}
+
+/// Set the uniform at location \c id to an integer value
+template <typename T, typename std::enable_if<type_traits<T>::integral == 1, int>::type = 0>
+void setUniformValue(GLint id, T value) {
+    glUniform1i(id, (int) value);
+}
+
+/// Set the uniform at location \c id to a floating point value
+template <typename T, typename std::enable_if<type_traits<T>::integral == 0, int>::type = 0>
+void setUniformValue(GLint id, T value) {
+    glUniform1f(id, (float) value);
+}
+
+/// Set the uniform at location \c id to a 2D vector (int)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 1, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 2, 1>  &v) {
+    glUniform2i(id, (int) v.x(), (int) v.y());
+}
+
+/// Set the uniform at location \c id to a 2D vector (float)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 0, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 2, 1>  &v) {
+    glUniform2f(id, (float) v.x(), (float) v.y());
+}
+
+/// Set the uniform at location \c id to a 3D vector (int)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 1, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 3, 1>  &v) {
+    glUniform3i(id, (int) v.x(), (int) v.y(), (int) v.z());
+}
+
+/// Set the uniform at location \c id to a 3D vector (float)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 0, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 3, 1>  &v) {
+    glUniform3f(id, (float) v.x(), (float) v.y(), (float) v.z());
+}
+
+/// Set the uniform at location \c id to a 4D vector (int)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 1, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 4, 1>  &v) {
+    glUniform4i(id, (int) v.x(), (int) v.y(), (int) v.z(), (int) v.w());
+}
+
+/// Set the uniform at location \c id to a 4D vector (float)
+template <typename T, typename std::enable_if<type_traits<T>::integral == 0, int>::type = 0>
+void setUniformValue(GLint id, const Eigen::Matrix<T, 4, 1>  &v) {
+    glUniform4f(id, (float) v.x(), (float) v.y(), (float) v.z(), (float) v.w());
+}
+
 NAMESPACE_END(detail)
 
 #endif // DOXYGEN_SHOULD_SKIP_THIS
@@ -52,6 +140,41 @@ class GLUniformBuffer;
 
 //  ----------------------------------------------------
 
+/**
+ * \class GLUniform glutil.h nanogui/glutil.h
+ *
+ * \brief A typed handle of a uniform of a \ref GLShader.
+ *
+ * Obtained once with \ref GLShader::uniformHandle; setting a value is then a
+ * single \c glUniform* call without any name lookup. Like
+ * \ref GLShader::setUniform, it applies to the program that is bound.
+ */
+template <typename T> class GLUniform {
+public:
+    /// Create a handle that refers to no uniform (setting it does nothing)
+    GLUniform() : mLocation(-1) { }
+
+    /// Create a handle of the uniform at \c location
+    explicit GLUniform(GLint location) : mLocation(location) { }
+
+    /// Return the location of the uniform (-1 if it does not exist)
+    GLint location() const { return mLocation; }
+
+    /// Return whether the handle refers to an active uniform
+    bool valid() const { return mLocation >= 0; }
+
+    /// Set the value of the uniform
+    void set(const T &value) const {
+        if (mLocation >= 0)
+            detail::setUniformValue(mLocation, value);
+    }
+
+private:
+    GLint mLocation;
+};
+
+//  ----------------------------------------------------
+
 /**
  * \class GLShader glutil.h nanogui/glutil.h
  *
@@ -78,12 +201,14 @@ public:
         GLuint compSize;///< The size (in bytes) of an individual element in this buffer.
         GLuint size;    ///< The total number of elements represented by this buffer.
         int version;    ///< The current version if this buffer.
+        size_t offset;  ///< The byte offset of the data in this buffer (see \ref GLShader::streamAttrib).
     };
 
     /// Create an unitialized OpenGL shader
     GLShader()
         : mVertexShader(0), mFragmentShader(0), mGeometryShader(0),
-          mProgramShader(0), mVertexArrayObject(0) { }
+          mProgramShader(0), mVertexArrayObject(0), mLoadedFromCache(false),
+          mSharedBindingGeneration(-1) { }
 
     /**
      * \brief Initialize the shader using the specified source strings.
@@ -130,6 +255,28 @@ public:
     /// Return the name of the shader
     const std::string &name() const { return mName; }
 
+    /// Return whether \ref init loaded the linked program from the program cache
+    bool loadedFromCache() const { return mLoadedFromCache; }
+
+    /**
+     * \brief Set the directory of the program cache (empty: disable caching).
+     *
+     * \ref init stores every program it links there (\c glGetProgramBinary)
+     * and reloads it on later runs instead of compiling. Entries are keyed
+     * by the sources, the definitions (\ref mDefinitions) and the driver,
+     * so editing a shader or updating the driver never loads a stale
+     * binary. A binary the driver rejects anyway is discarded and the
+     * program is compiled again. Without OpenGL 4.1 or
+     * \c ARB_get_program_binary, programs are always compiled.
+     *
+     * Defaults to \c $NANOGUI_SHADER_CACHE, or to \c nanogui/shaders in the
+     * user's cache directory.
+     */
+    static void setProgramCacheDirectory(const std::string &directory);
+
+    /// Return the directory of the program cache (empty: caching is disabled)
+    static std::string programCacheDirectory();
+
     /**
      * Set a preprocessor definition.  Custom preprocessor definitions must be
      * added **before** initializing the shader (e.g., via \ref initFromFiles).
@@ -146,12 +293,35 @@ public:
     /// Release underlying OpenGL objects
     void free();
 
-    /// Return the handle of a named shader attribute (-1 if it does not exist)
+    /// An active uniform or attribute of the linked program
+    struct Variable {
+        GLint location; ///< The location (-1 for uniforms in a uniform block).
+        GLenum type;    ///< The OpenGL type, e.g. ``GL_FLOAT_VEC3``.
+        GLint size;     ///< The number of array elements (1 if not an array).
+    };
+
+    /**
+     * \brief Return the handle of a named shader attribute (-1 if it does not exist)
+     *
+     * The active attributes and uniforms are looked up once when the program
+     * is linked, so this and \ref uniform are a hash table lookup.
+     */
     GLint attrib(const std::string &name, bool warn = true) const;
 
     /// Return the handle of a uniform attribute (-1 if it does not exist)
     GLint uniform(const std::string &name, bool warn = true) const;
 
+    /// Return a typed handle that sets the uniform \c name without looking it up again
+    template <typename T> GLUniform<T> uniformHandle(const std::string &name, bool warn = true) const {
+        return GLUniform<T>(uniform(name, warn));
+    }
+
+    /// Return the active uniforms of the linked program (arrays are listed with and without ``[0]``)
+    const std::unordered_map<std::string, Variable> &uniforms() const { return mUniforms; }
+
+    /// Return the active attributes of the linked program
+    const std::unordered_map<std::string, Variable> &attributes() const { return mAttributes; }
+
     /// Upload an Eigen matrix as a vertex buffer object (refreshing it as needed)
     template <typename Matrix> void uploadAttrib(const std::string &name, const Matrix &M, int version = -1) {
         uint32_t compSize = sizeof(typename Matrix::Scalar);
@@ -182,6 +352,49 @@ public:
         uploadAttrib("indices", M, version);
     }
 
+    /**
+     * \brief Stream an Eigen matrix into a vertex buffer object.
+     *
+     * Meant for data that changes every frame. Rather than reallocating the
+     * buffer like \ref uploadAttrib, the data is written to the next free
+     * segment of a ring buffer a few times larger than the data. Fences track
+     * which segments the GPU may still read, so the upload never waits for
+     * earlier draw calls; if the GPU falls behind, the ring is replaced by a
+     * fresh buffer instead.
+     *
+     * The position of the data within the buffer changes with every call,
+     * so streamed attributes should not be shared with \ref shareAttrib.
+     */
+    template <typename Matrix> void streamAttrib(const std::string &name, const Matrix &M, int version = -1) {
+        uint32_t compSize = sizeof(typename Matrix::Scalar);
+        GLuint glType = (GLuint) detail::type_traits<typename Matrix::Scalar>::type;
+        bool integral = (bool) detail::type_traits<typename Matrix::Scalar>::integral;
+
+        streamAttrib(name, (uint32_t) M.size(), (int) M.rows(), compSize,
+                     glType, integral, M.data(), version);
+    }
+
+    /// Stream an index buffer (see \ref streamAttrib)
+    template <typename Matrix> void streamIndices(const Matrix &M, int version = -1) {
+        streamAttrib("indices", M, version);
+    }
+
+    /**
+     * \brief Replace the columns of an attribute starting at column \c offset.
+     *
+     * The size of the attribute does not change. Uploaded attributes are
+     * updated in place. Streamed attributes move to a new ring segment; the
+     * GPU copies the unchanged columns, so only \c M is transferred.
+     */
+    template <typename Matrix> void updateAttrib(const std::string &name, const Matrix &M, uint32_t offset) {
+        uint32_t compSize = sizeof(typename Matrix::Scalar);
+        GLuint glType = (GLuint) detail::type_traits<typename Matrix::Scalar>::type;
+        bool integral = (bool) detail::type_traits<typename Matrix::Scalar>::integral;
+
+        updateAttrib(name, (size_t) offset * (size_t) M.rows(), (uint32_t) M.size(),
+                     (int) M.rows(), compSize, glType, integral, M.data());
+    }
+
     /// Invalidate the version numbers associated with attribute data
     void invalidateAttribs();
 
@@ -223,78 +436,78 @@ public:
     /// Initialize a uniform parameter with a 4x4 matrix (float)
     template <typename T>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 4, 4> &mat, bool warn = true) {
-        glUniformMatrix4fv(uniform(name, warn), 1, GL_FALSE, mat.template cast<float>().data());
+        detail::setUniformValue(uniform(name, warn), mat);
     }
 
     /// Initialize a uniform parameter with a 3x3 affine transform (float)
     template <typename T>
     void setUniform(const std::string &name, const Eigen::Transform<T, 3, 3> &affine, bool warn = true) {
-        glUniformMatrix4fv(uniform(name, warn), 1, GL_FALSE, affine.template cast<float>().data());
+        detail::setUniformValue(uniform(name, warn), affine);
     }
 
     /// Initialize a uniform parameter with a 3x3 matrix (float)
     template <typename T>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 3, 3> &mat, bool warn = true) {
-        glUniformMatrix3fv(uniform(name, warn), 1, GL_FALSE, mat.template cast<float>().data());
+        detail::setUniformValue(uniform(name, warn), mat);
     }
 
     /// Initialize a uniform parameter with a 2x2 affine transform (float)
     template <typename T>
     void setUniform(const std::string &name, const Eigen::Transform<T, 2, 2> &affine, bool warn = true) {
-        glUniformMatrix3fv(uniform(name, warn), 1, GL_FALSE, affine.template cast<float>().data());
+        detail::setUniformValue(uniform(name, warn), affine);
     }
 
     /// Initialize a uniform parameter with a boolean value
     void setUniform(const std::string &name, bool value, bool warn = true) {
-        glUniform1i(uniform(name, warn), (int)value);
+        detail::setUniformValue(uniform(name, warn), value);
     }
 
     /// Initialize a uniform parameter with an integer value
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 1, int>::type = 0>
     void setUniform(const std::string &name, T value, bool warn = true) {
-        glUniform1i(uniform(name, warn), (int) value);
+        detail::setUniformValue(uniform(name, warn), value);
     }
 
     /// Initialize a uniform parameter with a floating point value
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 0, int>::type = 0>
     void setUniform(const std::string &name, T value, bool warn = true) {
-        glUniform1f(uniform(name, warn), (float) value);
+        detail::setUniformValue(uniform(name, warn), value);
     }
 
     /// Initialize a uniform parameter with a 2D vector (int)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 1, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 2, 1>  &v, bool warn = true) {
-        glUniform2i(uniform(name, warn), (int) v.x(), (int) v.y());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform parameter with a 2D vector (float)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 0, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 2, 1>  &v, bool warn = true) {
-        glUniform2f(uniform(name, warn), (float) v.x(), (float) v.y());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform parameter with a 3D vector (int)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 1, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 3, 1>  &v, bool warn = true) {
-        glUniform3i(uniform(name, warn), (int) v.x(), (int) v.y(), (int) v.z());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform parameter with a 3D vector (float)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 0, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 3, 1>  &v, bool warn = true) {
-        glUniform3f(uniform(name, warn), (float) v.x(), (float) v.y(), (float) v.z());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform parameter with a 4D vector (int)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 1, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 4, 1>  &v, bool warn = true) {
-        glUniform4i(uniform(name, warn), (int) v.x(), (int) v.y(), (int) v.z(), (int) v.w());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform parameter with a 4D vector (float)
     template <typename T, typename std::enable_if<detail::type_traits<T>::integral == 0, int>::type = 0>
     void setUniform(const std::string &name, const Eigen::Matrix<T, 4, 1>  &v, bool warn = true) {
-        glUniform4f(uniform(name, warn), (float) v.x(), (float) v.y(), (float) v.z(), (float) v.w());
+        detail::setUniformValue(uniform(name, warn), v);
     }
 
     /// Initialize a uniform buffer with a uniform buffer object
@@ -353,6 +566,34 @@ public:
                        const void *data, int version = -1);
     void downloadAttrib(const std::string &name, size_t size, int dim,
                        uint32_t compSize, GLuint glType, void *data);
+    void streamAttrib(const std::string &name, size_t size, int dim,
+                      uint32_t compSize, GLuint glType, bool integral,
+                      const void *data, int version = -1);
+    void updateAttrib(const std::string &name, size_t offset, size_t size, int dim,
+                      uint32_t compSize, GLuint glType, bool integral, const void *data);
+
+protected:
+    /// The ring buffer bookkeeping of a streamed attribute
+    struct StreamRing {
+        /// A part of the ring that draw calls issued before \c fence may read
+        struct Segment {
+            size_t begin, end;
+            GLsync fence;
+        };
+
+        size_t capacity = 0;        ///< The size of the buffer in bytes.
+        size_t head = 0;            ///< Where the next segment starts.
+        std::deque<Segment> busy;   ///< Earlier segments the GPU may still read.
+    };
+
+    /// Look up the active uniforms, uniform blocks and attributes of \ref mProgramShader
+    void reflect();
+
+    /// Bind the uniform blocks that have a shared binding point by now (see \ref GLUniformBuffer::bindShared)
+    void bindSharedBlocks();
+
+    /// Find room for \c bytes in the ring of \c name; may replace \c buffer.id by a new buffer (\c retired)
+    size_t allocateStreamSegment(const std::string &name, Buffer &buffer, size_t bytes, GLuint &retired);
 
 protected:
     /// The registered name of this GLShader.
@@ -373,12 +614,30 @@ protected:
     /// The vertex array associated with this GLShader (as returned by ``glGenVertexArrays``).
     GLuint mVertexArrayObject;
 
+    /// Whether \ref mProgramShader was loaded from the program cache (no shader objects exist then).
+    bool mLoadedFromCache;
+
     /**
      * The map of string names to buffer objects representing the various
      * attributes that have been uploaded using \ref uploadAttrib.
      */
     std::map<std::string, Buffer> mBufferObjects;
 
+    /// The active uniforms of \ref mProgramShader by name.
+    std::unordered_map<std::string, Variable> mUniforms;
+
+    /// The active attributes of \ref mProgramShader by name.
+    std::unordered_map<std::string, Variable> mAttributes;
+
+    /// The indices of the active uniform blocks of \ref mProgramShader by name.
+    std::unordered_map<std::string, GLuint> mUniformBlocks;
+
+    /// Number of shared binding points that existed when \ref bindSharedBlocks last ran.
+    int mSharedBindingGeneration;
+
+    /// The ring buffers of the attributes that have been streamed using \ref streamAttrib.
+    std::map<std::string, StreamRing> mStreamRings;
+
     /**
      * \rst
      * The map of preprocessor names to values (if any have been created).  If
@@ -401,7 +660,7 @@ protected:
 class NANOGUI_EXPORT GLUniformBuffer {
 public:
     /// Default constructor: unusable until you call the ``init()`` method
-    GLUniformBuffer() : mID(0), mBindingPoint(0) { }
+    GLUniformBuffer() : mID(0), mBindingPoint(0), mSize(0) { }
 
     /// Create a new uniform buffer
     void init();
@@ -415,14 +674,46 @@ public:
     /// Release/unbind the uniform buffer
     void release();
 
-    /// Update content on the GPU using data
+    /**
+     * \brief Bind the uniform buffer to the binding point shared by all
+     * uniform blocks named \c blockName (see \ref sharedBindingPoint).
+     */
+    void bindShared(const std::string &blockName) { bind(sharedBindingPoint(blockName)); }
+
+    /// Update content on the GPU using data (the storage is only reallocated if the size changes)
     void update(const std::vector<uint8_t> &data);
 
+    /// Allocate \c size bytes of uninitialized storage
+    void allocate(size_t size);
+
+    /// Overwrite \c size bytes at \c offset without reallocating the storage
+    void update(size_t offset, const void *data, size_t size);
+
     /// Return the binding point of this uniform buffer
     int getBindingPoint() const { return mBindingPoint; }
+
+    /// Return the size of the storage in bytes
+    size_t size() const { return mSize; }
+
+    /**
+     * \brief Return the binding point reserved for uniform blocks named \c blockName.
+     *
+     * A \ref GLShader binds a uniform block of that name to this point in
+     * \ref GLShader::bind once the point exists, so a buffer bound with
+     * \ref bindShared once is seen by every shader that declares the block.
+     * Blocks no buffer is shared for keep their binding, so they can still
+     * be bound by hand. The points are handed out from the top
+     * of the range (\c GL_MAX_UNIFORM_BUFFER_BINDINGS) to stay clear of
+     * points chosen by hand.
+     *
+     * \throws std::runtime_error
+     *     If all binding points are taken.
+     */
+    static int sharedBindingPoint(const std::string &blockName);
 private:
     GLuint mID;
     int mBindingPoint;
+    size_t mSize;
 };
 
 //  ----------------------------------------------------
@@ -475,6 +766,394 @@ public:
 
 //  ----------------------------------------------------
 
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+NAMESPACE_BEGIN(detail)
+
+constexpr size_t std140_align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/// Size, base alignment and encoding of a type in the std140 layout
+template <typename T> struct std140_traits;
+
+template <typename T> struct std140_scalar_traits {
+    enum : size_t { size = 4, alignment = 4 };
+    static void write(uint8_t *dst, T value) { memcpy(dst, &value, 4); }
+};
+
+template <> struct std140_traits<float> : std140_scalar_traits<float> { };
+template <> struct std140_traits<int32_t> : std140_scalar_traits<int32_t> { };
+template <> struct std140_traits<uint32_t> : std140_scalar_traits<uint32_t> { };
+
+/* Vectors, and column major matrices whose columns are padded to a vec4 */
+template <typename S, int R, int C, int O, int MR, int MC>
+struct std140_traits<Eigen::Matrix<S, R, C, O, MR, MC>> {
+    static_assert(sizeof(S) == 4 && R >= 1 && R <= 4 && C >= 1 && C <= 4,
+                  "std140: unsupported vector or matrix type");
+    enum : size_t {
+        size = C == 1 ? (size_t) R * 4 : (size_t) C * 16,
+        alignment = C == 1 ? (R == 1 ? 4 : (R == 2 ? 8 : 16)) : 16
+    };
+    static void write(uint8_t *dst, const Eigen::Matrix<S, R, C, O, MR, MC> &value) {
+        memset(dst, 0, size);
+        for (int c = 0; c < C; ++c)
+            for (int r = 0; r < R; ++r)
+                memcpy(dst + c * 16 + r * 4, &value.coeffRef(r, c), 4);
+    }
+};
+
+/* Arrays, whose elements are padded to a vec4 */
+template <typename T, size_t N> struct std140_traits<std::array<T, N>> {
+    enum : size_t {
+        stride = (size_t) std140_align(std140_traits<T>::size, 16),
+        size = stride * N,
+        alignment = 16
+    };
+    static void write(uint8_t *dst, const std::array<T, N> &value) {
+        memset(dst, 0, size);
+        for (size_t i = 0; i < N; ++i)
+            std140_traits<T>::write(dst + i * stride, value[i]);
+    }
+};
+
+/// Offset of field I, given that the preceding fields end at 'End'
+template <size_t End, size_t I, typename... Fields> struct std140_offset;
+
+template <size_t End, size_t I, typename F, typename... Rest>
+struct std140_offset<End, I, F, Rest...>
+    : std140_offset<std140_align(End, std140_traits<F>::alignment) + std140_traits<F>::size,
+                    I - 1, Rest...> { };
+
+template <size_t End, typename F, typename... Rest>
+struct std140_offset<End, 0, F, Rest...> {
+    enum : size_t { value = std140_align(End, std140_traits<F>::alignment) };
+};
+
+/// End of the last field, given that the preceding fields end at 'End'
+template <size_t End, typename... Fields> struct std140_end {
+    enum : size_t { value = End };
+};
+
+template <size_t End, typename F, typename... Rest>
+struct std140_end<End, F, Rest...>
+    : std140_end<std140_align(End, std140_traits<F>::alignment) + std140_traits<F>::size,
+                 Rest...> { };
+
+NAMESPACE_END(detail)
+
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+/**
+ * \struct Std140Layout glutil.h nanogui/glutil.h
+ *
+ * \brief Compile-time description of a uniform block in the 'std140' layout.
+ *
+ * The fields are listed in the order of the block's declaration. Supported
+ * field types are \c float, \c int32_t, \c uint32_t, Eigen vectors and
+ * matrices of these with up to four rows and columns, and \c std::array of
+ * any of them. Offsets and padding are computed by the compiler:
+ *
+ * \code
+ * // uniform Lights { mat4 view; vec3 direction; float intensity; vec4 colors[8]; };
+ * using LightsLayout = Std140Layout<Matrix4f, Vector3f, float, std::array<Vector4f, 8>>;
+ * static_assert(LightsLayout::offset<2>() == 76, "");
+ * \endcode
+ */
+template <typename... Fields> struct Std140Layout {
+    /// The type of field \c I
+    template <size_t I> using Field = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+    /// Return the number of fields
+    static constexpr size_t fieldCount() { return sizeof...(Fields); }
+
+    /// Return the byte offset of field \c I
+    template <size_t I> static constexpr size_t offset() {
+        return detail::std140_offset<0, I, Fields...>::value;
+    }
+
+    /// Return the size of field \c I in bytes, including the padding of array elements
+    template <size_t I> static constexpr size_t fieldSize() {
+        return detail::std140_traits<Field<I>>::size;
+    }
+
+    /// Return the size of the block in bytes
+    static constexpr size_t size() {
+        return detail::std140_align(detail::std140_end<0, Fields...>::value, 16);
+    }
+};
+
+/**
+ * \class UniformBlockStd140 glutil.h nanogui/glutil.h
+ *
+ * \brief A uniform buffer holding one block described by a \ref Std140Layout.
+ *
+ * \ref set writes a field into a CPU copy of the block at its precomputed
+ * offset; fields whose bytes do not change are not marked. \ref upload then
+ * transfers the range spanning the changed fields with \c glBufferSubData,
+ * leaving the storage in place.
+ */
+template <typename Layout> class UniformBlockStd140 {
+public:
+    /// Default constructor: unusable until you call the ``init()`` method
+    UniformBlockStd140() : mDirtyBegin(0), mDirtyEnd(Layout::size()) {
+        memset(mData, 0, sizeof(mData));
+    }
+
+    /// Create the uniform buffer; the whole block is uploaded by the next \ref upload
+    void init() {
+        mBuffer.init();
+        mBuffer.allocate(Layout::size());
+        mDirtyBegin = 0;
+        mDirtyEnd = Layout::size();
+    }
+
+    /// Release underlying OpenGL object
+    void free() { mBuffer.free(); }
+
+    /// Set field \c I
+    template <size_t I> void set(const typename Layout::template Field<I> &value) {
+        const size_t offset = Layout::template offset<I>(), size = Layout::template fieldSize<I>();
+        uint8_t encoded[size];
+        detail::std140_traits<typename Layout::template Field<I>>::write(encoded, value);
+        if (memcmp(mData + offset, encoded, size) == 0)
+            return;
+        memcpy(mData + offset, encoded, size);
+        mDirtyBegin = std::min(mDirtyBegin, offset);
+        mDirtyEnd = std::max(mDirtyEnd, offset + size);
+    }
+
+    /// Upload the fields changed since the last call
+    void upload() {
+        if (mDirtyEnd <= mDirtyBegin)
+            return;
+        mBuffer.update(mDirtyBegin, mData + mDirtyBegin, mDirtyEnd - mDirtyBegin);
+        mDirtyBegin = Layout::size();
+        mDirtyEnd = 0;
+    }
+
+    /// Return whether fields changed since the last \ref upload
+    bool dirty() const { return mDirtyEnd > mDirtyBegin; }
+
+    /// Return the encoded block
+    const uint8_t *data() const { return mData; }
+
+    /// Return the underlying uniform buffer (e.g. to bind it)
+    GLUniformBuffer &buffer() { return mBuffer; }
+
+    /// Return the underlying uniform buffer
+    const GLUniformBuffer &buffer() const { return mBuffer; }
+
+private:
+    GLUniformBuffer mBuffer;
+    uint8_t mData[Layout::size()];
+    size_t mDirtyBegin, mDirtyEnd;
+};
+
+//  ----------------------------------------------------
+
+/**
+ * \class GLReadback glutil.h nanogui/glutil.h
+ *
+ * \brief Reads framebuffer contents back without stalling the pipeline.
+ *
+ * \ref read issues \c glReadPixels into a pixel buffer object, which returns
+ * immediately, and places a fence behind it. \ref poll checks the fences;
+ * once the GPU has finished a transfer, the buffer is mapped and handed to
+ * a worker thread, which copies the pixels out (flipping the rows), runs
+ * the completion (e.g. encoding and writing a file) and fulfills the
+ * returned future. A later \ref poll unmaps the buffer for reuse, so the
+ * render thread never copies pixels itself.
+ *
+ * Transfers that cannot complete (the fence wait fails or times out, the
+ * buffer cannot be mapped, or the instance is destroyed first) reach the
+ * completion with an \ref Image::error; the returned futures hold a
+ * \c std::runtime_error instead.
+ *
+ * \ref Screen polls all readbacks of its context once per frame, so a
+ * readback completes a frame or two after it was requested. All methods
+ * except the destructor must be called with the OpenGL context that
+ * created the instance current. The destructor may run anywhere: the
+ * buffers it cannot delete are deleted by the next \ref pollCurrentContext
+ * of that context.
+ */
+class NANOGUI_EXPORT GLReadback : public Object {
+public:
+    /// Pixels of a finished readback: BGRA8, top row first
+    struct Image {
+        Vector2i size;
+        std::vector<uint8_t> pixels;
+        /// Why the transfer failed (empty: the pixels are valid)
+        std::string error;
+    };
+
+    /// Work done on the worker thread once the pixels have arrived
+    typedef std::function<void(Image &image)> Completion;
+
+    GLReadback();
+
+    /**
+     * \brief Start reading a rectangle of a framebuffer.
+     *
+     * \param framebuffer
+     *     Framebuffer object to read from (0: the window's back buffer)
+     *
+     * \param size, offset
+     *     Rectangle to read, in pixels from the lower left corner
+     */
+    std::future<Image> read(GLuint framebuffer, const Vector2i &size,
+                            const Vector2i &offset = Vector2i::Zero());
+
+    /// Like \ref read, but write a TGA (32bpp BGRA) file on the worker thread
+    std::future<bool> readTGA(GLuint framebuffer, const Vector2i &size,
+                              const std::string &filename);
+
+    /// Like \ref read, but run \c completion on the worker thread
+    void read(GLuint framebuffer, const Vector2i &size, const Vector2i &offset,
+              const Completion &completion);
+
+    /// Hand finished transfers to the worker thread (\c wait: block until all are done)
+    void poll(bool wait = false);
+
+    /// Return the number of transfers which have not completed on the GPU yet
+    int pending() const { return (int) mPending.size(); }
+
+    /// Finish all pending transfers and release the pixel buffer objects
+    void free();
+
+    /**
+     * \brief Poll all instances that were created with the current OpenGL
+     * context, and delete the buffers left behind by destroyed ones.
+     */
+    static void pollCurrentContext();
+
+    /// Write a TGA (32bpp BGRA) file; the rows of \c image are stored top row first
+    static void writeTGA(const std::string &filename, const Image &image);
+
+protected:
+    virtual ~GLReadback();
+
+    struct Transfer {
+        GLuint buffer;
+        size_t capacity;
+        GLsync fence;
+        Vector2i size;
+        Completion completion;
+    };
+
+    /// A mapped buffer the worker thread is copying out of
+    struct Mapping {
+        GLuint buffer;
+        size_t capacity;
+        std::shared_future<void> copied;
+    };
+
+    /// Unmap the buffers the worker is done with (\c wait: wait for all of them)
+    void unmapCopied(bool wait);
+
+    GLFWwindow *mContext;
+    std::deque<Transfer> mPending;
+    std::deque<Mapping> mMapped;
+    /// Pixel buffer objects that are not in use, with their capacity in bytes
+    std::vector<std::pair<GLuint, size_t>> mBuffers;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+//  ----------------------------------------------------
+
+/**
+ * \class GLTextureUploader glutil.h nanogui/glutil.h
+ *
+ * \brief Uploads large textures over several frames without stalling.
+ *
+ * \ref upload queues decoded RGBA8 pixels for a texture. \ref process
+ * copies them in stripes of rows through a pair of pixel unpack buffers:
+ * while the GPU transfers one stripe from one buffer, the next stripe is
+ * written into the other. A buffer is only reused once the fence behind
+ * its transfer has signaled, so the render thread never waits for the
+ * driver; if neither buffer is free, the remaining stripes wait for the
+ * next frame. At most \ref frameBudget bytes are copied per call.
+ *
+ * \ref Screen owns an uploader and processes it at the start of every
+ * frame. All methods must be called with the OpenGL context that owns the
+ * textures current.
+ */
+class NANOGUI_EXPORT GLTextureUploader : public Object {
+public:
+    /// Called once the last stripe of a texture has been submitted
+    typedef std::function<void()> Completion;
+
+    GLTextureUploader(size_t frameBudget = 8u << 20);
+
+    /// Return the maximum number of bytes copied per call to \ref process
+    size_t frameBudget() const { return mFrameBudget; }
+
+    /// Set the maximum number of bytes copied per call to \ref process
+    void setFrameBudget(size_t frameBudget) { mFrameBudget = frameBudget; }
+
+    /**
+     * \brief Queue the pixels of a texture.
+     *
+     * The texture must already have storage of the given size (e.g. from
+     * \c glTexImage2D with a null pointer). \c rgba holds
+     * <tt>4 * size.prod()</tt> bytes, top row first like NanoVG images; it
+     * is kept (not copied) until the last stripe is written, so a decoder's
+     * buffer can be passed with its own deleter. \c completion runs on the
+     * calling thread from within \ref process, once draw calls issued
+     * afterwards are guaranteed to see the whole texture.
+     */
+    void upload(GLuint texture, const Vector2i &size, std::shared_ptr<const uint8_t> rgba,
+                const Completion &completion = Completion());
+
+    /// Drop the queued stripes of \c texture (e.g. before deleting it)
+    void cancel(GLuint texture);
+
+    /// Copy the next stripes, within the frame budget
+    void process();
+
+    /// Return the number of textures which are not completely submitted yet
+    int pending() const { return (int) mUploads.size(); }
+
+    /// Return the number of bytes still waiting to be copied
+    size_t pendingBytes() const;
+
+    /// Release the pixel unpack buffers and drop all queued uploads
+    void free();
+
+protected:
+    virtual ~GLTextureUploader();
+
+    struct Upload {
+        GLuint texture;
+        Vector2i size;
+        std::shared_ptr<const uint8_t> rgba;
+        /// First row that has not been submitted yet
+        int nextRow;
+        Completion completion;
+    };
+
+    struct StagingBuffer {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        /// Fence behind the last transfer out of the buffer (0: idle)
+        GLsync fence = 0;
+    };
+
+    /// Return whether \c buffer may be written (waits for nothing)
+    bool idle(StagingBuffer &buffer);
+
+    size_t mFrameBudget;
+    std::deque<Upload> mUploads;
+    StagingBuffer mStaging[2];
+    /// Buffer that receives the next stripe
+    int mNextStaging;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+//  ----------------------------------------------------
+
 /**
  * \class GLFramebuffer glutil.h nanogui/glutil.h
  *
@@ -508,10 +1187,19 @@ public:
 
     /// Quick and dirty method to write a TGA (32bpp RGBA) file of the framebuffer contents for debugging
     void downloadTGA(const std::string &filename);
+
+    /**
+     * \brief Write a TGA file of the framebuffer contents without stalling.
+     *
+     * The result is available a frame or two later, see \ref GLReadback.
+     * Multisampled framebuffers must be resolved (blitted) first.
+     */
+    std::future<bool> downloadTGAAsync(const std::string &filename);
 protected:
     GLuint mFramebuffer, mDepth, mColor;
     Vector2i mSize;
     int mSamples;
+    ref<GLReadback> mReadback;
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
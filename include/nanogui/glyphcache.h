@@ -0,0 +1,108 @@
+/*
+    nanogui/glyphcache.h -- Glyph prewarming for NanoVG fonts
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <map>
+#include <set>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class GlyphCache glyphcache.h nanogui/glyphcache.h
+ *
+ * \brief Rasterizes glyphs ahead of time, so that the first frame using a
+ * new font size does not stall.
+ *
+ * NanoVG rasterizes glyphs into its font atlas the first time they are
+ * drawn. A glyph cache collects the glyphs an application is going to need
+ * (declared with \ref addRange and \ref addText, or learned from the text
+ * layout cache with \ref learn), and \ref prewarm draws them into a frame
+ * that is discarded, so the rasterization happens at a convenient time.
+ *
+ * The font atlas itself is private to NanoVG and cannot be restored from
+ * disk. Instead, \ref save and \ref load persist the set of glyphs, which
+ * allows a later launch to prewarm everything the previous run displayed
+ * before its first frame.
+ *
+ * \ref prewarm must be called on the thread that owns the NanoVG context.
+ * It can be given a time budget to spread the work over several idle frames.
+ */
+class NANOGUI_EXPORT GlyphCache : public Object {
+public:
+    GlyphCache() { }
+
+    /// Request the codepoints <tt>[first, last]</tt> of a font at a given size
+    void addRange(const std::string &font, float size, uint32_t first, uint32_t last);
+
+    /// Request all codepoints of a UTF-8 string
+    void addText(const std::string &font, float size, const std::string &text);
+
+    /// Request every string currently in the text layout cache (see \ref nvgCachedTextBounds)
+    void learn();
+
+    /**
+     * \brief Rasterize requested glyphs that have not been rasterized yet.
+     *
+     * \param pixelRatio
+     *     Pixel ratio of the screen that will draw the text (see
+     *     \ref Screen::pixelRatio), since NanoVG rasterizes glyphs at their
+     *     size in device pixels
+     *
+     * \param timeBudget
+     *     Stop after roughly this many seconds (zero: no limit)
+     *
+     * \return
+     *     The number of glyphs that are still waiting to be rasterized
+     */
+    size_t prewarm(NVGcontext *ctx, float pixelRatio = 1.f, double timeBudget = 0.0);
+
+    /// Return the number of glyphs that are waiting for \ref prewarm
+    size_t pending() const;
+
+    /// Return the total number of requested glyphs
+    size_t size() const;
+
+    /**
+     * \brief Return the file that applications keep their glyph set in.
+     *
+     * That is \c $NANOGUI_GLYPH_CACHE if set, otherwise \c glyphs.cache in
+     * the per-user cache directory (see \ref userCacheDirectory), or an
+     * empty string if there is none.
+     */
+    static std::string defaultFileName();
+
+    /// Write all requested glyphs to a file, creating its directory if needed
+    void save(const std::string &filename) const;
+
+    /// Request the glyphs stored in a file (returns \c false if it cannot be read)
+    bool load(const std::string &filename);
+
+protected:
+    typedef std::pair<std::string, float> FontKey;
+
+    struct Glyphs {
+        std::set<uint32_t> codepoints;
+        /// Codepoints that have already been rasterized
+        std::set<uint32_t> warm;
+    };
+
+    virtual ~GlyphCache() { }
+
+protected:
+    std::map<FontKey, Glyphs> mGlyphs;
+    /// Context that \ref Glyphs::warm refers to
+    NVGcontext *mContext = nullptr;
+};
+
+NAMESPACE_END(nanogui)
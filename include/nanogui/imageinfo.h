@@ -0,0 +1,89 @@
+/*
+    nanogui/imageinfo.h -- Reads the size of an image file from its header,
+    without decoding it
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/common.h>
+#include <string>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \struct ImageInfo imageinfo.h nanogui/imageinfo.h
+ *
+ * \brief Dimensions, channel count and orientation of an image file.
+ *
+ * \ref probe reads just the headers: the markers in front of a JPEG frame
+ * header (including the EXIF orientation), the PNG chunks in front of the
+ * image data, the GIF screen descriptor and the KTX header of an
+ * \ref ETC2Image. That takes a few hundred bytes and microseconds per
+ * file, so items can be laid out and their textures allocated before the
+ * pixels are decoded, and directories of thousands of images can be
+ * listed with their sizes. Other formats \c stb_image
+ * understands (BMP, TGA, ...) are probed with \c stbi_info.
+ */
+struct NANOGUI_EXPORT ImageInfo {
+    enum class Format {
+        Unknown = 0,
+        JPEG,
+        PNG,
+        GIF,
+        /// ETC2 compressed KTX file, see \ref ETC2Image
+        KTX,
+        /// Another format \c stb_image can decode
+        Other
+    };
+
+    Format format = Format::Unknown;
+
+    /// Size of the stored pixels, as the decoders return them
+    int width = 0, height = 0;
+
+    /**
+     * Number of channels: 1 (gray), 2 (gray + alpha), 3 (RGB) or 4 (RGBA;
+     * also CMYK JPEG files and all GIF files, any frame of which may be
+     * transparent)
+     */
+    int channels = 0;
+
+    /**
+     * EXIF orientation, 1-8 (1: stored upright). The decoders ignore it;
+     * 5-8 are rotated by 90 degrees, see \ref orientedSize.
+     */
+    int orientation = 1;
+
+    /// Return whether the probe succeeded
+    bool valid() const { return width > 0 && height > 0; }
+
+    /// Return the size of the stored pixels
+    Vector2i size() const { return Vector2i(width, height); }
+
+    /// Return the size the image is meant to be viewed at, after applying the orientation
+    Vector2i orientedSize() const {
+        return orientation >= 5 ? Vector2i(height, width) : Vector2i(width, height);
+    }
+
+    /// Return the number of bytes of an RGBA texture of the full image
+    size_t textureBytes() const { return (size_t) width * height * 4; }
+
+    /**
+     * \brief Read the header of \c fileName.
+     *
+     * \return
+     *     \c false (and an \ref Format::Unknown \c info) if the file cannot
+     *     be read or its header is not recognized
+     */
+    static bool probe(const std::string &fileName, ImageInfo &info);
+};
+
+NAMESPACE_END(nanogui)
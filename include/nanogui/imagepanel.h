@@ -14,6 +14,8 @@
 #pragma once
 
 #include <nanogui/widget.h>
+#include <nanogui/thumbnailloader.h>
+#include <nanogui/textureatlas.h>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -21,16 +23,49 @@ NAMESPACE_BEGIN(nanogui)
  * \class ImagePanel imagepanel.h nanogui/imagepanel.h
  *
  * \brief Image panel widget which shows a number of square-shaped icons.
+ *
+ * Thumbnails added through \ref setImageFiles share a \ref TextureAtlas in
+ * which they are laid out in index order with the same spacing as on screen.
+ * Each visible row then needs a single fill per atlas page, and the shadows
+ * and borders of all thumbnails are drawn with one call each. The atlas only
+ * holds the visible rows and half a screen above and below; the slots of
+ * thumbnails that scroll out are reused, and they are decoded again (from
+ * the thumbnail cache, if enabled) when they come back.
  */
 class NANOGUI_EXPORT ImagePanel : public Widget {
 public:
     typedef std::vector<std::pair<int, std::string>> Images;
 public:
     ImagePanel(Widget *parent);
+    virtual ~ImagePanel();
 
-    void setImages(const Images &data) { mImages = data; }
+    void setImages(const Images &data);
     const Images& images() const { return mImages; }
 
+    /**
+     * \brief Populate the panel with image files without blocking.
+     *
+     * Thumbnails are decoded on worker threads by a \ref ThumbnailLoader
+     * (visible entries first) and copied into the panel's texture atlas a few
+     * per frame. Entries that are not loaded yet are drawn as placeholders,
+     * and their image handle in \ref images() is zero until then (\c -1 if
+     * decoding failed). Afterwards, it refers to the atlas page that holds
+     * the thumbnail, until the entry scrolls out of view and its atlas slot
+     * is reused.
+     */
+    void setImageFiles(const std::vector<std::string> &files);
+
+    /// Return whether thumbnails of visible entries are still being decoded
+    bool loading() const;
+
+    /// Return the directory used to cache thumbnails between runs (empty: disabled)
+    const std::string &thumbnailCacheDirectory() const { return mThumbnailCacheDirectory; }
+    /// Set the directory used to cache thumbnails between runs (applies to the next \ref setImageFiles call)
+    void setThumbnailCacheDirectory(const std::string &directory) { mThumbnailCacheDirectory = directory; }
+
+    /// Return the edge length of each thumbnail in pixels
+    int thumbSize() const { return mThumbSize; }
+
     std::function<void(int)> callback() const { return mCallback; }
     void setCallback(const std::function<void(int)> &callback) { mCallback = callback; }
 
@@ -41,8 +76,35 @@ public:
 protected:
     Vector2i gridSize() const;
     int indexForPosition(const Vector2i &p) const;
+    /// Return the first and last index that intersect the visible area (empty if y < x)
+    Vector2i visibleRange() const;
+    void releaseLoadedImages();
+    /// Copy thumbnails decoded by \ref mLoader into the atlas; \c range is the \ref visibleRange
+    void uploadThumbnails(NVGcontext *ctx, const Vector2i &range);
+    /// Return the atlas region holding the thumbnail of entry \c index (\c nullptr: none)
+    const TextureAtlas::Region *atlasRegion(int index) const;
+    /// Create the repeating tile used to draw the drop shadows of all thumbnails at once
+    void updateShadowImage(NVGcontext *ctx);
+    /// Delete the shadow tile from the context it was created in
+    void releaseShadowImage();
 protected:
     Images mImages;
+    ref<ThumbnailLoader> mLoader;
+    std::string mThumbnailCacheDirectory;
+    /// Atlas holding the thumbnails decoded by \ref mLoader
+    ref<TextureAtlas> mAtlas;
+    /// Atlas regions that hold the thumbnails near the visible range (empty for \ref setImages)
+    std::vector<TextureAtlas::Region> mSlots;
+    /// Entry of \ref mImages held by each slot (-1: none)
+    std::vector<int> mSlotOwners;
+    /// Whether each entry is queued in \ref mLoader or being decoded
+    std::vector<bool> mRequested;
+    /// Set when the atlas contents are stale and must be cleared in the next \ref draw
+    bool mResetAtlas;
+    /// Context \ref mShadowImage was created in
+    NVGcontext *mShadowContext;
+    int mShadowImage;
+    int mShadowStride;
     std::function<void(int)> mCallback;
     int mThumbSize;
     int mSpacing;
@@ -0,0 +1,116 @@
+/*
+    nanogui/jpegimage.h -- JPEG decoding at reduced scales (1/2, 1/4, 1/8)
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class JPEGImage jpegimage.h nanogui/jpegimage.h
+ *
+ * \brief Decodes JPEG files directly at 1/2, 1/4 or 1/8 of their size.
+ *
+ * A photo shown in a small box does not need every pixel decoded. Like
+ * libjpeg's \c scale_denom, the decoder transforms each 8x8 block of
+ * coefficients straight into 4x4 samples at 1/2, 2x2 at 1/4 and a single
+ * sample (the DC coefficient) at 1/8; the result equals the box-filtered
+ * full-size image. Subsampled chroma is transformed to the output
+ * resolution as well, so reduced scales need no upsampling pass. The
+ * entropy decoding is unchanged, but the transforms, color conversion and
+ * memory shrink with the square of the scale.
+ *
+ * Baseline and progressive Huffman-coded files with one (grayscale) or
+ * three (YCbCr or RGB) components are supported. Everything else (CMYK,
+ * arithmetic coding, 12 bit, lossless) throws, and callers fall back to
+ * \c stb_image; so do images that cannot be reduced, see \ref loadScaled.
+ */
+class NANOGUI_EXPORT JPEGImage : public Object {
+public:
+    /**
+     * \brief Read a JPEG file and parse its frame header.
+     *
+     * \throws std::runtime_error
+     *     If the file cannot be read, is not a JPEG file or uses a coding
+     *     process the decoder does not support.
+     */
+    JPEGImage(const std::string &fileName);
+
+    /// Return whether the file starts with a JPEG start-of-image marker
+    static bool isJPEG(const std::string &fileName);
+
+    /// Return the width of the full-size image
+    int width() const { return mWidth; }
+
+    /// Return the height of the full-size image
+    int height() const { return mHeight; }
+
+    /// Return the number of color components (1 or 3)
+    int components() const { return mComponents; }
+
+    /// Return whether the file is progressive
+    bool progressive() const { return mProgressive; }
+
+    /// Return the size of one dimension at 1/\c scale, rounded up like libjpeg
+    static int scaledSize(int size, int scale) { return (size + scale - 1) / scale; }
+
+    /**
+     * \brief Return the largest scale denominator (1, 2, 4 or 8) at which
+     * the image still covers <tt>minWidth x minHeight</tt> pixels.
+     */
+    int scaleFor(int minWidth, int minHeight) const { return scaleFor(mWidth, mHeight, minWidth, minHeight); }
+
+    /// Like \ref scaleFor, for an image of <tt>width x height</tt> (e.g. from \ref ImageInfo::probe)
+    static int scaleFor(int width, int height, int minWidth, int minHeight);
+
+    /**
+     * \brief Decode the image at 1/\c scale of its size.
+     *
+     * \param scale
+     *     1, 2, 4 or 8
+     *
+     * \param rgba
+     *     Receives <tt>4 * width * height</tt> bytes, top row first
+     *
+     * \throws std::runtime_error
+     *     If the compressed data is malformed.
+     */
+    void decode(int scale, std::vector<uint8_t> &rgba, int &width, int &height) const;
+
+    /**
+     * \brief Decode a JPEG file at the smallest scale that still covers
+     * <tt>minWidth x minHeight</tt> pixels.
+     *
+     * \return
+     *     \c false if the file is not a JPEG file the decoder supports or
+     *     cannot be reduced at all; callers decode the full image as
+     *     before in that case.
+     */
+    static bool loadScaled(const std::string &fileName, int minWidth, int minHeight,
+                           std::vector<uint8_t> &rgba, int &width, int &height);
+
+protected:
+    /// Parse the markers up to the frame header
+    void parseHeader();
+
+protected:
+    std::string mFileName;
+    std::vector<uint8_t> mData;
+    int mWidth, mHeight;
+    int mComponents;
+    bool mProgressive;
+};
+
+NAMESPACE_END(nanogui)
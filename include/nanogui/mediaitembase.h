@@ -18,6 +18,7 @@
 
 #include <nanogui/widget.h>
 #include <nanogui/slidecanvasbase.h>
+#include <nanogui/textureregistry.h>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -35,6 +36,7 @@ class NANOGUI_EXPORT MediaItemBase : public Widget {
 
 public:
 	MediaItemBase(Widget *parent);
+	~MediaItemBase();
 
     /// Return the panel used to house window buttons
     //Widget *buttonPanel(); //idk if this is necessary
@@ -63,6 +65,30 @@ public:
 	//The properties panel controls for the media item
 	virtual Widget *initPropertiesPanel(Window *parent) = 0;
 
+    /// Type name stored in slide documents, used to recreate the item when loading
+    virtual std::string itemType() const = 0;
+
+    /// Free images etc. while the context they were created in still exists
+    virtual void releaseResources() { }
+
+    /**
+     * \brief Estimate the bytes the item allocates to draw itself at its
+     * current size (decoded pixels, rasterized text, ...).
+     *
+     * Used to budget how many slides are rendered at once. Items read the
+     * sizes they need from file headers rather than decoding anything.
+     */
+    virtual size_t estimateMemory() const { return 0; }
+
+    /// Return whether the item looks the same in every frame, so that publishing may flatten it
+    virtual bool isStatic() const { return true; }
+
+    /// How images are fitted into the item (stored in slide documents as 0-2)
+    enum class ImageMode { Crop = 0, Scale, Stretch };
+
+    /// Fitting of the images drawn by \ref drawFittedImage
+    ImageMode mImageMode;
+
 	//Item's rectangle on the canvas
     Vector2f mCanvasSize; //0-1 tuple, 0,0 is top left
     Vector2f mCanvasPos; //0-1 tuple, 0,0 is top left
@@ -78,6 +104,52 @@ protected:
     void drawHandles(NVGcontext *ctx);
     void drawSnaps(NVGcontext *ctx);
 
+    /// Fill the item with \c image, fitted as \ref mImageMode says
+    void drawFittedImage(NVGcontext *ctx, int image);
+
+    /// Like \ref drawFittedImage, but only shows the given region of \c image (e.g. an atlas cell)
+    void drawFittedImage(NVGcontext *ctx, int image, const Vector2i &regionOrigin,
+                         const Vector2i &regionSize);
+
+    /// Return the size \ref drawFittedImage scales an image of \c imageSize to (before clipping)
+    Vector2i fittedSize(const Vector2i &imageSize) const;
+
+    /// Write \ref mImageMode, for items that show images
+    void saveImageMode(Serializer &s) const;
+
+    /// Read \ref mImageMode (invalid values become \ref ImageMode::Scale)
+    bool loadImageMode(Serializer &s);
+
+    /**
+     * \brief Register \c image as owned by this item with the screen's
+     * \ref TextureRegistry, so that it is accounted for and may be evicted.
+     *
+     * \param bytes
+     *     Size of an image NanoVG did not allocate itself (0: recorded
+     *     when NanoVG created it)
+     */
+    void trackTexture(NVGcontext *ctx, int image, size_t bytes = 0);
+
+    /// Stop owning \c image, before releasing an image that is shared with other items
+    void untrackTexture(int image);
+
+    /**
+     * \brief Return \c path the way the document \c s writes it: files in
+     * the document's directory (or below it) are stored relative to it, so
+     * that the directory can be moved or copied to a player as a whole.
+     */
+    static std::string documentPath(const Serializer &s, const std::string &path);
+
+    /**
+     * \brief Resolve a path read from the document \c s against the
+     * document's directory. Paths relative to the working directory, as
+     * older documents store them, are kept if only they exist.
+     */
+    static std::string resolveDocumentPath(const Serializer &s, const std::string &path);
+
+    /// Registry the images of this item are recorded in (\c nullptr: none)
+    ref<TextureRegistry> mTextureRegistry;
+
     bool mDrag;
 
     //Size of drag handles on canvas
@@ -28,8 +28,28 @@
 #include <nanogui/entypo.h>
 #include <nanogui/messagedialog.h>
 #include <nanogui/textbox.h>
+#include <nanogui/textvalidator.h>
 #include <nanogui/slider.h>
 #include <nanogui/imagepanel.h>
+#include <nanogui/thumbnailloader.h>
+#include <nanogui/workerpool.h>
+#include <nanogui/textureatlas.h>
+#include <nanogui/renderstats.h>
+#include <nanogui/textcache.h>
+#include <nanogui/glyphcache.h>
+#include <nanogui/contextgroup.h>
+#include <nanogui/displaylist.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/capturering.h>
+#include <nanogui/videodecoder.h>
+#include <nanogui/slidevideo.h>
+#include <nanogui/animatedimage.h>
+#include <nanogui/slideanimation.h>
+#include <nanogui/slidetext.h>
+#include <nanogui/etc2image.h>
+#include <nanogui/textureregistry.h>
+#include <nanogui/jpegimage.h>
+#include <nanogui/imageinfo.h>
 #include <nanogui/imageview.h>
 #include <nanogui/vscrollpanel.h>
 #include <nanogui/colorwheel.h>
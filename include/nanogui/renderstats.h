@@ -0,0 +1,50 @@
+/*
+    nanogui/renderstats.h -- Per-frame counters for the NanoVG render backend
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/opengl.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \struct RenderStats renderstats.h nanogui/renderstats.h
+ *
+ * \brief Work submitted to the NanoVG backend during one frame.
+ *
+ * Every backend call turns into at least one OpenGL draw call, so the sum
+ * of the counters is a lower bound on the number of draw calls of a frame.
+ */
+struct RenderStats {
+    /// Number of \c nvgFill() calls that reached the backend
+    int fillCalls = 0;
+    /// Number of \c nvgStroke() calls that reached the backend
+    int strokeCalls = 0;
+    /// Number of triangle batches (one per \c nvgText() call)
+    int triangleCalls = 0;
+    /// CPU time spent producing the frame in seconds (excluding the buffer swap)
+    double frameTime = 0.0;
+
+    /// Total number of backend calls
+    int drawCalls() const { return fillCalls + strokeCalls + triangleCalls; }
+};
+
+/// Start counting the backend calls issued by a NanoVG context
+extern NANOGUI_EXPORT void nvgAttachRenderStats(NVGcontext *ctx);
+
+/// Stop counting (must be called before the context is deleted)
+extern NANOGUI_EXPORT void nvgDetachRenderStats(NVGcontext *ctx);
+
+/// Return the counters accumulated since the last call and reset them
+extern NANOGUI_EXPORT RenderStats nvgTakeRenderStats(NVGcontext *ctx);
+
+NAMESPACE_END(nanogui)
@@ -15,6 +15,16 @@
 #pragma once
 
 #include <nanogui/widget.h>
+#include <nanogui/renderstats.h>
+#include <nanogui/contextgroup.h>
+#include <nanogui/capturering.h>
+#include <nanogui/textureregistry.h>
+#include <nanogui/workerpool.h>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -76,12 +86,18 @@ public:
      *     for a forward compatible core OpenGL 4.1 profile.  Requesting an
      *     invalid profile will result in no context (and therefore no GUI)
      *     being created.
+     *
+     * \param contextGroup
+     *     Optional group of screens whose OpenGL contexts share textures (see
+     *     \ref ContextGroup). Media that is shown on several displays is then
+     *     decoded and uploaded only once.
      */
     Screen(const Vector2i &size, const std::string &caption,
            bool resizable = true, bool fullscreen = false, int colorBits = 8,
            int alphaBits = 8, int depthBits = 24, int stencilBits = 8,
            int nSamples = 0,
-           unsigned int glMajor = 3, unsigned int glMinor = 1);
+           unsigned int glMajor = 3, unsigned int glMinor = 1,
+           ContextGroup *contextGroup = nullptr);
 
     /// Release all resources
     virtual ~Screen();
@@ -138,6 +154,114 @@ public:
     /// Return a pointer to the underlying nanoVG draw context
     NVGcontext *nvgContext() { return mNVGContext; }
 
+    /// Return the group sharing OpenGL textures with this screen (or \c nullptr)
+    ContextGroup *contextGroup() { return mContextGroup; }
+
+    /**
+     * \brief Record proof-of-play captures of this screen (\c nullptr: stop).
+     *
+     * \ref drawAll hands every frame to the ring, which captures it when
+     * its interval has elapsed or the slide has changed (see
+     * \ref CaptureRing::slideChanged).
+     */
+    void setCaptureRing(CaptureRing *ring);
+
+    /// Return the ring receiving proof-of-play captures (or \c nullptr)
+    CaptureRing *captureRing() { return mCaptureRing; }
+
+    /**
+     * \brief Return the uploader that streams large textures into this
+     * screen's context.
+     *
+     * \ref drawAll processes it at the start of every frame and keeps
+     * drawing frames while uploads are pending.
+     */
+    GLTextureUploader *textureUploader() { return mTextureUploader; }
+
+    /// Return the threads that media items of this screen decode their files on
+    WorkerPool *workerPool() { return mWorkerPool; }
+
+    /**
+     * \brief Return the registry accounting for the texture memory of this
+     * screen's context.
+     *
+     * \ref drawAll starts a registry frame before drawing and enforces the
+     * budget (see \ref TextureRegistry::setBudget) after drawing.
+     */
+    TextureRegistry *textureRegistry() { return mTextureRegistry; }
+
+    /// Return whether the debug overlay (frame time, texture memory) is drawn
+    bool debugHUD() const { return mDebugHUD; }
+
+    /// Set whether the debug overlay (frame time, texture memory) is drawn
+    void setDebugHUD(bool debugHUD) { mDebugHUD = debugHUD; redraw(); }
+
+    /// Return the backend calls and CPU time of the last frame drawn by \ref drawAll
+    const RenderStats &renderStats() const { return mRenderStats; }
+
+    /**
+     * \brief Return the frame clock: the time (\c glfwGetTime()) at which
+     * \ref drawAll started the frame being drawn.
+     *
+     * Animated widgets such as \ref SlideVideo use it so that everything in
+     * a frame shows the same instant.
+     */
+    double frameTime() const { return mFrameTime; }
+
+    /// Draw another frame soon, also when nothing else would trigger one (e.g. during playback)
+    void requestFrame();
+
+    /**
+     * \brief Lock the widget hierarchy of this screen.
+     *
+     * Event dispatch and \ref drawAll hold this lock. Any other thread that
+     * modifies widgets of this screen (e.g. a player advancing a slide while
+     * the screen renders on its own thread) must hold it as well:
+     * <tt>{ auto lock = screen->lockWidgets(); label->setCaption("..."); }</tt>
+     */
+    std::unique_lock<std::recursive_mutex> lockWidgets() {
+        return std::unique_lock<std::recursive_mutex>(mWidgetMutex);
+    }
+
+    /**
+     * \brief Render and present this screen on a dedicated thread.
+     *
+     * The OpenGL context is released by the calling thread and made current
+     * on the render thread, which calls \ref drawAll whenever \ref redraw is
+     * invoked. Blocking in ``glfwSwapBuffers`` then no longer delays other
+     * screens or event processing, which stays on the main thread. Started by
+     * \ref mainloop when parallel rendering is requested.
+     */
+    void startRenderThread();
+
+    /// Stop the render thread and make the context current on the calling thread again
+    void stopRenderThread();
+
+    /// Return whether this screen is rendered on its own thread
+    bool renderThreadActive() const { return mRenderThread.joinable(); }
+
+    /// Ask the render thread to draw a new frame (requests are coalesced)
+    void redraw();
+
+    /**
+     * \brief Run OpenGL code with the context of this screen current.
+     *
+     * While a render thread is active (see \ref startRenderThread), the
+     * context is only current there, so e.g. initializing a \ref GLShader
+     * in an event handler must go through this function. The task is queued
+     * and runs on the render thread before its next frame. Without a render
+     * thread, it runs right away on the calling thread.
+     *
+     * Do not wait for the returned future while holding \ref lockWidgets
+     * (which includes event handlers): the render thread may be waiting for
+     * that lock to draw.
+     *
+     * \return
+     *     A future that becomes ready (or receives the exception thrown by
+     *     \c task) once the task has run
+     */
+    std::future<void> runOnRenderThread(const std::function<void()> &task);
+
     void setShutdownGLFWOnDestruct(bool v) { mShutdownGLFWOnDestruct = v; }
     bool shutdownGLFWOnDestruct() { return mShutdownGLFWOnDestruct; }
 
@@ -184,6 +308,10 @@ public:
     void moveWindowToFront(Window *window);
     void drawWidgets();
 
+protected:
+    void renderThread();
+    void drawDebugHUD();
+
 protected:
     GLFWwindow *mGLFWWindow;
     NVGcontext *mNVGContext;
@@ -203,6 +331,24 @@ protected:
     bool mShutdownGLFWOnDestruct;
     bool mFullscreen;
     std::function<void(Vector2i)> mResizeCallback;
+    RenderStats mRenderStats;
+    double mFrameTime;
+    ref<ContextGroup> mContextGroup;
+    ref<CaptureRing> mCaptureRing;
+    ref<GLTextureUploader> mTextureUploader;
+    ref<WorkerPool> mWorkerPool;
+    ref<TextureRegistry> mTextureRegistry;
+    bool mDebugHUD;
+    /// Replaced rings, whose OpenGL resources are released by the next frame
+    std::vector<ref<CaptureRing>> mRetiredCaptureRings;
+    std::recursive_mutex mWidgetMutex;
+    std::thread mRenderThread;
+    std::thread::id mRenderThreadId;
+    std::mutex mRenderMutex;
+    std::condition_variable mRenderCondition;
+    bool mRedraw, mStopRendering;
+    /// Tasks queued by \ref runOnRenderThread
+    std::vector<std::pair<std::function<void()>, std::shared_ptr<std::promise<void>>>> mRenderTasks;
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
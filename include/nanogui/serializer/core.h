@@ -70,6 +70,9 @@ public:
     /// Check whether a file contains serialized data
     static bool isSerializedFile(const std::string &filename);
 
+    /// Return the path of the file being read or written
+    const std::string &filename() const { return mFilename; }
+
     /// Return the current size of the output file
     size_t size();
 
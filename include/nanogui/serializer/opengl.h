@@ -45,11 +45,12 @@ struct serialization_helper<GLShader> {
 
                 if (item.first == "indices") {
                     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buf.id);
-                    glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, totalSize,
+                    glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr) buf.offset, totalSize,
                                        temp.data());
                 } else {
                     glBindBuffer(GL_ARRAY_BUFFER, buf.id);
-                    glGetBufferSubData(GL_ARRAY_BUFFER, 0, totalSize, temp.data());
+                    glGetBufferSubData(GL_ARRAY_BUFFER, (GLintptr) buf.offset, totalSize,
+                                       temp.data());
                 }
                 s.set("data", temp);
                 s.pop();
@@ -74,6 +75,8 @@ struct serialization_helper<GLShader> {
             }
             value->bind();
             for (auto key : keys) {
+                if (value->mStreamRings.find(key) != value->mStreamRings.end())
+                    value->freeAttrib(key);
                 if (value->mBufferObjects.find(key) == value->mBufferObjects.end()) {
                     GLuint bufferID;
                     glGenBuffers(1, &bufferID);
@@ -90,6 +93,7 @@ struct serialization_helper<GLShader> {
                 s.get("version", buf.version);
                 s.get("data", data);
                 s.pop();
+                buf.offset = 0;
 
                 size_t totalSize = (size_t) buf.size * (size_t) buf.compSize;
                 if (key == "indices") {
@@ -0,0 +1,145 @@
+/*
+    nanogui/slideanimation.h -- Animated GIF or PNG on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/mediaitembase.h>
+#include <nanogui/animatedimage.h>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class SlideAnimation slideanimation.h nanogui/slideanimation.h
+ *
+ * \brief Plays an animated GIF or APNG on the slide, must be placed on a
+ * slidecanvas.
+ *
+ * Frames are composited once, scaled down to the size the item is shown
+ * at and packed into a single atlas texture; playback then only selects a
+ * cell of the atlas. The atlas is built on a worker thread, so the item
+ * plays from a sliding window until it is ready: frames are composited
+ * as they come due and only the frame on screen is kept as a texture.
+ * Animations whose frames do not fit into one atlas keep the sliding
+ * window.
+ *
+ * Frame delays follow the frame clock of the parent screen
+ * (\ref Screen::frameTime). Without a parent screen (slides rendered
+ * offscreen) the first frame is shown.
+ */
+class NANOGUI_EXPORT SlideAnimation : public MediaItemBase {
+public:
+    SlideAnimation(Widget *parent, const std::string &fileName);
+    ~SlideAnimation();
+
+    /// Draw the current frame
+    virtual void draw(NVGcontext *ctx) override;
+
+    virtual void save(Serializer &s) const override;
+    virtual bool load(Serializer &s) override;
+
+    virtual Widget *initPropertiesPanel(Window *parent) override;
+
+    virtual std::string itemType() const override { return "animation"; }
+
+    virtual bool isStatic() const override { return false; }
+
+    /// Return the path of the GIF or PNG file
+    const std::string &fileName() const { return mFileName; }
+
+    /// Return whether the frames are cached in an atlas (otherwise in a sliding window)
+    bool cached() const { return mAtlas > 0; }
+
+    virtual void releaseResources() override;
+
+    /// The composited canvases of the animation plus, at most, a full atlas
+    virtual size_t estimateMemory() const override;
+
+    /// Largest atlas width and height (the Raspberry Pi's GPU supports 2048)
+    static const int maxAtlasSize = 2048;
+
+protected:
+    void drawAnimation(NVGcontext *ctx);
+
+    /// Scale of the cached frames relative to the file, from the item's size on screen
+    float targetScale(float pixelRatio) const;
+
+    /// Atlas pixels composited on the worker thread
+    struct Atlas {
+        std::vector<uint8_t> pixels;
+        Vector2i size = Vector2i(0, 0);
+        int columns = 0;
+    };
+
+    /**
+     * \brief Set up the sliding window for \c scale and, if the frames
+     * fit, start building the atlas on the \ref WorkerPool of \c screen
+     * (without a screen only the first frame is shown, from the window).
+     */
+    void buildCache(NVGcontext *ctx, Screen *screen, float scale);
+
+    /// Upload the atlas once the worker has finished it
+    void collectCache(NVGcontext *ctx);
+
+    /// Stop building the atlas; the worker gives up after the frame it is compositing
+    void cancelCache();
+
+    /**
+     * \brief Composite every frame of \c fileName into an atlas of
+     * \c columns cells of \c cellSize (runs on the worker thread).
+     *
+     * \return
+     *     An empty atlas if the file cannot be read or \c cancel was set
+     */
+    static Atlas composeAtlas(const std::string &fileName, const Vector2i &cellSize,
+                              int columns, int rows, const std::atomic<bool> &cancel);
+
+    /// Scale the canvas of \c animation down to \c cellSize
+    static void scaleFrame(const AnimatedImage &animation, const Vector2i &cellSize,
+                           std::vector<uint8_t> &cell);
+
+    /// Composite up to frame \c index and upload it (sliding window)
+    void showFrame(NVGcontext *ctx, int index);
+
+    void releaseTextures();
+
+    std::string mFileName;
+    ref<AnimatedImage> mAnimation;
+    bool mOpenError;
+
+    NVGcontext *mTextureContext;
+    float mScale;
+    Vector2i mCellSize;
+    /// Atlas holding every frame (0: sliding window)
+    int mAtlas;
+    int mAtlasColumns;
+    /// Sliding window: two textures, so that the one on screen is not the one updated
+    int mWindowTextures[2];
+    int mWindowIndex;
+    /// Sliding window: frame in mWindowTextures[mWindowIndex] (-1: none)
+    int mWindowFrame;
+    std::vector<uint8_t> mCell;
+
+    /// Atlas being built for mCellSize (invalid: none)
+    std::future<Atlas> mBuild;
+    std::shared_ptr<std::atomic<bool>> mCancelBuild;
+
+    /// Frame clock time of the first frame (negative: not started)
+    double mStartTime;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+NAMESPACE_END(nanogui)
@@ -17,6 +17,8 @@
 
 NAMESPACE_BEGIN(nanogui)
 
+class SoftwareRenderer;
+
 /**
  * \class SlideCanvas slidecanvas.h slidecanvas/window.h
  *
@@ -50,9 +52,46 @@ public:
     virtual Vector2i preferredSize(NVGcontext *ctx) const override;
     /// Invoke the associated layout generator to properly place child widgets, if any
     virtual void performLayout(NVGcontext *ctx) override;
+    /// Store the slide's media items
     virtual void save(Serializer &s) const override;
+    /// Replace the slide's media items with the stored ones
     virtual bool load(Serializer &s) override;
 
+    /**
+     * \brief Place the slide area at the origin with \c resolution pixels
+     * and lay the media items out for it.
+     *
+     * Used to render a slide outside of the editor, see \ref drawSlide.
+     */
+    void layoutSlide(const Vector2i &resolution);
+
+    /// Draw only the slide area (no editor chrome) as placed by \ref layoutSlide
+    void drawSlide(NVGcontext *ctx);
+
+    /// Free the images etc. held by the media items while \c ctx still exists
+    void releaseResources();
+
+    /**
+     * \brief Flatten the static media items into one image (publish step).
+     *
+     * The static items below the first dynamic one (see
+     * \ref MediaItemBase::isStatic) are rendered with \c renderer at its
+     * resolution and written to \c imageFileName as a TGA file, or as an
+     * ETC2 compressed KTX file if the name ends in \c .ktx (see
+     * \ref ETC2Image). They are then replaced by a single full-slide
+     * \ref SlideImage showing that file, so that a player draws one
+     * texture plus the live items. Saved next to \c imageFileName, the
+     * slide refers to the image by a path relative to itself (see
+     * \ref MediaItemBase::documentPath).
+     * Items above a dynamic item stay live to keep their stacking order.
+     *
+     * Like \ref layoutSlide, this places the slide area at the origin.
+     *
+     * \return
+     *     The number of items that were flattened
+     */
+    int flatten(SoftwareRenderer *renderer, const std::string &imageFileName);
+
     //TODO: Generalize with MediaItem base class
     //virtual void ImageItemUpdate(SlideImage *image) override;
     //virtual void ImageLostFocus(SlideImage *image) override;
@@ -64,6 +103,8 @@ public:
 protected:
     /// Internal helper function to maintain nested window position values; overridden in \ref Popup
     virtual void refreshRelativePlacement();
+    /// Draw the media items clipped to the slide area
+    void drawItems(NVGcontext *ctx);
 protected:
     //Screen ratio width/height of the target screen resolution
     float windowRatio;
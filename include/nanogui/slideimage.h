@@ -17,9 +17,14 @@
 #include <nanogui/mediaitembase.h>
 #include <nanogui/vscrollpanel.h>
 #include <nanogui/textbox.h>
+#include <nanogui/contextgroup.h>
+#include <nanogui/glutil.h>
+#include <nanogui/imageinfo.h>
 
 // Includes for the GLTexture class.
 #include <cstdint>
+#include <atomic>
+#include <future>
 #include <memory>
 #include <utility>
 
@@ -47,13 +52,89 @@ public:
 
 	virtual Widget *initPropertiesPanel(Window *parent) override;
 
-    //TODO: Enum
-    int mImageMode; //0=Crop, 1=Scale, 2=Stretch
+    virtual std::string itemType() const override { return "image"; }
+
+    /// Return the path of the image file
+    const std::string &fileName() const { return mFileName; }
+
+    virtual void releaseResources() override;
+
+    /// Pixels of the decoded image, at the reduced size a JPEG file is decoded at offscreen
+    virtual size_t estimateMemory() const override;
+
+    /// Return the size and format read from the header of the file (invalid if it could not be probed)
+    const ImageInfo &imageInfo() const { return mImageInfo; }
+
+    /// Return whether the image is loaded and its texture is complete
+    bool ready() const { return mImageHandle > 0 && (!mUploaded || *mUploaded); }
 
 protected:
     void drawImage(NVGcontext *ctx);
 
+    /// Fill the area the image will take with a placeholder until its texture is complete
+    void drawPlaceholder(NVGcontext *ctx);
+
+    /// Pixels decoded on a worker thread
+    struct Decoded {
+        int width = 0, height = 0;
+        std::shared_ptr<const uint8_t> rgba;
+        /// Whether a JPEG file was decoded at a reduced scale
+        bool reduced = false;
+    };
+
+    /**
+     * \brief Return the number of pixels the image is drawn on.
+     *
+     * JPEG files are decoded at the smallest scale (see \ref JPEGImage)
+     * that still covers it.
+     */
+    Vector2i targetSize(const Screen *screen) const;
+
+    /**
+     * \brief Predict the size the file decodes to for \ref targetSize
+     * \c target, from its header (0x0 if unknown).
+     */
+    Vector2i decodedSize(const Vector2i &target) const;
+
+    /**
+     * \brief Decode the file on the screen's \ref WorkerPool, then hand it
+     * to the screen's \ref GLTextureUploader.
+     *
+     * When the size is known from the header, the texture is allocated
+     * (and accounted for) right away. Returns \c false while decoding;
+     * afterwards \ref mImageHandle is set (or 0 if the file could not be
+     * loaded).
+     */
+    bool streamImage(NVGcontext *ctx, Screen *screen);
+
+    /// Allocate an empty texture for \ref streamImage, in \ref mUploadTexture
+    int createStreamTexture(NVGcontext *ctx, const Vector2i &size);
+
+    /**
+     * \brief Load a KTX file written by \ref SlideCanvas::flatten.
+     *
+     * The blocks need no decoding and are a fraction of the size of the
+     * pixels, so they are uploaded right away rather than streamed.
+     *
+     * \throws std::runtime_error
+     *     If the file cannot be read or is not a valid KTX file.
+     */
+    int createCompressedImage(NVGcontext *ctx);
+
     int mImageHandle;
+    /// Set when \ref mImageHandle was obtained from the screen's context group
+    ref<ContextGroup> mImageGroup;
+    NVGcontext *mImageContext;
+    /// Set when the image was decoded at a reduced scale; it is decoded again once the item outgrows it
+    bool mImageReduced;
+
+    std::future<Decoded> mDecode;
+    /// Set to skip \ref mDecode if it has not started yet
+    std::shared_ptr<std::atomic<bool>> mCancelDecode;
+    /// Texture being streamed in, and the flag its upload sets when done
+    ref<GLTextureUploader> mUploader;
+    GLuint mUploadTexture;
+    std::shared_ptr<bool> mUploaded;
 
 	//Properties widgets
 	//TODO: Move size & position to base class
@@ -66,6 +147,8 @@ protected:
     float windowRatio;
 
     std::string mFileName;
+    /// Header of \ref mFileName, probed when the file is set
+    ImageInfo mImageInfo;
 	bool mFileLoadError;
 
     bool mIsXSnap;
@@ -0,0 +1,126 @@
+/*
+    nanogui/slidetext.h -- Text box on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/mediaitembase.h>
+#include <nanogui/textbox.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class SlideText slidetext.h nanogui/slidetext.h
+ *
+ * \brief Shows text on the slide, must be placed on a slidecanvas.
+ *
+ * The text is laid out and rasterized once, at the resolution the item is
+ * shown at, into a texture of the drawing context. Later frames draw that
+ * texture as a single quad until the text, its style or the size of the
+ * item change.
+ *
+ * Rasterization uses a \ref SoftwareRenderer per thread, so it neither
+ * interrupts the NanoVG frame being drawn nor depends on the kind of
+ * context (slides rendered offscreen work the same way).
+ *
+ * Font sizes are given for a 1080 pixel high slide and scale with the
+ * canvas.
+ */
+class NANOGUI_EXPORT SlideText : public MediaItemBase {
+public:
+    /// Horizontal placement of the lines in the box
+    enum class Alignment { Left, Center, Right };
+
+    /// Vertical placement of the text block in the box
+    enum class VerticalAlignment { Top, Middle, Bottom };
+
+    SlideText(Widget *parent, const std::string &text);
+    ~SlideText();
+
+    /// Draw the cached text
+    virtual void draw(NVGcontext *ctx) override;
+
+    virtual void save(Serializer &s) const override;
+    virtual bool load(Serializer &s) override;
+
+    virtual Widget *initPropertiesPanel(Window *parent) override;
+
+    virtual std::string itemType() const override { return "text"; }
+
+    virtual void releaseResources() override;
+
+    /// Pixels of the rasterized text, once in the renderer and once in the texture
+    virtual size_t estimateMemory() const override;
+
+    /// Return the text (UTF-8, '\\n' starts a new line)
+    const std::string &text() const { return mText; }
+    void setText(const std::string &text) { mText = text; }
+
+    /**
+     * \brief Return the font.
+     *
+     * Either the name of a theme font (\c "sans", \c "sans-bold") or the
+     * path of a TrueType file.
+     */
+    const std::string &font() const { return mFont; }
+    void setFont(const std::string &font) { mFont = font; }
+
+    /// Return the font size (for a 1080 pixel high slide)
+    float fontSize() const { return mFontSize; }
+    void setFontSize(float fontSize) { mFontSize = fontSize; }
+
+    const Color &color() const { return mColor; }
+    void setColor(const Color &color) { mColor = color; }
+
+    Alignment alignment() const { return mAlignment; }
+    void setAlignment(Alignment alignment) { mAlignment = alignment; }
+
+    VerticalAlignment verticalAlignment() const { return mVerticalAlignment; }
+    void setVerticalAlignment(VerticalAlignment alignment) { mVerticalAlignment = alignment; }
+
+    /// Return whether lines are broken at the box width
+    bool wordWrap() const { return mWordWrap; }
+    void setWordWrap(bool wordWrap) { mWordWrap = wordWrap; }
+
+    /// Return whether the font size shrinks until the text fits into the box
+    bool autoFit() const { return mAutoFit; }
+    void setAutoFit(bool autoFit) { mAutoFit = autoFit; }
+
+protected:
+    /// Lay out and rasterize the text into \ref mTexture
+    void rasterize(NVGcontext *ctx, const Vector2i &size, float scale);
+
+    std::string mText;
+    std::string mFont;
+    float mFontSize;
+    Color mColor;
+    Alignment mAlignment;
+    VerticalAlignment mVerticalAlignment;
+    bool mWordWrap;
+    bool mAutoFit;
+
+    /* Cached rasterization */
+    NVGcontext *mTextureContext;
+    int mTexture;
+    Vector2i mTextureSize;
+    /// Hash of everything the texture depends on
+    uint64_t mTextureHash;
+
+    //Properties widgets
+    Label *mTextLabel;
+    TextBox *mTextBox;
+    Label *mFontSizeLabel;
+    FloatBox<float> *mFontSizeBox;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+NAMESPACE_END(nanogui)
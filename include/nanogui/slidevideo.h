@@ -0,0 +1,105 @@
+/*
+    nanogui/slidevideo.h -- Motion-JPEG or image sequence clip on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/mediaitembase.h>
+#include <nanogui/videodecoder.h>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class SlideVideo slidevideo.h nanogui/slidevideo.h
+ *
+ * \brief Plays a clip on the slide, must be placed on a slidecanvas.
+ *
+ * The clip is decoded ahead of playback by a \ref VideoDecoder. Playback
+ * follows the frame clock of the parent screen (\ref Screen::frameTime),
+ * so a slow frame skips clip frames rather than slowing the clip down.
+ * Decoded frames are uploaded into a small ring of textures so that the
+ * texture being drawn is never the one being updated.
+ *
+ * Without a parent screen (slides rendered offscreen) the first frame is
+ * shown as a still image.
+ */
+class NANOGUI_EXPORT SlideVideo : public MediaItemBase {
+public:
+    SlideVideo(Widget *parent, const std::string &fileName);
+
+    /// Draw the current frame
+    virtual void draw(NVGcontext *ctx) override;
+
+    virtual void save(Serializer &s) const override;
+    virtual bool load(Serializer &s) override;
+
+    virtual Widget *initPropertiesPanel(Window *parent) override;
+
+    virtual std::string itemType() const override { return "video"; }
+
+    virtual bool isStatic() const override { return false; }
+
+    /// Return the path of the clip (an AVI file or a \c printf pattern)
+    const std::string &fileName() const { return mFileName; }
+
+    /// Return whether the clip starts over at the end
+    bool loop() const { return mLoop; }
+
+    /// Set whether the clip starts over at the end
+    void setLoop(bool loop);
+
+    /// Return the playback rate (0: the rate stored in the clip, 30 for image sequences)
+    double frameRate() const { return mFrameRate; }
+
+    /// Set the playback rate (0: the rate stored in the clip, 30 for image sequences)
+    void setFrameRate(double frameRate) { mFrameRate = frameRate; }
+
+    /// Return the number of frames skipped because decoding fell behind
+    int droppedFrames() const { return mDecoder ? mDecoder->droppedFrames() : 0; }
+
+    virtual void releaseResources() override;
+
+    /// The decoded frames held by the decoder and the item
+    virtual size_t estimateMemory() const override;
+
+protected:
+    void drawVideo(NVGcontext *ctx);
+
+    /// Upload \ref mFrame into the next texture of the ring
+    void uploadFrame(NVGcontext *ctx, int width, int height);
+
+    void releaseTextures();
+
+    static const int textureCount = 3;
+
+    std::string mFileName;
+    double mFrameRate;
+    bool mLoop;
+
+    ref<VideoDecoder> mDecoder;
+    bool mOpenError;
+
+    NVGcontext *mTextureContext;
+    int mTextures[textureCount];
+    /// Texture holding the frame on screen (-1: none yet)
+    int mTextureIndex;
+    int mTextureWidth, mTextureHeight;
+
+    /// Frame clock time of the first frame (negative: not started)
+    double mStartTime;
+    /// Pixels exchanged with the decoder
+    std::vector<uint8_t> mFrame;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,128 @@
+/*
+    nanogui/softwarerenderer.h -- NanoVG backend that rasterizes into an
+    RGBA8 buffer on the CPU
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <nanogui/opengl.h>
+#include <string>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class SoftwareRenderer softwarerenderer.h nanogui/softwarerenderer.h
+ *
+ * \brief Draws with NanoVG without any OpenGL context.
+ *
+ * The renderer owns a NanoVG context whose render backend rasterizes the
+ * tessellated paths, gradients, images and text into an RGBA8 buffer
+ * (top row first, premultiplied alpha). Widgets draw into it exactly as
+ * they draw into a \ref Screen, e.g. to produce slide previews on machines
+ * without a GPU.
+ *
+ * The backend mirrors the fragment shader and blending of NanoVG's GL3
+ * backend, so the output matches the OpenGL result up to rounding. The
+ * calls of a frame are collected until \ref endFrame and then rendered tile
+ * by tile by the calling thread and the helper threads of a
+ * \ref WorkerPool, which the renderer keeps across frames; solid spans are
+ * blended with SIMD instructions where available.
+ *
+ * \code
+ * ref<SoftwareRenderer> renderer = new SoftwareRenderer(1920, 1080);
+ * widget->setTheme(new Theme(renderer->context()));
+ * renderer->beginFrame(Color(0, 255));
+ * widget->draw(renderer->context());
+ * renderer->endFrame();
+ * renderer->writeTGA("preview.tga");
+ * \endcode
+ */
+class NANOGUI_EXPORT SoftwareRenderer : public Object {
+public:
+    /**
+     * \param width, height
+     *     Size of the pixel buffer
+     *
+     * \param flags
+     *     NanoVG creation flags (only \c NVG_ANTIALIAS is supported)
+     *
+     * \param threadCount
+     *     Number of threads rendering tiles (0: one per hardware thread)
+     */
+    SoftwareRenderer(int width, int height, int flags = NVG_ANTIALIAS,
+                     int threadCount = 0);
+
+    /// Return the NanoVG context drawing into the pixel buffer
+    NVGcontext *context() { return mContext; }
+
+    /// Return the size of the pixel buffer
+    const Vector2i &size() const { return mSize; }
+
+    /// Resize the pixel buffer (its contents become undefined)
+    void resize(const Vector2i &size);
+
+    /// Return the number of threads used to render tiles
+    int threadCount() const;
+
+    /// Set the number of threads used to render tiles (0: one per hardware thread)
+    void setThreadCount(int threadCount);
+
+    /// Return the edge length of the tiles the buffer is split into
+    int tileSize() const;
+
+    /// Set the edge length of the tiles the buffer is split into
+    void setTileSize(int tileSize);
+
+    /**
+     * \brief Clear the buffer and begin a NanoVG frame.
+     *
+     * The frame covers the buffer with <tt>size() / pixelRatio</tt>
+     * logical units, like \ref Screen does on high-DPI displays.
+     */
+    void beginFrame(const Color &background, float pixelRatio = 1.f);
+
+    /// Finish the NanoVG frame and rasterize everything drawn since \ref beginFrame
+    void endFrame();
+
+    /// Return the RGBA8 pixels (top row first, <tt>4 * width</tt> bytes per row)
+    const uint8_t *data() const { return mPixels.data(); }
+    uint8_t *data() { return mPixels.data(); }
+
+    /// Write the buffer into an uncompressed 32 bit TGA file
+    void writeTGA(const std::string &filename) const;
+
+    /// Return whether \c ctx was created by a \ref SoftwareRenderer
+    static bool isSoftwareContext(NVGcontext *ctx);
+
+    /**
+     * \brief Replace a sub-rectangle of an image of a software context.
+     *
+     * Counterpart of \c glTexSubImage2D, used by \ref TextureAtlas.
+     * \c rgba holds <tt>4 * w * h</tt> bytes.
+     */
+    static void updateImageRegion(NVGcontext *ctx, int image, int x, int y,
+                                  int w, int h, const uint8_t *rgba);
+
+protected:
+    virtual ~SoftwareRenderer();
+
+protected:
+    NVGcontext *mContext;
+    void *mBackend;
+    Vector2i mSize;
+    std::vector<uint8_t> mPixels;
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+NAMESPACE_END(nanogui)
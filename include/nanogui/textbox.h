@@ -17,6 +17,7 @@
 
 #include <nanogui/compat.h>
 #include <nanogui/widget.h>
+#include <nanogui/textvalidator.h>
 #include <sstream>
 
 NAMESPACE_BEGIN(nanogui)
@@ -65,8 +66,13 @@ public:
 
     /// Return the underlying regular expression specifying valid formats
     const std::string &format() const { return mFormat; }
-    /// Specify a regular expression specifying valid formats
-    void setFormat(const std::string &format) { mFormat = format; }
+    /// Specify a regular expression specifying valid formats (compiled into a \ref TextValidator)
+    void setFormat(const std::string &format);
+
+    /// Return the validator used to check the input (\c nullptr: everything is valid)
+    const TextValidator *validator() const { return mValidator.get(); }
+    /// Use a custom validator instead of the one derived from \ref format()
+    void setValidator(TextValidator *validator) { mValidator = validator; }
 
     /// Return the placeholder text to be displayed while the text box is empty.
     const std::string &placeholder() const { return mPlaceholder; }
@@ -94,7 +100,7 @@ public:
     virtual void save(Serializer &s) const override;
     virtual bool load(Serializer &s) override;
 protected:
-    bool checkFormat(const std::string& input,const std::string& format);
+    bool checkFormat(const std::string& input) const;
     bool copySelection();
     void pasteFromClipboard();
     bool deleteSelection();
@@ -119,6 +125,7 @@ protected:
     Alignment mAlignment;
     std::string mUnits;
     std::string mFormat;
+    ref<TextValidator> mValidator;
     int mUnitsImage;
     std::function<bool(const std::string& str)> mCallback;
     bool mValidFormat;
@@ -0,0 +1,102 @@
+/*
+    nanogui/textcache.h -- Shared cache for text measurements
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/**
+ * \file nanogui/textcache.h
+ *
+ * \brief Cached counterparts of the NanoVG text measurement functions.
+ *
+ * Widgets measure the same static strings in \ref Widget::preferredSize and
+ * \ref Widget::draw, frame after frame. The functions below remember the
+ * bounds and glyph positions of a string for a given font face, font size
+ * and alignment, in a least-recently-used cache shared by all widgets.
+ * Like NanoVG, which rasterizes fonts at the scale of the current transform
+ * times the device pixel ratio, the cache keeps separate entries per scale.
+ *
+ * Unlike their NanoVG counterparts, they take the font parameters as
+ * arguments and leave the font state of the context untouched. Strings are
+ * measured at the origin and translated to <tt>(x, y)</tt>, so results may
+ * differ from a direct measurement at a fractional position by less than a
+ * pixel. The cache is cleared when a \ref Theme is created or a widget tree
+ * switches to another theme, and can be cleared manually with
+ * \ref invalidateTextCache (e.g. after loading fonts under existing names).
+ */
+
+#pragma once
+
+#include <nanogui/opengl.h>
+#include <functional>
+
+NAMESPACE_BEGIN(nanogui)
+
+/// Hit and miss counts of the text layout cache
+struct TextCacheStats {
+    /// Number of lookups answered from the cache
+    size_t hits = 0;
+    /// Number of lookups that required measuring the string
+    size_t misses = 0;
+    /// Number of strings currently in the cache
+    size_t entries = 0;
+
+    /// Fraction of lookups answered from the cache
+    float hitRate() const { return hits + misses > 0 ? hits / (float) (hits + misses) : 0.f; }
+};
+
+/// Cached counterpart of \c nvgTextBounds()
+extern NANOGUI_EXPORT float nvgCachedTextBounds(NVGcontext *ctx, const std::string &font,
+                                                float size, int align, float x, float y,
+                                                const std::string &text,
+                                                float *bounds = nullptr);
+
+/// Cached counterpart of \c nvgTextBoxBounds()
+extern NANOGUI_EXPORT void nvgCachedTextBoxBounds(NVGcontext *ctx, const std::string &font,
+                                                  float size, int align, float x, float y,
+                                                  float breakRowWidth,
+                                                  const std::string &text, float *bounds);
+
+/**
+ * \brief Cached counterpart of \c nvgTextGlyphPositions().
+ *
+ * The \c str members of the returned positions point into \c text.
+ */
+extern NANOGUI_EXPORT int nvgCachedTextGlyphPositions(NVGcontext *ctx, const std::string &font,
+                                                      float size, int align, float x, float y,
+                                                      const std::string &text,
+                                                      NVGglyphPosition *positions,
+                                                      int maxPositions);
+
+/**
+ * \brief Record the device pixel ratio \c ctx draws at.
+ *
+ * NanoVG does not expose it, so whoever calls \c nvgBeginFrame reports it
+ * here (\ref Screen and \ref SoftwareRenderer do).
+ */
+extern NANOGUI_EXPORT void setTextCachePixelRatio(NVGcontext *ctx, float pixelRatio);
+
+/// Remove the strings measured with \c ctx, before the context is deleted
+extern NANOGUI_EXPORT void releaseTextCache(NVGcontext *ctx);
+
+/// Remove all strings from the text layout cache
+extern NANOGUI_EXPORT void invalidateTextCache();
+
+/// Set the maximum number of strings kept in the text layout cache (default: 4096)
+extern NANOGUI_EXPORT void setTextCacheCapacity(size_t capacity);
+
+/// Invoke \c callback with the font, size and string of every entry of the text layout cache
+extern NANOGUI_EXPORT void forEachCachedText(
+    const std::function<void(const std::string &font, float size, const std::string &text)> &callback);
+
+/// Return the hit and miss counts of the text layout cache
+extern NANOGUI_EXPORT TextCacheStats textCacheStats();
+
+/// Reset the hit and miss counts of the text layout cache
+extern NANOGUI_EXPORT void resetTextCacheStats();
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,141 @@
+/*
+    nanogui/textureatlas.h -- Shelf-packed texture atlas for small images
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <nanogui/opengl.h>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class TextureAtlas textureatlas.h nanogui/textureatlas.h
+ *
+ * \brief Packs many small RGBA images into a few large NanoVG images.
+ *
+ * Images are placed with a shelf packer: each page is divided into
+ * horizontal shelves whose height is set by the first image placed on them,
+ * and images go onto the first shelf that fits them snugly. Drawing many
+ * images from the same page does not require any texture switches, and
+ * images that sit on the same shelf with the same spacing as on screen can
+ * be drawn with a single fill (see \ref ImagePanel).
+ *
+ * All methods must be called on the thread that owns the NanoVG context.
+ */
+class NANOGUI_EXPORT TextureAtlas : public Object {
+public:
+    /// A sub-rectangle of an atlas page
+    struct Region {
+        /// The NanoVG image of the page (0 if the region is invalid)
+        int image = 0;
+        /// Top left corner of the image within the page (in pixels)
+        Vector2i pos = Vector2i::Zero();
+        /// Size of the image (in pixels)
+        Vector2i size = Vector2i::Zero();
+
+        bool valid() const { return image != 0; }
+    };
+
+    /**
+     * \param pageSize
+     *     Width and height of each atlas page in pixels
+     *
+     * \param padding
+     *     Number of transparent pixels kept between neighboring images. This
+     *     must be at least 1 to avoid filtering artifacts at image borders.
+     */
+    TextureAtlas(NVGcontext *ctx, int pageSize = 2048, int padding = 1);
+
+    /// Add an image and return its location (invalid if it is larger than a page)
+    Region add(int width, int height, const uint8_t *rgba);
+
+    /**
+     * \brief Reserve space for an image whose contents are not known yet.
+     *
+     * The region stays transparent until \ref update is called. Reserving
+     * equally sized regions in a fixed order places them side by side on
+     * the same shelf, which keeps neighbors on screen neighbors in the atlas.
+     */
+    Region reserve(int width, int height);
+
+    /// Replace the contents of a region (\c rgba holds <tt>4 * width * height</tt> bytes)
+    void update(const Region &region, const uint8_t *rgba);
+
+    /// Release all pages; previously returned regions become invalid
+    void clear();
+
+    /// Return the NanoVG context that owns the pages
+    NVGcontext *context() const { return mContext; }
+
+    /// Return the edge length of each page
+    int pageSize() const { return mPageSize; }
+
+    /// Return the number of pixels kept between neighboring images
+    int padding() const { return mPadding; }
+
+    /// Return the number of allocated pages
+    int pageCount() const { return (int) mPages.size(); }
+
+    /// Return the number of bytes of texture memory used by all pages
+    size_t memoryUsage() const { return mPages.size() * (size_t) mPageSize * mPageSize * 4; }
+
+    /**
+     * Create a paint which maps the given region onto the rectangle
+     * <tt>(x, y, w, h)</tt>. The paint can be used to fill any shape within
+     * that rectangle.
+     */
+    NVGpaint pattern(const Region &region, float x, float y, float w, float h,
+                     float alpha = 1.f) const;
+
+protected:
+    struct Shelf {
+        int y, height, x;
+    };
+
+    struct Page {
+        int image;
+        std::vector<Shelf> shelves;
+        int height;
+    };
+
+    virtual ~TextureAtlas();
+
+    bool allocate(Page &page, int width, int height, Vector2i &pos);
+
+protected:
+    NVGcontext *mContext;
+    int mPageSize;
+    int mPadding;
+    std::vector<Page> mPages;
+};
+
+/**
+ * \brief Return the size of an image icon.
+ *
+ * Same as ``nvgImageSize``; icons created by \ref nvgImageIcon are regular
+ * NanoVG images.
+ */
+extern NANOGUI_EXPORT void nvgImageIconSize(NVGcontext *ctx, int icon, int *w, int *h);
+
+/**
+ * \brief Counterpart of ``nvgImagePattern`` for image icons.
+ *
+ * Maps the icon onto the rectangle <tt>(x, y, w, h)</tt>. Icons created by
+ * \ref nvgImageIcon are drawn from the copy in the icon atlas of the
+ * context, any other image as with ``nvgImagePattern``.
+ */
+extern NANOGUI_EXPORT NVGpaint nvgImageIconPattern(NVGcontext *ctx, float x, float y,
+                                                   float w, float h, int icon,
+                                                   float alpha);
+
+NAMESPACE_END(nanogui)
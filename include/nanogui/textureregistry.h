@@ -0,0 +1,165 @@
+/*
+    nanogui/textureregistry.h -- Accounting and budget-driven eviction of
+    the NanoVG images of a context
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+class MediaItemBase;
+class Widget;
+
+/**
+ * \class TextureRegistry textureregistry.h nanogui/textureregistry.h
+ *
+ * \brief Keeps track of the texture memory of a NanoVG context.
+ *
+ * The registry hooks the texture callbacks of the NanoVG backend, so every
+ * image created or deleted through NanoVG is recorded with its size in
+ * bytes. Images wrapped around existing OpenGL textures do not pass through
+ * the backend and are recorded with \ref add.
+ *
+ * Media items register as the owners of their images and report every
+ * frame they are drawn in (\ref touch). When the images exceed the budget,
+ * \ref enforceBudget evicts the least recently drawn owners by calling
+ * \ref MediaItemBase::releaseResources; they load again when drawn. Owners
+ * drawn in the current frame, and owners inside the widgets passed to
+ * \ref setRetained (e.g. the slide shown next), are never evicted. Images
+ * without an owner (fonts, icons) are counted but never evicted. Items
+ * sharing an image (see \ref ContextGroup) are all its owners; it is
+ * freed once the last of them has released it.
+ *
+ * Each \ref Screen has a registry, see \ref Screen::textureRegistry.
+ * All methods are thread-safe.
+ */
+class NANOGUI_EXPORT TextureRegistry : public Object {
+    friend struct TextureRegistryHooks;
+public:
+    /// A recorded image
+    struct Texture {
+        int image;
+        size_t bytes;
+        /// Owning media items (empty: none)
+        std::vector<MediaItemBase *> owners;
+        /// Last frame one of the owners was drawn in
+        uint64_t lastUseFrame;
+    };
+
+    /// Start tracking the images of \c ctx created from now on
+    TextureRegistry(NVGcontext *ctx);
+
+    /**
+     * \brief Stop tracking (must be called before the context is deleted).
+     *
+     * Deletes the images left behind by destroyed owners, so the context
+     * must be current on the calling thread.
+     */
+    void detach();
+
+    /// Return the tracked context (\c nullptr after \ref detach)
+    NVGcontext *context() const { return mContext; }
+
+    /**
+     * \brief Record an image that NanoVG did not allocate (e.g.
+     * \c nvglCreateImageFromHandleGL3). Adding an image again only updates
+     * its size and keeps its owners.
+     */
+    void add(int image, size_t bytes);
+
+    /// Add \c owner to the items responsible for \c image
+    void setOwner(int image, MediaItemBase *owner);
+
+    /// Take \c image away from \c owner, e.g. before releasing a handle other items still use
+    void disown(int image, const MediaItemBase *owner);
+
+    /**
+     * \brief Forget an owner that is being destroyed.
+     *
+     * Images it still holds and no other owner does are deleted by the
+     * next \ref beginFrame, where the context is current.
+     */
+    void releaseOwner(MediaItemBase *owner);
+
+    /// Record that \c owner is drawn in the current frame
+    void touch(const MediaItemBase *owner);
+
+    /// Start a new frame and delete the images of released owners
+    void beginFrame();
+
+    /// Return the number of the current frame
+    uint64_t frame() const;
+
+    /// Return the texture memory budget in bytes (0: unlimited)
+    size_t budget() const;
+
+    /// Set the texture memory budget in bytes (0: unlimited)
+    void setBudget(size_t bytes);
+
+    /// Never evict owners inside these widgets, e.g. the current and the next slide
+    void setRetained(const std::vector<Widget *> &widgets);
+
+    /**
+     * \brief Evict owners until the images fit into the budget.
+     *
+     * Call after drawing a frame, with the context current.
+     *
+     * \return The number of bytes freed
+     */
+    size_t enforceBudget();
+
+    /// Return the number of bytes of all recorded images
+    size_t memoryUsage() const;
+
+    /// Return the number of bytes of images with an owner
+    size_t ownedMemoryUsage() const;
+
+    /// Return the number of recorded images
+    int textureCount() const;
+
+    /// Return how many owners were evicted so far
+    int evictionCount() const;
+
+    /// Return how many bytes evictions freed so far
+    size_t evictedBytes() const;
+
+    /// Return a snapshot of the recorded images
+    std::vector<Texture> textures() const;
+
+protected:
+    virtual ~TextureRegistry();
+
+    /// Whether \c owner is inside one of the retained widgets
+    bool retained(const MediaItemBase *owner) const;
+
+    void collectGarbage();
+
+protected:
+    mutable std::mutex mMutex;
+    NVGcontext *mContext;
+    std::map<int, Texture> mTextures;
+    std::map<const MediaItemBase *, uint64_t> mOwners;
+    std::vector<ref<Widget>> mRetained;
+    /// Images of released owners, deleted when the context is current
+    std::vector<int> mGarbage;
+    uint64_t mFrame;
+    size_t mBudget;
+    size_t mBytes;
+    int mEvictionCount;
+    size_t mEvictedBytes;
+};
+
+NAMESPACE_END(nanogui)
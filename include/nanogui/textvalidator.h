@@ -0,0 +1,139 @@
+/*
+    nanogui/textvalidator.h -- Input validators for TextBox
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <regex>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class TextValidator textvalidator.h nanogui/textvalidator.h
+ *
+ * \brief Decides whether the contents of a \ref TextBox are valid.
+ *
+ * \ref TextBox::setFormat turns its regular expression into a validator
+ * once, via \ref fromFormat, instead of compiling the expression for every
+ * check. Formats that are used throughout NanoGUI (integers, decimal
+ * numbers, <tt>"W x H"</tt> dimensions and <tt>"X, Y"</tt> coordinates) are
+ * recognized and checked by hand-written parsers that do not allocate.
+ */
+class NANOGUI_EXPORT TextValidator : public Object {
+public:
+    /// Return whether \c input is valid (the whole string must match)
+    virtual bool validate(const std::string &input) const = 0;
+
+    /**
+     * \brief Create the validator for a regular expression.
+     *
+     * Returns a validator registered for \c format with \ref registerFormat
+     * if there is one, a built-in parser if the expression is one of the
+     * common formats, and a \ref RegexValidator otherwise. Leading \c ^ and
+     * trailing \c $ anchors are ignored when looking for a match, since the
+     * whole input always has to match.
+     */
+    static ref<TextValidator> fromFormat(const std::string &format);
+
+    /**
+     * \brief Use \c validator for every text box whose format is \c format.
+     *
+     * This makes it possible to replace slow or unsupported regular
+     * expressions by custom code. Pass \c nullptr to remove a registration.
+     * Only affects subsequent calls of \ref TextBox::setFormat.
+     */
+    static void registerFormat(const std::string &format, TextValidator *validator);
+
+protected:
+    virtual ~TextValidator() { }
+};
+
+/// Matches the input against a regular expression that is compiled once
+class NANOGUI_EXPORT RegexValidator : public TextValidator {
+public:
+    RegexValidator(const std::string &format);
+    virtual bool validate(const std::string &input) const override;
+protected:
+    std::regex mRegex;
+    bool mValid;
+};
+
+/**
+ * \brief Accepts integers, optionally with a leading minus sign.
+ *
+ * The defaults correspond to <tt>[0-9]*</tt>.
+ */
+class NANOGUI_EXPORT IntegerValidator : public TextValidator {
+public:
+    /**
+     * \param allowNegative
+     *     Accept a leading \c '-' (<tt>[-]?[0-9]*</tt>)
+     *
+     * \param requireDigits
+     *     Reject strings without any digits
+     *
+     * \param allowLeadingZero
+     *     Accept a leading \c '0' (<tt>[1-9][0-9]*</tt> if \c false)
+     */
+    IntegerValidator(bool allowNegative = false, bool requireDigits = false,
+                     bool allowLeadingZero = true)
+        : mAllowNegative(allowNegative), mRequireDigits(requireDigits),
+          mAllowLeadingZero(allowLeadingZero) { }
+
+    virtual bool validate(const std::string &input) const override;
+protected:
+    bool mAllowNegative, mRequireDigits, mAllowLeadingZero;
+};
+
+/**
+ * \brief Accepts decimal numbers of the form <tt>[0-9]*\.?[0-9]+</tt>.
+ *
+ * Optionally preceded by one of the characters in \c signs and followed
+ * by an exponent <tt>([eE][-+]?[0-9]+)?</tt>.
+ */
+class NANOGUI_EXPORT NumberValidator : public TextValidator {
+public:
+    NumberValidator(const std::string &signs = "", bool allowExponent = false)
+        : mSigns(signs), mAllowExponent(allowExponent) { }
+
+    virtual bool validate(const std::string &input) const override;
+protected:
+    std::string mSigns;
+    bool mAllowExponent;
+};
+
+/**
+ * \brief Accepts two unsigned integers separated by a character and
+ * optional white space.
+ *
+ * Use <tt>'x'</tt> for dimensions (<tt>[0-9]{1,4}\\s*[x]\\s*[0-9]{1,4}</tt>)
+ * and <tt>','</tt> for coordinates.
+ */
+class NANOGUI_EXPORT PairValidator : public TextValidator {
+public:
+    PairValidator(char separator, int maxDigits = 4)
+        : mSeparator(separator), mMaxDigits(maxDigits) { }
+
+    virtual bool validate(const std::string &input) const override;
+
+    /**
+     * \brief Parse a string accepted by this validator.
+     *
+     * \return \c false if the string is not valid
+     */
+    bool parse(const std::string &input, int &first, int &second) const;
+protected:
+    char mSeparator;
+    int mMaxDigits;
+};
+
+NAMESPACE_END(nanogui)
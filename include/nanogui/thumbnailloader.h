@@ -0,0 +1,170 @@
+/*
+    nanogui/thumbnailloader.h -- Background decoder and on-disk cache for
+    ImagePanel thumbnails
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class ThumbnailLoader thumbnailloader.h nanogui/thumbnailloader.h
+ *
+ * \brief Decodes and downscales a list of image files on worker threads.
+ *
+ * Files are decoded in the order of their distance to the currently visible
+ * index range (see \ref setVisibleRange), so that whatever is on screen
+ * appears first; \ref setPrefetch limits how far ahead. Each decoded image is downscaled so that its shorter side
+ * matches the thumbnail size, and is optionally written to a cache directory
+ * from which later runs can load it without touching the original file.
+ * JPEG files are decoded at a reduced scale right away (see \ref JPEGImage).
+ *
+ * Worker threads never touch OpenGL. Finished thumbnails are handed over to
+ * NanoVG on the render thread by \ref upload, which should be called once per
+ * frame (\ref ImagePanel does this automatically).
+ */
+class NANOGUI_EXPORT ThumbnailLoader : public Object {
+public:
+    /**
+     * \param thumbSize
+     *     Edge length (in pixels) of the shorter side of each thumbnail
+     *
+     * \param cacheDirectory
+     *     Directory that holds previously generated thumbnails. Pass an
+     *     empty string to disable the on-disk cache. The directory must exist.
+     *
+     * \param threadCount
+     *     Number of worker threads. A value of zero uses one thread less
+     *     than the number of hardware threads (but at least one).
+     */
+    ThumbnailLoader(int thumbSize, const std::string &cacheDirectory = "",
+                    int threadCount = 0);
+
+    /// Return the edge length of the shorter side of each thumbnail
+    int thumbSize() const { return mThumbSize; }
+
+    /// Return the on-disk cache directory (empty if disabled)
+    const std::string &cacheDirectory() const { return mCacheDirectory; }
+
+    /// Replace the list of files. Pending work for the previous list is discarded.
+    void setFiles(const std::vector<std::string> &files);
+
+    /// Return the current list of files
+    const std::vector<std::string> &files() const { return mFiles; }
+
+    /// Prioritize the indices in <tt>[first, last]</tt> (inclusive)
+    void setVisibleRange(int first, int last);
+
+    /**
+     * \brief Only decode files at most \c count indices away from the
+     * visible range (-1: decode all files, the default).
+     *
+     * The others stay queued until the visible range comes close.
+     */
+    void setPrefetch(int count);
+
+    /// Queue a file again, e.g. after its thumbnail was discarded
+    void request(int index);
+
+    /// A decoded thumbnail (\c width and \c height are zero if decoding failed)
+    struct Thumbnail {
+        int index;
+        int width, height;
+        std::vector<uint8_t> rgba;
+    };
+
+    /**
+     * \brief Hand over thumbnails that finished decoding.
+     *
+     * Can be called on any thread. Use this instead of \ref upload to place
+     * the pixel data somewhere else than a separate NanoVG image per file
+     * (e.g. a \ref TextureAtlas).
+     *
+     * \return
+     *     The number of entries appended to \c thumbnails
+     */
+    int fetch(std::vector<Thumbnail> &thumbnails, int maxCount = 16);
+
+    /**
+     * \brief Create NanoVG images for thumbnails that finished decoding.
+     *
+     * Must be called on the thread that owns \c ctx.
+     *
+     * \param loaded
+     *     Receives <tt>(index, image)</tt> pairs for the new images. An image
+     *     handle of \c -1 marks a file that could not be decoded.
+     *
+     * \param maxUploads
+     *     Upper bound on the number of textures created by this call, which
+     *     keeps the per-frame cost of a large batch of finished files bounded.
+     *
+     * \return
+     *     The number of entries appended to \c loaded
+     */
+    int upload(NVGcontext *ctx, std::vector<std::pair<int, int>> &loaded,
+               int maxUploads = 16);
+
+    /// Return the number of files that have not been handed over by \ref fetch or \ref upload yet
+    int pending() const;
+
+    /**
+     * \brief Decode a single file into a thumbnail (no caching, no threads).
+     *
+     * \return
+     *     \c true on success. In this case, \c rgba contains
+     *     <tt>4 * width * height</tt> bytes.
+     */
+    static bool decode(const std::string &filename, int thumbSize,
+                       std::vector<uint8_t> &rgba, int &width, int &height);
+
+protected:
+    /// Shut down the worker threads
+    virtual ~ThumbnailLoader();
+
+    void workerThread();
+    bool nextTask(int &index, std::string &filename, uint32_t &generation);
+    /// Return the queued index to decode next (end() if none is within the prefetch window)
+    std::set<int>::iterator closestTask();
+    std::string cacheFilename(const std::string &filename) const;
+    bool readCache(const std::string &cacheFile, Thumbnail &result) const;
+    void writeCache(const std::string &cacheFile, const Thumbnail &result) const;
+
+protected:
+    int mThumbSize;
+    std::string mCacheDirectory;
+    std::vector<std::string> mFiles;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::thread> mThreads;
+    /// Indices that still need to be decoded
+    std::set<int> mQueue;
+    /// Decoded thumbnails waiting for \ref fetch
+    std::vector<Thumbnail> mResults;
+    /// Number of files currently being decoded by the workers
+    int mInFlight;
+    /// Incremented by \ref setFiles to discard stale results
+    uint32_t mGeneration;
+    int mVisibleFirst, mVisibleLast;
+    /// See \ref setPrefetch
+    int mPrefetch;
+    bool mShutdown;
+};
+
+NAMESPACE_END(nanogui)
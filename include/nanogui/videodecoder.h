@@ -0,0 +1,188 @@
+/*
+    nanogui/videodecoder.h -- Streaming decoder for Motion-JPEG AVI files
+    and image sequences
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class VideoDecoder videodecoder.h nanogui/videodecoder.h
+ *
+ * \brief Decodes the frames of a clip ahead of playback on worker threads.
+ *
+ * Two kinds of clips are supported, both parsed in-tree:
+ *
+ * - AVI files with a Motion-JPEG video stream and an \c idx1 index (as
+ *   written by most cameras and by <tt>ffmpeg -c:v mjpeg</tt>). Frames
+ *   without Huffman tables, which is common for MJPEG, get the standard
+ *   tables of the JPEG specification.
+ * - Image sequences given as a \c printf pattern such as
+ *   <tt>frames/%04d.jpg</tt>, numbered from 0 or 1 without gaps. Any
+ *   format that stb_image reads works.
+ *
+ * Decoded frames go into a fixed number of slots, so memory use does not
+ * depend on the length of the clip. The workers decode the frames following
+ * the one last requested by \ref fetch, in order and wrapping around at the
+ * end. If decoding falls behind playback, frames that are already late are
+ * skipped instead of decoded, and late frames waiting in the ring are
+ * discarded (see \ref droppedFrames). Clips with no more frames than slots
+ * are decoded once and kept: \ref fetch copies their frames instead of
+ * releasing the slots, so short loops are never decoded again.
+ *
+ * Image sequences are scanned for their length on a worker thread, since
+ * checking thousands of files would stall the caller; until the scan has
+ * finished, \ref frameCount is 1 and \ref fetch returns no frames.
+ *
+ * Worker threads never touch OpenGL; \ref SlideVideo uploads the frames.
+ */
+class NANOGUI_EXPORT VideoDecoder : public Object {
+public:
+    /**
+     * \brief Open a clip.
+     *
+     * \param slotCount
+     *     Number of decoded frames kept ahead of playback
+     *
+     * \param threadCount
+     *     Number of worker threads. With none, frames are only available
+     *     through \ref decodeFrame, and an image sequence is scanned right
+     *     away.
+     *
+     * \throws std::runtime_error
+     *     If the clip cannot be opened or contains no frames.
+     */
+    VideoDecoder(const std::string &path, int slotCount = 6, int threadCount = 2);
+
+    /**
+     * \brief Read the frame size of a clip from the AVI main header, or
+     * from the header of the first image of a sequence, without opening
+     * it for decoding.
+     */
+    static bool probe(const std::string &path, int &width, int &height);
+
+    /// Return the path of the clip
+    const std::string &path() const { return mPath; }
+
+    /// Return the number of frames
+    int frameCount() const { return mFrameCount; }
+
+    /// Return the frame rate stored in the clip (0 for image sequences)
+    double frameRate() const { return mFrameRate; }
+
+    /// Return whether the workers wrap around to the first frame at the end
+    bool loop() const { return mLoop; }
+
+    /// Set whether the workers wrap around to the first frame at the end
+    void setLoop(bool loop);
+
+    /**
+     * \brief Take the newest decoded frame that is due at frame \c target.
+     *
+     * Decoded frames before the returned one are discarded. The pixels are
+     * exchanged with \c rgba, so the caller's buffer is recycled by the
+     * decoder and no frame is copied (except for clips that are kept
+     * decoded, see above).
+     *
+     * \return
+     *     The index of the frame now in \c rgba, or -1 if no frame at or
+     *     before \c target has been decoded yet, or if it is the frame
+     *     returned last time
+     */
+    int fetch(int target, std::vector<uint8_t> &rgba, int &width, int &height);
+
+    /// Return the number of frames that were skipped or discarded because they were late
+    int droppedFrames() const;
+
+    /// Decode frame \c index on the calling thread (e.g. for a still image)
+    bool decodeFrame(int index, std::vector<uint8_t> &rgba, int &width, int &height);
+
+protected:
+    /// Shut down the worker threads
+    virtual ~VideoDecoder();
+
+    /// A decoded frame of the ring
+    struct Slot {
+        enum State { Free, Decoding, Ready };
+        State state = Free;
+        int index = -1;
+        int width = 0, height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    void openAvi();
+    /// Find the first image; \c scan: count the images as well
+    void openSequence(bool scan);
+    /// Count the images of a sequence
+    int scanSequence() const;
+    /// Return whether the whole clip is kept decoded (needs \ref mMutex)
+    bool keepsAllFrames() const;
+    /// Read the compressed data of a frame
+    bool readFrame(int index, std::vector<uint8_t> &data);
+    bool findAviFrame(int index, uint64_t &offset, uint32_t &size);
+    std::string sequenceFilename(int index) const;
+    void workerThread();
+    /// Number of frames from \c from forward to \c to, taking looping into account
+    int distance(int from, int to) const;
+
+protected:
+    std::string mPath;
+    /// Frame count; written by the sequence scan while workers may read it
+    std::atomic<int> mFrameCount;
+    double mFrameRate;
+
+    /* Container access, guarded by mFileMutex */
+    std::mutex mFileMutex;
+    FILE *mFile;
+    /// AVI: position of the "movi" list, which idx1 offsets may be relative to
+    uint64_t mMoviOffset;
+    /// AVI: position and number of the idx1 entries
+    uint64_t mIndexOffset;
+    uint32_t mIndexCount;
+    bool mIndexAbsolute;
+    /// AVI: chunk ids of the video stream ("00dc" and "00db")
+    uint32_t mVideoChunk[2];
+    /// AVI: first idx1 entry of every 1024th frame, bounds each lookup
+    std::vector<uint32_t> mIndexCheckpoints;
+    /// AVI: last frame looked up, so that sequential lookups scan few entries
+    int mCursorFrame;
+    uint32_t mCursorEntry;
+    /// Image sequences: first number
+    int mSequenceStart;
+
+    /* Decoding state, guarded by mMutex */
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::thread> mThreads;
+    std::vector<Slot> mSlots;
+    /// Next frame handed to a worker (-1: end of the clip reached)
+    int mNextDecode;
+    /// Frame returned by the last successful \ref fetch
+    int mLastFetched;
+    /// Whether \ref mFrameCount is final (image sequences are scanned by a worker)
+    bool mScanned;
+    bool mScanning;
+    int mDropped;
+    bool mLoop;
+    bool mShutdown;
+};
+
+NAMESPACE_END(nanogui)
@@ -14,6 +14,7 @@
 
 #include <nanogui/object.h>
 #include <nanogui/theme.h>
+#include <nanogui/displaylist.h>
 #include <vector>
 
 NAMESPACE_BEGIN(nanogui)
@@ -335,6 +336,9 @@ protected:
      */
     float mIconExtraScale;
     Cursor mCursor;
+
+    /// Recorded drawing of the widget's own appearance (see \ref DisplayList)
+    DisplayList mDisplayList;
 public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
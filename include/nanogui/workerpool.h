@@ -0,0 +1,80 @@
+/*
+    nanogui/workerpool.h -- Fixed set of threads running queued tasks
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+/** \file */
+
+#pragma once
+
+#include <nanogui/object.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+NAMESPACE_BEGIN(nanogui)
+
+/**
+ * \class WorkerPool workerpool.h nanogui/workerpool.h
+ *
+ * \brief Runs queued tasks on a fixed number of threads, in the order they
+ * were submitted.
+ *
+ * Media items decode their files here (see \ref Screen::workerPool), so a
+ * slide with many images neither starts a thread per image nor holds more
+ * decoded images in memory at once than there are threads.
+ *
+ * Unlike the futures of \c std::async, the futures \ref submit returns do
+ * not wait for the task when they are destroyed; tasks that are no longer
+ * needed should check a cancel flag of their own and return early.
+ */
+class NANOGUI_EXPORT WorkerPool : public Object {
+public:
+    /**
+     * \param threadCount
+     *     Number of worker threads. A value of zero uses one thread less
+     *     than the number of hardware threads (but at least one).
+     */
+    WorkerPool(int threadCount = 0);
+
+    /// Return the number of worker threads
+    int threadCount() const { return (int) mThreads.size(); }
+
+    /// Return the number of tasks that have not started yet
+    int pending() const;
+
+    /// Queue \c task and return a future for its result
+    template <typename Func> auto submit(Func &&task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(task));
+        std::future<Result> future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+protected:
+    /// Finish the running tasks and shut down the worker threads; queued tasks are dropped
+    virtual ~WorkerPool();
+
+    void enqueue(std::function<void()> task);
+    void workerThread();
+
+protected:
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mQueue;
+    bool mShutdown;
+};
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,482 @@
+/*
+    src/animatedimage.cpp -- Frame-by-frame compositing of animated GIF
+    and PNG (APNG) files
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/animatedimage.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Canvases and frames are allocated whole (both formats allow 65535 pixels
+   or more per side); 8192x8192 RGBA is 256 MB */
+static const size_t MAX_PIXELS = (size_t) 1 << 26;
+
+static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+static uint16_t readLE16(const uint8_t *p) { return (uint16_t) (p[0] | (p[1] << 8)); }
+static uint16_t readBE16(const uint8_t *p) { return (uint16_t) ((p[0] << 8) | p[1]); }
+static uint32_t readBE32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static void writeBE32(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back((uint8_t) (value >> 24));
+    out.push_back((uint8_t) (value >> 16));
+    out.push_back((uint8_t) (value >> 8));
+    out.push_back((uint8_t) value);
+}
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+    /* Initialized once, even when several threads decode frames */
+    static const Crc32Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* Append a PNG chunk with its CRC */
+static void writeChunk(std::vector<uint8_t> &out, const char *type,
+                       const uint8_t *data, size_t size) {
+    writeBE32(out, (uint32_t) size);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    writeBE32(out, crc32(out.data() + start, size + 4));
+}
+
+/* Decode GIF LZW data (split into sub-blocks) into 'size' color indices.
+   Truncated data leaves the remaining indices at zero, like browsers do. */
+static bool decodeLzw(const uint8_t *data, size_t dataSize, int minCodeSize,
+                      uint8_t *out, size_t size) {
+    if (minCodeSize < 2 || minCodeSize > 8)
+        return false;
+
+    uint16_t prefix[4096];
+    uint8_t suffix[4096];
+    uint8_t stack[4097];
+    const int clear = 1 << minCodeSize, end = clear + 1;
+    int codeSize = minCodeSize + 1, next = clear + 2, prev = -1;
+    uint8_t first = 0;
+
+    uint32_t bits = 0;
+    int bitCount = 0;
+    size_t pos = 0, blockEnd = 0, written = 0;
+    while (written < size) {
+        while (bitCount < codeSize) {
+            if (pos == blockEnd) {
+                if (pos >= dataSize || data[pos] == 0)
+                    return true;
+                blockEnd = pos + 1 + data[pos];
+                pos++;
+                if (blockEnd > dataSize)
+                    return true;
+            }
+            bits |= (uint32_t) data[pos++] << bitCount;
+            bitCount += 8;
+        }
+        int code = (int) (bits & ((1u << codeSize) - 1));
+        bits >>= codeSize;
+        bitCount -= codeSize;
+
+        if (code == clear) {
+            codeSize = minCodeSize + 1;
+            next = clear + 2;
+            prev = -1;
+            continue;
+        }
+        if (code == end)
+            break;
+        if (prev < 0) {
+            if (code > clear)
+                return false;
+            out[written++] = first = (uint8_t) code;
+            prev = code;
+            continue;
+        }
+        if (code > next)
+            return false;
+
+        int c = code, depth = 0;
+        if (code == next) {
+            stack[depth++] = first;
+            c = prev;
+        }
+        while (c > end && depth < 4096) {
+            stack[depth++] = suffix[c];
+            c = prefix[c];
+        }
+        stack[depth++] = first = (uint8_t) c;
+        while (depth > 0 && written < size)
+            out[written++] = stack[--depth];
+
+        if (next < 4096) {
+            prefix[next] = (uint16_t) prev;
+            suffix[next] = first;
+            if (++next == (1 << codeSize) && codeSize < 12)
+                codeSize++;
+        }
+        prev = code;
+    }
+    return true;
+}
+
+AnimatedImage::AnimatedImage(const std::string &fileName)
+    : mFileName(fileName), mIsGif(false), mWidth(0), mHeight(0), mLoopCount(1),
+      mFrameIndex(-1) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("AnimatedImage: could not open \"" + fileName + "\"!");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    mData.resize(size > 0 ? (size_t) size : 0);
+    bool ok = size > 0 && fread(mData.data(), mData.size(), 1, file) == 1;
+    fclose(file);
+    if (!ok)
+        throw std::runtime_error("AnimatedImage: could not read \"" + fileName + "\"!");
+
+    if (mData.size() >= 6 && (memcmp(mData.data(), "GIF87a", 6) == 0 ||
+                              memcmp(mData.data(), "GIF89a", 6) == 0)) {
+        mIsGif = true;
+        parseGif();
+    } else if (mData.size() >= 8 && memcmp(mData.data(), pngSignature, 8) == 0) {
+        parsePng();
+    } else {
+        throw std::runtime_error("AnimatedImage: \"" + fileName + "\" is neither a GIF nor a PNG file!");
+    }
+    if (mFrames.empty() || mWidth <= 0 || mHeight <= 0)
+        throw std::runtime_error("AnimatedImage: \"" + fileName + "\" contains no frames!");
+    if ((size_t) mWidth * mHeight > MAX_PIXELS)
+        throw std::runtime_error("AnimatedImage: \"" + fileName + "\" is too large!");
+
+    mFrameStart.push_back(0.0);
+    for (const Frame &frame : mFrames)
+        mFrameStart.push_back(mFrameStart.back() + frame.delay);
+    rewind();
+}
+
+void AnimatedImage::parseGif() {
+    const uint8_t *data = mData.data();
+    size_t size = mData.size(), pos = 13;
+    if (size < pos)
+        throw std::runtime_error("AnimatedImage: truncated GIF \"" + mFileName + "\"!");
+    mWidth = readLE16(data + 6);
+    mHeight = readLE16(data + 8);
+    uint8_t flags = data[10];
+    size_t globalPalette = 0;
+    int globalPaletteSize = 0;
+    if (flags & 0x80) {
+        globalPalette = pos;
+        globalPaletteSize = 2 << (flags & 7);
+        pos += (size_t) globalPaletteSize * 3;
+    }
+
+    /* Without a NETSCAPE2.0 extension, a GIF plays once */
+    mLoopCount = 1;
+    Frame control;
+    auto skipBlocks = [&]() {
+        while (pos < size && data[pos] != 0)
+            pos += 1 + data[pos];
+        pos++;
+    };
+
+    while (pos < size) {
+        uint8_t block = data[pos++];
+        if (block == 0x3b) {
+            break;
+        } else if (block == 0x21 && pos < size) {
+            uint8_t label = data[pos++];
+            if (label == 0xf9 && pos + 5 < size && data[pos] >= 4) {
+                uint8_t packed = data[pos + 1];
+                int disposal = (packed >> 2) & 7;
+                control.dispose = disposal == 2 ? DisposeBackground :
+                                  disposal == 3 ? DisposePrevious : DisposeNone;
+                control.transparent = (packed & 1) ? data[pos + 4] : -1;
+                /* Browsers show very short delays as 100 ms */
+                int delay = readLE16(data + pos + 2);
+                control.delay = (delay < 2 ? 10 : delay) / 100.0;
+            } else if (label == 0xff && pos + 15 < size && data[pos] == 11 &&
+                       memcmp(data + pos + 1, "NETSCAPE2.0", 11) == 0 &&
+                       data[pos + 12] >= 3 && data[pos + 13] == 1) {
+                int loops = readLE16(data + pos + 14);
+                mLoopCount = loops == 0 ? 0 : loops + 1;
+            }
+            skipBlocks();
+        } else if (block == 0x2c && pos + 9 <= size) {
+            Frame frame = control;
+            if (frame.delay == 0)
+                frame.delay = 0.1;
+            frame.x = readLE16(data + pos);
+            frame.y = readLE16(data + pos + 2);
+            frame.width = readLE16(data + pos + 4);
+            frame.height = readLE16(data + pos + 6);
+            uint8_t packed = data[pos + 8];
+            frame.interlaced = (packed & 0x40) != 0;
+            pos += 9;
+            if (packed & 0x80) {
+                frame.paletteOffset = pos;
+                frame.paletteSize = 2 << (packed & 7);
+                pos += (size_t) frame.paletteSize * 3;
+            } else {
+                frame.paletteOffset = globalPalette;
+                frame.paletteSize = globalPaletteSize;
+            }
+            frame.dataOffset = pos;
+            pos++;
+            skipBlocks();
+            mFrames.push_back(frame);
+            control = Frame();
+        } else {
+            break;
+        }
+    }
+}
+
+void AnimatedImage::parsePng() {
+    const uint8_t *data = mData.data();
+    size_t size = mData.size(), pos = 8;
+    bool animated = false, sawData = false;
+    Frame still;
+
+    while (pos + 12 <= size) {
+        size_t length = readBE32(data + pos);
+        const uint8_t *type = data + pos + 4;
+        size_t payload = pos + 8;
+        if (payload + length + 4 > size)
+            break;
+        pos = payload + length + 4;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length == 13) {
+            mPngHeader.assign(data + payload, data + payload + 13);
+            mWidth = (int) readBE32(data + payload);
+            mHeight = (int) readBE32(data + payload + 4);
+        } else if (memcmp(type, "acTL", 4) == 0 && length == 8) {
+            animated = true;
+            mLoopCount = (int) readBE32(data + payload + 4);
+        } else if (memcmp(type, "PLTE", 4) == 0 || memcmp(type, "tRNS", 4) == 0) {
+            mPngTables.push_back(std::make_pair(pos - length - 12, length + 12));
+        } else if (memcmp(type, "fcTL", 4) == 0 && length == 26) {
+            Frame frame;
+            frame.width = (int) readBE32(data + payload + 4);
+            frame.height = (int) readBE32(data + payload + 8);
+            frame.x = (int) readBE32(data + payload + 12);
+            frame.y = (int) readBE32(data + payload + 16);
+            int num = readBE16(data + payload + 20), den = readBE16(data + payload + 22);
+            frame.delay = std::max(num / (double) (den == 0 ? 100 : den), 0.01);
+            uint8_t dispose = data[payload + 24];
+            frame.dispose = dispose == 1 ? DisposeBackground :
+                            dispose == 2 ? DisposePrevious : DisposeNone;
+            /* The first frame has no previous state to go back to */
+            if (mFrames.empty() && frame.dispose == DisposePrevious)
+                frame.dispose = DisposeBackground;
+            frame.blend = data[payload + 25] == 1;
+            mFrames.push_back(frame);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            /* The default image is only part of the animation if an fcTL precedes it */
+            if (!mFrames.empty() && !sawData)
+                mFrames.back().chunks.push_back(std::make_pair(payload, length));
+            still.chunks.push_back(std::make_pair(payload, length));
+        } else if (memcmp(type, "fdAT", 4) == 0 && length > 4) {
+            sawData = true;
+            if (!mFrames.empty())
+                mFrames.back().chunks.push_back(std::make_pair(payload + 4, length - 4));
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+    }
+    if (mPngHeader.empty())
+        throw std::runtime_error("AnimatedImage: PNG \"" + mFileName + "\" has no header!");
+
+    mFrames.erase(std::remove_if(mFrames.begin(), mFrames.end(), [&](const Frame &f) {
+        return f.chunks.empty() || f.x + f.width > mWidth || f.y + f.height > mHeight;
+    }), mFrames.end());
+
+    if (!animated || mFrames.empty()) {
+        mFrames.clear();
+        still.width = mWidth;
+        still.height = mHeight;
+        still.delay = 1.0;
+        still.blend = false;
+        if (!still.chunks.empty())
+            mFrames.push_back(still);
+        mLoopCount = 0;
+    }
+}
+
+int AnimatedImage::frameAt(double time, bool &finished) const {
+    double length = duration();
+    finished = mLoopCount > 0 && time >= length * mLoopCount;
+    if (finished || length <= 0)
+        return finished ? frameCount() - 1 : 0;
+    time = std::fmod(std::max(time, 0.0), length);
+    int index = (int) (std::upper_bound(mFrameStart.begin(), mFrameStart.end(), time) -
+                       mFrameStart.begin()) - 1;
+    return std::min(std::max(index, 0), frameCount() - 1);
+}
+
+void AnimatedImage::rewind() {
+    mCanvas.assign((size_t) mWidth * mHeight * 4, 0);
+    mFrameIndex = -1;
+}
+
+const std::vector<uint8_t> &AnimatedImage::nextFrame() {
+    int index = mFrameIndex + 1;
+    if (index >= frameCount()) {
+        rewind();
+        index = 0;
+    } else if (mFrameIndex >= 0) {
+        const Frame &previous = mFrames[mFrameIndex];
+        if (previous.dispose == DisposeBackground)
+            clearRect(previous);
+        else if (previous.dispose == DisposePrevious && mPrevious.size() == mCanvas.size())
+            mCanvas.swap(mPrevious);
+    }
+
+    const Frame &frame = mFrames[index];
+    if (frame.dispose == DisposePrevious)
+        mPrevious = mCanvas;
+    /* A frame that cannot be decoded leaves the canvas as it was */
+    bool decoded = mIsGif ? decodeGifFrame(frame) : decodePngFrame(frame);
+    if (decoded)
+        blit(frame);
+    mFrameIndex = index;
+    return mCanvas;
+}
+
+bool AnimatedImage::decodeGifFrame(const Frame &frame) {
+    /* GIF frames may be larger than the canvas */
+    size_t pixelCount = (size_t) frame.width * frame.height;
+    if (pixelCount == 0 || pixelCount > MAX_PIXELS || frame.dataOffset >= mData.size())
+        return false;
+    std::vector<uint8_t> indices(pixelCount, 0);
+    if (!decodeLzw(mData.data() + frame.dataOffset + 1, mData.size() - frame.dataOffset - 1,
+                   mData[frame.dataOffset], indices.data(), pixelCount))
+        return false;
+
+    /* Rows of interlaced images are stored in four passes */
+    std::vector<int> rows;
+    rows.reserve(frame.height);
+    if (frame.interlaced) {
+        static const int start[4] = { 0, 4, 2, 1 }, step[4] = { 8, 8, 4, 2 };
+        for (int pass = 0; pass < 4; ++pass)
+            for (int y = start[pass]; y < frame.height; y += step[pass])
+                rows.push_back(y);
+    } else {
+        for (int y = 0; y < frame.height; ++y)
+            rows.push_back(y);
+    }
+
+    const uint8_t *palette = mData.data() + frame.paletteOffset;
+    size_t available = frame.paletteOffset < mData.size() ? mData.size() - frame.paletteOffset : 0;
+    int paletteSize = (int) std::min((size_t) frame.paletteSize, available / 3);
+    mFramePixels.resize(pixelCount * 4);
+    for (int i = 0; i < frame.height; ++i) {
+        const uint8_t *src = indices.data() + (size_t) i * frame.width;
+        uint8_t *dst = mFramePixels.data() + (size_t) rows[i] * frame.width * 4;
+        for (int x = 0; x < frame.width; ++x, dst += 4) {
+            int index = src[x];
+            if (index == frame.transparent || index >= paletteSize) {
+                dst[0] = dst[1] = dst[2] = dst[3] = 0;
+            } else {
+                memcpy(dst, palette + index * 3, 3);
+                dst[3] = 255;
+            }
+        }
+    }
+    return true;
+}
+
+bool AnimatedImage::decodePngFrame(const Frame &frame) {
+    /* Wrap the frame into a standalone PNG file for stb_image */
+    std::vector<uint8_t> png(pngSignature, pngSignature + 8);
+    uint8_t header[13];
+    memcpy(header, mPngHeader.data(), 13);
+    for (int i = 0; i < 4; ++i) {
+        header[i] = (uint8_t) (frame.width >> (24 - 8 * i));
+        header[4 + i] = (uint8_t) (frame.height >> (24 - 8 * i));
+    }
+    writeChunk(png, "IHDR", header, 13);
+    for (const auto &table : mPngTables)
+        png.insert(png.end(), mData.begin() + table.first,
+                   mData.begin() + table.first + table.second);
+    std::vector<uint8_t> compressed;
+    for (const auto &chunk : frame.chunks)
+        compressed.insert(compressed.end(), mData.begin() + chunk.first,
+                          mData.begin() + chunk.first + chunk.second);
+    writeChunk(png, "IDAT", compressed.data(), compressed.size());
+    writeChunk(png, "IEND", nullptr, 0);
+
+    int w, h, n;
+    uint8_t *pixels = stbi_load_from_memory(png.data(), (int) png.size(), &w, &h, &n, 4);
+    if (!pixels)
+        return false;
+    bool ok = w == frame.width && h == frame.height;
+    if (ok)
+        mFramePixels.assign(pixels, pixels + (size_t) w * h * 4);
+    stbi_image_free(pixels);
+    return ok;
+}
+
+void AnimatedImage::clearRect(const Frame &frame) {
+    int x0 = std::min(frame.x, mWidth), x1 = std::min(frame.x + frame.width, mWidth);
+    int y1 = std::min(frame.y + frame.height, mHeight);
+    for (int y = frame.y; y < y1; ++y)
+        memset(mCanvas.data() + ((size_t) y * mWidth + x0) * 4, 0, (size_t) (x1 - x0) * 4);
+}
+
+void AnimatedImage::blit(const Frame &frame) {
+    int w = std::min(frame.width, mWidth - frame.x);
+    int h = std::min(frame.height, mHeight - frame.y);
+    if (w <= 0 || h <= 0)
+        return;
+    for (int y = 0; y < h; ++y) {
+        const uint8_t *src = mFramePixels.data() + (size_t) y * frame.width * 4;
+        uint8_t *dst = mCanvas.data() + ((size_t) (frame.y + y) * mWidth + frame.x) * 4;
+        if (!frame.blend) {
+            memcpy(dst, src, (size_t) w * 4);
+            continue;
+        }
+        /* Straight alpha "over" operator */
+        for (int x = 0; x < w; ++x, src += 4, dst += 4) {
+            uint32_t sa = src[3];
+            if (sa == 255) {
+                memcpy(dst, src, 4);
+            } else if (sa != 0) {
+                uint32_t da = dst[3] * (255 - sa) / 255;
+                uint32_t a = sa + da;
+                for (int c = 0; c < 3; ++c)
+                    dst[c] = (uint8_t) ((src[c] * sa + dst[c] * da + a / 2) / a);
+                dst[3] = (uint8_t) a;
+            }
+        }
+    }
+}
+
+NAMESPACE_END(nanogui)
@@ -12,6 +12,8 @@
 #include <nanogui/button.h>
 #include <nanogui/theme.h>
 #include <nanogui/opengl.h>
+#include <nanogui/textureatlas.h>
+#include <nanogui/textcache.h>
 #include <nanogui/serializer/core.h>
 
 NAMESPACE_BEGIN(nanogui)
@@ -24,22 +26,20 @@ Button::Button(Widget *parent, const std::string &caption, int icon)
 
 Vector2i Button::preferredSize(NVGcontext *ctx) const {
     int fontSize = mFontSize == -1 ? mTheme->mButtonFontSize : mFontSize;
-    nvgFontSize(ctx, fontSize);
-    nvgFontFace(ctx, "sans-bold");
-    float tw = nvgTextBounds(ctx, 0,0, mCaption.c_str(), nullptr, nullptr);
+    float tw = nvgCachedTextBounds(ctx, "sans-bold", fontSize,
+                                   NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, 0, 0, mCaption);
     float iw = 0.0f, ih = fontSize;
 
     if (mIcon) {
         if (nvgIsFontIcon(mIcon)) {
             ih *= icon_scale();
-            nvgFontFace(ctx, "icons");
-            nvgFontSize(ctx, ih);
-            iw = nvgTextBounds(ctx, 0, 0, utf8(mIcon).data(), nullptr, nullptr)
+            iw = nvgCachedTextBounds(ctx, "icons", ih, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE,
+                                     0, 0, utf8(mIcon).data())
                 + mSize.y() * 0.15f;
         } else {
             int w, h;
             ih *= 0.9f;
-            nvgImageSize(ctx, mIcon, &w, &h);
+            nvgImageIconSize(ctx, mIcon, &w, &h);
             iw = w * ih / h;
         }
     }
@@ -106,6 +106,14 @@ bool Button::mouseButtonEvent(const Vector2i &p, int button, bool down, int modi
 void Button::draw(NVGcontext *ctx) {
     Widget::draw(ctx);
 
+    DrawStateHash hash(this);
+    hash.add(mCaption).add(mIcon).add((int) mIconPosition).add(mPushed).add(mMouseFocus)
+        .add(mFontSize).add(mBackgroundColor).add(mTextColor);
+    if (mDisplayList.replay(ctx, hash.value()))
+        return;
+    mDisplayList.begin(ctx, hash.value());
+    nvgSave(ctx);
+
     NVGcolor gradTop = mTheme->mButtonGradientTopUnfocused;
     NVGcolor gradBot = mTheme->mButtonGradientBotUnfocused;
 
@@ -155,7 +163,8 @@ void Button::draw(NVGcontext *ctx) {
     int fontSize = mFontSize == -1 ? mTheme->mButtonFontSize : mFontSize;
     nvgFontSize(ctx, fontSize);
     nvgFontFace(ctx, "sans-bold");
-    float tw = nvgTextBounds(ctx, 0,0, mCaption.c_str(), nullptr, nullptr);
+    float tw = nvgCachedTextBounds(ctx, "sans-bold", fontSize,
+                                   NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, 0, 0, mCaption);
 
     Vector2f center = mPos.cast<float>() + mSize.cast<float>() * 0.5f;
     Vector2f textPos(center.x() - tw * 0.5f, center.y() - 1);
@@ -172,11 +181,12 @@ void Button::draw(NVGcontext *ctx) {
             ih *= icon_scale();
             nvgFontSize(ctx, ih);
             nvgFontFace(ctx, "icons");
-            iw = nvgTextBounds(ctx, 0, 0, icon.data(), nullptr, nullptr);
+            iw = nvgCachedTextBounds(ctx, "icons", ih, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE,
+                                     0, 0, icon.data());
         } else {
             int w, h;
             ih *= 0.9f;
-            nvgImageSize(ctx, mIcon, &w, &h);
+            nvgImageIconSize(ctx, mIcon, &w, &h);
             iw = w * ih / h;
         }
         if (mCaption != "")
@@ -201,9 +211,11 @@ void Button::draw(NVGcontext *ctx) {
         if (nvgIsFontIcon(mIcon)) {
             nvgText(ctx, iconPos.x(), iconPos.y()+1, icon.data(), nullptr);
         } else {
-            NVGpaint imgPaint = nvgImagePattern(ctx,
-                    iconPos.x(), iconPos.y() - ih/2, iw, ih, 0, mIcon, mEnabled ? 0.5f : 0.25f);
+            NVGpaint imgPaint = nvgImageIconPattern(ctx,
+                    iconPos.x(), iconPos.y() - ih/2, iw, ih, mIcon, mEnabled ? 0.5f : 0.25f);
 
+            nvgBeginPath(ctx);
+            nvgRect(ctx, iconPos.x(), iconPos.y() - ih/2, iw, ih);
             nvgFillPaint(ctx, imgPaint);
             nvgFill(ctx);
         }
@@ -216,6 +228,9 @@ void Button::draw(NVGcontext *ctx) {
     nvgText(ctx, textPos.x(), textPos.y(), mCaption.c_str(), nullptr);
     nvgFillColor(ctx, textColor);
     nvgText(ctx, textPos.x(), textPos.y() + 1, mCaption.c_str(), nullptr);
+
+    nvgRestore(ctx);
+    mDisplayList.end(ctx);
 }
 
 void Button::save(Serializer &s) const {
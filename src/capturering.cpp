@@ -0,0 +1,420 @@
+/*
+    src/capturering.cpp -- Proof-of-play captures in a fixed-size
+    on-disk ring buffer
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/capturering.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* File layout: a header, followed by 'slotCount' slots, each consisting of
+   a slot header and the RGB8 pixels. All integers are little endian. */
+static const char ringMagic[8] = { 'N', 'G', 'C', 'A', 'P', 'R', 'N', 'G' };
+static const uint32_t ringVersion = 1;
+static const uint32_t slotMagic = 0x544f4c53; /* "SLOT" */
+static const size_t fileHeaderSize = 64;
+static const size_t slotHeaderSize = 96;
+static const size_t slideIdSize = 72;
+
+struct RingHeader {
+    char magic[8];
+    uint32_t version, slotCount, width, height;
+};
+
+struct SlotHeader {
+    uint32_t magic, reserved;
+    uint64_t sequence, timestamp;
+    char slideId[slideIdSize];
+};
+
+static_assert(sizeof(SlotHeader) == slotHeaderSize, "Unexpected slot header size");
+
+/* Captures in flight before new ones are skipped */
+static const int maxPendingCaptures = 2;
+
+/* Ring files of long running players exceed 2 GB easily, which a long
+   offset cannot address on every platform */
+static bool seek(FILE *file, size_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64) offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t) offset, SEEK_SET) == 0;
+#endif
+}
+
+CaptureRing::CaptureRing(const std::string &filename, int slotCount, const Vector2i &frameSize)
+    : mFilename(filename), mSlotCount(std::max(slotCount, 1)),
+      mFrameSize(frameSize.cwiseMax(1)), mInterval(60.0), mLastCapture(-1e30),
+      mSlideChanged(false), mFramebuffer(0), mColor(0), mStepsSize(0, 0), mTimer(0),
+      mTimerPending(false), mFile(nullptr), mNextSlot(0), mNextSequence(0),
+      mCaptureCount(0), mSkippedCount(0), mCpuTime(0), mGpuTime(0) {
+
+    RingHeader expected;
+    memset(&expected, 0, sizeof(RingHeader));
+    memcpy(expected.magic, ringMagic, sizeof(ringMagic));
+    expected.version = ringVersion;
+    expected.slotCount = (uint32_t) mSlotCount;
+    expected.width = (uint32_t) mFrameSize.x();
+    expected.height = (uint32_t) mFrameSize.y();
+
+    /* Reuse an existing ring with the same layout */
+    mFile = fopen(filename.c_str(), "r+b");
+    if (mFile) {
+        RingHeader header;
+        if (fread(&header, sizeof(RingHeader), 1, mFile) != 1 ||
+            memcmp(&header, &expected, sizeof(RingHeader)) != 0) {
+            fclose(mFile);
+            mFile = nullptr;
+        }
+    }
+
+    if (mFile) {
+        bool found = false;
+        for (int slot = 0; slot < mSlotCount; ++slot) {
+            Entry entry;
+            if (!readSlotHeader(slot, entry))
+                continue;
+            if (!found || entry.sequence >= mNextSequence) {
+                mNextSequence = entry.sequence + 1;
+                mNextSlot = (slot + 1) % mSlotCount;
+                found = true;
+            }
+        }
+        return;
+    }
+
+    /* Create the file at its final size so that it never grows later */
+    mFile = fopen(filename.c_str(), "w+b");
+    if (!mFile)
+        throw std::runtime_error("CaptureRing: could not create \"" + filename + "\"!");
+    uint8_t header[fileHeaderSize];
+    memset(header, 0, fileHeaderSize);
+    memcpy(header, &expected, sizeof(RingHeader));
+    SlotHeader empty;
+    memset(&empty, 0, sizeof(SlotHeader));
+    bool ok = fwrite(header, fileHeaderSize, 1, mFile) == 1;
+    for (int slot = 0; slot < mSlotCount && ok; ++slot) {
+        ok = seek(mFile, slotOffset(slot)) &&
+             fwrite(&empty, sizeof(SlotHeader), 1, mFile) == 1;
+    }
+    uint8_t last = 0;
+    ok = ok && seek(mFile, slotOffset(mSlotCount) - 1) &&
+         fwrite(&last, 1, 1, mFile) == 1 && fflush(mFile) == 0;
+    if (!ok) {
+        fclose(mFile);
+        throw std::runtime_error("CaptureRing: could not allocate \"" + filename + "\"!");
+    }
+}
+
+CaptureRing::~CaptureRing() {
+    /* OpenGL resources must have been released by free() */
+    if (mFile)
+        fclose(mFile);
+}
+
+size_t CaptureRing::slotSize() const {
+    return slotHeaderSize + (size_t) mFrameSize.prod() * 3;
+}
+
+size_t CaptureRing::slotOffset(int slot) const {
+    return fileHeaderSize + (size_t) slot * slotSize();
+}
+
+bool CaptureRing::readSlotHeader(int slot, Entry &entry) const {
+    SlotHeader header;
+    if (!seek(mFile, slotOffset(slot)) ||
+        fread(&header, sizeof(SlotHeader), 1, mFile) != 1 || header.magic != slotMagic)
+        return false;
+    entry.slot = slot;
+    entry.sequence = header.sequence;
+    entry.timestamp = header.timestamp;
+    header.slideId[slideIdSize - 1] = '\0';
+    entry.slideId = header.slideId;
+    return true;
+}
+
+void CaptureRing::slideChanged(const std::string &slideId) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mSlideId = slideId;
+    mSlideChanged = true;
+}
+
+std::string CaptureRing::slideId() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mSlideId;
+}
+
+CaptureRing::Target CaptureRing::createTarget(const Vector2i &size, GLenum format) {
+    Target target;
+    target.size = size;
+    GLint renderbuffer;
+    glGetIntegerv(GL_RENDERBUFFER_BINDING, &renderbuffer);
+    glGenRenderbuffers(1, &target.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, format, size.x(), size.y());
+    glBindRenderbuffer(GL_RENDERBUFFER, (GLuint) renderbuffer);
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.framebuffer);
+    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              target.color);
+    return target;
+}
+
+void CaptureRing::createSteps(const Vector2i &framebufferSize) {
+    releaseSteps();
+    mStepsSize = framebufferSize;
+
+    /* Expects the default framebuffer to be bound for drawing */
+    GLint samples = 0;
+    glGetIntegerv(GL_SAMPLES, &samples);
+    if (samples > 0) {
+        /* A resolving blit needs the formats of both sides to match */
+        GLint red = 8, alpha = 8;
+        glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_BACK_LEFT,
+            GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE, &red);
+        glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_BACK_LEFT,
+            GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alpha);
+        GLenum format = red > 8 ? GL_RGB10_A2 : (alpha > 0 ? GL_RGBA8 : GL_RGB8);
+        mSteps.push_back(createTarget(framebufferSize, format));
+    }
+
+    Vector2i size = framebufferSize;
+    while (size.x() > 2 * mFrameSize.x() || size.y() > 2 * mFrameSize.y()) {
+        for (int i = 0; i < 2; ++i)
+            if (size[i] > 2 * mFrameSize[i])
+                size[i] /= 2;
+        mSteps.push_back(createTarget(size, GL_RGBA8));
+    }
+}
+
+void CaptureRing::downscale(const Vector2i &framebufferSize) {
+    GLuint source = 0;
+    Vector2i sourceSize = framebufferSize;
+    for (const Target &step : mSteps) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, step.framebuffer);
+        if (step.size == sourceSize && source == 0) {
+            /* Resolve the samples */
+            glBlitFramebuffer(0, 0, sourceSize.x(), sourceSize.y(), 0, 0, step.size.x(),
+                              step.size.y(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        } else {
+            /* Halved axes read exactly twice the size, so that every linear
+               sample lands between four pixels and averages them */
+            Vector2i read = step.size;
+            for (int i = 0; i < 2; ++i)
+                if (sourceSize[i] > step.size[i])
+                    read[i] *= 2;
+            glBlitFramebuffer(0, 0, read.x(), read.y(), 0, 0, step.size.x(), step.size.y(),
+                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        source = step.framebuffer;
+        sourceSize = step.size;
+    }
+
+    /* At most 2:1 per axis is left */
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFramebuffer);
+    glBlitFramebuffer(0, 0, sourceSize.x(), sourceSize.y(), 0, 0, mFrameSize.x(),
+                      mFrameSize.y(), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+}
+
+void CaptureRing::releaseSteps() {
+    for (const Target &step : mSteps) {
+        glDeleteFramebuffers(1, &step.framebuffer);
+        glDeleteRenderbuffers(1, &step.color);
+    }
+    mSteps.clear();
+    mStepsSize = Vector2i(0, 0);
+}
+
+void CaptureRing::collectTimer() {
+    if (!mTimerPending)
+        return;
+    GLint available = 0;
+    glGetQueryObjectiv(mTimer, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(mTimer, GL_QUERY_RESULT, &elapsed);
+    mTimerPending = false;
+    std::lock_guard<std::mutex> guard(mMutex);
+    mGpuTime = elapsed * 1e-9;
+}
+
+void CaptureRing::frameDrawn(const Vector2i &framebufferSize, double time) {
+    collectTimer();
+
+    std::string slideId;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        bool periodic = mInterval > 0 && time - mLastCapture >= mInterval;
+        if (!periodic && !mSlideChanged)
+            return;
+        if (mReadback && mReadback->pending() >= maxPendingCaptures) {
+            mSkippedCount++;
+            return;
+        }
+        mSlideChanged = false;
+        mLastCapture = time;
+        slideId = mSlideId;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t timestamp = (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    GLint readFramebuffer, drawFramebuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+
+    if (!mFramebuffer) {
+        Target frame = createTarget(mFrameSize, GL_RGBA8);
+        mFramebuffer = frame.framebuffer;
+        mColor = frame.color;
+        mReadback = new GLReadback();
+        glGenQueries(1, &mTimer);
+    }
+    if (framebufferSize != mStepsSize) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        createSteps(framebufferSize);
+    }
+
+    /* Measure on the GPU; a capture is only timed once the previous result was read */
+    bool timed = !mTimerPending;
+    if (timed)
+        glBeginQuery(GL_TIME_ELAPSED, mTimer);
+    downscale(framebufferSize);
+    if (timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        mTimerPending = true;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint) readFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint) drawFramebuffer);
+
+    ref<CaptureRing> self = this;
+    mReadback->read(mFramebuffer, mFrameSize, Vector2i::Zero(),
+        [self, timestamp, slideId](GLReadback::Image &image) mutable {
+            self->store(image, timestamp, slideId);
+        });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> guard(mMutex);
+    mCpuTime = elapsed;
+}
+
+void CaptureRing::store(const GLReadback::Image &image, uint64_t timestamp,
+                        const std::string &slideId) {
+    if (image.size != mFrameSize || image.pixels.empty())
+        return;
+
+    /* BGRA to RGB */
+    size_t pixelCount = (size_t) mFrameSize.prod();
+    std::vector<uint8_t> rgb(pixelCount * 3);
+    const uint8_t *src = image.pixels.data();
+    for (size_t i = 0; i < pixelCount; ++i) {
+        rgb[i * 3 + 0] = src[i * 4 + 2];
+        rgb[i * 3 + 1] = src[i * 4 + 1];
+        rgb[i * 3 + 2] = src[i * 4 + 0];
+    }
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    SlotHeader header;
+    memset(&header, 0, sizeof(SlotHeader));
+    header.magic = slotMagic;
+    header.sequence = mNextSequence;
+    header.timestamp = timestamp;
+    strncpy(header.slideId, slideId.c_str(), slideIdSize - 1);
+
+    /* Invalidate the slot, write the pixels, then the header, so that an
+       interrupted write never leaves a mismatched capture behind */
+    SlotHeader empty;
+    memset(&empty, 0, sizeof(SlotHeader));
+    size_t offset = slotOffset(mNextSlot);
+    bool ok = seek(mFile, offset) &&
+              fwrite(&empty, sizeof(SlotHeader), 1, mFile) == 1 &&
+              fwrite(rgb.data(), rgb.size(), 1, mFile) == 1 &&
+              fflush(mFile) == 0 &&
+              seek(mFile, offset) &&
+              fwrite(&header, sizeof(SlotHeader), 1, mFile) == 1 &&
+              fflush(mFile) == 0;
+    if (!ok)
+        throw std::runtime_error("CaptureRing: could not write to \"" + mFilename + "\"!");
+
+    mNextSlot = (mNextSlot + 1) % mSlotCount;
+    mNextSequence++;
+    mCaptureCount++;
+}
+
+int CaptureRing::captureCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mCaptureCount;
+}
+
+int CaptureRing::skippedCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mSkippedCount;
+}
+
+double CaptureRing::cpuTime() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mCpuTime;
+}
+
+double CaptureRing::gpuTime() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mGpuTime;
+}
+
+std::vector<CaptureRing::Entry> CaptureRing::entries() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    std::vector<Entry> result;
+    for (int slot = 0; slot < mSlotCount; ++slot) {
+        Entry entry;
+        if (readSlotHeader(slot, entry))
+            result.push_back(entry);
+    }
+    std::sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) {
+        return a.sequence < b.sequence;
+    });
+    return result;
+}
+
+bool CaptureRing::readFrame(int slot, std::vector<uint8_t> &rgb) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    Entry entry;
+    if (slot < 0 || slot >= mSlotCount || !readSlotHeader(slot, entry))
+        return false;
+    rgb.resize((size_t) mFrameSize.prod() * 3);
+    return fread(rgb.data(), rgb.size(), 1, mFile) == 1;
+}
+
+void CaptureRing::free() {
+    if (mReadback) {
+        mReadback->free();
+        mReadback = nullptr;
+    }
+    releaseSteps();
+    if (mFramebuffer) {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        glDeleteRenderbuffers(1, &mColor);
+        mFramebuffer = mColor = 0;
+    }
+    if (mTimer) {
+        glDeleteQueries(1, &mTimer);
+        mTimer = 0;
+        mTimerPending = false;
+    }
+}
+
+NAMESPACE_END(nanogui)
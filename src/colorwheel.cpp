@@ -35,6 +35,12 @@ void ColorWheel::draw(NVGcontext *ctx) {
     if (!mVisible)
         return;
 
+    DrawStateHash hash(this);
+    hash.add(mHue).add(mWhite).add(mBlack);
+    if (mDisplayList.replay(ctx, hash.value()))
+        return;
+    mDisplayList.begin(ctx, hash.value());
+
     float x = mPos.x(),
           y = mPos.y(),
           w = mSize.x(),
@@ -138,6 +144,7 @@ void ColorWheel::draw(NVGcontext *ctx) {
     nvgRestore(vg);
 
     nvgRestore(vg);
+    mDisplayList.end(ctx);
 }
 
 bool ColorWheel::mouseButtonEvent(const Vector2i &p, int button, bool down,
@@ -13,14 +13,24 @@
 
 #if defined(_WIN32)
 #  include <windows.h>
+#  include <direct.h>
+#else
+#  include <sys/stat.h>
 #endif
 
 #include <nanogui/opengl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
 #include <map>
 #include <thread>
 #include <chrono>
 #include <iostream>
 
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
 #if !defined(_WIN32)
 #  include <locale.h>
 #  include <signal.h>
@@ -57,11 +67,17 @@ void init() {
         throw std::runtime_error("Could not initialize GLFW!");
 
     glfwSetTime(0);
+
+    /* Images are also decoded on worker threads (see WorkerPool), which must
+       not write stb_image's global flags while others decode: set them
+       once, to the values nvgCreateImage() uses */
+    stbi_set_unpremultiply_on_load(1);
+    stbi_convert_iphone_png_to_rgb(1);
 }
 
 static bool mainloop_active = false;
 
-void mainloop(int refresh) {
+void mainloop(int refresh, bool parallel) {
     if (mainloop_active)
         throw std::runtime_error("Main loop is already running!");
 
@@ -92,10 +108,18 @@ void mainloop(int refresh) {
                 if (!screen->visible()) {
                     continue;
                 } else if (glfwWindowShouldClose(screen->glfwWindow())) {
+                    auto lock = screen->lockWidgets();
                     screen->setVisible(false);
                     continue;
                 }
-                screen->drawAll();
+                if (parallel) {
+                    /* The render thread picks up the request and presents
+                       independently of the other screens */
+                    screen->startRenderThread();
+                    screen->redraw();
+                } else {
+                    screen->drawAll();
+                }
                 numScreens++;
             }
 
@@ -116,6 +140,11 @@ void mainloop(int refresh) {
         leave();
     }
 
+    if (parallel) {
+        for (auto kv : __nanogui_screens)
+            kv.second->stopRenderThread();
+    }
+
     if (refresh > 0)
         refresh_thread.join();
 }
@@ -153,28 +182,17 @@ std::array<char, 8> utf8(int c) {
     return seq;
 }
 
-int __nanogui_get_image(NVGcontext *ctx, const std::string &name, uint8_t *data, uint32_t size) {
-    static std::map<std::string, int> iconCache;
-    auto it = iconCache.find(name);
-    if (it != iconCache.end())
-        return it->second;
-    int iconID = nvgCreateImageMem(ctx, 0, data, size);
-    if (iconID == 0)
-        throw std::runtime_error("Unable to load resource data.");
-    iconCache[name] = iconID;
-    return iconID;
-}
-
-std::vector<std::pair<int, std::string>>
-loadImageDirectory(NVGcontext *ctx, const std::string &path) {
-    std::vector<std::pair<int, std::string> > result;
+/* Invoke 'callback' with the name of every entry of a directory */
+static void forEachDirectoryEntry(const std::string &path,
+                                  const std::function<void(const char *)> &callback) {
 #if !defined(_WIN32)
     DIR *dp = opendir(path.c_str());
     if (!dp)
         throw std::runtime_error("Could not open image directory!");
     struct dirent *ep;
-    while ((ep = readdir(dp))) {
-        const char *fname = ep->d_name;
+    while ((ep = readdir(dp)))
+        callback(ep->d_name);
+    closedir(dp);
 #else
     WIN32_FIND_DATA ffd;
     std::string searchPath = path + "/*.*";
@@ -182,23 +200,75 @@ loadImageDirectory(NVGcontext *ctx, const std::string &path) {
     if (handle == INVALID_HANDLE_VALUE)
         throw std::runtime_error("Could not open image directory!");
     do {
-        const char *fname = ffd.cFileName;
+        callback(ffd.cFileName);
+    } while (FindNextFileA(handle, &ffd) != 0);
+    FindClose(handle);
 #endif
+}
+
+std::vector<std::pair<int, std::string>>
+loadImageDirectory(NVGcontext *ctx, const std::string &path) {
+    std::vector<std::pair<int, std::string> > result;
+    forEachDirectoryEntry(path, [&](const char *fname) {
         if (strstr(fname, "png") == nullptr)
-            continue;
+            return;
         std::string fullName = path + "/" + std::string(fname);
         int img = nvgCreateImage(ctx, fullName.c_str(), 0);
         if (img == 0)
             throw std::runtime_error("Could not open image data!");
         result.push_back(
             std::make_pair(img, fullName.substr(0, fullName.length() - 4)));
-#if !defined(_WIN32)
-    }
-    closedir(dp);
+    });
+    return result;
+}
+
+std::string userCacheDirectory(const std::string &name) {
+#if defined(_WIN32)
+    if (const char *dir = getenv("LOCALAPPDATA"))
+        return std::string(dir) + "\\nanogui\\" + name;
 #else
-    } while (FindNextFileA(handle, &ffd) != 0);
-    FindClose(handle);
+    if (const char *dir = getenv("XDG_CACHE_HOME"))
+        return std::string(dir) + "/nanogui/" + name;
+    if (const char *dir = getenv("HOME"))
+        return std::string(dir) + "/.cache/nanogui/" + name;
 #endif
+    return "";
+}
+
+bool createDirectories(const std::string &path) {
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/' && path[pos] != '\\')
+            continue;
+        std::string prefix = path.substr(0, pos);
+        if (prefix.back() == ':')
+            continue; /* Drive letter */
+#if defined(_WIN32)
+        if (_mkdir(prefix.c_str()) != 0 && errno != EEXIST)
+#else
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+#endif
+            return false;
+    }
+    return true;
+}
+
+std::vector<std::string> listImageDirectory(const std::string &path) {
+    static const char *extensions[] = { "png", "jpg", "jpeg", "gif", "bmp", "tga" };
+    std::vector<std::string> result;
+    forEachDirectoryEntry(path, [&](const char *fname) {
+        const char *dot = strrchr(fname, '.');
+        if (!dot || dot == fname)
+            return;
+        std::string ext(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        for (const char *e : extensions) {
+            if (ext == e) {
+                result.push_back(path + "/" + fname);
+                break;
+            }
+        }
+    });
+    std::sort(result.begin(), result.end());
     return result;
 }
 
@@ -0,0 +1,321 @@
+/*
+    src/contextgroup.cpp -- OpenGL share group for several Screens
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/contextgroup.h>
+#include <nanogui/etc2image.h>
+#include <nanogui/workerpool.h>
+#include <chrono>
+
+/* Needed for nvglCreateImageFromHandleGL3(), the implementation lives in screen.cpp */
+#define NANOVG_GL3
+#include <nanovg_gl.h>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+ContextGroup::ContextGroup() { }
+
+ContextGroup::~ContextGroup() {
+    /* Members remove themselves before their contexts are destroyed, so
+       anything left here belongs to contexts that no longer exist */
+}
+
+GLFWwindow *ContextGroup::shareWindow() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mMembers.empty() ? nullptr : mMembers.front().second.window;
+}
+
+void ContextGroup::addContext(NVGcontext *ctx, GLFWwindow *window) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    if (member(ctx))
+        return;
+    Member m;
+    m.window = window;
+    mMembers.push_back(std::make_pair(ctx, std::move(m)));
+}
+
+void ContextGroup::removeContext(NVGcontext *ctx) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    for (auto it = mMembers.begin(); it != mMembers.end(); ++it) {
+        if (it->first != ctx)
+            continue;
+        for (const auto &handle : it->second.handles) {
+            nvgDeleteImage(ctx, handle.second.image);
+            unreference(handle.first);
+        }
+        mMembers.erase(it);
+        break;
+    }
+    collectGarbage();
+}
+
+int ContextGroup::contextCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return (int) mMembers.size();
+}
+
+ContextGroup::Member *ContextGroup::member(NVGcontext *ctx) {
+    for (auto &m : mMembers)
+        if (m.first == ctx)
+            return &m.second;
+    return nullptr;
+}
+
+std::string ContextGroup::textureKey(const std::string &filename, int imageFlags) const {
+    /* Only the flags which affect the texture object itself are part of the key */
+    int textureFlags = imageFlags & (NVG_IMAGE_GENERATE_MIPMAPS | NVG_IMAGE_REPEATX |
+                                     NVG_IMAGE_REPEATY | NVG_IMAGE_NEAREST);
+    return std::to_string(textureFlags) + ":" + filename;
+}
+
+int ContextGroup::image(NVGcontext *ctx, const std::string &filename, int imageFlags,
+                        WorkerPool *pool) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    Member *m = member(ctx);
+    if (!m)
+        throw std::runtime_error("ContextGroup::image(): context is not a member of the group!");
+
+    /* The calling context is current, use the opportunity to clean up */
+    collectGarbage();
+
+    std::string key = textureKey(filename, imageFlags);
+    auto handle = m->handles.find(key);
+    if (handle != m->handles.end()) {
+        handle->second.uses++;
+        return handle->second.image;
+    }
+
+    auto it = mTextures.find(key);
+    if (it == mTextures.end()) {
+        /* Only one member decodes each file, and it does so without the
+           lock, so that the others keep drawing in the meantime */
+        std::shared_future<Pixels> pixels;
+        std::shared_ptr<std::packaged_task<Pixels()>> task;
+        auto decoding = mDecoding.find(key);
+        if (decoding != mDecoding.end()) {
+            pixels = decoding->second;
+        } else {
+            auto decodeFile = [filename]() { return decode(filename); };
+            if (pool) {
+                pixels = pool->submit(decodeFile).share();
+            } else {
+                task = std::make_shared<std::packaged_task<Pixels()>>(decodeFile);
+                pixels = task->get_future().share();
+            }
+            mDecoding[key] = pixels;
+        }
+        if (pool && pixels.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return -1;
+
+        lock.unlock();
+        if (task)
+            (*task)();
+        pixels.wait();
+        lock.lock();
+
+        /* Another member may have uploaded it meanwhile */
+        m = member(ctx);
+        it = mTextures.find(key);
+        if (it == mTextures.end()) {
+            /* A failed decode is retried by the next call */
+            mDecoding.erase(key);
+            Texture texture;
+            createTexture(pixels.get(), imageFlags, texture);
+            it = mTextures.insert(std::make_pair(key, texture)).first;
+        }
+    }
+
+    Texture &texture = it->second;
+    if (texture.fence) {
+        /* The upload may still be in flight on another member's context. Once
+           the fence has signaled nobody needs to wait for it any more,
+           otherwise this context's command stream waits on the GPU */
+        GLenum status = glClientWaitSync(texture.fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync(texture.fence);
+            texture.fence = 0;
+        } else {
+            glWaitSync(texture.fence, 0, GL_TIMEOUT_IGNORED);
+        }
+    }
+
+    int image = nvglCreateImageFromHandleGL3(ctx, texture.id, texture.width, texture.height,
+                                             imageFlags | NVG_IMAGE_NODELETE);
+    if (image == 0) {
+        if (texture.refCount == 0) {
+            mGarbage.push_back(texture.id);
+            if (texture.fence)
+                mGarbageFences.push_back(texture.fence);
+            mTextures.erase(it);
+            collectGarbage();
+        }
+        return 0;
+    }
+
+    texture.refCount++;
+    m->handles[key] = Handle { image, 1 };
+    m->keys[image] = key;
+    return image;
+}
+
+void ContextGroup::releaseImage(NVGcontext *ctx, int image) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    Member *m = member(ctx);
+    if (!m)
+        return;
+    auto key = m->keys.find(image);
+    if (key == m->keys.end())
+        return;
+    Handle &handle = m->handles[key->second];
+    if (--handle.uses > 0)
+        return;
+
+    /* Freeing a NVG_IMAGE_NODELETE handle does not touch the GL texture */
+    nvgDeleteImage(ctx, image);
+    unreference(key->second);
+    m->handles.erase(key->second);
+    m->keys.erase(key);
+}
+
+int ContextGroup::textureCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return (int) mTextures.size();
+}
+
+size_t ContextGroup::memoryUsage() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    size_t bytes = 0;
+    for (const auto &texture : mTextures)
+        bytes += texture.second.bytes;
+    return bytes;
+}
+
+size_t ContextGroup::textureBytes(NVGcontext *ctx, int image) const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    for (const auto &m : mMembers) {
+        if (m.first != ctx)
+            continue;
+        auto key = m.second.keys.find(image);
+        if (key == m.second.keys.end())
+            return 0;
+        auto texture = mTextures.find(key->second);
+        return texture == mTextures.end() ? 0 : texture->second.bytes;
+    }
+    return 0;
+}
+
+void ContextGroup::unreference(const std::string &key) {
+    auto it = mTextures.find(key);
+    if (it == mTextures.end() || --it->second.refCount > 0)
+        return;
+    /* The caller may not have a context current, so defer the deletion */
+    mGarbage.push_back(it->second.id);
+    if (it->second.fence)
+        mGarbageFences.push_back(it->second.fence);
+    mTextures.erase(it);
+}
+
+void ContextGroup::collectGarbage() {
+    for (GLsync fence : mGarbageFences)
+        glDeleteSync(fence);
+    mGarbageFences.clear();
+    if (mGarbage.empty())
+        return;
+    glDeleteTextures((GLsizei) mGarbage.size(), mGarbage.data());
+    mGarbage.clear();
+}
+
+ContextGroup::Pixels ContextGroup::decode(const std::string &filename) {
+    Pixels pixels;
+    if (ETC2Image::isKTX(filename)) {
+        /* Published slides may hold compressed images, see SlideCanvas::flatten();
+           failures propagate to the caller of image() */
+        pixels.compressed = new ETC2Image(filename);
+        pixels.width = pixels.compressed->width();
+        pixels.height = pixels.compressed->height();
+        return pixels;
+    }
+
+    /* Decode like nvgCreateImage() so that shared and private images look
+       the same (nanogui::init() sets stb_image's flags for that) */
+    int n;
+    uint8_t *data = stbi_load(filename.c_str(), &pixels.width, &pixels.height, &n, 4);
+    if (!data)
+        throw std::runtime_error("ContextGroup::image(): could not load \"" + filename +
+                                 "\": " + stbi_failure_reason());
+    pixels.rgba = std::shared_ptr<uint8_t>(data, stbi_image_free);
+    return pixels;
+}
+
+void ContextGroup::createTexture(const Pixels &pixels, int imageFlags, Texture &texture) {
+    int w = pixels.width, h = pixels.height;
+    GLint boundTexture, unpackAlignment, unpackRowLength, unpackSkipPixels, unpackSkipRows;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &unpackRowLength);
+    glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &unpackSkipPixels);
+    glGetIntegerv(GL_UNPACK_SKIP_ROWS, &unpackSkipRows);
+
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    bool mipmaps = (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) != 0;
+    if (pixels.compressed) {
+        texture.bytes = pixels.compressed->upload();
+        /* Mipmaps cannot be generated from compressed blocks */
+        mipmaps = false;
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     pixels.rgba.get());
+        texture.bytes = (size_t) w * h * 4;
+    }
+
+    bool nearest = (imageFlags & NVG_IMAGE_NEAREST) != 0;
+    if (mipmaps) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        nearest ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                    (imageFlags & NVG_IMAGE_REPEATX) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                    (imageFlags & NVG_IMAGE_REPEATY) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, unpackRowLength);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, unpackSkipPixels);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, unpackSkipRows);
+    glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+
+    /* Other members may sample the texture from their own threads right
+       away. Rather than stalling until the upload is complete, fence it and
+       let them wait on the GPU in image(); the flush makes sure the fence
+       reaches the GPU before another context waits for it */
+    texture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    texture.width = w;
+    texture.height = h;
+    texture.flags = imageFlags;
+    if (mipmaps)
+        texture.bytes = texture.bytes * 4 / 3;
+    texture.refCount = 0;
+}
+
+NAMESPACE_END(nanogui)
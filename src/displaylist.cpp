@@ -0,0 +1,339 @@
+/*
+    src/displaylist.cpp -- Recorded NanoVG backend calls that can be
+    replayed without re-tessellating the paths
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/displaylist.h>
+#include <nanogui/widget.h>
+#include <nanogui/opengl.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+NAMESPACE_BEGIN(nanogui)
+
+DrawStateHash::DrawStateHash(const Widget *widget) : DrawStateHash() {
+    add(widget->visible()).add(widget->enabled()).add(widget->focused());
+    addPointer(widget->theme());
+    for (const Widget *w = widget; w; w = w->parent())
+        add(w->position()).add(w->size());
+}
+
+DrawStateHash &DrawStateHash::add(const void *data, size_t size) {
+    /* FNV-1a */
+    for (size_t i = 0; i < size; ++i) {
+        mValue ^= ((const uint8_t *) data)[i];
+        mValue *= 0x100000001b3ull;
+    }
+    return *this;
+}
+
+struct DisplayList::Recording {
+    enum class CommandType { Fill, Stroke, Triangles };
+
+    struct Command {
+        CommandType type;
+        NVGpaint paint;
+        NVGcompositeOperationState compositeOperation;
+        NVGscissor scissor;
+        float fringe;
+        float bounds[4];
+        float strokeWidth;
+        size_t firstPath, pathCount;
+        size_t firstVertex, vertexCount;
+    };
+
+    /* Offsets of the path vertices within 'vertices' while recording */
+    struct PathVertices {
+        size_t fill, stroke;
+    };
+
+    std::vector<Command> commands;
+    std::vector<NVGpath> paths;
+    std::vector<PathVertices> pathVertices;
+    std::vector<NVGvertex> vertices;
+    uint64_t key = 0;
+    bool valid = false;
+
+    void clear() {
+        commands.clear();
+        paths.clear();
+        pathVertices.clear();
+        vertices.clear();
+        valid = false;
+    }
+
+    Command &addCommand(CommandType type, const NVGpaint *paint,
+                        NVGcompositeOperationState compositeOperation,
+                        const NVGscissor *scissor) {
+        Command command;
+        memset(&command, 0, sizeof(Command));
+        command.type = type;
+        command.paint = *paint;
+        command.compositeOperation = compositeOperation;
+        command.scissor = *scissor;
+        command.firstPath = paths.size();
+        command.firstVertex = vertices.size();
+        commands.push_back(command);
+        return commands.back();
+    }
+
+    void addPaths(Command &command, const NVGpath *src, int count) {
+        for (int i = 0; i < count; ++i) {
+            const NVGpath &path = src[i];
+            PathVertices offsets { vertices.size(), 0 };
+            vertices.insert(vertices.end(), path.fill, path.fill + path.nfill);
+            offsets.stroke = vertices.size();
+            vertices.insert(vertices.end(), path.stroke, path.stroke + path.nstroke);
+            paths.push_back(path);
+            pathVertices.push_back(offsets);
+        }
+        command.pathCount = (size_t) count;
+    }
+
+    /* Point the recorded paths at the final vertex storage */
+    void finish() {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            paths[i].fill = paths[i].nfill > 0 ? &vertices[pathVertices[i].fill] : nullptr;
+            paths[i].stroke = paths[i].nstroke > 0 ? &vertices[pathVertices[i].stroke] : nullptr;
+        }
+        pathVertices.clear();
+        pathVertices.shrink_to_fit();
+    }
+};
+
+/* The backend callbacks only receive the backend's user pointer, which is
+   used to find the active recordings and the original callbacks */
+struct DisplayListHook {
+    NVGparams original;
+    std::vector<DisplayList::Recording *> recordings;
+    float devicePixelRatio = 1.f;
+};
+
+static std::mutex hookMutex;
+static std::map<void *, DisplayListHook> hooks;
+static std::atomic<bool> replayEnabled(true);
+static std::atomic<uint64_t> generation(0);
+
+static DisplayListHook *findHook(void *uptr) {
+    std::lock_guard<std::mutex> guard(hookMutex);
+    auto it = hooks.find(uptr);
+    return it == hooks.end() ? nullptr : &it->second;
+}
+
+static void listRenderViewport(void *uptr, float width, float height,
+                               float devicePixelRatio) {
+    DisplayListHook *hook = findHook(uptr);
+    hook->devicePixelRatio = devicePixelRatio;
+    hook->original.renderViewport(uptr, width, height, devicePixelRatio);
+}
+
+static void listRenderFill(void *uptr, NVGpaint *paint,
+                           NVGcompositeOperationState compositeOperation,
+                           NVGscissor *scissor, float fringe, const float *bounds,
+                           const NVGpath *paths, int npaths) {
+    DisplayListHook *hook = findHook(uptr);
+    for (auto recording : hook->recordings) {
+        auto &command = recording->addCommand(DisplayList::Recording::CommandType::Fill,
+                                              paint, compositeOperation, scissor);
+        command.fringe = fringe;
+        memcpy(command.bounds, bounds, sizeof(float) * 4);
+        recording->addPaths(command, paths, npaths);
+    }
+    hook->original.renderFill(uptr, paint, compositeOperation, scissor, fringe,
+                              bounds, paths, npaths);
+}
+
+static void listRenderStroke(void *uptr, NVGpaint *paint,
+                             NVGcompositeOperationState compositeOperation,
+                             NVGscissor *scissor, float fringe, float strokeWidth,
+                             const NVGpath *paths, int npaths) {
+    DisplayListHook *hook = findHook(uptr);
+    for (auto recording : hook->recordings) {
+        auto &command = recording->addCommand(DisplayList::Recording::CommandType::Stroke,
+                                              paint, compositeOperation, scissor);
+        command.fringe = fringe;
+        command.strokeWidth = strokeWidth;
+        recording->addPaths(command, paths, npaths);
+    }
+    hook->original.renderStroke(uptr, paint, compositeOperation, scissor, fringe,
+                                strokeWidth, paths, npaths);
+}
+
+static void listRenderTriangles(void *uptr, NVGpaint *paint,
+                                NVGcompositeOperationState compositeOperation,
+                                NVGscissor *scissor, const NVGvertex *verts,
+                                int nverts) {
+    DisplayListHook *hook = findHook(uptr);
+    for (auto recording : hook->recordings) {
+        auto &command = recording->addCommand(DisplayList::Recording::CommandType::Triangles,
+                                              paint, compositeOperation, scissor);
+        recording->vertices.insert(recording->vertices.end(), verts, verts + nverts);
+        command.vertexCount = (size_t) nverts;
+    }
+    hook->original.renderTriangles(uptr, paint, compositeOperation, scissor,
+                                   verts, nverts);
+}
+
+void nvgAttachDisplayLists(NVGcontext *ctx) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    if (hooks.count(params->userPtr))
+        return;
+    hooks[params->userPtr].original = *params;
+    params->renderViewport = listRenderViewport;
+    params->renderFill = listRenderFill;
+    params->renderStroke = listRenderStroke;
+    params->renderTriangles = listRenderTriangles;
+}
+
+void nvgDetachDisplayLists(NVGcontext *ctx) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    auto it = hooks.find(params->userPtr);
+    if (it == hooks.end())
+        return;
+    params->renderViewport = it->second.original.renderViewport;
+    params->renderFill = it->second.original.renderFill;
+    params->renderStroke = it->second.original.renderStroke;
+    params->renderTriangles = it->second.original.renderTriangles;
+    hooks.erase(it);
+}
+
+DisplayList::DisplayList() { }
+
+DisplayList::~DisplayList() { }
+
+void DisplayList::clear() {
+    mRecording.reset();
+}
+
+int DisplayList::commandCount() const {
+    return mRecording ? (int) mRecording->commands.size() : 0;
+}
+
+size_t DisplayList::memoryUsage() const {
+    if (!mRecording)
+        return 0;
+    return mRecording->commands.capacity() * sizeof(Recording::Command) +
+           mRecording->paths.capacity() * sizeof(NVGpath) +
+           mRecording->vertices.capacity() * sizeof(NVGvertex);
+}
+
+void DisplayList::setEnabled(bool enabled) {
+    replayEnabled = enabled;
+}
+
+bool DisplayList::enabled() {
+    return replayEnabled;
+}
+
+void DisplayList::invalidateAll() {
+    generation++;
+}
+
+/* Combine the widget's hash with everything else the vertices depend on */
+static uint64_t recordingKey(NVGcontext *ctx, uint64_t hash, float devicePixelRatio) {
+    float xform[6];
+    nvgCurrentTransform(ctx, xform);
+    uint64_t gen = generation;
+    DrawStateHash key;
+    key.add(&hash, sizeof(hash)).add(&gen, sizeof(gen));
+    key.add(xform, sizeof(xform)).add(devicePixelRatio);
+    return key.value();
+}
+
+bool DisplayList::replay(NVGcontext *ctx, uint64_t hash) {
+    if (!mRecording || !mRecording->valid || !replayEnabled)
+        return false;
+
+    NVGparams *params = nvgInternalParams(ctx);
+    DisplayListHook *hook = findHook(params->userPtr);
+    if (!hook || mRecording->key != recordingKey(ctx, hash, hook->devicePixelRatio))
+        return false;
+
+    /* Font atlas pages and other images may have been replaced since */
+    int lastImage = 0;
+    for (const auto &command : mRecording->commands) {
+        int image = command.paint.image;
+        if (image == 0 || image == lastImage)
+            continue;
+        int w, h;
+        if (!hook->original.renderGetTextureSize(params->userPtr, image, &w, &h)) {
+            clear();
+            return false;
+        }
+        lastImage = image;
+    }
+
+    /* Go through the hooked callbacks so that enclosing recordings and the
+       render statistics see the replayed calls */
+    for (auto &command : mRecording->commands) {
+        NVGpaint paint = command.paint;
+        NVGscissor scissor = command.scissor;
+        switch (command.type) {
+            case Recording::CommandType::Fill:
+                params->renderFill(params->userPtr, &paint, command.compositeOperation,
+                                   &scissor, command.fringe, command.bounds,
+                                   mRecording->paths.data() + command.firstPath,
+                                   (int) command.pathCount);
+                break;
+            case Recording::CommandType::Stroke:
+                params->renderStroke(params->userPtr, &paint, command.compositeOperation,
+                                     &scissor, command.fringe, command.strokeWidth,
+                                     mRecording->paths.data() + command.firstPath,
+                                     (int) command.pathCount);
+                break;
+            case Recording::CommandType::Triangles:
+                params->renderTriangles(params->userPtr, &paint, command.compositeOperation,
+                                        &scissor, mRecording->vertices.data() + command.firstVertex,
+                                        (int) command.vertexCount);
+                break;
+        }
+    }
+    return true;
+}
+
+void DisplayList::begin(NVGcontext *ctx, uint64_t hash) {
+    clear();
+    if (!replayEnabled)
+        return;
+
+    NVGparams *params = nvgInternalParams(ctx);
+    DisplayListHook *hook = findHook(params->userPtr);
+    if (!hook)
+        return;
+
+    mRecording.reset(new Recording());
+    mRecording->key = recordingKey(ctx, hash, hook->devicePixelRatio);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    hook->recordings.push_back(mRecording.get());
+}
+
+void DisplayList::end(NVGcontext *ctx) {
+    if (!mRecording)
+        return;
+
+    NVGparams *params = nvgInternalParams(ctx);
+    DisplayListHook *hook = findHook(params->userPtr);
+    if (hook) {
+        std::lock_guard<std::mutex> guard(hookMutex);
+        auto &recordings = hook->recordings;
+        recordings.erase(std::remove(recordings.begin(), recordings.end(), mRecording.get()),
+                         recordings.end());
+    }
+
+    mRecording->finish();
+    mRecording->valid = true;
+}
+
+NAMESPACE_END(nanogui)
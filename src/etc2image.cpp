@@ -0,0 +1,731 @@
+/*
+    src/etc2image.cpp -- ETC2 / EAC encoder and decoder, KTX files
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/etc2image.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define NANOGUI_ETC2_SSE2
+#endif
+
+#if !defined(GL_ETC1_RGB8_OES)
+#  define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#if !defined(GL_COMPRESSED_RGB8_ETC2)
+#  define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#if !defined(GL_COMPRESSED_RGBA8_ETC2_EAC)
+#  define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+NAMESPACE_BEGIN(nanogui)
+
+namespace {
+
+const uint8_t ktxIdentifier[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+/* Intensity modifiers of the individual and differential modes, in the
+   order of the pixel index values (+a, +b, -a, -b) */
+const int modifierTable[8][4] = {
+    {  2,   8,  -2,   -8 }, {  5,  17,  -5,  -17 }, {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 }, { 18,  60, -18,  -60 }, { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 }, { 47, 183, -47, -183 }
+};
+
+/* Distances of the T and H modes */
+const int distanceTable[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+/* EAC alpha modifiers, multiplied by the block's multiplier */
+const int alphaTable[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 }, { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 }, { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 }, { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 }, { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 }, { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 }, { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 }, { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+inline int clamp255(int v) { return v < 0 ? 0 : (v > 255 ? 255 : v); }
+inline int extend4(int v) { return (v << 4) | v; }
+inline int extend5(int v) { return (v << 3) | (v >> 2); }
+inline int extend6(int v) { return (v << 2) | (v >> 4); }
+inline int extend7(int v) { return (v << 1) | (v >> 6); }
+
+/* Nearest value with 'bits' bits, for a color in [0, 255] */
+inline int quantize(float value, int bits) {
+    int maximum = (1 << bits) - 1;
+    return std::min(std::max((int) (value * maximum / 255.f + 0.5f), 0), maximum);
+}
+
+inline uint64_t readBE64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+        value = (value << 8) | p[i];
+    return value;
+}
+
+inline void writeBE64(uint8_t *p, uint64_t value) {
+    for (int i = 7; i >= 0; --i, value >>= 8)
+        p[i] = (uint8_t) value;
+}
+
+/* The pixels of a 4x4 block. Pixel i lies at x = i / 4, y = i % 4, the
+   order of the index bits of both ETC2 and EAC. */
+struct Block {
+    int rgba[16][4];
+};
+
+/* The eight pixels of a block that share a base color */
+struct HalfBlock {
+    int pixel[8];
+    int rgb[8][3];
+#if defined(NANOGUI_ETC2_SSE2)
+    /* r0 g0 r1 g1 ... and b0 0 b1 0 ..., the layout _mm_madd_epi16 squares and sums */
+    alignas(16) int16_t rg[16];
+    alignas(16) int16_t b[16];
+#endif
+    float average[3];
+
+    void setup(const Block &block, bool flip, int half) {
+        int n = 0;
+        average[0] = average[1] = average[2] = 0.f;
+        for (int i = 0; i < 16; ++i) {
+            int x = i / 4, y = i % 4;
+            if ((flip ? y / 2 : x / 2) != half)
+                continue;
+            pixel[n] = i;
+            for (int c = 0; c < 3; ++c) {
+                rgb[n][c] = block.rgba[i][c];
+                average[c] += block.rgba[i][c] / 8.f;
+            }
+#if defined(NANOGUI_ETC2_SSE2)
+            rg[2 * n] = (int16_t) rgb[n][0];
+            rg[2 * n + 1] = (int16_t) rgb[n][1];
+            b[2 * n] = (int16_t) rgb[n][2];
+            b[2 * n + 1] = 0;
+#endif
+            n++;
+        }
+    }
+};
+
+/* Squared error of the half block when every pixel picks its best modifier
+   around 'base'; the picked index values are written to 'indices' */
+uint32_t fitModifiers(const HalfBlock &half, const int base[3], const int *modifiers,
+                      uint8_t *indices) {
+#if defined(NANOGUI_ETC2_SSE2)
+    const __m128i rg0 = _mm_load_si128((const __m128i *) half.rg);
+    const __m128i rg1 = _mm_load_si128((const __m128i *) (half.rg + 8));
+    const __m128i b0 = _mm_load_si128((const __m128i *) half.b);
+    const __m128i b1 = _mm_load_si128((const __m128i *) (half.b + 8));
+    __m128i best0 = _mm_set1_epi32(INT32_MAX), best1 = best0;
+    __m128i index0 = _mm_setzero_si128(), index1 = index0;
+
+    for (int k = 0; k < 4; ++k) {
+        int r = clamp255(base[0] + modifiers[k]);
+        int g = clamp255(base[1] + modifiers[k]);
+        int b = clamp255(base[2] + modifiers[k]);
+        const __m128i colorRG = _mm_set1_epi32((g << 16) | r);
+        const __m128i colorB = _mm_set1_epi32(b);
+        const __m128i value = _mm_set1_epi32(k);
+
+        __m128i d = _mm_sub_epi16(rg0, colorRG);
+        __m128i e = _mm_madd_epi16(d, d);
+        d = _mm_sub_epi16(b0, colorB);
+        e = _mm_add_epi32(e, _mm_madd_epi16(d, d));
+        __m128i less = _mm_cmplt_epi32(e, best0);
+        best0 = _mm_or_si128(_mm_and_si128(less, e), _mm_andnot_si128(less, best0));
+        index0 = _mm_or_si128(_mm_and_si128(less, value), _mm_andnot_si128(less, index0));
+
+        d = _mm_sub_epi16(rg1, colorRG);
+        e = _mm_madd_epi16(d, d);
+        d = _mm_sub_epi16(b1, colorB);
+        e = _mm_add_epi32(e, _mm_madd_epi16(d, d));
+        less = _mm_cmplt_epi32(e, best1);
+        best1 = _mm_or_si128(_mm_and_si128(less, e), _mm_andnot_si128(less, best1));
+        index1 = _mm_or_si128(_mm_and_si128(less, value), _mm_andnot_si128(less, index1));
+    }
+
+    __m128i sum = _mm_add_epi32(best0, best1);
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    alignas(16) int32_t values[8];
+    _mm_store_si128((__m128i *) values, index0);
+    _mm_store_si128((__m128i *) (values + 4), index1);
+    for (int i = 0; i < 8; ++i)
+        indices[i] = (uint8_t) values[i];
+    return (uint32_t) _mm_cvtsi128_si32(sum);
+#else
+    int colors[4][3];
+    for (int k = 0; k < 4; ++k)
+        for (int c = 0; c < 3; ++c)
+            colors[k][c] = clamp255(base[c] + modifiers[k]);
+
+    uint32_t error = 0;
+    for (int i = 0; i < 8; ++i) {
+        uint32_t best = UINT32_MAX;
+        for (int k = 0; k < 4; ++k) {
+            int dr = half.rgb[i][0] - colors[k][0];
+            int dg = half.rgb[i][1] - colors[k][1];
+            int db = half.rgb[i][2] - colors[k][2];
+            uint32_t e = (uint32_t) (dr * dr + dg * dg + db * db);
+            if (e < best) {
+                best = e;
+                indices[i] = (uint8_t) k;
+            }
+        }
+        error += best;
+    }
+    return error;
+#endif
+}
+
+/* Best modifier table for a base color */
+uint32_t fitTable(const HalfBlock &half, const int base[3], int &table, uint8_t *indices) {
+    uint32_t bestError = UINT32_MAX;
+    uint8_t candidate[8];
+    for (int t = 0; t < 8; ++t) {
+        uint32_t error = fitModifiers(half, base, modifierTable[t], candidate);
+        if (error < bestError) {
+            bestError = error;
+            table = t;
+            memcpy(indices, candidate, 8);
+        }
+    }
+    return bestError;
+}
+
+/* Two bits per pixel: the MSBs in bits 31..16, the LSBs in bits 15..0 */
+uint64_t packIndices(const HalfBlock *halves, uint8_t indices[2][8]) {
+    uint64_t bits = 0;
+    for (int h = 0; h < 2; ++h) {
+        for (int i = 0; i < 8; ++i) {
+            int p = halves[h].pixel[i];
+            bits |= (uint64_t) (indices[h][i] >> 1) << (16 + p);
+            bits |= (uint64_t) (indices[h][i] & 1) << p;
+        }
+    }
+    return bits;
+}
+
+/* ETC1 compatible modes: one base color per half block, coded either
+   independently (4 bits per channel) or as a 5 bit color plus a 3 bit
+   difference */
+uint64_t encodeHalves(const Block &block, uint64_t &bestError) {
+    uint64_t best = 0;
+    for (int flip = 0; flip < 2; ++flip) {
+        HalfBlock halves[2];
+        halves[0].setup(block, flip != 0, 0);
+        halves[1].setup(block, flip != 0, 1);
+
+        for (int differential = 0; differential < 2; ++differential) {
+            int quantized[2][3], base[2][3], table[2] = { 0, 0 };
+            uint8_t indices[2][8];
+            for (int h = 0; h < 2; ++h) {
+                for (int c = 0; c < 3; ++c) {
+                    quantized[h][c] = quantize(halves[h].average[c], differential ? 5 : 4);
+                    if (differential && h == 1) {
+                        /* The difference has to fit into 3 signed bits */
+                        int delta = std::min(std::max(quantized[1][c] - quantized[0][c], -4), 3);
+                        quantized[1][c] = quantized[0][c] + delta;
+                    }
+                    base[h][c] = differential ? extend5(quantized[h][c]) : extend4(quantized[h][c]);
+                }
+            }
+            uint64_t error = fitTable(halves[0], base[0], table[0], indices[0]);
+            if (error >= bestError)
+                continue;
+            error += fitTable(halves[1], base[1], table[1], indices[1]);
+            if (error >= bestError)
+                continue;
+
+            uint64_t bits = 0;
+            if (differential) {
+                for (int c = 0; c < 3; ++c) {
+                    int delta = quantized[1][c] - quantized[0][c];
+                    bits |= (uint64_t) quantized[0][c] << (59 - 8 * c);
+                    bits |= (uint64_t) (delta & 7) << (56 - 8 * c);
+                }
+            } else {
+                for (int c = 0; c < 3; ++c) {
+                    bits |= (uint64_t) quantized[0][c] << (60 - 8 * c);
+                    bits |= (uint64_t) quantized[1][c] << (56 - 8 * c);
+                }
+            }
+            bits |= (uint64_t) table[0] << 37;
+            bits |= (uint64_t) table[1] << 34;
+            bits |= (uint64_t) differential << 33;
+            bits |= (uint64_t) flip << 32;
+            bits |= packIndices(halves, indices);
+            best = bits;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+void decodeColor(uint64_t bits, uint8_t out[16][4]);
+
+/* Planar mode: a linear gradient through the colors O (top left),
+   H (top right) and V (bottom left), fitted by least squares */
+uint64_t encodePlanar(const Block &block, uint64_t &error) {
+    static const int bitCount[3] = { 6, 7, 6 };
+    int o[3], h[3], v[3];
+    for (int c = 0; c < 3; ++c) {
+        /* On the 4x4 grid the x and y slopes are independent of each other */
+        float mean = 0.f, slopeX = 0.f, slopeY = 0.f;
+        for (int i = 0; i < 16; ++i) {
+            float p = (float) block.rgba[i][c];
+            mean += p;
+            slopeX += (i / 4 - 1.5f) * p;
+            slopeY += (i % 4 - 1.5f) * p;
+        }
+        mean /= 16.f;
+        slopeX /= 20.f;
+        slopeY /= 20.f;
+        float origin = mean - 1.5f * (slopeX + slopeY);
+        o[c] = quantize(origin, bitCount[c]);
+        h[c] = quantize(origin + 4.f * slopeX, bitCount[c]);
+        v[c] = quantize(origin + 4.f * slopeY, bitCount[c]);
+    }
+
+    uint64_t bits = 0;
+    bits |= (uint64_t) o[0] << 57;
+    bits |= (uint64_t) (o[1] >> 6) << 56;
+    bits |= (uint64_t) (o[1] & 63) << 49;
+    bits |= (uint64_t) (o[2] >> 5) << 48;
+    bits |= (uint64_t) ((o[2] >> 3) & 3) << 43;
+    bits |= (uint64_t) (o[2] & 7) << 39;
+    bits |= (uint64_t) (h[0] >> 1) << 34;
+    bits |= (uint64_t) 1 << 33;
+    bits |= (uint64_t) (h[0] & 1) << 32;
+    bits |= (uint64_t) h[1] << 25;
+    bits |= (uint64_t) h[2] << 19;
+    bits |= (uint64_t) v[0] << 13;
+    bits |= (uint64_t) v[1] << 6;
+    bits |= (uint64_t) v[2];
+
+    /* The mode is signalled by the red and green differences staying in
+       range while the blue one overflows; the unused bits are chosen to
+       make it so */
+    int r = (int) ((bits >> 59) & 15), dr = (int) ((bits >> 56) & 7);
+    if (dr >= 4 && r + dr - 8 < 0)
+        bits |= (uint64_t) 1 << 63;
+    int g = (int) ((bits >> 51) & 15), dg = (int) ((bits >> 48) & 7);
+    if (dg >= 4 && g + dg - 8 < 0)
+        bits |= (uint64_t) 1 << 55;
+    int b = (o[2] >> 3) & 3, db = (int) ((bits >> 40) & 3);
+    if (b + db > 3)
+        bits |= (uint64_t) 7 << 45;
+    else
+        bits |= (uint64_t) 1 << 42;
+
+    uint8_t decoded[16][4];
+    decodeColor(bits, decoded);
+    error = 0;
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            int d = decoded[i][c] - block.rgba[i][c];
+            error += (uint64_t) (d * d);
+        }
+    }
+    return bits;
+}
+
+uint64_t encodeColor(const Block &block) {
+    uint64_t error = UINT64_MAX, planarError;
+    uint64_t bits = encodeHalves(block, error);
+    uint64_t planar = encodePlanar(block, planarError);
+    return planarError < error ? planar : bits;
+}
+
+/* EAC: a base value plus one of 8 modifiers (from one of 16 tables) times a multiplier */
+uint64_t encodeAlpha(const Block &block) {
+    int minimum = 255, maximum = 0;
+    for (int i = 0; i < 16; ++i) {
+        minimum = std::min(minimum, block.rgba[i][3]);
+        maximum = std::max(maximum, block.rgba[i][3]);
+    }
+
+    int bestBase = minimum, bestMultiplier = 1, bestTable = 13;
+    uint64_t indexBits = 0;
+    if (minimum == maximum) {
+        /* Modifier 4 of table 13 is zero */
+        for (int i = 0; i < 16; ++i)
+            indexBits |= (uint64_t) 4 << (45 - 3 * i);
+    } else {
+        uint32_t bestError = UINT32_MAX;
+        for (int t = 0; t < 16 && bestError > 0; ++t) {
+            const int *modifiers = alphaTable[t];
+            float multiplier = (maximum - minimum) / (float) (modifiers[7] - modifiers[3]);
+            int first = std::max(1, (int) multiplier);
+            for (int m = first; m <= std::min(first + 1, 15); ++m) {
+                int base = clamp255((int) std::lround((minimum + maximum) * 0.5f -
+                                                      m * (modifiers[7] + modifiers[3]) * 0.5f));
+                uint32_t error = 0;
+                uint64_t bits = 0;
+                for (int i = 0; i < 16 && error < bestError; ++i) {
+                    int a = block.rgba[i][3], best = INT32_MAX, index = 0;
+                    for (int k = 0; k < 8; ++k) {
+                        int d = clamp255(base + modifiers[k] * m) - a;
+                        if (d * d < best) {
+                            best = d * d;
+                            index = k;
+                        }
+                    }
+                    error += (uint32_t) best;
+                    bits |= (uint64_t) index << (45 - 3 * i);
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestBase = base;
+                    bestMultiplier = m;
+                    bestTable = t;
+                    indexBits = bits;
+                }
+            }
+        }
+    }
+    return ((uint64_t) bestBase << 56) | ((uint64_t) bestMultiplier << 52) |
+           ((uint64_t) bestTable << 48) | indexBits;
+}
+
+void decodeColor(uint64_t bits, uint8_t out[16][4]) {
+    auto paint = [&](const int colors[4][3]) {
+        for (int i = 0; i < 16; ++i) {
+            int index = (int) (((bits >> (16 + i)) & 1) << 1 | ((bits >> i) & 1));
+            for (int c = 0; c < 3; ++c)
+                out[i][c] = (uint8_t) colors[index][c];
+        }
+    };
+
+    bool differential = (bits >> 33) & 1;
+    int channel[3], delta[3];
+    for (int c = 0; c < 3; ++c) {
+        channel[c] = (int) ((bits >> (59 - 8 * c)) & 31);
+        delta[c] = (int) ((bits >> (56 - 8 * c)) & 7);
+        if (delta[c] >= 4)
+            delta[c] -= 8;
+    }
+
+    if (differential && (channel[0] + delta[0] < 0 || channel[0] + delta[0] > 31)) {
+        /* T mode */
+        int c1[3] = { extend4((int) (((bits >> 59) & 3) << 2 | ((bits >> 56) & 3))),
+                      extend4((int) ((bits >> 52) & 15)), extend4((int) ((bits >> 48) & 15)) };
+        int c2[3] = { extend4((int) ((bits >> 44) & 15)), extend4((int) ((bits >> 40) & 15)),
+                      extend4((int) ((bits >> 36) & 15)) };
+        int d = distanceTable[((bits >> 34) & 3) << 1 | ((bits >> 32) & 1)];
+        int colors[4][3];
+        for (int c = 0; c < 3; ++c) {
+            colors[0][c] = c1[c];
+            colors[1][c] = clamp255(c2[c] + d);
+            colors[2][c] = c2[c];
+            colors[3][c] = clamp255(c2[c] - d);
+        }
+        paint(colors);
+    } else if (differential && (channel[1] + delta[1] < 0 || channel[1] + delta[1] > 31)) {
+        /* H mode */
+        int r1 = (int) ((bits >> 59) & 15);
+        int g1 = (int) (((bits >> 56) & 7) << 1 | ((bits >> 52) & 1));
+        int b1 = (int) (((bits >> 51) & 1) << 3 | ((bits >> 47) & 7));
+        int r2 = (int) ((bits >> 43) & 15), g2 = (int) ((bits >> 39) & 15);
+        int b2 = (int) ((bits >> 35) & 15);
+        int index = (int) (((bits >> 34) & 1) << 2 | ((bits >> 32) & 1) << 1);
+        if (((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2))
+            index |= 1;
+        int d = distanceTable[index];
+        int c1[3] = { extend4(r1), extend4(g1), extend4(b1) };
+        int c2[3] = { extend4(r2), extend4(g2), extend4(b2) };
+        int colors[4][3];
+        for (int c = 0; c < 3; ++c) {
+            colors[0][c] = clamp255(c1[c] + d);
+            colors[1][c] = clamp255(c1[c] - d);
+            colors[2][c] = clamp255(c2[c] + d);
+            colors[3][c] = clamp255(c2[c] - d);
+        }
+        paint(colors);
+    } else if (differential && (channel[2] + delta[2] < 0 || channel[2] + delta[2] > 31)) {
+        /* Planar mode */
+        int o[3] = { extend6((int) ((bits >> 57) & 63)),
+                     extend7((int) (((bits >> 56) & 1) << 6 | ((bits >> 49) & 63))),
+                     extend6((int) (((bits >> 48) & 1) << 5 | ((bits >> 43) & 3) << 3 |
+                                    ((bits >> 39) & 7))) };
+        int h[3] = { extend6((int) (((bits >> 34) & 31) << 1 | ((bits >> 32) & 1))),
+                     extend7((int) ((bits >> 25) & 127)), extend6((int) ((bits >> 19) & 63)) };
+        int v[3] = { extend6((int) ((bits >> 13) & 63)), extend7((int) ((bits >> 6) & 127)),
+                     extend6((int) (bits & 63)) };
+        for (int i = 0; i < 16; ++i) {
+            int x = i / 4, y = i % 4;
+            for (int c = 0; c < 3; ++c)
+                out[i][c] = (uint8_t) clamp255((x * (h[c] - o[c]) + y * (v[c] - o[c]) +
+                                                4 * o[c] + 2) >> 2);
+        }
+    } else {
+        /* Individual or differential mode */
+        int base[2][3];
+        for (int c = 0; c < 3; ++c) {
+            if (differential) {
+                base[0][c] = extend5(channel[c]);
+                base[1][c] = extend5(channel[c] + delta[c]);
+            } else {
+                base[0][c] = extend4((int) ((bits >> (60 - 8 * c)) & 15));
+                base[1][c] = extend4((int) ((bits >> (56 - 8 * c)) & 15));
+            }
+        }
+        const int *tables[2] = { modifierTable[(bits >> 37) & 7], modifierTable[(bits >> 34) & 7] };
+        bool flip = (bits >> 32) & 1;
+        for (int i = 0; i < 16; ++i) {
+            int x = i / 4, y = i % 4, half = flip ? y / 2 : x / 2;
+            int index = (int) (((bits >> (16 + i)) & 1) << 1 | ((bits >> i) & 1));
+            for (int c = 0; c < 3; ++c)
+                out[i][c] = (uint8_t) clamp255(base[half][c] + tables[half][index]);
+        }
+    }
+}
+
+void decodeAlpha(uint64_t bits, uint8_t out[16][4]) {
+    int base = (int) (bits >> 56), multiplier = (int) ((bits >> 52) & 15);
+    const int *modifiers = alphaTable[(bits >> 48) & 15];
+    for (int i = 0; i < 16; ++i)
+        out[i][3] = (uint8_t) clamp255(base + modifiers[(bits >> (45 - 3 * i)) & 7] * multiplier);
+}
+
+struct KTXHeader {
+    uint8_t identifier[12];
+    uint32_t endianness;
+    uint32_t glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat;
+    uint32_t pixelWidth, pixelHeight, pixelDepth;
+    uint32_t numberOfArrayElements, numberOfFaces, numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+uint32_t swap32(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+}
+
+} // namespace
+
+ETC2Image::ETC2Image(const std::string &fileName)
+    : mWidth(0), mHeight(0), mFormat(Format::RGB8) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("ETC2Image: could not open \"" + fileName + "\"!");
+
+    KTXHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) == 0;
+    bool swap = ok && header.endianness == 0x01020304;
+    if (ok && swap) {
+        uint32_t *fields = &header.glType;
+        for (int i = 0; i < 12; ++i)
+            fields[i] = swap32(fields[i]);
+    }
+    ok = ok && (swap || header.endianness == 0x04030201);
+    if (!ok) {
+        fclose(file);
+        throw std::runtime_error("ETC2Image: \"" + fileName + "\" is not a KTX file!");
+    }
+
+    if (header.glInternalFormat == GL_COMPRESSED_RGBA8_ETC2_EAC)
+        mFormat = Format::RGBA8;
+    else if (header.glInternalFormat != GL_COMPRESSED_RGB8_ETC2 &&
+             header.glInternalFormat != GL_ETC1_RGB8_OES)
+        ok = false;
+    ok = ok && header.glType == 0 && header.pixelWidth > 0 && header.pixelHeight > 0 &&
+         header.pixelDepth == 0 && header.numberOfFaces == 1 &&
+         header.numberOfArrayElements == 0 &&
+         header.pixelWidth <= 16384 && header.pixelHeight <= 16384;
+    if (!ok) {
+        fclose(file);
+        throw std::runtime_error("ETC2Image: \"" + fileName + "\" does not hold an ETC2 image!");
+    }
+    mWidth = (int) header.pixelWidth;
+    mHeight = (int) header.pixelHeight;
+
+    size_t blockBytes = mFormat == Format::RGBA8 ? 16 : 8;
+    size_t size = (size_t) ((mWidth + 3) / 4) * ((mHeight + 3) / 4) * blockBytes;
+    uint32_t imageSize = 0;
+    ok = fseek(file, (long) header.bytesOfKeyValueData, SEEK_CUR) == 0 &&
+         fread(&imageSize, sizeof(imageSize), 1, file) == 1;
+    if (swap)
+        imageSize = swap32(imageSize);
+    mData.resize(size);
+    ok = ok && imageSize >= size && fread(mData.data(), size, 1, file) == 1;
+    fclose(file);
+    if (!ok)
+        throw std::runtime_error("ETC2Image: \"" + fileName + "\" is truncated!");
+}
+
+ETC2Image::ETC2Image(const uint8_t *rgba, int width, int height, Format format,
+                     int threadCount)
+    : mWidth(width), mHeight(height), mFormat(format) {
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("ETC2Image: invalid image size!");
+
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockBytes = format == Format::RGBA8 ? 16 : 8;
+    mData.resize((size_t) blocksX * blocksY * blockBytes);
+
+    /* Threads take rows of blocks as they become free */
+    std::atomic<int> nextRow(0);
+    auto encodeRows = [&]() {
+        Block block;
+        int by;
+        while ((by = nextRow++) < blocksY) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                /* Blocks reaching past the edge repeat the last row / column */
+                for (int i = 0; i < 16; ++i) {
+                    int x = std::min(bx * 4 + i / 4, width - 1);
+                    int y = std::min(by * 4 + i % 4, height - 1);
+                    const uint8_t *p = rgba + ((size_t) y * width + x) * 4;
+                    for (int c = 0; c < 4; ++c)
+                        block.rgba[i][c] = p[c];
+                }
+                uint8_t *out = mData.data() + ((size_t) by * blocksX + bx) * blockBytes;
+                if (format == Format::RGBA8) {
+                    writeBE64(out, encodeAlpha(block));
+                    out += 8;
+                }
+                writeBE64(out, encodeColor(block));
+            }
+        }
+    };
+
+    if (threadCount <= 0)
+        threadCount = (int) std::thread::hardware_concurrency();
+    threadCount = std::max(1, std::min(threadCount, blocksY));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; ++i)
+        threads.emplace_back(encodeRows);
+    encodeRows();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+bool ETC2Image::isKTX(const std::string &fileName) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        return false;
+    uint8_t identifier[sizeof(ktxIdentifier)];
+    bool result = fread(identifier, sizeof(identifier), 1, file) == 1 &&
+                  memcmp(identifier, ktxIdentifier, sizeof(ktxIdentifier)) == 0;
+    fclose(file);
+    return result;
+}
+
+bool ETC2Image::hasAlpha(const uint8_t *rgba, int width, int height) {
+    size_t count = (size_t) width * height;
+    for (size_t i = 0; i < count; ++i)
+        if (rgba[i * 4 + 3] != 255)
+            return true;
+    return false;
+}
+
+GLenum ETC2Image::internalFormat() const {
+    return mFormat == Format::RGBA8 ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_COMPRESSED_RGB8_ETC2;
+}
+
+void ETC2Image::save(const std::string &fileName) const {
+    KTXHeader header;
+    memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.endianness = 0x04030201;
+    header.glType = 0;
+    header.glTypeSize = 1;
+    header.glFormat = 0;
+    header.glInternalFormat = internalFormat();
+    header.glBaseInternalFormat = mFormat == Format::RGBA8 ? GL_RGBA : GL_RGB;
+    header.pixelWidth = (uint32_t) mWidth;
+    header.pixelHeight = (uint32_t) mHeight;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = 1;
+    header.bytesOfKeyValueData = 0;
+    uint32_t imageSize = (uint32_t) mData.size();
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("ETC2Image::save(): could not open \"" + fileName + "\"!");
+    /* Blocks are a multiple of 4 bytes, no padding follows them */
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(&imageSize, sizeof(imageSize), 1, file) == 1 &&
+              fwrite(mData.data(), mData.size(), 1, file) == 1;
+    if (fclose(file) != 0 || !ok)
+        throw std::runtime_error("ETC2Image::save(): could not write \"" + fileName + "\"!");
+}
+
+void ETC2Image::decode(uint8_t *rgba) const {
+    int blocksX = (mWidth + 3) / 4, blocksY = (mHeight + 3) / 4;
+    size_t blockBytes = mFormat == Format::RGBA8 ? 16 : 8;
+    uint8_t pixels[16][4];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const uint8_t *block = mData.data() + ((size_t) by * blocksX + bx) * blockBytes;
+            if (mFormat == Format::RGBA8) {
+                decodeAlpha(readBE64(block), pixels);
+                block += 8;
+            } else {
+                for (int i = 0; i < 16; ++i)
+                    pixels[i][3] = 255;
+            }
+            decodeColor(readBE64(block), pixels);
+
+            for (int i = 0; i < 16; ++i) {
+                int x = bx * 4 + i / 4, y = by * 4 + i % 4;
+                if (x < mWidth && y < mHeight)
+                    memcpy(rgba + ((size_t) y * mWidth + x) * 4, pixels[i], 4);
+            }
+        }
+    }
+}
+
+size_t ETC2Image::upload() const {
+    GLenum format = internalFormat();
+    if (supported(format)) {
+        /* Drivers may list the format yet reject some images, check */
+        glGetError();
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, mWidth, mHeight, 0,
+                               (GLsizei) mData.size(), mData.data());
+        if (glGetError() == GL_NO_ERROR)
+            return mData.size();
+    }
+
+    std::vector<uint8_t> rgba((size_t) mWidth * mHeight * 4);
+    decode(rgba.data());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 rgba.data());
+    return rgba.size();
+}
+
+bool ETC2Image::supported(GLenum internalFormat) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    if (count <= 0)
+        return false;
+    std::vector<GLint> formats((size_t) count);
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    return std::find(formats.begin(), formats.end(), (GLint) internalFormat) != formats.end();
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,117 @@
+/*
+    src/example_displaylist.cpp -- Measures the CPU time per frame of a
+    screen full of static widget chrome (windows, buttons, labels and
+    color wheels), once drawn through NanoVG and once replayed from the
+    widgets' display lists
+
+    Usage: example_displaylist [windows]
+
+    Vertical sync is disabled and the buffer swap is not part of the
+    measured time, so the numbers reflect what the CPU spends building the
+    frame. Each configuration is warmed up first (which also records the
+    display lists) and then reported as mean and median over all frames.
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/opengl.h>
+#include <nanogui/screen.h>
+#include <nanogui/window.h>
+#include <nanogui/layout.h>
+#include <nanogui/label.h>
+#include <nanogui/button.h>
+#include <nanogui/colorwheel.h>
+#include <nanogui/displaylist.h>
+#include <nanogui/entypo.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace nanogui;
+
+static const int WARMUP_FRAMES = 30;
+static const int MEASURED_FRAMES = 500;
+
+struct Measurement {
+    double drawCalls = 0;
+    double meanTime = 0;
+    double medianTime = 0;
+};
+
+static Measurement measure(Screen *screen, bool displayLists) {
+    DisplayList::setEnabled(displayLists);
+    for (int i = 0; i < WARMUP_FRAMES; ++i) {
+        glfwPollEvents();
+        screen->drawAll();
+    }
+
+    Measurement m;
+    std::vector<double> times;
+    for (int i = 0; i < MEASURED_FRAMES; ++i) {
+        glfwPollEvents();
+        screen->drawAll();
+        times.push_back(screen->renderStats().frameTime);
+        m.drawCalls += screen->renderStats().drawCalls();
+        m.meanTime += times.back();
+    }
+    m.drawCalls /= MEASURED_FRAMES;
+    m.meanTime /= MEASURED_FRAMES;
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    m.medianTime = times[times.size() / 2];
+    return m;
+}
+
+int main(int argc, char **argv) {
+    try {
+        int windowCount = argc > 1 ? std::max(1, atoi(argv[1])) : 24;
+
+        nanogui::init();
+
+        /* scoped variables */ {
+            ref<Screen> screen = new Screen(Vector2i(1280, 960), "Display list benchmark", false);
+            glfwSwapInterval(0);
+
+            const int columns = 6;
+            for (int i = 0; i < windowCount; ++i) {
+                Window *window = new Window(screen, "Window " + std::to_string(i));
+                window->setPosition(Vector2i(10 + (i % columns) * 210, 10 + (i / columns) * 230));
+                window->setLayout(new GroupLayout());
+                new Label(window, "Push buttons", "sans-bold");
+                new Button(window, "Plain button");
+                new Button(window, "Styled", ENTYPO_ICON_ROCKET);
+                new Label(window, "Color wheel", "sans-bold");
+                ColorWheel *wheel = new ColorWheel(window, Color(0.1f * (i % 10), 0.5f, 0.8f, 1.f));
+                wheel->setFixedSize(Vector2i(80, 80));
+            }
+            screen->performLayout();
+            screen->drawAll();
+            screen->setVisible(true);
+
+            Measurement drawn = measure(screen, false);
+            Measurement replayed = measure(screen, true);
+
+            printf("%i windows, %i frames each:\n", windowCount, MEASURED_FRAMES);
+            printf("  display lists disabled: %7.3f ms/frame mean, %7.3f median, %6.1f backend calls\n",
+                   drawn.meanTime * 1000, drawn.medianTime * 1000, drawn.drawCalls);
+            printf("  display lists enabled : %7.3f ms/frame mean, %7.3f median, %6.1f backend calls\n",
+                   replayed.meanTime * 1000, replayed.medianTime * 1000, replayed.drawCalls);
+            if (replayed.medianTime > 0)
+                printf("  speedup (median)      : %7.2fx\n", drawn.medianTime / replayed.medianTime);
+        }
+
+        nanogui::shutdown();
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+    src/example_etc2.cpp -- Compresses images with the ETC2 encoder and
+    reports the quality (PSNR) of the result and how fast the encoder is
+    with different numbers of threads
+
+    Usage: example_etc2 [-a] [-o output.ktx] [image files]
+
+      -a               Keep the alpha channel (RGBA8 ETC2 + EAC); by
+                       default images are compressed to RGB8 ETC2
+      -o <file>        Write the last compressed image to a KTX file
+
+    Without image files, a synthetic 1920x1080 slide is drawn with the
+    SoftwareRenderer and compressed.
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/etc2image.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/theme.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+using namespace nanogui;
+
+static const int MEASURED_RUNS = 3;
+
+struct TestImage {
+    std::string name;
+    int width, height;
+    std::vector<uint8_t> rgba;
+};
+
+/* Gradients, shapes and text, the content of a typical slide */
+static TestImage drawSlide() {
+    ref<SoftwareRenderer> renderer = new SoftwareRenderer(1920, 1080);
+    ref<Theme> theme = new Theme(renderer->context());
+    NVGcontext *ctx = renderer->context();
+
+    renderer->beginFrame(Color(0, 255));
+    nvgBeginPath(ctx);
+    nvgRect(ctx, 0, 0, 1920, 1080);
+    nvgFillPaint(ctx, nvgLinearGradient(ctx, 0, 0, 1920, 1080, nvgRGB(20, 40, 120),
+                                        nvgRGB(230, 120, 40)));
+    nvgFill(ctx);
+    for (int i = 0; i < 12; ++i) {
+        float x = 160.f + i * 140.f, y = 700.f + 150.f * std::sin(i * 0.8f);
+        nvgBeginPath(ctx);
+        nvgCircle(ctx, x, y, 40.f + i * 5.f);
+        nvgFillPaint(ctx, nvgRadialGradient(ctx, x, y, 10.f, 100.f, nvgRGBA(255, 255, 255, 220),
+                                            nvgRGBA(0, 160, 90, 160)));
+        nvgFill(ctx);
+    }
+    nvgFontFace(ctx, "sans-bold");
+    nvgFontSize(ctx, 160.f);
+    nvgFillColor(ctx, nvgRGB(255, 255, 255));
+    nvgText(ctx, 120, 260, "Compressed slide", nullptr);
+    nvgFontFace(ctx, "sans");
+    nvgFontSize(ctx, 48.f);
+    for (int i = 0; i < 4; ++i)
+        nvgText(ctx, 130, 380 + i * 60.f, "ETC2 keeps four bits per pixel of this text", nullptr);
+    renderer->endFrame();
+
+    TestImage image { "synthetic slide", 1920, 1080, std::vector<uint8_t>() };
+    image.rgba.assign(renderer->data(), renderer->data() + (size_t) 1920 * 1080 * 4);
+    return image;
+}
+
+static double psnr(double squaredError, size_t count) {
+    if (squaredError == 0)
+        return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 * count / squaredError);
+}
+
+template <typename F> static double measure(F f) {
+    double best = INFINITY;
+    for (int i = 0; i < MEASURED_RUNS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    bool alpha = false;
+    std::string outputFile;
+    std::vector<TestImage> images;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-a") {
+                alpha = true;
+            } else if (arg == "-o" && i + 1 < argc) {
+                outputFile = argv[++i];
+            } else if (!arg.empty() && arg[0] == '-') {
+                std::cerr << "Usage: " << argv[0] << " [-a] [-o output.ktx] [image files]"
+                          << std::endl;
+                return -1;
+            } else {
+                int w, h, n;
+                uint8_t *data = stbi_load(arg.c_str(), &w, &h, &n, 4);
+                if (!data) {
+                    std::cerr << "Could not load \"" << arg << "\"" << std::endl;
+                    return -1;
+                }
+                images.push_back(TestImage { arg, w, h, std::vector<uint8_t>(
+                                                 data, data + (size_t) w * h * 4) });
+                stbi_image_free(data);
+            }
+        }
+        if (images.empty())
+            images.push_back(drawSlide());
+
+        ETC2Image::Format format = alpha ? ETC2Image::Format::RGBA8 : ETC2Image::Format::RGB8;
+        int maxThreads = std::max(1, (int) std::thread::hardware_concurrency());
+        for (const TestImage &image : images) {
+            size_t pixels = (size_t) image.width * image.height;
+            printf("%s: %i x %i, %s\n", image.name.c_str(), image.width, image.height,
+                   alpha ? "RGBA8 ETC2 + EAC" : "RGB8 ETC2");
+
+            ref<ETC2Image> compressed;
+            for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+                double seconds = measure([&]() {
+                    compressed = new ETC2Image(image.rgba.data(), image.width, image.height,
+                                               format, threads);
+                });
+                printf("  encode on %2i threads: %8.2f ms (%.1f MPixel/s)\n", threads,
+                       seconds * 1000, pixels / seconds * 1e-6);
+                if (threads == maxThreads)
+                    break;
+            }
+
+            std::vector<uint8_t> decoded(pixels * 4);
+            double seconds = measure([&]() { compressed->decode(decoded.data()); });
+            printf("  decode:                %8.2f ms (%.1f MPixel/s)\n", seconds * 1000,
+                   pixels / seconds * 1e-6);
+
+            double error[4] = { 0, 0, 0, 0 };
+            for (size_t i = 0; i < decoded.size(); ++i) {
+                double d = (double) decoded[i] - image.rgba[i];
+                error[i % 4] += d * d;
+            }
+            printf("  PSNR: RGB %.2f dB (R %.2f, G %.2f, B %.2f)",
+                   psnr(error[0] + error[1] + error[2], pixels * 3), psnr(error[0], pixels),
+                   psnr(error[1], pixels), psnr(error[2], pixels));
+            if (alpha)
+                printf(", alpha %.2f dB", psnr(error[3], pixels));
+            printf("\n  size: %zu bytes (%.1f%% of RGBA8)\n", compressed->data().size(),
+                   100.0 * compressed->data().size() / (pixels * 4));
+            if (!alpha && ETC2Image::hasAlpha(image.rgba.data(), image.width, image.height))
+                printf("  note: the image has an alpha channel, use -a to keep it\n");
+
+            if (!outputFile.empty() && &image == &images.back())
+                compressed->save(outputFile);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
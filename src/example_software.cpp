@@ -0,0 +1,184 @@
+/*
+    src/example_software.cpp -- Renders the same widgets with OpenGL and
+    with the SoftwareRenderer, reports how much the two images differ and
+    how the software renderer scales with the number of threads
+
+    Usage: example_software [output prefix]
+
+    Writes <prefix>-gl.tga and <prefix>-software.tga (default prefix:
+    "example_software").
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/opengl.h>
+#include <nanogui/screen.h>
+#include <nanogui/window.h>
+#include <nanogui/layout.h>
+#include <nanogui/label.h>
+#include <nanogui/button.h>
+#include <nanogui/checkbox.h>
+#include <nanogui/slider.h>
+#include <nanogui/textbox.h>
+#include <nanogui/colorwheel.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/entypo.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nanogui;
+
+static const int MEASURED_FRAMES = 20;
+
+static void createWidgets(Screen *screen) {
+    Window *window = new Window(screen, "Slide preview");
+    window->setPosition(Vector2i(15, 15));
+    window->setLayout(new GroupLayout());
+
+    new Label(window, "Push buttons", "sans-bold");
+    Button *b = new Button(window, "Plain button");
+    b->setTooltip("short tooltip");
+    b = new Button(window, "Styled", ENTYPO_ICON_ROCKET);
+    b->setBackgroundColor(Color(0, 0, 255, 25));
+
+    new Label(window, "Toggle and check boxes", "sans-bold");
+    b = new Button(window, "Toggle me");
+    b->setFlags(Button::ToggleButton);
+    b->setPushed(true);
+    CheckBox *cb = new CheckBox(window, "Flag 1");
+    cb->setChecked(true);
+    new CheckBox(window, "Flag 2");
+
+    new Label(window, "Slider and text box", "sans-bold");
+    Widget *panel = new Widget(window);
+    panel->setLayout(new BoxLayout(Orientation::Horizontal, Alignment::Middle, 0, 20));
+    Slider *slider = new Slider(panel);
+    slider->setValue(0.5f);
+    slider->setFixedWidth(80);
+    TextBox *textBox = new TextBox(panel);
+    textBox->setFixedSize(Vector2i(60, 25));
+    textBox->setValue("50");
+    textBox->setUnits("%");
+
+    Window *colors = new Window(screen, "Color wheel");
+    colors->setPosition(Vector2i(300, 15));
+    colors->setLayout(new GroupLayout());
+    new ColorWheel(colors);
+
+    screen->performLayout();
+}
+
+/* Read the back buffer, top row first */
+static std::vector<uint8_t> readFramebuffer(const Vector2i &size) {
+    std::vector<uint8_t> pixels((size_t) size.x() * size.y() * 4);
+    std::vector<uint8_t> flipped(pixels.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x(), size.y(), GL_RGBA, GL_UNSIGNED_BYTE, flipped.data());
+    size_t rowBytes = (size_t) size.x() * 4;
+    for (int y = 0; y < size.y(); ++y)
+        memcpy(&pixels[y * rowBytes], &flipped[(size.y() - 1 - y) * rowBytes], rowBytes);
+    return pixels;
+}
+
+static void writeTGA(const std::string &filename, const Vector2i &size,
+                     const std::vector<uint8_t> &rgba) {
+    ref<SoftwareRenderer> image = new SoftwareRenderer(size.x(), size.y());
+    memcpy(image->data(), rgba.data(), rgba.size());
+    image->writeTGA(filename);
+}
+
+static double renderSoftware(Screen *screen, SoftwareRenderer *renderer, int frames) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        renderer->beginFrame(screen->background(), screen->pixelRatio());
+        screen->draw(renderer->context());
+        renderer->endFrame();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / frames;
+}
+
+int main(int argc, char **argv) {
+    try {
+        std::string prefix = argc > 1 ? argv[1] : "example_software";
+
+        nanogui::init();
+
+        /* scoped variables */ {
+            ref<Screen> screen = new Screen(Vector2i(800, 600), "Software renderer", false);
+            createWidgets(screen);
+
+            /* OpenGL reference image */
+            Vector2i fbSize;
+            glfwGetFramebufferSize(screen->glfwWindow(), &fbSize.x(), &fbSize.y());
+            Color bg = screen->background();
+            glClearColor(bg[0], bg[1], bg[2], bg[3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            screen->drawWidgets();
+            glFinish();
+            std::vector<uint8_t> gl = readFramebuffer(fbSize);
+
+            /* Software image: the theme registers the fonts with the new context */
+            ref<SoftwareRenderer> renderer = new SoftwareRenderer(fbSize.x(), fbSize.y());
+            ref<Theme> theme = new Theme(renderer->context());
+            renderSoftware(screen, renderer, 1);
+
+            const uint8_t *sw = renderer->data();
+            double squaredError = 0;
+            int maxError = 0;
+            size_t differing = 0;
+            for (size_t i = 0; i < gl.size(); i += 4) {
+                int pixelError = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int e = std::abs((int) gl[i + c] - (int) sw[i + c]);
+                    squaredError += (double) e * e;
+                    pixelError = std::max(pixelError, e);
+                }
+                maxError = std::max(maxError, pixelError);
+                if (pixelError > 8)
+                    differing++;
+            }
+            double mse = squaredError / (gl.size() / 4 * 3);
+            double psnr = mse > 0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+
+            printf("Framebuffer: %i x %i\n", fbSize.x(), fbSize.y());
+            printf("Max. channel difference: %i\n", maxError);
+            printf("Pixels differing by more than 8: %zu (%.3f%%)\n", differing,
+                   100.0 * differing / (gl.size() / 4));
+            printf("PSNR: %.2f dB\n", psnr);
+
+            writeTGA(prefix + "-gl.tga", fbSize, gl);
+            renderer->writeTGA(prefix + "-software.tga");
+
+            /* Thread scaling */
+            int hardwareThreads = std::max(1, (int) std::thread::hardware_concurrency());
+            renderer->setThreadCount(1);
+            double single = renderSoftware(screen, renderer, MEASURED_FRAMES);
+            printf("Software, 1 thread: %.2f ms/frame\n", single);
+            if (hardwareThreads > 1) {
+                renderer->setThreadCount(hardwareThreads);
+                double multi = renderSoftware(screen, renderer, MEASURED_FRAMES);
+                printf("Software, %i threads: %.2f ms/frame (%.2fx)\n", hardwareThreads,
+                       multi, single / multi);
+            }
+        }
+
+        nanogui::shutdown();
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
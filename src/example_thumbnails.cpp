@@ -0,0 +1,187 @@
+/*
+    src/example_thumbnails.cpp -- Measures draw calls and frame time of an
+    ImagePanel showing 1000 thumbnails, once from the shared texture atlas
+    and once with a separate NanoVG image per thumbnail, how long the
+    thumbnails take to decode compared to decoding the full images, and
+    how long reading just the image sizes from the file headers takes
+
+    Usage: example_thumbnails [image directory]
+
+    Without an argument, 1000 synthetic images are written to a temporary
+    directory first. Point it at a directory of JPEG photos to measure the
+    reduced-scale JPEG decoder. All files of the directory are probed, the
+    first 1000 are shown.
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/opengl.h>
+#include <nanogui/screen.h>
+#include <nanogui/imagepanel.h>
+#include <nanogui/imageinfo.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+using namespace nanogui;
+
+static const int IMAGE_COUNT = 1000;
+static const int MEASURED_FRAMES = 300;
+
+/* Write an uncompressed 24 bit TGA file with a simple gradient pattern */
+static bool writeTestImage(const std::string &filename, int index) {
+    const int w = 320, h = 240;
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+        return false;
+    uint8_t header[18] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                           (uint8_t) (w & 0xFF), (uint8_t) (w >> 8),
+                           (uint8_t) (h & 0xFF), (uint8_t) (h >> 8), 24, 0 };
+    fwrite(header, sizeof(header), 1, file);
+    std::vector<uint8_t> row(w * 3);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            row[x * 3 + 0] = (uint8_t) (x + index * 7);
+            row[x * 3 + 1] = (uint8_t) (y + index * 13);
+            row[x * 3 + 2] = (uint8_t) ((x ^ y) + index);
+        }
+        fwrite(row.data(), row.size(), 1, file);
+    }
+    return fclose(file) == 0;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Measurement {
+    double drawCalls = 0;
+    double frameTime = 0;
+};
+
+static Measurement measure(Screen *screen, int frames) {
+    Measurement m;
+    for (int i = 0; i < frames; ++i) {
+        glfwPollEvents();
+        screen->drawAll();
+        m.drawCalls += screen->renderStats().drawCalls();
+        m.frameTime += screen->renderStats().frameTime;
+    }
+    m.drawCalls /= frames;
+    m.frameTime /= frames;
+    return m;
+}
+
+int main(int argc, char **argv) {
+    try {
+        std::vector<std::string> files;
+        if (argc > 1) {
+            files = listImageDirectory(argv[1]);
+        } else {
+#if defined(_WIN32)
+            std::string directory = ".";
+#else
+            char tmpl[] = "/tmp/nanogui-thumbnails-XXXXXX";
+            std::string directory = mkdtemp(tmpl) ? tmpl : ".";
+#endif
+            for (int i = 0; i < IMAGE_COUNT; ++i) {
+                std::string filename = directory + "/image" + std::to_string(i) + ".tga";
+                if (!writeTestImage(filename, i))
+                    throw std::runtime_error("Could not write " + filename);
+                files.push_back(filename);
+            }
+        }
+
+        /* What a media library needs to list the files: their headers */
+        size_t probed = 0, probedFiles = files.size();
+        auto probeStart = std::chrono::steady_clock::now();
+        for (const auto &file : files) {
+            ImageInfo info;
+            if (ImageInfo::probe(file, info))
+                probed++;
+        }
+        double probeTime = seconds(probeStart);
+
+        if (files.size() > (size_t) IMAGE_COUNT)
+            files.resize(IMAGE_COUNT);
+
+        nanogui::init();
+
+        /* scoped variables */ {
+            ref<Screen> screen = new Screen(Vector2i(1280, 960), "Thumbnail benchmark", false);
+            glfwSwapInterval(0);
+
+            ImagePanel *panel = new ImagePanel(screen);
+            panel->setSize(screen->size());
+
+            /* Atlas: decode in the background, then measure once everything visible is uploaded */
+            panel->setImageFiles(files);
+            do {
+                glfwPollEvents();
+                screen->drawAll();
+            } while (panel->loading());
+            Measurement atlas = measure(screen, MEASURED_FRAMES);
+
+            /* Separate images: the same thumbnails, one NanoVG image each */
+            NVGcontext *ctx = screen->nvgContext();
+            ImagePanel::Images images;
+            double decodeTime = 0;
+            for (const auto &file : files) {
+                std::vector<uint8_t> rgba;
+                int w, h, image = 0;
+                auto start = std::chrono::steady_clock::now();
+                bool decoded = ThumbnailLoader::decode(file, panel->thumbSize(), rgba, w, h);
+                decodeTime += seconds(start);
+                if (decoded)
+                    image = nvgCreateImageRGBA(ctx, w, h, 0, rgba.data());
+                images.push_back(std::make_pair(image > 0 ? image : -1, file));
+            }
+
+            /* What every thumbnail cost before: decoding the full image */
+            auto start = std::chrono::steady_clock::now();
+            for (const auto &file : files) {
+                int w, h, n;
+                uint8_t *data = stbi_load(file.c_str(), &w, &h, &n, 4);
+                if (data)
+                    stbi_image_free(data);
+            }
+            double fullDecodeTime = seconds(start);
+            panel->setImages(images);
+            Measurement separate = measure(screen, MEASURED_FRAMES);
+
+            for (const auto &image : images)
+                if (image.first > 0)
+                    nvgDeleteImage(ctx, image.first);
+
+            printf("%zu thumbnails, averages over %i frames:\n", files.size(), MEASURED_FRAMES);
+            printf("  texture atlas   : %7.1f draw calls, %7.3f ms/frame\n",
+                   atlas.drawCalls, atlas.frameTime * 1000);
+            printf("  separate images : %7.1f draw calls, %7.3f ms/frame\n",
+                   separate.drawCalls, separate.frameTime * 1000);
+            printf("decode time per file:\n");
+            printf("  thumbnail       : %7.3f ms\n", decodeTime * 1000 / files.size());
+            printf("  full image      : %7.3f ms (without downscaling)\n",
+                   fullDecodeTime * 1000 / files.size());
+            printf("  header only     : %7.3f ms (%zu of %zu files probed)\n",
+                   probeTime * 1000 / std::max<size_t>(probedFiles, 1), probed, probedFiles);
+        }
+
+        nanogui::shutdown();
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
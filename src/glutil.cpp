@@ -12,6 +12,14 @@
 #include <nanogui/glutil.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
 #include <Eigen/Geometry>
 
 NAMESPACE_BEGIN(nanogui)
@@ -65,6 +73,189 @@ static GLuint createShader_helper(GLint type, const std::string &name,
     return id;
 }
 
+/* Program cache */
+
+static std::mutex programCacheMutex;
+static std::string programCacheDir;
+static bool programCacheDirInitialized = false;
+
+static std::string defaultProgramCacheDirectory() {
+    if (const char *dir = getenv("NANOGUI_SHADER_CACHE"))
+        return dir;
+    return userCacheDirectory("shaders");
+}
+
+void GLShader::setProgramCacheDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> guard(programCacheMutex);
+    programCacheDir = directory;
+    programCacheDirInitialized = true;
+}
+
+std::string GLShader::programCacheDirectory() {
+    std::lock_guard<std::mutex> guard(programCacheMutex);
+    if (!programCacheDirInitialized) {
+        programCacheDir = defaultProgramCacheDirectory();
+        programCacheDirInitialized = true;
+    }
+    return programCacheDir;
+}
+
+/* glGetProgramBinary() and friends are core in OpenGL 4.1 (ARB_get_program_binary
+   before), so neither the GLAD loader generated for OpenGL 3.3 nor older
+   system headers declare them. They are looked up at runtime instead, and
+   the program cache is disabled if the driver does not have them. */
+#if !defined(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+#  define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#if !defined(GL_PROGRAM_BINARY_LENGTH)
+#  define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#if !defined(GL_NUM_PROGRAM_BINARY_FORMATS)
+#  define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#if defined(_WIN32)
+#  define NANOGUI_GL_CALL __stdcall
+#else
+#  define NANOGUI_GL_CALL
+#endif
+
+struct ProgramBinaryFunctions {
+    void (NANOGUI_GL_CALL *getProgramBinary)(GLuint, GLsizei, GLsizei *, GLenum *, void *);
+    void (NANOGUI_GL_CALL *programBinary)(GLuint, GLenum, const void *, GLsizei);
+    void (NANOGUI_GL_CALL *programParameteri)(GLuint, GLenum, GLint);
+};
+
+/* Return the entry points, or nullptr if the current context lacks them. Some
+   platforms (GLX) return an address for any name, so support is checked first. */
+static const ProgramBinaryFunctions *programBinaryFunctions() {
+    static const ProgramBinaryFunctions functions = []() {
+        ProgramBinaryFunctions f = { nullptr, nullptr, nullptr };
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major * 10 + minor < 41 && !glfwExtensionSupported("GL_ARB_get_program_binary"))
+            return f;
+        f.getProgramBinary = (decltype(f.getProgramBinary)) glfwGetProcAddress("glGetProgramBinary");
+        f.programBinary = (decltype(f.programBinary)) glfwGetProcAddress("glProgramBinary");
+        f.programParameteri = (decltype(f.programParameteri)) glfwGetProcAddress("glProgramParameteri");
+        return f;
+    }();
+    bool available = functions.getProgramBinary && functions.programBinary &&
+                     functions.programParameteri;
+    return available ? &functions : nullptr;
+}
+
+struct ProgramCacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t format, length;
+};
+
+static const char programCacheMagic[8] = { 'N', 'G', 'P', 'R', 'O', 'G', 'B', '1' };
+
+/* FNV-1a over the sources, definitions and driver strings */
+static uint64_t programCacheKey(const std::vector<std::string> &parts) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&hash](const void *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= ((const uint8_t *) data)[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+    for (const auto &part : parts) {
+        uint64_t size = part.size();
+        add(&size, sizeof(size));
+        add(part.data(), part.size());
+    }
+    return hash;
+}
+
+/* Return the cache file of a program, or an empty string if caching is unavailable */
+static std::string programCacheFile(uint64_t key) {
+    if (!programBinaryFunctions())
+        return "";
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    std::string dir = GLShader::programCacheDirectory();
+    if (formats <= 0 || dir.empty())
+        return "";
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+    return dir + "/" + name;
+}
+
+static GLuint loadProgramBinary(const std::string &filename, uint64_t key) {
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    ProgramCacheHeader header;
+    std::vector<uint8_t> binary;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) == 0 &&
+              header.key == key;
+    if (ok) {
+        binary.resize(header.length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        programBinaryFunctions()->programBinary(program, header.format, binary.data(),
+                                                (GLsizei) binary.size());
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    /* Unreadable or rejected by the driver: compile again and replace it */
+    if (!program)
+        remove(filename.c_str());
+    return program;
+}
+
+static void storeProgramBinary(const std::string &filename, uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+    header.key = key;
+    std::vector<uint8_t> binary((size_t) length);
+    GLenum format;
+    programBinaryFunctions()->getProgramBinary(program, length, nullptr, &format, binary.data());
+    header.format = format;
+    header.length = (uint32_t) length;
+
+    size_t slash = filename.find_last_of("/\\");
+    if (slash != std::string::npos && !createDirectories(filename.substr(0, slash)))
+        return;
+
+    /* Write to a temporary file first, so that concurrent processes never
+       read a partially written binary */
+    std::string temp = filename + "." +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    FILE *file = fopen(temp.c_str(), "wb");
+    if (!file)
+        return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    ok = fclose(file) == 0 && ok;
+#if defined(_WIN32)
+    remove(filename.c_str());
+#endif
+    if (!ok || rename(temp.c_str(), filename.c_str()) != 0)
+        remove(temp.c_str());
+}
+
 bool GLShader::initFromFiles(
     const std::string &name,
     const std::string &vertex_fname,
@@ -94,6 +285,31 @@ bool GLShader::init(const std::string &name,
 
     glGenVertexArrays(1, &mVertexArrayObject);
     mName = name;
+    mLoadedFromCache = false;
+
+    /* Geometry shaders are not supported, such programs always fail below */
+    std::string cacheFile;
+    uint64_t cacheKey = 0;
+    if (geometry_str.empty()) {
+        auto glString = [](GLenum name) {
+            const GLubyte *str = glGetString(name);
+            return str ? std::string((const char *) str) : std::string();
+        };
+        cacheKey = programCacheKey({ vertex_str, fragment_str, defines,
+                                     glString(GL_VENDOR), glString(GL_RENDERER),
+                                     glString(GL_VERSION),
+                                     glString(GL_SHADING_LANGUAGE_VERSION) });
+        cacheFile = programCacheFile(cacheKey);
+    }
+    if (!cacheFile.empty()) {
+        mProgramShader = loadProgramBinary(cacheFile, cacheKey);
+        if (mProgramShader) {
+            mLoadedFromCache = true;
+            reflect();
+            return true;
+        }
+    }
+
     mVertexShader =
         createShader_helper(GL_VERTEX_SHADER, name, defines, vertex_str);
 //    mGeometryShader =
@@ -114,6 +330,10 @@ bool GLShader::init(const std::string &name,
     if (mGeometryShader)
         glAttachShader(mProgramShader, mGeometryShader);
 
+    if (!cacheFile.empty())
+        programBinaryFunctions()->programParameteri(mProgramShader,
+                                                    GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     glLinkProgram(mProgramShader);
 
     GLint status;
@@ -127,23 +347,84 @@ bool GLShader::init(const std::string &name,
         throw std::runtime_error("Shader linking failed!");
     }
 
+    if (!cacheFile.empty())
+        storeProgramBinary(cacheFile, cacheKey, mProgramShader);
+
+    reflect();
     return true;
 }
 
+void GLShader::reflect() {
+    mUniforms.clear();
+    mAttributes.clear();
+    mUniformBlocks.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(mProgramShader, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    glGetProgramiv(mProgramShader, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &count);
+    maxLength = std::max(maxLength, count);
+    glGetProgramiv(mProgramShader, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &count);
+    maxLength = std::max(maxLength, count);
+    std::vector<char> name((size_t) std::max(maxLength, 1) + 1);
+
+    /* Arrays are reported as "name[0]"; they can be set by either name */
+    auto insert = [](std::unordered_map<std::string, Variable> &map,
+                     const std::string &key, const Variable &variable) {
+        map[key] = variable;
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+            map[key.substr(0, key.size() - 3)] = variable;
+    };
+
+    glGetProgramiv(mProgramShader, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        Variable variable;
+        glGetActiveUniform(mProgramShader, (GLuint) i, (GLsizei) name.size(), &length,
+                           &variable.size, &variable.type, name.data());
+        std::string key(name.data(), (size_t) length);
+        variable.location = glGetUniformLocation(mProgramShader, key.c_str());
+        insert(mUniforms, key, variable);
+    }
+
+    glGetProgramiv(mProgramShader, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        Variable variable;
+        glGetActiveAttrib(mProgramShader, (GLuint) i, (GLsizei) name.size(), &length,
+                          &variable.size, &variable.type, name.data());
+        std::string key(name.data(), (size_t) length);
+        variable.location = glGetAttribLocation(mProgramShader, key.c_str());
+        insert(mAttributes, key, variable);
+    }
+
+    /* Blocks with a shared buffer are bound by bindSharedBlocks() */
+    glGetProgramiv(mProgramShader, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(mProgramShader, (GLuint) i, (GLsizei) name.size(),
+                                    &length, name.data());
+        mUniformBlocks[std::string(name.data(), (size_t) length)] = (GLuint) i;
+    }
+    mSharedBindingGeneration = -1;
+}
+
 void GLShader::bind() {
     glUseProgram(mProgramShader);
     glBindVertexArray(mVertexArrayObject);
+    bindSharedBlocks();
 }
 
 GLint GLShader::attrib(const std::string &name, bool warn) const {
-    GLint id = glGetAttribLocation(mProgramShader, name.c_str());
+    auto it = mAttributes.find(name);
+    GLint id = it != mAttributes.end() ? it->second.location : -1;
     if (id == -1 && warn)
         std::cerr << mName << ": warning: did not find attrib " << name << std::endl;
     return id;
 }
 
 void GLShader::setUniform(const std::string &name, const GLUniformBuffer &buf, bool warn) {
-    GLuint blockIndex = glGetUniformBlockIndex(mProgramShader, name.c_str());
+    auto it = mUniformBlocks.find(name);
+    GLuint blockIndex = it != mUniformBlocks.end() ? it->second : GL_INVALID_INDEX;
     if (blockIndex == GL_INVALID_INDEX) {
         if (warn)
             std::cerr << mName << ": warning: did not find uniform buffer " << name << std::endl;
@@ -153,7 +434,15 @@ void GLShader::setUniform(const std::string &name, const GLUniformBuffer &buf, b
 }
 
 GLint GLShader::uniform(const std::string &name, bool warn) const {
-    GLint id = glGetUniformLocation(mProgramShader, name.c_str());
+    auto it = mUniforms.find(name);
+    GLint id;
+    if (it != mUniforms.end())
+        id = it->second.location;
+    else if (name.find_first_of("[.") != std::string::npos)
+        /* Elements of arrays and structures are not all listed */
+        id = glGetUniformLocation(mProgramShader, name.c_str());
+    else
+        id = -1;
     if (id == -1 && warn)
         std::cerr << mName << ": warning: did not find uniform " << name << std::endl;
     return id;
@@ -169,6 +458,10 @@ void GLShader::uploadAttrib(const std::string &name, size_t size, int dim,
             return;
     }
 
+    /* Streamed data is replaced by a plain buffer */
+    if (mStreamRings.find(name) != mStreamRings.end())
+        freeAttrib(name);
+
     GLuint bufferID;
     auto it = mBufferObjects.find(name);
     if (it != mBufferObjects.end()) {
@@ -186,6 +479,7 @@ void GLShader::uploadAttrib(const std::string &name, size_t size, int dim,
         buffer.compSize = compSize;
         buffer.size = (GLuint) size;
         buffer.version = version;
+        buffer.offset = 0;
         mBufferObjects[name] = buffer;
     }
     size_t totalSize = size * (size_t) compSize;
@@ -205,6 +499,200 @@ void GLShader::uploadAttrib(const std::string &name, size_t size, int dim,
     }
 }
 
+/* Streamed data starts at multiples of this many bytes */
+static const size_t streamAlignment = 256;
+
+/* A new stream ring has room for this many copies of the data */
+static const size_t streamRingSegments = 4;
+static const size_t streamRingMinCapacity = 64 * 1024;
+
+static GLenum attribTarget(const std::string &name) {
+    return name == "indices" ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+}
+
+/* Write to a part of a buffer that the GPU is known not to read */
+static void writeStreamSegment(GLenum target, GLuint id, size_t offset,
+                               size_t bytes, const void *data) {
+    glBindBuffer(target, id);
+    void *ptr = glMapBufferRange(target, (GLintptr) offset, (GLsizeiptr) bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                 GL_MAP_UNSYNCHRONIZED_BIT);
+    if (ptr) {
+        memcpy(ptr, data, bytes);
+        if (glUnmapBuffer(target) == GL_TRUE)
+            return;
+    }
+    /* The mapping failed or its contents were lost */
+    glBufferSubData(target, (GLintptr) offset, (GLsizeiptr) bytes, data);
+}
+
+size_t GLShader::allocateStreamSegment(const std::string &name, Buffer &buffer,
+                                       size_t bytes, GLuint &retired) {
+    StreamRing &ring = mStreamRings[name];
+    size_t current = (size_t) buffer.size * (size_t) buffer.compSize;
+    retired = 0;
+
+    /* All draw calls reading the current segment have been issued by now */
+    if (ring.capacity > 0 && current > 0)
+        ring.busy.push_back({ buffer.offset, buffer.offset + current,
+                              glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+
+    for (auto it = ring.busy.begin(); it != ring.busy.end(); ) {
+        if (glClientWaitSync(it->fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++it;
+            continue;
+        }
+        glDeleteSync(it->fence);
+        it = ring.busy.erase(it);
+    }
+
+    size_t begin = ring.head;
+    if (begin + bytes > ring.capacity)
+        begin = 0;
+
+    /* The current segment stays intact, updateAttrib() copies from it */
+    bool overlaps = begin + bytes > ring.capacity ||
+        (current > 0 && buffer.offset < begin + bytes && begin < buffer.offset + current);
+    for (auto const &segment : ring.busy)
+        overlaps |= segment.begin < begin + bytes && begin < segment.end;
+
+    if (overlaps) {
+        /* Start a new buffer rather than waiting for the GPU. OpenGL keeps
+           the old one alive until the draw calls reading it have finished */
+        for (auto &segment : ring.busy)
+            glDeleteSync(segment.fence);
+        ring.busy.clear();
+        ring.capacity = std::max(ring.capacity,
+            std::max(bytes * streamRingSegments, streamRingMinCapacity));
+        retired = buffer.id;
+        GLenum target = attribTarget(name);
+        glGenBuffers(1, &buffer.id);
+        glBindBuffer(target, buffer.id);
+        glBufferData(target, (GLsizeiptr) ring.capacity, nullptr, GL_STREAM_DRAW);
+        begin = 0;
+    }
+
+    ring.head = (begin + bytes + streamAlignment - 1) / streamAlignment * streamAlignment;
+    return begin;
+}
+
+void GLShader::streamAttrib(const std::string &name, size_t size, int dim,
+                            uint32_t compSize, GLuint glType, bool integral,
+                            const void *data, int version) {
+    int attribID = 0;
+    if (name != "indices") {
+        attribID = attrib(name);
+        if (attribID < 0)
+            return;
+    }
+
+    /* Uploaded data is replaced by a stream ring */
+    auto it = mBufferObjects.find(name);
+    if (it != mBufferObjects.end() && mStreamRings.find(name) == mStreamRings.end()) {
+        freeAttrib(name);
+        it = mBufferObjects.end();
+    }
+    if (it == mBufferObjects.end()) {
+        Buffer buffer;
+        buffer.id = 0;
+        buffer.glType = glType;
+        buffer.dim = dim;
+        buffer.compSize = compSize;
+        buffer.size = 0;
+        buffer.version = version;
+        buffer.offset = 0;
+        it = mBufferObjects.insert(std::make_pair(name, buffer)).first;
+        mStreamRings[name] = StreamRing();
+    }
+
+    Buffer &buffer = it->second;
+    GLenum target = attribTarget(name);
+    size_t totalSize = size * (size_t) compSize;
+    if (totalSize > 0) {
+        GLuint retired;
+        size_t offset = allocateStreamSegment(name, buffer, totalSize, retired);
+        if (retired)
+            glDeleteBuffers(1, &retired);
+        writeStreamSegment(target, buffer.id, offset, totalSize, data);
+        buffer.offset = offset;
+    }
+    buffer.glType = glType;
+    buffer.dim = dim;
+    buffer.compSize = compSize;
+    buffer.size = (GLuint) size;
+    buffer.version = version;
+
+    glBindBuffer(target, buffer.id);
+    if (name != "indices") {
+        if (size == 0) {
+            glDisableVertexAttribArray(attribID);
+        } else {
+            glEnableVertexAttribArray(attribID);
+            glVertexAttribPointer(attribID, dim, glType, integral, 0,
+                                  (const void *) buffer.offset);
+        }
+    }
+}
+
+void GLShader::updateAttrib(const std::string &name, size_t offset, size_t size, int dim,
+                            uint32_t compSize, GLuint glType, bool integral,
+                            const void *data) {
+    auto it = mBufferObjects.find(name);
+    if (it == mBufferObjects.end())
+        throw std::runtime_error("updateAttrib(" + mName + ", " + name + ") : buffer not found!");
+
+    Buffer &buffer = it->second;
+    if (buffer.compSize != compSize || buffer.glType != glType || buffer.dim != (GLuint) dim)
+        throw std::runtime_error(mName + ": updateAttrib: type mismatch!");
+    if (offset + size > buffer.size)
+        throw std::runtime_error(mName + ": updateAttrib: range exceeds the buffer!");
+    if (size == 0)
+        return;
+
+    GLenum target = attribTarget(name);
+    size_t first = offset * (size_t) compSize;
+    size_t bytes = size * (size_t) compSize;
+    size_t totalSize = (size_t) buffer.size * (size_t) compSize;
+
+    if (mStreamRings.find(name) == mStreamRings.end()) {
+        glBindBuffer(target, buffer.id);
+        glBufferSubData(target, (GLintptr) first, (GLsizeiptr) bytes, data);
+        return;
+    }
+
+    GLuint previous = buffer.id, retired;
+    size_t previousOffset = buffer.offset;
+    size_t segment = allocateStreamSegment(name, buffer, totalSize, retired);
+
+    /* Let the GPU copy the unchanged parts of the previous segment */
+    size_t last = first + bytes;
+    glBindBuffer(GL_COPY_READ_BUFFER, previous);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+    if (first > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            (GLintptr) previousOffset, (GLintptr) segment,
+                            (GLsizeiptr) first);
+    if (last < totalSize)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            (GLintptr) (previousOffset + last), (GLintptr) (segment + last),
+                            (GLsizeiptr) (totalSize - last));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (retired)
+        glDeleteBuffers(1, &retired);
+
+    /* The copies and this write touch disjoint ranges */
+    writeStreamSegment(target, buffer.id, segment + first, bytes, data);
+    buffer.offset = segment;
+
+    if (name != "indices") {
+        GLint attribID = attrib(name);
+        if (attribID >= 0)
+            glVertexAttribPointer(attribID, dim, glType, integral, 0,
+                                  (const void *) buffer.offset);
+    }
+}
+
 void GLShader::downloadAttrib(const std::string &name, size_t size, int /* dim */,
                              uint32_t compSize, GLuint /* glType */, void *data) {
     auto it = mBufferObjects.find(name);
@@ -219,10 +707,10 @@ void GLShader::downloadAttrib(const std::string &name, size_t size, int /* dim *
 
     if (name == "indices") {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buf.id);
-        glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, totalSize, data);
+        glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr) buf.offset, totalSize, data);
     } else {
         glBindBuffer(GL_ARRAY_BUFFER, buf.id);
-        glGetBufferSubData(GL_ARRAY_BUFFER, 0, totalSize, data);
+        glGetBufferSubData(GL_ARRAY_BUFFER, (GLintptr) buf.offset, totalSize, data);
     }
 }
 
@@ -239,7 +727,8 @@ void GLShader::shareAttrib(const GLShader &otherShader, const std::string &name,
             return;
         glEnableVertexAttribArray(attribID);
         glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
-        glVertexAttribPointer(attribID, buffer.dim, buffer.glType, buffer.compSize == 1 ? GL_TRUE : GL_FALSE, 0, 0);
+        glVertexAttribPointer(attribID, buffer.dim, buffer.glType, buffer.compSize == 1 ? GL_TRUE : GL_FALSE, 0,
+                              (const void *) buffer.offset);
     } else {
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.id);
     }
@@ -256,6 +745,12 @@ void GLShader::freeAttrib(const std::string &name) {
         glDeleteBuffers(1, &it->second.id);
         mBufferObjects.erase(it);
     }
+    auto ring = mStreamRings.find(name);
+    if (ring != mStreamRings.end()) {
+        for (auto &segment : ring->second.busy)
+            glDeleteSync(segment.fence);
+        mStreamRings.erase(ring);
+    }
 }
 
 void GLShader::drawIndexed(int type, uint32_t offset_, uint32_t count_) {
@@ -269,6 +764,10 @@ void GLShader::drawIndexed(int type, uint32_t offset_, uint32_t count_) {
         case GL_LINES: offset *= 2; count *= 2; break;
     }
 
+    auto it = mBufferObjects.find("indices");
+    if (it != mBufferObjects.end())
+        offset = it->second.offset / sizeof(uint32_t) + offset;
+
     glDrawElements(type, (GLsizei) count, GL_UNSIGNED_INT,
                    (const void *)(offset * sizeof(uint32_t)));
 }
@@ -284,12 +783,20 @@ void GLShader::free() {
     for (auto &buf: mBufferObjects)
         glDeleteBuffers(1, &buf.second.id);
     mBufferObjects.clear();
+    for (auto &ring : mStreamRings)
+        for (auto &segment : ring.second.busy)
+            glDeleteSync(segment.fence);
+    mStreamRings.clear();
 
     if (mVertexArrayObject) {
         glDeleteVertexArrays(1, &mVertexArrayObject);
         mVertexArrayObject = 0;
     }
 
+    mUniforms.clear();
+    mAttributes.clear();
+    mUniformBlocks.clear();
+
     glDeleteProgram(mProgramShader); mProgramShader = 0;
     glDeleteShader(mVertexShader);   mVertexShader = 0;
     glDeleteShader(mFragmentShader); mFragmentShader = 0;
@@ -323,12 +830,70 @@ void GLUniformBuffer::release() {
 void GLUniformBuffer::free() {
     glDeleteBuffers(1, &mID);
     mID = 0;
+    mSize = 0;
 }
 
 void GLUniformBuffer::update(const std::vector<uint8_t> &data) {
     glBindBuffer(GL_UNIFORM_BUFFER, mID);
-    glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_DYNAMIC_DRAW);
+    if (data.size() == mSize) {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size(), data.data());
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_DYNAMIC_DRAW);
+        mSize = data.size();
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void GLUniformBuffer::allocate(size_t size) {
+    glBindBuffer(GL_UNIFORM_BUFFER, mID);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    mSize = size;
+}
+
+void GLUniformBuffer::update(size_t offset, const void *data, size_t size) {
+    if (offset + size > mSize)
+        throw std::runtime_error("GLUniformBuffer::update(): range exceeds the buffer!");
+    glBindBuffer(GL_UNIFORM_BUFFER, mID);
+    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr) offset, (GLsizeiptr) size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+static std::mutex sharedBindingMutex;
+static std::map<std::string, int> sharedBindingPoints;
+/* Number of shared binding points handed out so far */
+static std::atomic<int> sharedBindingCount(0);
+
+int GLUniformBuffer::sharedBindingPoint(const std::string &blockName) {
+    std::lock_guard<std::mutex> guard(sharedBindingMutex);
+    auto it = sharedBindingPoints.find(blockName);
+    if (it != sharedBindingPoints.end())
+        return it->second;
+
+    GLint maxBindings = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+    int bindingPoint = maxBindings - 1 - (int) sharedBindingPoints.size();
+    if (bindingPoint < 0)
+        throw std::runtime_error("GLUniformBuffer: no binding point left for \"" + blockName + "\"!");
+    sharedBindingPoints[blockName] = bindingPoint;
+    sharedBindingCount++;
+    return bindingPoint;
+}
+
+void GLShader::bindSharedBlocks() {
+    /* Nothing to do unless a block got a shared buffer since the last call */
+    int generation = sharedBindingCount.load();
+    if (generation == mSharedBindingGeneration || mUniformBlocks.empty()) {
+        mSharedBindingGeneration = generation;
+        return;
+    }
+    std::lock_guard<std::mutex> guard(sharedBindingMutex);
+    for (const auto &block : mUniformBlocks) {
+        auto it = sharedBindingPoints.find(block.first);
+        if (it != sharedBindingPoints.end())
+            glUniformBlockBinding(mProgramShader, block.second, (GLuint) it->second);
+    }
+    mSharedBindingGeneration = generation;
 }
 
 //  ----------------------------------------------------
@@ -371,6 +936,8 @@ void GLFramebuffer::init(const Vector2i &size, int nSamples) {
 }
 
 void GLFramebuffer::free() {
+    if (mReadback)
+        mReadback->free();
     glDeleteRenderbuffers(1, &mColor);
     glDeleteRenderbuffers(1, &mDepth);
     mColor = mDepth = 0;
@@ -444,6 +1011,438 @@ void GLFramebuffer::downloadTGA(const std::string &filename) {
     std::cout << "done." << std::endl;
 }
 
+std::future<bool> GLFramebuffer::downloadTGAAsync(const std::string &filename) {
+    if (!mReadback)
+        mReadback = new GLReadback();
+    return mReadback->readTGA(mFramebuffer, mSize, filename);
+}
+
+//  ----------------------------------------------------
+
+/* Runs readback completions in order on a single background thread */
+class ReadbackWorker {
+public:
+    ~ReadbackWorker() {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_one();
+        if (mThread.joinable())
+            mThread.join();
+    }
+
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mJobs.push_back(std::move(job));
+            if (!mThread.joinable())
+                mThread = std::thread([this]() { run(); });
+        }
+        mCondition.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true) {
+            mCondition.wait(lock, [&]() { return mStop || !mJobs.empty(); });
+            if (mJobs.empty())
+                break;
+            auto job = std::move(mJobs.front());
+            mJobs.pop_front();
+            lock.unlock();
+            try {
+                job();
+            } catch (const std::exception &e) {
+                std::cerr << "Error in readback completion: " << e.what() << std::endl;
+            }
+            lock.lock();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mJobs;
+    std::thread mThread;
+    bool mStop = false;
+};
+
+/* Buffers of destroyed readbacks, deleted once their context is current
+   and the worker no longer copies out of them */
+struct OrphanedBuffer {
+    GLFWwindow *context;
+    GLuint buffer;
+    GLsync fence;
+    std::shared_future<void> copied;
+};
+
+static ReadbackWorker readbackWorker;
+static std::mutex readbackMutex;
+static std::vector<GLReadback *> readbacks;
+static std::vector<OrphanedBuffer> orphanedBuffers;
+
+/* How long poll(true) waits for a single transfer */
+static const GLuint64 readbackTimeout = 1000000000ull;
+
+static void failTransfer(const GLReadback::Completion &completion, const Vector2i &size,
+                         const std::string &error) {
+    readbackWorker.post([completion, size, error]() {
+        GLReadback::Image image;
+        image.size = size;
+        image.error = error;
+        completion(image);
+    });
+}
+
+static bool ready(const std::shared_future<void> &future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+GLReadback::GLReadback() : mContext(glfwGetCurrentContext()) {
+    std::lock_guard<std::mutex> guard(readbackMutex);
+    readbacks.push_back(this);
+}
+
+GLReadback::~GLReadback() {
+    /* The context may not be current, so the buffers are handed over to
+       pollCurrentContext(); transfers still in flight fail right away */
+    std::lock_guard<std::mutex> guard(readbackMutex);
+    readbacks.erase(std::remove(readbacks.begin(), readbacks.end(), this), readbacks.end());
+    for (auto &transfer : mPending) {
+        failTransfer(transfer.completion, transfer.size,
+                     "GLReadback: destroyed before the transfer completed");
+        orphanedBuffers.push_back(OrphanedBuffer { mContext, transfer.buffer, transfer.fence,
+                                                   std::shared_future<void>() });
+    }
+    for (auto &mapping : mMapped)
+        orphanedBuffers.push_back(OrphanedBuffer { mContext, mapping.buffer, 0, mapping.copied });
+    for (auto &buffer : mBuffers)
+        orphanedBuffers.push_back(OrphanedBuffer { mContext, buffer.first, 0,
+                                                   std::shared_future<void>() });
+}
+
+void GLReadback::read(GLuint framebuffer, const Vector2i &size, const Vector2i &offset,
+                      const Completion &completion) {
+    size_t bytes = (size_t) size.prod() * 4;
+
+    /* Reuse an idle buffer if one is large enough */
+    Transfer transfer;
+    transfer.buffer = 0;
+    transfer.capacity = bytes;
+    for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+        if (it->second >= bytes) {
+            transfer.buffer = it->first;
+            transfer.capacity = it->second;
+            mBuffers.erase(it);
+            break;
+        }
+    }
+
+    GLint readFramebuffer, packBuffer, packAlignment;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    if (transfer.buffer == 0) {
+        glGenBuffers(1, &transfer.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, transfer.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, transfer.buffer);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(offset.x(), offset.y(), size.x(), size.y(), GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    transfer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    transfer.size = size;
+    transfer.completion = completion;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint) packBuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint) readFramebuffer);
+
+    mPending.push_back(transfer);
+}
+
+std::future<GLReadback::Image> GLReadback::read(GLuint framebuffer, const Vector2i &size,
+                                                 const Vector2i &offset) {
+    auto promise = std::make_shared<std::promise<Image>>();
+    read(framebuffer, size, offset, [promise](Image &image) {
+        if (image.error.empty())
+            promise->set_value(std::move(image));
+        else
+            promise->set_exception(std::make_exception_ptr(std::runtime_error(image.error)));
+    });
+    return promise->get_future();
+}
+
+std::future<bool> GLReadback::readTGA(GLuint framebuffer, const Vector2i &size,
+                                      const std::string &filename) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    read(framebuffer, size, Vector2i::Zero(), [promise, filename](Image &image) {
+        try {
+            writeTGA(filename, image);
+            promise->set_value(true);
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return promise->get_future();
+}
+
+void GLReadback::poll(bool wait) {
+    while (!mPending.empty()) {
+        Transfer &transfer = mPending.front();
+        GLenum status = glClientWaitSync(transfer.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                         wait ? readbackTimeout : 0);
+        if (status == GL_TIMEOUT_EXPIRED && !wait)
+            break;
+        glDeleteSync(transfer.fence);
+
+        Transfer done = std::move(transfer);
+        mPending.pop_front();
+
+        /* Later commands using the buffer are ordered behind the transfer,
+           so it can be reused even if the wait failed */
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            mBuffers.push_back(std::make_pair(done.buffer, done.capacity));
+            failTransfer(done.completion, done.size, status == GL_TIMEOUT_EXPIRED
+                ? "GLReadback: timed out waiting for the transfer"
+                : "GLReadback: waiting for the transfer failed");
+            continue;
+        }
+
+        size_t rowSize = (size_t) done.size.x() * 4, bytes = rowSize * done.size.y();
+        GLint packBuffer;
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, done.buffer);
+        const uint8_t *data = (const uint8_t *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes,
+                                                                 GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint) packBuffer);
+        if (!data) {
+            mBuffers.push_back(std::make_pair(done.buffer, done.capacity));
+            failTransfer(done.completion, done.size, "GLReadback: could not map the pixel buffer");
+            continue;
+        }
+
+        /* The buffer stays mapped until the worker has copied it; the rows
+           arrive bottom row first */
+        auto copied = std::make_shared<std::promise<void>>();
+        mMapped.push_back(Mapping { done.buffer, done.capacity, copied->get_future().share() });
+        Vector2i size = done.size;
+        Completion completion = std::move(done.completion);
+        readbackWorker.post([data, size, rowSize, copied, completion]() {
+            Image image;
+            image.size = size;
+            image.pixels.resize(rowSize * size.y());
+            for (int y = 0; y < size.y(); ++y)
+                memcpy(&image.pixels[y * rowSize], data + (size.y() - 1 - y) * rowSize, rowSize);
+            copied->set_value();
+            completion(image);
+        });
+    }
+    unmapCopied(wait);
+}
+
+void GLReadback::unmapCopied(bool wait) {
+    while (!mMapped.empty()) {
+        Mapping &mapping = mMapped.front();
+        if (!wait && !ready(mapping.copied))
+            break;
+        mapping.copied.wait();
+
+        GLint packBuffer;
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, mapping.buffer);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, (GLuint) packBuffer);
+
+        mBuffers.push_back(std::make_pair(mapping.buffer, mapping.capacity));
+        mMapped.pop_front();
+    }
+}
+
+void GLReadback::free() {
+    poll(true);
+    for (auto &buffer : mBuffers)
+        glDeleteBuffers(1, &buffer.first);
+    mBuffers.clear();
+}
+
+void GLReadback::pollCurrentContext() {
+    GLFWwindow *context = glfwGetCurrentContext();
+    std::lock_guard<std::mutex> guard(readbackMutex);
+    for (auto readback : readbacks) {
+        if (readback->mContext == context)
+            readback->poll();
+    }
+
+    /* Deleting a buffer also unmaps it */
+    for (auto it = orphanedBuffers.begin(); it != orphanedBuffers.end(); ) {
+        if (it->context != context || (it->copied.valid() && !ready(it->copied))) {
+            ++it;
+            continue;
+        }
+        if (it->fence)
+            glDeleteSync(it->fence);
+        glDeleteBuffers(1, &it->buffer);
+        it = orphanedBuffers.erase(it);
+    }
+}
+
+void GLReadback::writeTGA(const std::string &filename, const Image &image) {
+    if (!image.error.empty())
+        throw std::runtime_error("GLReadback::writeTGA(): " + image.error);
+    if (image.pixels.size() != (size_t) image.size.prod() * 4)
+        throw std::runtime_error("GLReadback::writeTGA(): Could not read the framebuffer");
+
+    FILE *tga = fopen(filename.c_str(), "wb");
+    if (tga == nullptr)
+        throw std::runtime_error("GLReadback::writeTGA(): Could not open output file");
+    uint8_t header[18] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                           (uint8_t) (image.size.x() % 256), (uint8_t) (image.size.x() / 256),
+                           (uint8_t) (image.size.y() % 256), (uint8_t) (image.size.y() / 256),
+                           32, 0x20 /* Scan from top left */ };
+    bool ok = fwrite(header, sizeof(header), 1, tga) == 1 &&
+              fwrite(image.pixels.data(), image.pixels.size(), 1, tga) == 1;
+    if (fclose(tga) != 0 || !ok)
+        throw std::runtime_error("GLReadback::writeTGA(): Could not write output file");
+}
+
+//  ----------------------------------------------------
+
+/* Largest stripe written into one unpack buffer */
+static const size_t maxStripeBytes = 4u << 20;
+
+GLTextureUploader::GLTextureUploader(size_t frameBudget)
+    : mFrameBudget(frameBudget), mNextStaging(0) { }
+
+GLTextureUploader::~GLTextureUploader() {
+    /* The unpack buffers can only be released by free(), which needs the context */
+}
+
+void GLTextureUploader::upload(GLuint texture, const Vector2i &size,
+                               std::shared_ptr<const uint8_t> rgba, const Completion &completion) {
+    if (!rgba || size.x() <= 0 || size.y() <= 0)
+        throw std::runtime_error("GLTextureUploader::upload(): no pixel data!");
+    Upload upload;
+    upload.texture = texture;
+    upload.size = size;
+    upload.rgba = std::move(rgba);
+    upload.nextRow = 0;
+    upload.completion = completion;
+    mUploads.push_back(std::move(upload));
+}
+
+void GLTextureUploader::cancel(GLuint texture) {
+    mUploads.erase(std::remove_if(mUploads.begin(), mUploads.end(),
+                                  [texture](const Upload &u) { return u.texture == texture; }),
+                   mUploads.end());
+}
+
+size_t GLTextureUploader::pendingBytes() const {
+    size_t bytes = 0;
+    for (const Upload &u : mUploads)
+        bytes += (size_t) (u.size.y() - u.nextRow) * u.size.x() * 4;
+    return bytes;
+}
+
+bool GLTextureUploader::idle(StagingBuffer &staging) {
+    if (!staging.fence)
+        return true;
+    if (glClientWaitSync(staging.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        return false;
+    glDeleteSync(staging.fence);
+    staging.fence = 0;
+    return true;
+}
+
+void GLTextureUploader::process() {
+    if (mUploads.empty())
+        return;
+
+    GLint unpackBuffer, boundTexture, unpackAlignment, unpackRowLength, unpackSkipPixels, unpackSkipRows;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &unpackRowLength);
+    glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &unpackSkipPixels);
+    glGetIntegerv(GL_UNPACK_SKIP_ROWS, &unpackSkipRows);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    size_t budget = mFrameBudget;
+    bool copied = false;
+    while (!mUploads.empty()) {
+        Upload &upload = mUploads.front();
+        size_t rowBytes = (size_t) upload.size.x() * 4;
+        /* Always make some progress, even if a single row exceeds the budget */
+        size_t rows = std::min(budget, maxStripeBytes) / rowBytes;
+        if (!copied)
+            rows = std::max(rows, (size_t) 1);
+        rows = std::min(rows, (size_t) (upload.size.y() - upload.nextRow));
+        if (rows == 0)
+            break;
+
+        StagingBuffer &staging = mStaging[mNextStaging];
+        if (!idle(staging))
+            break;
+        size_t bytes = rows * rowBytes;
+        if (!staging.buffer)
+            glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+        if (staging.capacity < bytes) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            staging.capacity = bytes;
+        }
+        void *target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!target)
+            break;
+        memcpy(target, upload.rgba.get() + upload.nextRow * rowBytes, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        /* Rows are stored top row first, like NanoVG uploads them */
+        glBindTexture(GL_TEXTURE_2D, upload.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.nextRow, upload.size.x(), (GLsizei) rows,
+                        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mNextStaging ^= 1;
+
+        upload.nextRow += (int) rows;
+        budget -= std::min(budget, bytes);
+        copied = true;
+        if (upload.nextRow == upload.size.y()) {
+            Completion completion = std::move(upload.completion);
+            mUploads.pop_front();
+            if (completion)
+                completion();
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, unpackRowLength);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, unpackSkipPixels);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, unpackSkipRows);
+    glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (GLuint) unpackBuffer);
+}
+
+void GLTextureUploader::free() {
+    for (StagingBuffer &staging : mStaging) {
+        if (staging.fence)
+            glDeleteSync(staging.fence);
+        if (staging.buffer)
+            glDeleteBuffers(1, &staging.buffer);
+        staging = StagingBuffer();
+    }
+    mUploads.clear();
+}
+
 //  ----------------------------------------------------
 
 Eigen::Vector3f project(const Eigen::Vector3f &obj,
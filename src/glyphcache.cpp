@@ -0,0 +1,187 @@
+/*
+    src/glyphcache.cpp -- Glyph prewarming for NanoVG fonts
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/glyphcache.h>
+#include <nanogui/opengl.h>
+#include <nanogui/textcache.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Number of glyphs passed to a single nvgText() call by prewarm() */
+static const size_t GLYPHS_PER_CALL = 64;
+
+void GlyphCache::addRange(const std::string &font, float size, uint32_t first,
+                          uint32_t last) {
+    auto &codepoints = mGlyphs[FontKey(font, size)].codepoints;
+    for (uint32_t c = std::max(first, (uint32_t) 32); c <= last && c <= 0x10FFFF; ++c)
+        codepoints.insert(c);
+}
+
+void GlyphCache::addText(const std::string &font, float size, const std::string &text) {
+    auto &codepoints = mGlyphs[FontKey(font, size)].codepoints;
+    const uint8_t *c = (const uint8_t *) text.c_str(), *end = c + text.size();
+
+    /* Decode UTF-8, skipping malformed sequences */
+    while (c < end) {
+        uint32_t cp = *c++;
+        int extra = 0;
+        if (cp >= 0xF0)      { cp &= 0x07; extra = 3; }
+        else if (cp >= 0xE0) { cp &= 0x0F; extra = 2; }
+        else if (cp >= 0xC0) { cp &= 0x1F; extra = 1; }
+        else if (cp >= 0x80) continue;
+        for (; extra > 0 && c < end && (*c & 0xC0) == 0x80; --extra)
+            cp = (cp << 6) | (*c++ & 0x3F);
+        if (extra == 0 && cp >= 32)
+            codepoints.insert(cp);
+    }
+}
+
+void GlyphCache::learn() {
+    forEachCachedText([this](const std::string &font, float size, const std::string &text) {
+        addText(font, size, text);
+    });
+}
+
+size_t GlyphCache::prewarm(NVGcontext *ctx, float pixelRatio, double timeBudget) {
+    if (ctx != mContext) {
+        for (auto &kv : mGlyphs)
+            kv.second.warm.clear();
+        mContext = ctx;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto outOfTime = [&]() {
+        return timeBudget > 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeBudget;
+    };
+
+    /* The glyphs are drawn into a frame that is discarded afterwards, which
+       leaves them rasterized in NanoVG's font atlas */
+    nvgBeginFrame(ctx, 1, 1, pixelRatio);
+    setTextCachePixelRatio(ctx, pixelRatio);
+    std::string text;
+    for (auto &kv : mGlyphs) {
+        Glyphs &glyphs = kv.second;
+        if (glyphs.warm.size() == glyphs.codepoints.size())
+            continue;
+
+        nvgFontFace(ctx, kv.first.first.c_str());
+        nvgFontSize(ctx, kv.first.second);
+        nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+
+        auto it = glyphs.codepoints.begin();
+        while (it != glyphs.codepoints.end()) {
+            text.clear();
+            size_t count = 0;
+            for (; it != glyphs.codepoints.end() && count < GLYPHS_PER_CALL; ++it) {
+                if (glyphs.warm.insert(*it).second) {
+                    text += utf8((int) *it).data();
+                    count++;
+                }
+            }
+            if (!text.empty())
+                nvgText(ctx, 0, 0, text.c_str(), nullptr);
+            if (outOfTime())
+                break;
+        }
+        if (outOfTime())
+            break;
+    }
+    nvgCancelFrame(ctx);
+
+    return pending();
+}
+
+size_t GlyphCache::pending() const {
+    size_t count = 0;
+    for (const auto &kv : mGlyphs)
+        count += kv.second.codepoints.size() - kv.second.warm.size();
+    return count;
+}
+
+size_t GlyphCache::size() const {
+    size_t count = 0;
+    for (const auto &kv : mGlyphs)
+        count += kv.second.codepoints.size();
+    return count;
+}
+
+std::string GlyphCache::defaultFileName() {
+    if (const char *file = getenv("NANOGUI_GLYPH_CACHE"))
+        return file;
+    std::string dir = userCacheDirectory("");
+    return dir.empty() ? "" : dir + "glyphs.cache";
+}
+
+void GlyphCache::save(const std::string &filename) const {
+    size_t slash = filename.find_last_of("/\\");
+    if (slash != std::string::npos && slash > 0)
+        createDirectories(filename.substr(0, slash));
+
+    std::ofstream os(filename);
+    if (!os)
+        throw std::runtime_error("Could not write glyph cache \"" + filename + "\"");
+
+    /* One line per font and size: name, size and codepoint ranges (tab separated) */
+    for (const auto &kv : mGlyphs) {
+        if (kv.second.codepoints.empty())
+            continue;
+        os << kv.first.first << '\t' << kv.first.second << '\t';
+        auto it = kv.second.codepoints.begin();
+        bool firstRange = true;
+        while (it != kv.second.codepoints.end()) {
+            uint32_t first = *it, last = *it;
+            while (++it != kv.second.codepoints.end() && *it == last + 1)
+                last = *it;
+            os << (firstRange ? "" : " ") << first;
+            if (last != first)
+                os << '-' << last;
+            firstRange = false;
+        }
+        os << '\n';
+    }
+}
+
+bool GlyphCache::load(const std::string &filename) {
+    std::ifstream is(filename);
+    if (!is)
+        return false;
+
+    std::string line;
+    while (std::getline(is, line)) {
+        size_t tab1 = line.find('\t'), tab2 = line.find('\t', tab1 + 1);
+        if (tab1 == std::string::npos || tab2 == std::string::npos)
+            continue;
+        std::string font = line.substr(0, tab1);
+        float size = std::strtof(line.c_str() + tab1 + 1, nullptr);
+        if (!(size > 0))
+            continue;
+
+        std::istringstream ranges(line.substr(tab2 + 1));
+        std::string range;
+        while (ranges >> range) {
+            char *end = nullptr;
+            unsigned long first = std::strtoul(range.c_str(), &end, 10), last = first;
+            if (*end == '-')
+                last = std::strtoul(end + 1, nullptr, 10);
+            if (last >= first && last - first <= 0x10FFFF)
+                addRange(font, size, (uint32_t) first, (uint32_t) last);
+        }
+    }
+    return true;
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,259 @@
+/*
+    src/imageinfo.cpp -- Reads the size of an image file from its header,
+    without decoding it
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/imageinfo.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Larger images are rejected by stb_image as well */
+static const uint32_t MAX_DIMENSION = 1 << 24;
+
+/* EXIF and eXIf blocks are read whole, but only up to this size */
+static const uint32_t MAX_EXIF_SIZE = 65536;
+
+static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+static const uint8_t ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB,
+                                           '\r', '\n', 0x1A, '\n' };
+
+static uint32_t be16(const uint8_t *p) { return (uint32_t) p[0] << 8 | p[1]; }
+static uint32_t be32(const uint8_t *p) { return be16(p) << 16 | be16(p + 2); }
+
+/* Orientation tag (0x0112) of the first IFD of a TIFF structure, as found
+   in JPEG APP1 "Exif" segments and PNG eXIf chunks */
+static int exifOrientation(const uint8_t *data, size_t size) {
+    if (size < 8)
+        return 1;
+    bool little;
+    if (data[0] == 'I' && data[1] == 'I')
+        little = true;
+    else if (data[0] == 'M' && data[1] == 'M')
+        little = false;
+    else
+        return 1;
+    auto u16 = [&](size_t o) -> uint32_t {
+        return little ? (uint32_t) data[o + 1] << 8 | data[o] : be16(data + o);
+    };
+    auto u32 = [&](size_t o) -> uint32_t {
+        return little ? u16(o + 2) << 16 | u16(o) : be32(data + o);
+    };
+    if (u16(2) != 42)
+        return 1;
+    size_t ifd = u32(4);
+    if (ifd > size - 2)
+        return 1;
+    uint32_t count = u16(ifd);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t entry = ifd + 2 + (size_t) i * 12;
+        if (entry + 12 > size)
+            break;
+        /* A single SHORT, stored in the first half of the value field */
+        if (u16(entry) == 0x0112 && u16(entry + 2) == 3) {
+            uint32_t orientation = u16(entry + 8);
+            return orientation >= 1 && orientation <= 8 ? (int) orientation : 1;
+        }
+    }
+    return 1;
+}
+
+/* Walk the markers behind SOI up to the frame header; only the segments
+   in between (APPn, DQT, DHT, ...) are skipped, never the entropy data */
+static bool probeJPEG(FILE *file, ImageInfo &info) {
+    for (;;) {
+        int c = fgetc(file);
+        if (c != 0xFF)
+            return false;
+        while (c == 0xFF)
+            c = fgetc(file);
+        if (c == EOF)
+            return false;
+
+        int marker = c;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+            continue; /* TEM, RSTn and SOI stand alone */
+        if (marker == 0xD9 || marker == 0xDA)
+            return false; /* EOI or SOS before a frame header */
+
+        uint8_t length[2];
+        if (fread(length, sizeof(length), 1, file) != 1 || be16(length) < 2)
+            return false;
+        uint32_t size = be16(length) - 2;
+
+        /* SOF0-SOF15, except DHT, JPG and DAC which share the range */
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 &&
+            marker != 0xCC) {
+            uint8_t frame[6];
+            if (size < sizeof(frame) || fread(frame, sizeof(frame), 1, file) != 1)
+                return false;
+            info.height = (int) be16(frame + 1);
+            info.width = (int) be16(frame + 3);
+            info.channels = frame[5];
+            return info.channels == 1 || info.channels == 3 || info.channels == 4;
+        }
+
+        if (marker == 0xE1 && size >= 14) {
+            std::vector<uint8_t> segment(size);
+            if (fread(segment.data(), size, 1, file) != 1)
+                return false;
+            if (info.orientation == 1 && memcmp(segment.data(), "Exif\0\0", 6) == 0)
+                info.orientation = exifOrientation(segment.data() + 6, size - 6);
+            continue;
+        }
+
+        if (fseek(file, (long) size, SEEK_CUR) != 0)
+            return false;
+    }
+}
+
+/* Read IHDR, then look at the chunks in front of the image data for
+   transparency (tRNS) and orientation (eXIf) */
+static bool probePNG(FILE *file, ImageInfo &info) {
+    bool header = false;
+    uint8_t colorType = 0;
+    for (;;) {
+        uint8_t chunk[8];
+        if (fread(chunk, sizeof(chunk), 1, file) != 1)
+            return header;
+        uint32_t size = be32(chunk);
+        const uint8_t *type = chunk + 4;
+        if (size > 0x7FFFFFFF)
+            return false;
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            uint8_t ihdr[13];
+            if (header || size != sizeof(ihdr) || fread(ihdr, sizeof(ihdr), 1, file) != 1)
+                return false;
+            uint32_t width = be32(ihdr), height = be32(ihdr + 4);
+            if (width > MAX_DIMENSION || height > MAX_DIMENSION)
+                return false;
+            info.width = (int) width;
+            info.height = (int) height;
+            colorType = ihdr[9];
+            switch (colorType) {
+                case 0: info.channels = 1; break;
+                case 2: info.channels = 3; break;
+                case 3: info.channels = 3; break;
+                case 4: info.channels = 2; break;
+                case 6: info.channels = 4; break;
+                default: return false;
+            }
+            header = true;
+            size = 0;
+        } else if (!header) {
+            /* Only Apple's CgBI chunk may precede IHDR */
+            if (memcmp(type, "CgBI", 4) != 0)
+                return false;
+        } else if (memcmp(type, "IDAT", 4) == 0 || memcmp(type, "IEND", 4) == 0) {
+            return true;
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (colorType == 0 || colorType == 2 || colorType == 3)
+                info.channels++;
+        } else if (memcmp(type, "eXIf", 4) == 0 && size <= MAX_EXIF_SIZE) {
+            std::vector<uint8_t> exif(size);
+            if (size > 0 && fread(exif.data(), size, 1, file) != 1)
+                return false;
+            info.orientation = exifOrientation(exif.data(), size);
+            size = 0;
+        }
+
+        /* Skip the rest of the chunk and its CRC */
+        if (fseek(file, (long) size + 4, SEEK_CUR) != 0)
+            return false;
+    }
+}
+
+/* The logical screen descriptor follows the signature */
+static bool probeGIF(FILE *file, ImageInfo &info) {
+    uint8_t screen[4];
+    if (fread(screen, sizeof(screen), 1, file) != 1)
+        return false;
+    info.width = screen[0] | screen[1] << 8;
+    info.height = screen[2] | screen[3] << 8;
+    info.channels = 4;
+    return true;
+}
+
+/* The KTX header stores its fields in the byte order given by the
+   endianness field; ETC2 RGBA8 (GL_COMPRESSED_RGBA8_ETC2_EAC) has alpha */
+static bool probeKTX(FILE *file, ImageInfo &info) {
+    uint8_t header[44];
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(header, sizeof(header), 1, file) != 1 ||
+        memcmp(header, ktxIdentifier, sizeof(ktxIdentifier)) != 0)
+        return false;
+    bool big = header[12] == 0x04;
+    auto u32 = [&](size_t o) -> uint32_t {
+        const uint8_t *p = header + o;
+        return big ? be32(p) : (uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 |
+                               (uint32_t) p[1] << 8 | p[0];
+    };
+    if (u32(12) != 0x04030201)
+        return false;
+    uint32_t width = u32(36), height = u32(40);
+    if (width > MAX_DIMENSION || height > MAX_DIMENSION)
+        return false;
+    info.width = (int) width;
+    info.height = (int) height;
+    info.channels = u32(28) == 0x9278 ? 4 : 3;
+    return true;
+}
+
+bool ImageInfo::probe(const std::string &fileName, ImageInfo &info) {
+    info = ImageInfo();
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint8_t signature[8];
+    size_t read = fread(signature, 1, sizeof(signature), file);
+    Format format = Format::Unknown;
+    bool ok = false;
+    if (read >= 3 && signature[0] == 0xFF && signature[1] == 0xD8 && signature[2] == 0xFF) {
+        format = Format::JPEG;
+        ok = fseek(file, 2, SEEK_SET) == 0 && probeJPEG(file, info);
+    } else if (read == sizeof(signature) && memcmp(signature, pngSignature, 8) == 0) {
+        format = Format::PNG;
+        ok = probePNG(file, info);
+    } else if (read >= 6 && (memcmp(signature, "GIF87a", 6) == 0 ||
+                             memcmp(signature, "GIF89a", 6) == 0)) {
+        format = Format::GIF;
+        ok = fseek(file, 6, SEEK_SET) == 0 && probeGIF(file, info);
+    } else if (read == sizeof(signature) && memcmp(signature, ktxIdentifier, 8) == 0) {
+        format = Format::KTX;
+        ok = probeKTX(file, info);
+    }
+    fclose(file);
+
+    if (format == Format::Unknown) {
+        int width, height, channels;
+        if (stbi_info(fileName.c_str(), &width, &height, &channels)) {
+            format = Format::Other;
+            info.width = width;
+            info.height = height;
+            info.channels = channels;
+            ok = true;
+        }
+    }
+
+    if (!ok || !info.valid()) {
+        info = ImageInfo();
+        return false;
+    }
+    info.format = format;
+    return true;
+}
+
+NAMESPACE_END(nanogui)
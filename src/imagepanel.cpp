@@ -12,12 +12,188 @@
 
 #include <nanogui/imagepanel.h>
 #include <nanogui/opengl.h>
+#include <algorithm>
+#include <cmath>
 
 NAMESPACE_BEGIN(nanogui)
 
 ImagePanel::ImagePanel(Widget *parent)
-    : Widget(parent), mThumbSize(64), mSpacing(10), mMargin(10),
-      mMouseIndex(-1) {}
+    : Widget(parent), mResetAtlas(false), mShadowContext(nullptr), mShadowImage(0),
+      mShadowStride(0), mThumbSize(64), mSpacing(10), mMargin(10), mMouseIndex(-1) {}
+
+ImagePanel::~ImagePanel() {
+    releaseShadowImage();
+}
+
+void ImagePanel::setImages(const Images &data) {
+    releaseLoadedImages();
+    mLoader = nullptr;
+    mImages = data;
+}
+
+void ImagePanel::setImageFiles(const std::vector<std::string> &files) {
+    releaseLoadedImages();
+    if (!mLoader || mLoader->thumbSize() != mThumbSize ||
+        mLoader->cacheDirectory() != mThumbnailCacheDirectory)
+        mLoader = new ThumbnailLoader(mThumbSize, mThumbnailCacheDirectory);
+
+    mImages.clear();
+    mImages.reserve(files.size());
+    /* The loader starts out with every file queued */
+    mRequested.assign(files.size(), true);
+    for (const auto &file : files) {
+        size_t dot = file.find_last_of('.'), slash = file.find_last_of("/\\");
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+            mImages.push_back(std::make_pair(0, file.substr(0, dot)));
+        else
+            mImages.push_back(std::make_pair(0, file));
+    }
+    mLoader->setFiles(files);
+}
+
+void ImagePanel::releaseLoadedImages() {
+    mSlots.clear();
+    mSlotOwners.clear();
+    mRequested.clear();
+    mResetAtlas = true;
+}
+
+const TextureAtlas::Region *ImagePanel::atlasRegion(int index) const {
+    if (mSlots.empty())
+        return nullptr;
+    size_t slot = (size_t) index % mSlots.size();
+    return mSlotOwners[slot] == index ? &mSlots[slot] : nullptr;
+}
+
+void ImagePanel::uploadThumbnails(NVGcontext *ctx, const Vector2i &range) {
+    if (!mAtlas)
+        mAtlas = new TextureAtlas(ctx, 1024, mSpacing);
+
+    /* Only the visible rows and half a screen above and below are kept in
+       the atlas, so its size does not grow with the number of files */
+    Vector2i grid = gridSize();
+    int visibleRows = range.y() >= range.x() ? (range.y() - range.x()) / grid.x() + 1 : 1;
+    int prefetch = std::max(1, visibleRows / 2) * grid.x();
+    size_t capacity = (size_t) (visibleRows + 1) * grid.x() + 2 * prefetch;
+    mLoader->setPrefetch(prefetch);
+
+    /* Entry i lives in slot i % capacity; the slots are reserved in order, so
+       that neighboring thumbnails are mostly neighbors in the atlas as well */
+    if (mSlots.size() < capacity) {
+        mAtlas->clear();
+        mSlots.clear();
+        for (size_t i = 0; i < capacity; ++i)
+            mSlots.push_back(mAtlas->reserve(mThumbSize, mThumbSize));
+        mSlotOwners.assign(capacity, -1);
+        for (size_t i = 0; i < mImages.size(); ++i) {
+            if (mImages[i].first > 0) {
+                mImages[i].first = 0;
+                mRequested[i] = false;
+            }
+        }
+    }
+
+    /* Entries that come back into the window after their slot was recycled */
+    int first = std::max(range.x() - prefetch, 0);
+    int last = std::min(std::max(range.x(), range.y()) + prefetch, (int) mImages.size() - 1);
+    for (int i = first; i <= last; ++i) {
+        if (mImages[i].first == 0 && !mRequested[i]) {
+            mRequested[i] = true;
+            mLoader->request(i);
+        }
+    }
+
+    std::vector<ThumbnailLoader::Thumbnail> thumbnails;
+    mLoader->fetch(thumbnails);
+
+    std::vector<uint8_t> square((size_t) mThumbSize * mThumbSize * 4);
+    for (const auto &thumbnail : thumbnails) {
+        int index = thumbnail.index;
+        if (thumbnail.width <= 0 || thumbnail.height <= 0) {
+            mImages[index].first = -1;
+            continue;
+        }
+
+        /* Scrolled away while decoding: requested again when it returns */
+        if (index < first || index > last) {
+            mRequested[index] = false;
+            continue;
+        }
+
+        size_t slot = (size_t) index % mSlots.size();
+        const TextureAtlas::Region &region = mSlots[slot];
+        if (!region.valid()) {
+            mImages[index].first = -1;
+            continue;
+        }
+        int previous = mSlotOwners[slot];
+        if (previous >= 0 && previous != index) {
+            mImages[previous].first = 0;
+            mRequested[previous] = false;
+        }
+        mSlotOwners[slot] = index;
+
+        /* Crop the centered square and resample it to the thumbnail size */
+        int side = std::min(thumbnail.width, thumbnail.height);
+        int ox = (thumbnail.width - side) / 2, oy = (thumbnail.height - side) / 2;
+        uint32_t *dst = (uint32_t *) square.data();
+        const uint32_t *src = (const uint32_t *) thumbnail.rgba.data();
+        for (int y = 0; y < mThumbSize; ++y) {
+            const uint32_t *row = src + (size_t) (oy + y * side / mThumbSize) * thumbnail.width;
+            for (int x = 0; x < mThumbSize; ++x)
+                *dst++ = row[ox + x * side / mThumbSize];
+        }
+
+        mAtlas->update(region, square.data());
+        mImages[index].first = region.image;
+    }
+}
+
+void ImagePanel::updateShadowImage(NVGcontext *ctx) {
+    int stride = mThumbSize + mSpacing;
+    if (mShadowImage && mShadowContext == ctx && mShadowStride == stride)
+        return;
+    releaseShadowImage();
+
+    /* Signed distance to a rounded rectangle (same as NanoVG's shader) */
+    auto sdroundrect = [](float x, float y, float ex, float ey, float r) {
+        float dx = std::abs(x) - (ex - r), dy = std::abs(y) - (ey - r);
+        return std::min(std::max(dx, dy), 0.f) +
+               std::sqrt(std::pow(std::max(dx, 0.f), 2.f) +
+                         std::pow(std::max(dy, 0.f), 2.f)) - r;
+    };
+
+    /* One thumbnail cell with the box gradient shadow of the former per-image
+       drawing code, including the hole for the image itself */
+    float t = (float) mThumbSize, half = t * 0.5f;
+    std::vector<uint8_t> tile((size_t) stride * stride * 4, 0);
+    for (int py = 0; py < stride; ++py) {
+        for (int px = 0; px < stride; ++px) {
+            float x = px + 0.5f - mSpacing / 2, y = py + 0.5f - mSpacing / 2;
+            if (x < -5 || y < -5 || x > t + 5 || y > t + 5)
+                continue;
+            float d = sdroundrect(x - half, y - half - 1, half + 1, half + 1, 5);
+            float shadow = 1.f - std::min(std::max((d + 1.5f) / 3.f, 0.f), 1.f);
+            float hole = sdroundrect(x - half, y - half, half, half, 6);
+            float coverage = std::min(std::max(hole + 0.5f, 0.f), 1.f);
+            tile[((size_t) py * stride + px) * 4 + 3] =
+                (uint8_t) std::round(128 * shadow * coverage);
+        }
+    }
+
+    mShadowImage = nvgCreateImageRGBA(ctx, stride, stride,
+                                      NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY,
+                                      tile.data());
+    mShadowContext = ctx;
+    mShadowStride = stride;
+}
+
+void ImagePanel::releaseShadowImage() {
+    if (mShadowImage)
+        nvgDeleteImage(mShadowContext, mShadowImage);
+    mShadowImage = 0;
+    mShadowContext = nullptr;
+}
 
 Vector2i ImagePanel::gridSize() const {
     int nCols = 1 + std::max(0,
@@ -39,6 +215,28 @@ int ImagePanel::indexForPosition(const Vector2i &p) const {
     return overImage ? (gridPos.x() + gridPos.y() * grid.x()) : -1;
 }
 
+Vector2i ImagePanel::visibleRange() const {
+    /* Intersect the panel with the extent of all of its ancestors (e.g. a VScrollPanel) */
+    Vector2i lo = Vector2i::Zero(), hi = mSize, offset = Vector2i::Zero();
+    const Widget *widget = this;
+    while (widget->parent()) {
+        offset += widget->position();
+        widget = widget->parent();
+        lo = lo.cwiseMax(-offset);
+        hi = hi.cwiseMin(widget->size() - offset);
+    }
+
+    Vector2i grid = gridSize();
+    int stride = mThumbSize + mSpacing;
+    if (hi.y() <= lo.y() || hi.x() <= lo.x() || mImages.empty())
+        return Vector2i(0, -1);
+
+    int firstRow = std::max(0, (lo.y() - mMargin) / stride);
+    int lastRow = std::max(0, (hi.y() - mMargin) / stride);
+    return Vector2i(std::min(firstRow * grid.x(), (int) mImages.size()),
+                    std::min((lastRow + 1) * grid.x(), (int) mImages.size()) - 1);
+}
+
 bool ImagePanel::mouseMotionEvent(const Vector2i &p, const Vector2i & /* rel */,
                               int /* button */, int /* modifiers */) {
     mMouseIndex = indexForPosition(p);
@@ -53,6 +251,16 @@ bool ImagePanel::mouseButtonEvent(const Vector2i &p, int /* button */, bool down
     return true;
 }
 
+bool ImagePanel::loading() const {
+    if (!mLoader)
+        return false;
+    Vector2i range = visibleRange();
+    for (int i = range.x(); i <= range.y(); ++i)
+        if (mImages[i].first == 0)
+            return true;
+    return false;
+}
+
 Vector2i ImagePanel::preferredSize(NVGcontext *) const {
     Vector2i grid = gridSize();
     return Vector2i(
@@ -63,51 +271,151 @@ Vector2i ImagePanel::preferredSize(NVGcontext *) const {
 
 void ImagePanel::draw(NVGcontext* ctx) {
     Vector2i grid = gridSize();
+    Vector2i range = visibleRange();
+    int stride = mThumbSize + mSpacing;
+
+    if (mResetAtlas) {
+        if (mAtlas)
+            mAtlas->clear();
+        /* setImages and setImageFiles switch here, where the context is current */
+        releaseShadowImage();
+        mResetAtlas = false;
+    }
+
+    if (mLoader) {
+        mLoader->setVisibleRange(range.x(), range.y());
+        uploadThumbnails(ctx, range);
+    }
+
+    auto cellPos = [&](int i) {
+        return mPos + Vector2i::Constant(mMargin) +
+               Vector2i(i % grid.x(), i / grid.x()) * stride;
+    };
+
+    /* Group atlas thumbnails that can be drawn by the same image pattern,
+       i.e. which sit on the same atlas page at the same offset as on screen */
+    struct Batch {
+        int image;
+        Vector2i origin;
+        float alpha;
+        std::vector<int> cells;
+    };
+    std::vector<Batch> batches;
+    std::vector<int> pending, failed, loaded;
+
+    for (int i = range.x(); i <= range.y(); ++i) {
+        int image = mImages[i].first;
+        if (image <= 0) {
+            (image == 0 ? pending : failed).push_back(i);
+            continue;
+        }
+        loaded.push_back(i);
+
+        const TextureAtlas::Region *region = atlasRegion(i);
+        if (!region || region->image != image) {
+            /* Image provided via setImages(): draw it individually */
+            Vector2i p = cellPos(i);
+            int imgw, imgh;
+            nvgImageSize(ctx, image, &imgw, &imgh);
+            float iw, ih, ix, iy;
+            if (imgw < imgh) {
+                iw = mThumbSize;
+                ih = iw * (float)imgh / (float)imgw;
+                ix = 0;
+                iy = -(ih - mThumbSize) * 0.5f;
+            } else {
+                ih = mThumbSize;
+                iw = ih * (float)imgw / (float)imgh;
+                ix = -(iw - mThumbSize) * 0.5f;
+                iy = 0;
+            }
 
-    for (size_t i=0; i<mImages.size(); ++i) {
-        Vector2i p = mPos + Vector2i::Constant(mMargin) +
-            Vector2i((int) i % grid.x(), (int) i / grid.x()) * (mThumbSize + mSpacing);
-        int imgw, imgh;
-
-        nvgImageSize(ctx, mImages[i].first, &imgw, &imgh);
-        float iw, ih, ix, iy;
-        if (imgw < imgh) {
-            iw = mThumbSize;
-            ih = iw * (float)imgh / (float)imgw;
-            ix = 0;
-            iy = -(ih - mThumbSize) * 0.5f;
-        } else {
-            ih = mThumbSize;
-            iw = ih * (float)imgw / (float)imgh;
-            ix = -(iw - mThumbSize) * 0.5f;
-            iy = 0;
+            NVGpaint imgPaint = nvgImagePattern(
+                ctx, p.x() + ix, p.y()+ iy, iw, ih, 0, image,
+                mMouseIndex == i ? 1.0 : 0.7);
+
+            nvgBeginPath(ctx);
+            nvgRoundedRect(ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
+            nvgFillPaint(ctx, imgPaint);
+            nvgFill(ctx);
+            continue;
         }
 
-        NVGpaint imgPaint = nvgImagePattern(
-            ctx, p.x() + ix, p.y()+ iy, iw, ih, 0, mImages[i].first,
-            mMouseIndex == (int)i ? 1.0 : 0.7);
+        Vector2i origin = cellPos(i) - region->pos;
+        float alpha = mMouseIndex == i ? 1.f : 0.7f;
+        auto it = std::find_if(batches.begin(), batches.end(), [&](const Batch &b) {
+            return b.image == image && b.origin == origin && b.alpha == alpha;
+        });
+        if (it == batches.end()) {
+            batches.push_back(Batch { image, origin, alpha, std::vector<int>() });
+            it = batches.end() - 1;
+        }
+        it->cells.push_back(i);
+    }
 
+    int pageSize = mAtlas ? mAtlas->pageSize() : 0;
+    for (const auto &batch : batches) {
         nvgBeginPath(ctx);
-        nvgRoundedRect(ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
-        nvgFillPaint(ctx, imgPaint);
+        for (int i : batch.cells) {
+            Vector2i p = cellPos(i);
+            nvgRoundedRect(ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
+        }
+        nvgFillPaint(ctx, nvgImagePattern(ctx, batch.origin.x(), batch.origin.y(),
+                                          pageSize, pageSize, 0, batch.image,
+                                          batch.alpha));
         nvgFill(ctx);
+    }
 
-        NVGpaint shadowPaint =
-            nvgBoxGradient(ctx, p.x() - 1, p.y(), mThumbSize + 2, mThumbSize + 2, 5, 3,
-                           nvgRGBA(0, 0, 0, 128), nvgRGBA(0, 0, 0, 0));
+    if (!loaded.empty()) {
+        /* Drop shadows of all thumbnails from a single repeating tile */
+        updateShadowImage(ctx);
+        Vector2i origin = mPos + Vector2i::Constant(mMargin - mSpacing / 2);
         nvgBeginPath(ctx);
-        nvgRect(ctx, p.x()-5,p.y()-5, mThumbSize+10,mThumbSize+10);
-        nvgRoundedRect(ctx, p.x(),p.y(), mThumbSize,mThumbSize, 6);
-        nvgPathWinding(ctx, NVG_HOLE);
-        nvgFillPaint(ctx, shadowPaint);
+        for (int i : loaded) {
+            Vector2i p = cellPos(i) - Vector2i::Constant(mSpacing / 2);
+            nvgRect(ctx, p.x(), p.y(), stride, stride);
+        }
+        nvgFillPaint(ctx, nvgImagePattern(ctx, origin.x(), origin.y(), stride,
+                                          stride, 0, mShadowImage, 1.f));
         nvgFill(ctx);
 
         nvgBeginPath(ctx);
-        nvgRoundedRect(ctx, p.x()+0.5f,p.y()+0.5f, mThumbSize-1,mThumbSize-1, 4-0.5f);
+        for (int i : loaded) {
+            Vector2i p = cellPos(i);
+            nvgRoundedRect(ctx, p.x()+0.5f,p.y()+0.5f, mThumbSize-1,mThumbSize-1, 4-0.5f);
+        }
         nvgStrokeWidth(ctx, 1.0f);
         nvgStrokeColor(ctx, nvgRGBA(255,255,255,80));
         nvgStroke(ctx);
     }
+
+    /* Placeholders for thumbnails that are still being decoded (or failed) */
+    auto drawPlaceholders = [&](const std::vector<int> &cells, const Color &fill) {
+        if (cells.empty())
+            return;
+        nvgBeginPath(ctx);
+        for (int i : cells) {
+            Vector2i p = cellPos(i);
+            nvgRoundedRect(ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
+        }
+        nvgFillColor(ctx, fill);
+        nvgFill(ctx);
+        nvgStrokeWidth(ctx, 1.0f);
+        nvgStrokeColor(ctx, Color(255, 32));
+        nvgStroke(ctx);
+    };
+    drawPlaceholders(pending, Color(255, 24));
+    drawPlaceholders(failed, Color(0, 48));
+
+    if (mMouseIndex >= range.x() && mMouseIndex <= range.y() &&
+        mImages[mMouseIndex].first <= 0) {
+        Vector2i p = cellPos(mMouseIndex);
+        nvgBeginPath(ctx);
+        nvgRoundedRect(ctx, p.x(), p.y(), mThumbSize, mThumbSize, 5);
+        nvgStrokeWidth(ctx, 1.0f);
+        nvgStrokeColor(ctx, Color(255, 80));
+        nvgStroke(ctx);
+    }
 }
 
 NAMESPACE_END(nanogui)
@@ -0,0 +1,853 @@
+/*
+    src/jpegimage.cpp -- JPEG decoding at reduced scales (1/2, 1/4, 1/8)
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/jpegimage.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Position of the n-th zigzag coefficient in the 8x8 block; the extra
+   entries catch runs past the end of a corrupt block */
+static const uint8_t zigzag[64 + 16] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+enum Marker {
+    SOF0 = 0xC0, SOF1 = 0xC1, SOF2 = 0xC2, DHT = 0xC4, RST0 = 0xD0, RST7 = 0xD7,
+    SOI = 0xD8, EOI = 0xD9, SOS = 0xDA, DQT = 0xDB, DRI = 0xDD, APP14 = 0xEE
+};
+
+static const int FAST_BITS = 9;
+
+static int log2i(int value) {
+    int result = 0;
+    while ((1 << result) < value)
+        result++;
+    return result;
+}
+
+/* Basis functions of the N-point inverse DCTs (N = 1, 2, 4, 8): every
+   output sample is the average of 8 / N samples of the full transform, so
+   a reduced block equals the box-filtered full-size one (libjpeg computes
+   the same). Averaging cancels some frequencies completely, e.g. all but
+   the DC coefficient for N = 1. */
+struct IDCTBasis {
+    float basis[4][8][8];
+    /// Frequencies that do not cancel out, for each N
+    int used[4][8];
+    int usedCount[4];
+
+    IDCTBasis() {
+        for (int k = 0; k < 4; ++k) {
+            int n = 1 << k, group = 8 / n;
+            usedCount[k] = 0;
+            for (int u = 0; u < 8; ++u) {
+                bool zero = true;
+                for (int x = 0; x < n; ++x) {
+                    double sum = 0;
+                    for (int i = x * group; i < (x + 1) * group; ++i)
+                        sum += std::cos((2 * i + 1) * u * M_PI / 16);
+                    basis[k][x][u] = (float) (0.5 * (u == 0 ? M_SQRT1_2 : 1.0) * sum / group);
+                    zero &= std::abs(sum) < 1e-9;
+                }
+                if (!zero)
+                    used[k][usedCount[k]++] = u;
+            }
+        }
+    }
+};
+
+static const IDCTBasis &idctBasis() {
+    static IDCTBasis basis;
+    return basis;
+}
+
+static uint8_t clampSample(float value) {
+    return (uint8_t) (value <= 0.f ? 0 : value >= 255.f ? 255 : (int) value);
+}
+
+/* Inverse DCT of a block into nx * ny samples, each written fx * fy times */
+static void inverseDCT(const int16_t *block, const uint16_t *quant, int nx, int ny,
+                       int fx, int fy, uint8_t *out, int stride) {
+    const IDCTBasis &b = idctBasis();
+    int kx = log2i(nx), ky = log2i(ny);
+    const float (*bx)[8] = b.basis[kx];
+    const float (*by)[8] = b.basis[ky];
+
+    /* Without AC coefficients (smooth areas, and all that 1/8 needs) the block is flat */
+    uint64_t words[16];
+    memcpy(words, block, sizeof(words));
+    uint64_t ac = words[0] & ~(uint64_t) 0xffff;
+    for (int i = 1; i < 16; ++i)
+        ac |= words[i];
+    if (ac == 0 || (nx == 1 && ny == 1)) {
+        uint8_t value = clampSample(block[0] * (int) quant[0] * 0.125f + 128.5f);
+        for (int y = 0; y < ny * fy; ++y)
+            memset(out + (size_t) y * stride, value, nx * fx);
+        return;
+    }
+
+    /* Columns first; most of them are empty or hold only one coefficient */
+    float tmp[8][8];
+    int columns[8], columnCount = 0;
+    for (int i = 0; i < b.usedCount[kx]; ++i) {
+        int u = b.used[kx][i];
+        float column[8];
+        int count = 0;
+        for (int j = 0; j < b.usedCount[ky]; ++j) {
+            int v = b.used[ky][j];
+            if (block[v * 8 + u] != 0) {
+                column[j] = (float) (block[v * 8 + u] * (int) quant[v * 8 + u]);
+                count = j + 1;
+            } else {
+                column[j] = 0.f;
+            }
+        }
+        if (count == 0)
+            continue;
+        for (int y = 0; y < ny; ++y) {
+            float sum = 0.f;
+            for (int j = 0; j < count; ++j)
+                sum += by[y][b.used[ky][j]] * column[j];
+            tmp[y][u] = sum;
+        }
+        columns[columnCount++] = u;
+    }
+
+    for (int y = 0; y < ny; ++y) {
+        uint8_t row[8];
+        for (int x = 0; x < nx; ++x) {
+            float sum = 128.5f;
+            for (int i = 0; i < columnCount; ++i)
+                sum += bx[x][columns[i]] * tmp[y][columns[i]];
+            row[x] = clampSample(sum);
+        }
+        for (int ry = 0; ry < fy; ++ry) {
+            uint8_t *dst = out + (size_t) (y * fy + ry) * stride;
+            if (fx == 1) {
+                memcpy(dst, row, nx);
+            } else {
+                for (int x = 0; x < nx; ++x)
+                    for (int rx = 0; rx < fx; ++rx)
+                        *dst++ = row[x];
+            }
+        }
+    }
+}
+
+struct JPEGHuffmanTable {
+    bool defined = false;
+    uint8_t fast[1 << FAST_BITS];
+    /// Short AC codes with their value: value << 8 | run << 4 | total length (0: none)
+    int16_t fastAC[1 << FAST_BITS];
+    uint16_t code[256];
+    uint8_t values[256];
+    uint8_t size[257];
+    uint32_t maxcode[18];
+    int delta[17];
+
+    /* Canonical codes from the number of codes of each length */
+    void build(const uint8_t *counts, const uint8_t *symbols, int total) {
+        int k = 0;
+        for (int i = 0; i < 16; ++i)
+            for (int j = 0; j < counts[i]; ++j)
+                size[k++] = (uint8_t) (i + 1);
+        size[k] = 0;
+
+        int next = 0;
+        k = 0;
+        for (int j = 1; j <= 16; ++j) {
+            delta[j] = k - next;
+            while (size[k] == j)
+                code[k++] = (uint16_t) next++;
+            if (next - 1 >= (1 << j))
+                throw std::runtime_error("JPEGImage: invalid Huffman table!");
+            maxcode[j] = (uint32_t) next << (16 - j);
+            next <<= 1;
+        }
+        maxcode[17] = 0xffffffffu;
+
+        memset(fast, 255, sizeof(fast));
+        for (int i = 0; i < k; ++i) {
+            if (size[i] > FAST_BITS)
+                continue;
+            int first = code[i] << (FAST_BITS - size[i]), count = 1 << (FAST_BITS - size[i]);
+            for (int j = 0; j < count; ++j)
+                fast[first + j] = (uint8_t) i;
+        }
+        memcpy(values, symbols, total);
+
+        /* AC codes whose value bits fit behind them into the lookahead */
+        for (int i = 0; i < (1 << FAST_BITS); ++i) {
+            fastAC[i] = 0;
+            if (fast[i] == 255)
+                continue;
+            int rs = values[fast[i]], run = rs >> 4, bits = rs & 15, length = size[fast[i]];
+            if (bits == 0 || length + bits > FAST_BITS)
+                continue;
+            int value = ((i << length) & ((1 << FAST_BITS) - 1)) >> (FAST_BITS - bits);
+            if (value < (1 << (bits - 1)))
+                value = value - (1 << bits) + 1;
+            if (value >= -128 && value <= 127)
+                fastAC[i] = (int16_t) (value * 256 + run * 16 + length + bits);
+        }
+        defined = true;
+    }
+};
+
+struct JPEGComponent {
+    int id, h, v, tq;
+    int dcTable = 0, acTable = 0;
+    int dcPred = 0;
+    /// Blocks covering the component and blocks in its (MCU-aligned) plane
+    int blocksW = 0, blocksH = 0, planeBlocksW = 0, planeBlocksH = 0;
+    /// Samples per block side in the output, each repeated fx (fy) times
+    int nx = 8, ny = 8, fx = 1, fy = 1;
+    /// Coefficients of all blocks (progressive files only)
+    std::vector<int16_t> coefficients;
+    /// Samples at the output resolution
+    std::vector<uint8_t> plane;
+};
+
+/* Walks the markers of a file: up to the frame header, or through all
+   scans into the component planes */
+struct JPEGDecoder {
+    const uint8_t *data;
+    size_t size, pos = 0;
+    int scale;
+
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    bool hitMarker = false;
+
+    JPEGHuffmanTable dcTables[4], acTables[4];
+    uint16_t quant[4][64];
+    std::vector<JPEGComponent> components;
+    int width = 0, height = 0, hmax = 1, vmax = 1;
+    int mcusPerLine = 0, mcusPerColumn = 0, planeWidth = 0, planeHeight = 0;
+    bool progressive = false;
+    int restartInterval = 0, eobrun = 0;
+    /// Color transform from the Adobe marker (-1: none given)
+    int adobeTransform = -1;
+
+    JPEGDecoder(const uint8_t *data, size_t size, int scale)
+        : data(data), size(size), scale(scale) {
+        memset(quant, 0, sizeof(quant));
+    }
+
+    int nextMarker() {
+        while (pos + 1 < size) {
+            if (data[pos] == 0xFF && data[pos + 1] != 0 && data[pos + 1] != 0xFF) {
+                pos += 2;
+                return data[pos - 1];
+            }
+            pos++;
+        }
+        return -1;
+    }
+
+    /// Return the payload of the segment at 'pos' and move past it
+    const uint8_t *segment(size_t &length) {
+        if (pos + 2 > size)
+            throw std::runtime_error("JPEGImage: truncated marker segment!");
+        length = (size_t) ((data[pos] << 8) | data[pos + 1]);
+        if (length < 2 || pos + length > size)
+            throw std::runtime_error("JPEGImage: truncated marker segment!");
+        const uint8_t *payload = data + pos + 2;
+        pos += length;
+        length -= 2;
+        return payload;
+    }
+
+    void run(bool headerOnly) {
+        if (size < 2 || data[0] != 0xFF || data[1] != SOI)
+            throw std::runtime_error("JPEGImage: not a JPEG file!");
+        pos = 2;
+        bool frame = false;
+        for (;;) {
+            int marker = nextMarker();
+            if (marker == -1 || marker == EOI) {
+                if (!frame)
+                    throw std::runtime_error("JPEGImage: no frame header!");
+                break;
+            }
+            size_t length;
+            if (marker == SOF0 || marker == SOF1 || marker == SOF2) {
+                if (frame)
+                    throw std::runtime_error("JPEGImage: more than one frame!");
+                const uint8_t *p = segment(length);
+                parseFrame(p, length, marker == SOF2);
+                frame = true;
+                if (headerOnly)
+                    return;
+                layout();
+            } else if (marker >= 0xC3 && marker <= 0xCF && marker != DHT && marker != 0xC8 &&
+                       marker != 0xCC) {
+                throw std::runtime_error("JPEGImage: unsupported coding process (lossless, "
+                                         "hierarchical or arithmetic)!");
+            } else if (marker == DHT) {
+                const uint8_t *p = segment(length);
+                parseHuffmanTables(p, length);
+            } else if (marker == DQT) {
+                const uint8_t *p = segment(length);
+                parseQuantizationTables(p, length);
+            } else if (marker == DRI) {
+                const uint8_t *p = segment(length);
+                if (length < 2)
+                    throw std::runtime_error("JPEGImage: invalid restart interval!");
+                restartInterval = (p[0] << 8) | p[1];
+            } else if (marker == SOS) {
+                if (!frame)
+                    throw std::runtime_error("JPEGImage: scan before the frame header!");
+                const uint8_t *p = segment(length);
+                parseScan(p, length);
+            } else if (marker == APP14) {
+                const uint8_t *p = segment(length);
+                if (length >= 12 && memcmp(p, "Adobe", 5) == 0)
+                    adobeTransform = p[11];
+            } else if (marker >= RST0 && marker <= RST7) {
+                /* Stray restart marker between scans, nothing to skip */
+            } else {
+                segment(length);
+            }
+        }
+
+        if (progressive)
+            for (auto &c : components)
+                for (int by = 0; by < c.planeBlocksH; ++by)
+                    for (int bx = 0; bx < c.planeBlocksW; ++bx)
+                        transform(c, &c.coefficients[((size_t) by * c.planeBlocksW + bx) * 64],
+                                  bx, by);
+    }
+
+    void parseFrame(const uint8_t *p, size_t length, bool isProgressive) {
+        if (length < 6)
+            throw std::runtime_error("JPEGImage: invalid frame header!");
+        if (p[0] != 8)
+            throw std::runtime_error("JPEGImage: only 8 bit samples are supported!");
+        height = (p[1] << 8) | p[2];
+        width = (p[3] << 8) | p[4];
+        int count = p[5];
+        if (width == 0 || height == 0)
+            throw std::runtime_error("JPEGImage: the image has no size in its frame header!");
+        if (count != 1 && count != 3)
+            throw std::runtime_error("JPEGImage: only grayscale and three-component images "
+                                     "are supported!");
+        if (length < 6 + (size_t) count * 3)
+            throw std::runtime_error("JPEGImage: invalid frame header!");
+        progressive = isProgressive;
+
+        components.resize(count);
+        for (int i = 0; i < count; ++i) {
+            JPEGComponent &c = components[i];
+            c.id = p[6 + i * 3];
+            c.h = p[7 + i * 3] >> 4;
+            c.v = p[7 + i * 3] & 15;
+            c.tq = p[8 + i * 3];
+            if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.tq > 3)
+                throw std::runtime_error("JPEGImage: invalid component in the frame header!");
+            hmax = std::max(hmax, c.h);
+            vmax = std::max(vmax, c.v);
+        }
+        /* Chroma is transformed straight to the output resolution, which
+           needs power-of-two subsampling */
+        for (auto &c : components) {
+            int rx = hmax / c.h, ry = vmax / c.v;
+            if (hmax % c.h || vmax % c.v || (rx & (rx - 1)) || (ry & (ry - 1)))
+                throw std::runtime_error("JPEGImage: unsupported chroma subsampling!");
+        }
+    }
+
+    void layout() {
+        int blockSize = 8 / scale;
+        mcusPerLine = (width + 8 * hmax - 1) / (8 * hmax);
+        mcusPerColumn = (height + 8 * vmax - 1) / (8 * vmax);
+        planeWidth = mcusPerLine * hmax * blockSize;
+        planeHeight = mcusPerColumn * vmax * blockSize;
+        for (auto &c : components) {
+            int cw = (width * c.h + hmax - 1) / hmax, ch = (height * c.v + vmax - 1) / vmax;
+            c.blocksW = (cw + 7) / 8;
+            c.blocksH = (ch + 7) / 8;
+            c.planeBlocksW = mcusPerLine * c.h;
+            c.planeBlocksH = mcusPerColumn * c.v;
+            /* A subsampled block covers more output samples; an inverse DCT
+               bigger than 8x8 has no coefficients, so repeat the samples */
+            int spanX = blockSize * hmax / c.h, spanY = blockSize * vmax / c.v;
+            c.nx = std::min(8, spanX);
+            c.ny = std::min(8, spanY);
+            c.fx = spanX / c.nx;
+            c.fy = spanY / c.ny;
+            c.plane.assign((size_t) planeWidth * planeHeight, 128);
+            if (progressive)
+                c.coefficients.assign((size_t) c.planeBlocksW * c.planeBlocksH * 64, 0);
+        }
+    }
+
+    void parseHuffmanTables(const uint8_t *p, size_t length) {
+        size_t offset = 0;
+        while (offset + 17 <= length) {
+            int tc = p[offset] >> 4, th = p[offset] & 15;
+            if (tc > 1 || th > 3)
+                throw std::runtime_error("JPEGImage: invalid Huffman table!");
+            const uint8_t *counts = p + offset + 1;
+            int total = 0;
+            for (int i = 0; i < 16; ++i)
+                total += counts[i];
+            if (total > 256 || offset + 17 + total > length)
+                throw std::runtime_error("JPEGImage: invalid Huffman table!");
+            (tc == 0 ? dcTables : acTables)[th].build(counts, p + offset + 17, total);
+            offset += 17 + total;
+        }
+    }
+
+    void parseQuantizationTables(const uint8_t *p, size_t length) {
+        size_t offset = 0;
+        while (offset < length) {
+            int pq = p[offset] >> 4, tq = p[offset] & 15;
+            size_t tableSize = pq ? 128 : 64;
+            if (pq > 1 || tq > 3 || offset + 1 + tableSize > length)
+                throw std::runtime_error("JPEGImage: invalid quantization table!");
+            const uint8_t *values = p + offset + 1;
+            for (int i = 0; i < 64; ++i)
+                quant[tq][zigzag[i]] = pq ? (uint16_t) ((values[i * 2] << 8) | values[i * 2 + 1])
+                                          : values[i];
+            offset += 1 + tableSize;
+        }
+    }
+
+    void parseScan(const uint8_t *p, size_t length) {
+        if (length < 1)
+            throw std::runtime_error("JPEGImage: invalid scan header!");
+        int count = p[0];
+        if (count < 1 || count > (int) components.size() || length < 4 + (size_t) count * 2)
+            throw std::runtime_error("JPEGImage: invalid scan header!");
+        std::vector<JPEGComponent *> scan;
+        for (int i = 0; i < count; ++i) {
+            int id = p[1 + i * 2], tables = p[2 + i * 2];
+            JPEGComponent *c = nullptr;
+            for (auto &component : components)
+                if (component.id == id)
+                    c = &component;
+            if (!c || (tables >> 4) > 3 || (tables & 15) > 3)
+                throw std::runtime_error("JPEGImage: invalid scan header!");
+            c->dcTable = tables >> 4;
+            c->acTable = tables & 15;
+            scan.push_back(c);
+        }
+        int ss = p[1 + count * 2], se = p[2 + count * 2];
+        int ah = p[3 + count * 2] >> 4, al = p[3 + count * 2] & 15;
+        if (!progressive) {
+            ss = 0;
+            se = 63;
+            ah = al = 0;
+        } else if (se > 63 || ss > se || (ss == 0 && se != 0) || (ss > 0 && count != 1) ||
+                   al > 13) {
+            throw std::runtime_error("JPEGImage: invalid progressive scan!");
+        }
+        decodeScan(scan, ss, se, ah, al);
+    }
+
+    void resetBits() {
+        bitBuffer = 0;
+        bitCount = 0;
+        hitMarker = false;
+    }
+
+    /* Entropy-coded bytes into the bit buffer; past a marker (or the end of
+       a truncated file) only zeros arrive */
+    void fill() {
+        while (bitCount <= 24) {
+            uint32_t byte = 0;
+            if (!hitMarker && pos < size) {
+                byte = data[pos];
+                if (byte == 0xFF) {
+                    int next = pos + 1 < size ? data[pos + 1] : (int) EOI;
+                    if (next == 0) {
+                        pos += 2;
+                    } else {
+                        hitMarker = true;
+                        byte = 0;
+                    }
+                } else {
+                    pos++;
+                }
+            }
+            bitBuffer |= byte << (24 - bitCount);
+            bitCount += 8;
+        }
+    }
+
+    int receive(int n) {
+        if (n == 0)
+            return 0;
+        if (n > 16)
+            throw std::runtime_error("JPEGImage: corrupt Huffman code!");
+        if (bitCount < n)
+            fill();
+        int value = (int) (bitBuffer >> (32 - n));
+        bitBuffer <<= n;
+        bitCount -= n;
+        return value;
+    }
+
+    int receiveExtend(int n) {
+        if (n == 0)
+            return 0;
+        int value = receive(n);
+        return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+    }
+
+    int decodeHuffman(const JPEGHuffmanTable &t) {
+        if (bitCount < 16)
+            fill();
+        int k = t.fast[bitBuffer >> (32 - FAST_BITS)];
+        if (k < 255) {
+            int s = t.size[k];
+            bitBuffer <<= s;
+            bitCount -= s;
+            return t.values[k];
+        }
+        uint32_t prefix = bitBuffer >> 16;
+        for (k = FAST_BITS + 1; k < 17; ++k)
+            if (prefix < t.maxcode[k])
+                break;
+        if (k == 17)
+            throw std::runtime_error("JPEGImage: corrupt Huffman code!");
+        int index = (int) (bitBuffer >> (32 - k)) + t.delta[k];
+        if (index < 0 || index > 255)
+            throw std::runtime_error("JPEGImage: corrupt Huffman code!");
+        bitBuffer <<= k;
+        bitCount -= k;
+        return t.values[index];
+    }
+
+    const JPEGHuffmanTable &table(const JPEGHuffmanTable *tables, int index) {
+        if (!tables[index].defined)
+            throw std::runtime_error("JPEGImage: scan uses an undefined Huffman table!");
+        return tables[index];
+    }
+
+    void restart() {
+        resetBits();
+        while (pos + 1 < size) {
+            if (data[pos] == 0xFF && data[pos + 1] >= RST0 && data[pos + 1] <= RST7) {
+                pos += 2;
+                break;
+            }
+            /* Any other marker ends the scan early; 'fill' stops there */
+            if (data[pos] == 0xFF && data[pos + 1] != 0 && data[pos + 1] != 0xFF)
+                break;
+            pos++;
+        }
+        eobrun = 0;
+        for (auto &c : components)
+            c.dcPred = 0;
+    }
+
+    void decodeScan(const std::vector<JPEGComponent *> &scan, int ss, int se, int ah, int al) {
+        for (JPEGComponent *c : scan) {
+            if (!progressive || ss > 0 || ah == 0)
+                table(ss == 0 ? dcTables : acTables, ss == 0 ? c->dcTable : c->acTable);
+            if (!progressive)
+                table(acTables, c->acTable);
+        }
+        resetBits();
+        eobrun = 0;
+        for (auto &c : components)
+            c.dcPred = 0;
+
+        int todo = restartInterval > 0 ? restartInterval : INT_MAX;
+        if (scan.size() == 1) {
+            /* Non-interleaved: the blocks of the component, row by row */
+            JPEGComponent &c = *scan[0];
+            for (int by = 0; by < c.blocksH; ++by) {
+                for (int bx = 0; bx < c.blocksW; ++bx) {
+                    decodeBlock(c, bx, by, ss, se, ah, al);
+                    if (--todo == 0) {
+                        restart();
+                        todo = restartInterval;
+                    }
+                }
+            }
+        } else {
+            for (int my = 0; my < mcusPerColumn; ++my) {
+                for (int mx = 0; mx < mcusPerLine; ++mx) {
+                    for (JPEGComponent *c : scan)
+                        for (int v = 0; v < c->v; ++v)
+                            for (int h = 0; h < c->h; ++h)
+                                decodeBlock(*c, mx * c->h + h, my * c->v + v, ss, se, ah, al);
+                    if (--todo == 0) {
+                        restart();
+                        todo = restartInterval;
+                    }
+                }
+            }
+        }
+    }
+
+    void decodeBlock(JPEGComponent &c, int bx, int by, int ss, int se, int ah, int al) {
+        if (!progressive) {
+            int16_t block[64];
+            memset(block, 0, sizeof(block));
+            decodeBaseline(c, block);
+            transform(c, block, bx, by);
+            return;
+        }
+        int16_t *block = &c.coefficients[((size_t) by * c.planeBlocksW + bx) * 64];
+        if (ss == 0)
+            decodeDC(c, block, ah, al);
+        else if (ah == 0)
+            decodeACFirst(c, block, ss, se, al);
+        else
+            decodeACRefine(c, block, ss, se, al);
+    }
+
+    void decodeBaseline(JPEGComponent &c, int16_t *block) {
+        c.dcPred += receiveExtend(decodeHuffman(dcTables[c.dcTable]));
+        block[0] = (int16_t) c.dcPred;
+        const JPEGHuffmanTable &ac = acTables[c.acTable];
+        for (int k = 1; k < 64; ) {
+            if (bitCount < 16)
+                fill();
+            int fast = ac.fastAC[bitBuffer >> (32 - FAST_BITS)];
+            if (fast) {
+                k += (fast >> 4) & 15;
+                bitBuffer <<= fast & 15;
+                bitCount -= fast & 15;
+                block[zigzag[k++]] = (int16_t) (fast >> 8);
+                continue;
+            }
+            int rs = decodeHuffman(ac), r = rs >> 4, s = rs & 15;
+            if (s == 0) {
+                if (r != 15)
+                    break;
+                k += 16;
+            } else {
+                k += r;
+                block[zigzag[k]] = (int16_t) receiveExtend(s);
+                k++;
+            }
+        }
+    }
+
+    void decodeDC(JPEGComponent &c, int16_t *block, int ah, int al) {
+        if (ah == 0) {
+            c.dcPred += receiveExtend(decodeHuffman(dcTables[c.dcTable]));
+            block[0] = (int16_t) (c.dcPred * (1 << al));
+        } else if (receive(1)) {
+            block[0] |= (int16_t) (1 << al);
+        }
+    }
+
+    void decodeACFirst(JPEGComponent &c, int16_t *block, int ss, int se, int al) {
+        if (eobrun > 0) {
+            eobrun--;
+            return;
+        }
+        const JPEGHuffmanTable &ac = acTables[c.acTable];
+        for (int k = ss; k <= se; ) {
+            if (bitCount < 16)
+                fill();
+            int fast = ac.fastAC[bitBuffer >> (32 - FAST_BITS)];
+            if (fast) {
+                k += (fast >> 4) & 15;
+                bitBuffer <<= fast & 15;
+                bitCount -= fast & 15;
+                block[zigzag[k++]] = (int16_t) ((fast >> 8) * (1 << al));
+                continue;
+            }
+            int rs = decodeHuffman(ac), r = rs >> 4, s = rs & 15;
+            if (s == 0) {
+                if (r < 15) {
+                    eobrun = (1 << r) - 1 + receive(r);
+                    break;
+                }
+                k += 16;
+            } else {
+                k += r;
+                block[zigzag[k]] = (int16_t) (receiveExtend(s) * (1 << al));
+                k++;
+            }
+        }
+    }
+
+    /* Successive approximation: one more bit of every nonzero coefficient,
+       and coefficients that become nonzero at this bit */
+    void decodeACRefine(JPEGComponent &c, int16_t *block, int ss, int se, int al) {
+        int p1 = 1 << al, m1 = -p1;
+        int k = ss;
+        if (eobrun == 0) {
+            const JPEGHuffmanTable &ac = acTables[c.acTable];
+            for (; k <= se; ++k) {
+                int rs = decodeHuffman(ac), r = rs >> 4, s = rs & 15;
+                if (s) {
+                    s = receive(1) ? p1 : m1;
+                } else if (r != 15) {
+                    eobrun = (1 << r) + receive(r);
+                    break;
+                }
+                /* Skip r zero coefficients, refining the nonzero ones passed */
+                for (; k <= se; ++k) {
+                    int16_t &coef = block[zigzag[k]];
+                    if (coef != 0) {
+                        if (receive(1) && (coef & p1) == 0)
+                            coef = (int16_t) (coef + (coef >= 0 ? p1 : m1));
+                    } else if (--r < 0) {
+                        break;
+                    }
+                }
+                if (s && k <= 63)
+                    block[zigzag[k]] = (int16_t) s;
+            }
+        }
+        if (eobrun > 0) {
+            for (; k <= se; ++k) {
+                int16_t &coef = block[zigzag[k]];
+                if (coef != 0 && receive(1) && (coef & p1) == 0)
+                    coef = (int16_t) (coef + (coef >= 0 ? p1 : m1));
+            }
+            eobrun--;
+        }
+    }
+
+    void transform(JPEGComponent &c, const int16_t *block, int bx, int by) {
+        uint8_t *out = c.plane.data() + (size_t) by * c.ny * c.fy * planeWidth +
+                       (size_t) bx * c.nx * c.fx;
+        inverseDCT(block, quant[c.tq], c.nx, c.ny, c.fx, c.fy, out, planeWidth);
+    }
+
+    /// Whether three components hold RGB rather than YCbCr
+    bool isRGB() const {
+        if (adobeTransform != -1)
+            return adobeTransform == 0;
+        return components[0].id == 'R' && components[1].id == 'G' && components[2].id == 'B';
+    }
+
+    void convert(std::vector<uint8_t> &rgba, int outWidth, int outHeight) const {
+        rgba.resize((size_t) outWidth * outHeight * 4);
+        bool gray = components.size() == 1, rgb = !gray && isRGB();
+        for (int y = 0; y < outHeight; ++y) {
+            const uint8_t *p0 = components[0].plane.data() + (size_t) y * planeWidth;
+            uint8_t *dst = rgba.data() + (size_t) y * outWidth * 4;
+            if (gray) {
+                for (int x = 0; x < outWidth; ++x, dst += 4) {
+                    dst[0] = dst[1] = dst[2] = p0[x];
+                    dst[3] = 255;
+                }
+                continue;
+            }
+            const uint8_t *p1 = components[1].plane.data() + (size_t) y * planeWidth;
+            const uint8_t *p2 = components[2].plane.data() + (size_t) y * planeWidth;
+            if (rgb) {
+                for (int x = 0; x < outWidth; ++x, dst += 4) {
+                    dst[0] = p0[x];
+                    dst[1] = p1[x];
+                    dst[2] = p2[x];
+                    dst[3] = 255;
+                }
+                continue;
+            }
+            /* JFIF YCbCr, 16 bit fixed point */
+            for (int x = 0; x < outWidth; ++x, dst += 4) {
+                int luma = p0[x] << 16, cb = p1[x] - 128, cr = p2[x] - 128;
+                int r = (luma + 91881 * cr + 32768) >> 16;
+                int g = (luma - 22554 * cb - 46802 * cr + 32768) >> 16;
+                int b = (luma + 116130 * cb + 32768) >> 16;
+                dst[0] = (uint8_t) std::min(std::max(r, 0), 255);
+                dst[1] = (uint8_t) std::min(std::max(g, 0), 255);
+                dst[2] = (uint8_t) std::min(std::max(b, 0), 255);
+                dst[3] = 255;
+            }
+        }
+    }
+};
+
+JPEGImage::JPEGImage(const std::string &fileName)
+    : mFileName(fileName), mWidth(0), mHeight(0), mComponents(0), mProgressive(false) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("JPEGImage: could not open \"" + fileName + "\"!");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    mData.resize(size > 0 ? (size_t) size : 0);
+    bool ok = size > 0 && fread(mData.data(), mData.size(), 1, file) == 1;
+    fclose(file);
+    if (!ok)
+        throw std::runtime_error("JPEGImage: could not read \"" + fileName + "\"!");
+    parseHeader();
+}
+
+void JPEGImage::parseHeader() {
+    JPEGDecoder decoder(mData.data(), mData.size(), 1);
+    decoder.run(true);
+    mWidth = decoder.width;
+    mHeight = decoder.height;
+    mComponents = (int) decoder.components.size();
+    mProgressive = decoder.progressive;
+}
+
+bool JPEGImage::isJPEG(const std::string &fileName) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file)
+        return false;
+    uint8_t marker[3];
+    bool result = fread(marker, sizeof(marker), 1, file) == 1 &&
+                  marker[0] == 0xFF && marker[1] == SOI && marker[2] == 0xFF;
+    fclose(file);
+    return result;
+}
+
+int JPEGImage::scaleFor(int width, int height, int minWidth, int minHeight) {
+    int scale = 1;
+    while (scale < 8 && scaledSize(width, scale * 2) >= minWidth &&
+           scaledSize(height, scale * 2) >= minHeight)
+        scale *= 2;
+    return scale;
+}
+
+void JPEGImage::decode(int scale, std::vector<uint8_t> &rgba, int &width, int &height) const {
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+        throw std::runtime_error("JPEGImage::decode(): the scale must be 1, 2, 4 or 8!");
+    JPEGDecoder decoder(mData.data(), mData.size(), scale);
+    decoder.run(false);
+    width = scaledSize(mWidth, scale);
+    height = scaledSize(mHeight, scale);
+    decoder.convert(rgba, width, height);
+}
+
+bool JPEGImage::loadScaled(const std::string &fileName, int minWidth, int minHeight,
+                           std::vector<uint8_t> &rgba, int &width, int &height) {
+    if (!isJPEG(fileName))
+        return false;
+    try {
+        ref<JPEGImage> image = new JPEGImage(fileName);
+        int scale = image->scaleFor(minWidth, minHeight);
+        if (scale == 1)
+            return false;
+        image->decode(scale, rgba, width, height);
+        return true;
+    } catch (const std::exception &) {
+        /* Unsupported, corrupt or too large; the full decoder gets its chance */
+        return false;
+    }
+}
+
+NAMESPACE_END(nanogui)
@@ -21,13 +21,14 @@
 
 // Includes for the GLTexture class.
 #include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <utility>
 
 NAMESPACE_BEGIN(nanogui)
 
 MediaItemBase::MediaItemBase(Widget *parent)
-    : Widget(parent), mCanvasPos(.5,.5), mCanvasSize(.25,.25),
+    : Widget(parent), mImageMode(ImageMode::Scale), mCanvasPos(.5,.5), mCanvasSize(.25,.25),
 	  mIsXSnap(false), mIsYSnap(false){
 	mPos = {40,40};
 	mSize = {90, 90};
@@ -35,11 +36,32 @@ MediaItemBase::MediaItemBase(Widget *parent)
 	mDrag = false;
 }
 
-/*
 MediaItemBase::~MediaItemBase()
 {
-    //delete texture;
-}*/
+    //Images the subclass did not delete go once the context is current
+    if (mTextureRegistry)
+        mTextureRegistry->releaseOwner(this);
+}
+
+void MediaItemBase::trackTexture(NVGcontext *ctx, int image, size_t bytes) {
+    if (image <= 0)
+        return;
+    Screen *screen = nullptr;
+    for (Widget *w = this; w && !screen; w = w->parent())
+        screen = dynamic_cast<Screen *>(w);
+    //Offscreen contexts (thumbnails, slide_render) are not accounted for
+    if (!screen || screen->nvgContext() != ctx)
+        return;
+    mTextureRegistry = screen->textureRegistry();
+    if (bytes > 0)
+        mTextureRegistry->add(image, bytes);
+    mTextureRegistry->setOwner(image, this);
+}
+
+void MediaItemBase::untrackTexture(int image) {
+    if (mTextureRegistry)
+        mTextureRegistry->disown(image, this);
+}
 
 Vector2i MediaItemBase::preferredSize(NVGcontext *ctx) const {
     Vector2i result = mSize;
@@ -60,6 +82,9 @@ void MediaItemBase::performLayout(NVGcontext *ctx) {
 //or maybe we create a virtual method for the parent class to
 //override.
 void MediaItemBase::draw(NVGcontext *ctx) {
+    if (mTextureRegistry)
+        mTextureRegistry->touch(this);
+
     nvgSave(ctx);
 
     //Outer widget rectangle
@@ -81,6 +106,83 @@ void MediaItemBase::draw(NVGcontext *ctx) {
     Widget::draw(ctx);
 }
 
+void MediaItemBase::drawFittedImage(NVGcontext *ctx, int image){
+	int w, h;
+
+	nvgImageSize(ctx, image, &w, &h);
+	drawFittedImage(ctx, image, Vector2i(0, 0), Vector2i(w, h));
+}
+
+Vector2i MediaItemBase::fittedSize(const Vector2i &imageSize) const {
+	int w = imageSize.x(), h = imageSize.y();
+	float inRatio = ((float)w)/h;
+	float outRatio = ((float)(mSize.x()-mHandleSize))/(mSize.y()-mHandleSize);
+	int maxOutputWidth = mSize.x()-mHandleSize, maxOutputHeight = mSize.y()-mHandleSize;
+	int outputWidth = 0, outputHeight = 0;
+
+	switch(mImageMode)
+	{
+		case ImageMode::Crop:
+			if(inRatio > outRatio)
+			{
+				outputHeight = maxOutputHeight;
+				outputWidth = ((float)maxOutputHeight)*inRatio;
+			}else{
+				outputWidth = maxOutputWidth;
+				outputHeight = ((float)maxOutputWidth)/inRatio;
+			}
+			break;
+		case ImageMode::Scale:
+			if(inRatio < outRatio)
+			{
+				outputHeight = maxOutputHeight;
+				outputWidth = ((float)maxOutputHeight)*inRatio;
+			}else{
+				outputWidth = maxOutputWidth;
+				outputHeight = ((float)maxOutputWidth)/inRatio;
+			}
+			break;
+		case ImageMode::Stretch:
+			outputHeight = maxOutputHeight;
+			outputWidth = maxOutputWidth;
+			break;
+	}
+	return Vector2i(outputWidth, outputHeight);
+}
+
+void MediaItemBase::drawFittedImage(NVGcontext *ctx, int image,
+		const Vector2i &regionOrigin, const Vector2i &regionSize){
+	int imageWidth, imageHeight;
+	int w = regionSize.x(), h = regionSize.y();
+
+	nvgImageSize(ctx, image, &imageWidth, &imageHeight);
+
+	Vector2i output = fittedSize(regionSize);
+	int outputWidth = output.x(), outputHeight = output.y();
+
+	//The pattern spans the whole image, placed so that the region fills the output
+	float scaleX = ((float)outputWidth)/w, scaleY = ((float)outputHeight)/h;
+	NVGpaint imgPaint = nvgImagePattern(ctx,
+			mPos.x()+(mSize.x()/2)-outputWidth/2-regionOrigin.x()*scaleX,
+			mPos.y()+(mSize.y()/2)-outputHeight/2-regionOrigin.y()*scaleY,
+			imageWidth*scaleX,imageHeight*scaleY,
+			0, image, 1);
+
+	nvgBeginPath(ctx);
+
+	if(mImageMode == ImageMode::Scale)
+		nvgRect(ctx,
+				mPos.x()+(mSize.x()/2)-outputWidth/2,
+				mPos.y()+(mSize.y()/2)-outputHeight/2,
+				outputWidth,outputHeight);
+	else
+		nvgRect(ctx, mPos.x()+mHandleSize/2,mPos.y()+mHandleSize/2,mSize.x()-mHandleSize,mSize.y()-mHandleSize);
+
+
+	nvgFillPaint(ctx, imgPaint);
+	nvgFill(ctx);
+}
+
 void MediaItemBase::drawSnaps(NVGcontext *ctx){
 	int thickness = 2;
 
@@ -309,14 +411,60 @@ void MediaItemBase::refreshRelativePlacement() {
 
 void MediaItemBase::save(Serializer &s) const {
     Widget::save(s);
+    s.set("canvasPos", mCanvasPos);
+    s.set("canvasSize", mCanvasSize);
 }
 
 bool MediaItemBase::load(Serializer &s) {
     if (!Widget::load(s)) return false;
-//    if (!s.get("title", mTitle)) return false;
-//    if (!s.get("modal", mModal)) return false;
+    if (!s.get("canvasPos", mCanvasPos)) return false;
+    if (!s.get("canvasSize", mCanvasSize)) return false;
+    return true;
+}
 
+void MediaItemBase::saveImageMode(Serializer &s) const {
+    s.set("imageMode", (int) mImageMode);
+}
+
+bool MediaItemBase::loadImageMode(Serializer &s) {
+    int imageMode;
+    if (!s.get("imageMode", imageMode)) return false;
+    mImageMode = imageMode >= 0 && imageMode <= 2 ? (ImageMode) imageMode : ImageMode::Scale;
     return true;
 }
 
+/* Directory part of a path, including the trailing separator */
+static std::string directoryOf(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static bool fileExists(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file)
+        fclose(file);
+    return file != nullptr;
+}
+
+std::string MediaItemBase::documentPath(const Serializer &s, const std::string &path) {
+    std::string directory = directoryOf(s.filename());
+    if (!directory.empty() && path.size() > directory.size() &&
+        path.compare(0, directory.size(), directory) == 0)
+        return path.substr(directory.size());
+    return path;
+}
+
+std::string MediaItemBase::resolveDocumentPath(const Serializer &s, const std::string &path) {
+    std::string directory = directoryOf(s.filename());
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\' ||
+                                      (path.size() > 1 && path[1] == ':'));
+    if (path.empty() || directory.empty() || absolute)
+        return path;
+    /* Image sequences ("frame%04d.png") are never found, and resolve against the document */
+    std::string resolved = directory + path;
+    if (!fileExists(resolved) && fileExists(path))
+        return path;
+    return resolved;
+}
+
 NAMESPACE_END(nanogui)
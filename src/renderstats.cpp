@@ -0,0 +1,97 @@
+/*
+    src/renderstats.cpp -- Per-frame counters for the NanoVG render backend
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/renderstats.h>
+#include <map>
+#include <mutex>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* The backend callbacks only receive the backend's user pointer, which is
+   used to find the counters and the original callbacks */
+struct RenderStatsHook {
+    NVGparams original;
+    RenderStats stats;
+};
+
+static std::mutex hookMutex;
+static std::map<void *, RenderStatsHook> hooks;
+
+static RenderStatsHook &findHook(void *uptr) {
+    std::lock_guard<std::mutex> guard(hookMutex);
+    return hooks.find(uptr)->second;
+}
+
+static void statsRenderFill(void *uptr, NVGpaint *paint,
+                            NVGcompositeOperationState compositeOperation,
+                            NVGscissor *scissor, float fringe, const float *bounds,
+                            const NVGpath *paths, int npaths) {
+    RenderStatsHook &hook = findHook(uptr);
+    hook.stats.fillCalls++;
+    hook.original.renderFill(uptr, paint, compositeOperation, scissor, fringe,
+                             bounds, paths, npaths);
+}
+
+static void statsRenderStroke(void *uptr, NVGpaint *paint,
+                              NVGcompositeOperationState compositeOperation,
+                              NVGscissor *scissor, float fringe, float strokeWidth,
+                              const NVGpath *paths, int npaths) {
+    RenderStatsHook &hook = findHook(uptr);
+    hook.stats.strokeCalls++;
+    hook.original.renderStroke(uptr, paint, compositeOperation, scissor, fringe,
+                               strokeWidth, paths, npaths);
+}
+
+static void statsRenderTriangles(void *uptr, NVGpaint *paint,
+                                 NVGcompositeOperationState compositeOperation,
+                                 NVGscissor *scissor, const NVGvertex *verts,
+                                 int nverts) {
+    RenderStatsHook &hook = findHook(uptr);
+    hook.stats.triangleCalls++;
+    hook.original.renderTriangles(uptr, paint, compositeOperation, scissor,
+                                  verts, nverts);
+}
+
+void nvgAttachRenderStats(NVGcontext *ctx) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    if (hooks.count(params->userPtr))
+        return;
+    hooks[params->userPtr].original = *params;
+    params->renderFill = statsRenderFill;
+    params->renderStroke = statsRenderStroke;
+    params->renderTriangles = statsRenderTriangles;
+}
+
+void nvgDetachRenderStats(NVGcontext *ctx) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    auto it = hooks.find(params->userPtr);
+    if (it == hooks.end())
+        return;
+    params->renderFill = it->second.original.renderFill;
+    params->renderStroke = it->second.original.renderStroke;
+    params->renderTriangles = it->second.original.renderTriangles;
+    hooks.erase(it);
+}
+
+RenderStats nvgTakeRenderStats(NVGcontext *ctx) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    auto it = hooks.find(params->userPtr);
+    if (it == hooks.end())
+        return RenderStats();
+    RenderStats stats = it->second.stats;
+    it->second.stats = RenderStats();
+    return stats;
+}
+
+NAMESPACE_END(nanogui)
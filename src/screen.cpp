@@ -16,7 +16,12 @@
 #include <nanogui/opengl.h>
 #include <nanogui/window.h>
 #include <nanogui/popup.h>
+#include <nanogui/renderstats.h>
+#include <nanogui/displaylist.h>
+#include <nanogui/textcache.h>
+#include <nanogui/glutil.h>
 #include <map>
+#include <thread>
 #include <iostream>
 
 #if defined(_WIN32)
@@ -105,17 +110,22 @@ static float get_pixel_ratio(GLFWwindow *window) {
 Screen::Screen()
     : Widget(nullptr), mGLFWWindow(nullptr), mNVGContext(nullptr),
       mCursor(Cursor::Arrow), mBackground(0.3f, 0.3f, 0.32f, 1.f),
-      mShutdownGLFWOnDestruct(false), mFullscreen(false) {
+      mShutdownGLFWOnDestruct(false), mFullscreen(false), mFrameTime(0), mDebugHUD(false),
+      mRedraw(false),
+      mStopRendering(false) {
     memset(mCursors, 0, sizeof(GLFWcursor *) * (int) Cursor::CursorCount);
 }
 
 Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
                bool fullscreen, int colorBits, int alphaBits, int depthBits,
                int stencilBits, int nSamples,
-               unsigned int glMajor, unsigned int glMinor)
+               unsigned int glMajor, unsigned int glMinor,
+               ContextGroup *contextGroup)
     : Widget(nullptr), mGLFWWindow(nullptr), mNVGContext(nullptr),
       mCursor(Cursor::Arrow), mBackground(0.3f, 0.3f, 0.32f, 1.f), mCaption(caption),
-      mShutdownGLFWOnDestruct(false), mFullscreen(fullscreen) {
+      mShutdownGLFWOnDestruct(false), mFullscreen(fullscreen), mFrameTime(0), mDebugHUD(false),
+      mRedraw(false),
+      mStopRendering(false) {
     memset(mCursors, 0, sizeof(GLFWcursor *) * (int) Cursor::CursorCount);
 
     /* Request a forward compatible OpenGL glMajor.glMinor core profile context.
@@ -135,14 +145,15 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
     glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
     glfwWindowHint(GLFW_RESIZABLE, resizable ? GL_TRUE : GL_FALSE);
 
+    GLFWwindow *share = contextGroup ? contextGroup->shareWindow() : nullptr;
     if (fullscreen) {
         GLFWmonitor *monitor = glfwGetPrimaryMonitor();
         const GLFWvidmode *mode = glfwGetVideoMode(monitor);
         mGLFWWindow = glfwCreateWindow(mode->width, mode->height,
-                                       caption.c_str(), monitor, nullptr);
+                                       caption.c_str(), monitor, share);
     } else {
         mGLFWWindow = glfwCreateWindow(size.x(), size.y(),
-                                       caption.c_str(), nullptr, nullptr);
+                                       caption.c_str(), nullptr, share);
     }
 
     if (!mGLFWWindow)
@@ -186,6 +197,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->cursorPosCallbackEvent(x, y);
         }
     );
@@ -198,6 +210,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->mouseButtonCallbackEvent(button, action, modifiers);
         }
     );
@@ -210,6 +223,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->keyCallbackEvent(key, scancode, action, mods);
         }
     );
@@ -222,6 +236,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->charCallbackEvent(codepoint);
         }
     );
@@ -234,6 +249,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->dropCallbackEvent(count, filenames);
         }
     );
@@ -246,6 +262,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             Screen *s = it->second;
             if (!s->mProcessEvents)
                 return;
+            auto lock = s->lockWidgets();
             s->scrollCallbackEvent(x, y);
         }
     );
@@ -264,6 +281,7 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
             if (!s->mProcessEvents)
                 return;
 
+            auto lock = s->lockWidgets();
             s->resizeCallbackEvent(width, height);
         }
     );
@@ -276,12 +294,18 @@ Screen::Screen(const Vector2i &size, const std::string &caption, bool resizable,
                 return;
 
             Screen *s = it->second;
+            auto lock = s->lockWidgets();
             // focused: 0 when false, 1 when true
             s->focusEvent(focused != 0);
         }
     );
 
     initialize(mGLFWWindow, true);
+
+    if (contextGroup) {
+        mContextGroup = contextGroup;
+        mContextGroup->addContext(mNVGContext, mGLFWWindow);
+    }
 }
 
 void Screen::initialize(GLFWwindow *window, bool shutdownGLFWOnDestruct) {
@@ -324,6 +348,11 @@ void Screen::initialize(GLFWwindow *window, bool shutdownGLFWOnDestruct) {
     mNVGContext = nvgCreateGL3(flags);
     if (mNVGContext == nullptr)
         throw std::runtime_error("Could not initialize NanoVG!");
+    nvgAttachRenderStats(mNVGContext);
+    nvgAttachDisplayLists(mNVGContext);
+    mTextureRegistry = new TextureRegistry(mNVGContext);
+    mTextureUploader = new GLTextureUploader();
+    mWorkerPool = new WorkerPool();
 
     mVisible = glfwGetWindowAttrib(window, GLFW_VISIBLE) != 0;
     setTheme(new Theme(mNVGContext));
@@ -339,17 +368,45 @@ void Screen::initialize(GLFWwindow *window, bool shutdownGLFWOnDestruct) {
 
     /// Fixes retina display-related font rendering issue (#185)
     nvgBeginFrame(mNVGContext, mSize[0], mSize[1], mPixelRatio);
+    setTextCachePixelRatio(mNVGContext, mPixelRatio);
     nvgEndFrame(mNVGContext);
 }
 
 Screen::~Screen() {
+    stopRenderThread();
     __nanogui_screens.erase(mGLFWWindow);
     for (int i=0; i < (int) Cursor::CursorCount; ++i) {
         if (mCursors[i])
             glfwDestroyCursor(mCursors[i]);
     }
-    if (mNVGContext)
+    if (mNVGContext) {
+        /* Release the widgets first, some of them own NanoVG images */
+        for (auto child : mChildren) {
+            if (child)
+                child->decRef();
+        }
+        mChildren.clear();
+        glfwMakeContextCurrent(mGLFWWindow);
+        for (auto &ring : mRetiredCaptureRings)
+            ring->free();
+        mRetiredCaptureRings.clear();
+        if (mCaptureRing) {
+            mCaptureRing->free();
+            mCaptureRing = nullptr;
+        }
+        mTextureUploader->free();
+        if (mContextGroup) {
+            /* Unreferenced shared textures are deleted right away */
+            mContextGroup->removeContext(mNVGContext);
+        }
+        __nanogui_release_images(mNVGContext);
+        releaseTextCache(mNVGContext);
+        /* Deletes the images of the released widgets */
+        mTextureRegistry->detach();
+        nvgDetachDisplayLists(mNVGContext);
+        nvgDetachRenderStats(mNVGContext);
         nvgDeleteGL3(mNVGContext);
+    }
     if (mGLFWWindow && mShutdownGLFWOnDestruct)
         glfwDestroyWindow(mGLFWWindow);
 }
@@ -383,26 +440,190 @@ void Screen::setSize(const Vector2i &size) {
 }
 
 void Screen::drawAll() {
-    glClearColor(mBackground[0], mBackground[1], mBackground[2], mBackground[3]);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-    drawContents();
-    drawWidgets();
+    {
+        auto lock = lockWidgets();
+        double frameStart = glfwGetTime();
+        mFrameTime = frameStart;
+        glClearColor(mBackground[0], mBackground[1], mBackground[2], mBackground[3]);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+        /* Frees the images of destroyed widgets while the context is current */
+        mTextureRegistry->beginFrame();
+
+        /* Stream the next stripes of large textures; the transfers overlap with this frame */
+        mTextureUploader->process();
+        if (mTextureUploader->pending() > 0)
+            requestFrame();
+
+        drawContents();
+        drawWidgets();
+
+        /* Everything drawn in this frame has been touched and stays */
+        mTextureRegistry->enforceBudget();
+
+        for (auto &ring : mRetiredCaptureRings)
+            ring->free();
+        mRetiredCaptureRings.clear();
+        if (mCaptureRing)
+            mCaptureRing->frameDrawn(mFBSize, glfwGetTime());
+
+        /* Hand finished screenshots etc. to their worker thread */
+        GLReadback::pollCurrentContext();
+
+        mRenderStats = nvgTakeRenderStats(mNVGContext);
+        mRenderStats.frameTime = glfwGetTime() - frameStart;
+    }
 
+    /* Waiting for the buffer swap must not hold up event processing */
     glfwSwapBuffers(mGLFWWindow);
 }
 
+void Screen::setCaptureRing(CaptureRing *ring) {
+    auto lock = lockWidgets();
+    if (mCaptureRing.get() == ring)
+        return;
+    /* The OpenGL resources can only be released where the context is current */
+    if (mCaptureRing)
+        mRetiredCaptureRings.push_back(mCaptureRing);
+    mCaptureRing = ring;
+}
+
+void Screen::redraw() {
+    {
+        std::lock_guard<std::mutex> guard(mRenderMutex);
+        mRedraw = true;
+    }
+    mRenderCondition.notify_one();
+}
+
+void Screen::requestFrame() {
+    if (renderThreadActive())
+        redraw();
+    else
+        glfwPostEmptyEvent(); /* Wakes up mainloop(), which draws all screens */
+}
+
+std::future<void> Screen::runOnRenderThread(const std::function<void()> &task) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    {
+        std::lock_guard<std::mutex> guard(mRenderMutex);
+        if (mRenderThread.joinable() && !mStopRendering) {
+            mRenderTasks.push_back(std::make_pair(task, promise));
+            promise = nullptr;
+        }
+    }
+    if (!promise) {
+        mRenderCondition.notify_one();
+        return future;
+    }
+
+    glfwMakeContextCurrent(mGLFWWindow);
+    try {
+        task();
+        promise->set_value();
+    } catch (...) {
+        promise->set_exception(std::current_exception());
+    }
+    return future;
+}
+
+/* Run the tasks queued by runOnRenderThread(), with mRenderMutex held by 'lock' */
+static void runRenderTasks(
+    std::unique_lock<std::mutex> &lock,
+    std::vector<std::pair<std::function<void()>, std::shared_ptr<std::promise<void>>>> &queue) {
+    while (!queue.empty()) {
+        auto tasks = std::move(queue);
+        queue.clear();
+        lock.unlock();
+        for (auto &task : tasks) {
+            try {
+                task.first();
+                task.second->set_value();
+            } catch (...) {
+                task.second->set_exception(std::current_exception());
+            }
+        }
+        lock.lock();
+    }
+}
+
+void Screen::startRenderThread() {
+    if (mRenderThread.joinable())
+        return;
+
+    /* A context can only be current on one thread at a time */
+    if (glfwGetCurrentContext() == mGLFWWindow)
+        glfwMakeContextCurrent(nullptr);
+
+    mRedraw = true;
+    mStopRendering = false;
+    mRenderThread = std::thread([this]() { renderThread(); });
+}
+
+void Screen::stopRenderThread() {
+    if (!mRenderThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(mRenderMutex);
+        mStopRendering = true;
+    }
+    mRenderCondition.notify_one();
+    mRenderThread.join();
+    mRedraw = mStopRendering = false;
+
+    glfwMakeContextCurrent(mGLFWWindow);
+}
+
+void Screen::renderThread() {
+    mRenderThreadId = std::this_thread::get_id();
+    glfwMakeContextCurrent(mGLFWWindow);
+
+    std::unique_lock<std::mutex> lock(mRenderMutex);
+    while (true) {
+        mRenderCondition.wait(lock, [this]() {
+            return mRedraw || mStopRendering || !mRenderTasks.empty();
+        });
+        runRenderTasks(lock, mRenderTasks);
+        if (mStopRendering)
+            break;
+        if (!mRedraw)
+            continue;
+        mRedraw = false;
+        lock.unlock();
+
+        try {
+            drawAll();
+        } catch (const std::exception &e) {
+            std::cerr << "Caught exception in render thread: " << e.what() << std::endl;
+            leave();
+        }
+
+        lock.lock();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+    mRenderThreadId = std::thread::id();
+}
+
 void Screen::drawWidgets() {
     if (!mVisible)
         return;
 
-    glfwMakeContextCurrent(mGLFWWindow);
+    /* GLFW only permits window queries on the main thread. The render thread
+       already owns the context and relies on resizeCallbackEvent() instead */
+    if (std::this_thread::get_id() != mRenderThreadId) {
+        glfwMakeContextCurrent(mGLFWWindow);
 
-//    glfwGetFramebufferSize(mGLFWWindow, &mFBSize[0], &mFBSize[1]);
-    glfwGetWindowSize(mGLFWWindow, &mSize[0], &mSize[1]);
+//        glfwGetFramebufferSize(mGLFWWindow, &mFBSize[0], &mFBSize[1]);
+        glfwGetWindowSize(mGLFWWindow, &mSize[0], &mSize[1]);
+#if defined(_WIN32) || defined(__linux__)
+        mSize = (mSize.cast<float>() / mPixelRatio).cast<int>();
+#endif
+    }
 
 #if defined(_WIN32) || defined(__linux__)
-    mSize = (mSize.cast<float>() / mPixelRatio).cast<int>();
     mFBSize = (mSize.cast<float>() * mPixelRatio).cast<int>();
 #else
     /* Recompute pixel ratio on OSX */
@@ -413,6 +634,7 @@ void Screen::drawWidgets() {
     glViewport(0, 0, mFBSize[0], mFBSize[1]);
 //    glBindSampler(0, 0);
     nvgBeginFrame(mNVGContext, mSize[0], mSize[1], mPixelRatio);
+    setTextCachePixelRatio(mNVGContext, mPixelRatio);
 
     draw(mNVGContext);
 
@@ -464,9 +686,57 @@ void Screen::drawWidgets() {
         }
     }
 
+    if (mDebugHUD)
+        drawDebugHUD();
+
     nvgEndFrame(mNVGContext);
 }
 
+void Screen::drawDebugHUD() {
+    const double MB = 1024.0 * 1024.0;
+    char lines[5][128];
+    int count = 0;
+
+    snprintf(lines[count++], sizeof(lines[0]), "frame %.2f ms, %i draw calls",
+             mRenderStats.frameTime * 1000, mRenderStats.drawCalls());
+    size_t budget = mTextureRegistry->budget();
+    if (budget > 0)
+        snprintf(lines[count++], sizeof(lines[0]), "textures %.1f / %.1f MB (%i images)",
+                 mTextureRegistry->memoryUsage() / MB, budget / MB,
+                 mTextureRegistry->textureCount());
+    else
+        snprintf(lines[count++], sizeof(lines[0]), "textures %.1f MB (%i images)",
+                 mTextureRegistry->memoryUsage() / MB, mTextureRegistry->textureCount());
+    snprintf(lines[count++], sizeof(lines[0]), "media %.1f MB, %i evictions (%.1f MB)",
+             mTextureRegistry->ownedMemoryUsage() / MB, mTextureRegistry->evictionCount(),
+             mTextureRegistry->evictedBytes() / MB);
+    if (mContextGroup)
+        snprintf(lines[count++], sizeof(lines[0]), "shared %.1f MB (%i textures)",
+                 mContextGroup->memoryUsage() / MB, mContextGroup->textureCount());
+    if (mCaptureRing)
+        snprintf(lines[count++], sizeof(lines[0]), "capture %.3f ms CPU, %.3f ms GPU",
+                 mCaptureRing->cpuTime() * 1000, mCaptureRing->gpuTime() * 1000);
+
+    const float fontSize = 16.f, lineHeight = 20.f;
+    nvgSave(mNVGContext);
+    nvgResetTransform(mNVGContext);
+    nvgResetScissor(mNVGContext);
+    nvgGlobalAlpha(mNVGContext, 1.0f);
+    nvgBeginPath(mNVGContext);
+    nvgRoundedRect(mNVGContext, 8, 8, 330, count * lineHeight + 12, 4);
+    nvgFillColor(mNVGContext, Color(0, 180));
+    nvgFill(mNVGContext);
+
+    nvgFontFace(mNVGContext, "sans");
+    nvgFontSize(mNVGContext, fontSize);
+    nvgFontBlur(mNVGContext, 0.0f);
+    nvgTextAlign(mNVGContext, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFillColor(mNVGContext, Color(255, 255));
+    for (int i = 0; i < count; ++i)
+        nvgText(mNVGContext, 16, 14 + i * lineHeight, lines[i], nullptr);
+    nvgRestore(mNVGContext);
+}
+
 bool Screen::keyboardEvent(int key, int scancode, int action, int modifiers) {
     if (mFocusPath.size() > 0) {
         for (auto it = mFocusPath.rbegin() + 1; it != mFocusPath.rend(); ++it)
@@ -17,6 +17,9 @@
 #include <nanogui/window.h>
 #include <nanogui/slidecanvas.h>
 #include <nanogui/slideimage.h>
+#include <nanogui/slidevideo.h>
+#include <nanogui/slideanimation.h>
+#include <nanogui/slidetext.h>
 #include <nanogui/layout.h>
 #include <nanogui/label.h>
 #include <nanogui/checkbox.h>
@@ -36,6 +39,7 @@
 #include <nanogui/colorpicker.h>
 #include <nanogui/graph.h>
 #include <nanogui/tabwidget.h>
+#include <nanogui/glyphcache.h>
 #include <iostream>
 #include <string>
 
@@ -150,8 +154,27 @@ public:
             imagetest = new SlideImage(mSlideCanvas,file);
             imagetest->mCanvas = mSlideCanvas;
         });
+        b = new Button(tools,"Add Video");
+        b->setCallback([this] {
+            //Image sequences are given as a printf pattern, e.g. frames/%04d.jpg
+            string file = file_dialog({ {"avi", "Motion-JPEG AVI file"} }, false);
+            cout << "Adding video: " << file.c_str() << endl;
+            SlideVideo *video = new SlideVideo(mSlideCanvas, file);
+            video->mCanvas = mSlideCanvas;
+        });
+        b = new Button(tools,"Add Animation");
+        b->setCallback([this] {
+            string file = file_dialog(
+                    { {"gif", "GIF file"}, {"png", "Animated PNG file"} }, false);
+            cout << "Adding animation: " << file.c_str() << endl;
+            SlideAnimation *animation = new SlideAnimation(mSlideCanvas, file);
+            animation->mCanvas = mSlideCanvas;
+        });
         b = new Button(tools,"Add Text");
-        b->setCallback([&] {cout<<"Add Text\n";});
+        b->setCallback([this] {
+            SlideText *text = new SlideText(mSlideCanvas, "Text");
+            text->mCanvas = mSlideCanvas;
+        });
 
 
 
@@ -193,7 +216,7 @@ public:
         mImageScaling->setCallback( [&] (const int i) {
         	if(mSlideCanvas->selectedImage() != NULL)
         		{
-        			mSlideCanvas->selectedImage()->mImageMode = i;
+        			mSlideCanvas->selectedImage()->mImageMode = (MediaItemBase::ImageMode) i;
         		}
 			return true;
 		});*/
@@ -214,6 +237,10 @@ public:
             setVisible(false);
             return true;
         }
+        if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+            setDebugHUD(!debugHUD());
+            return true;
+        }
         return false;
     }
 
@@ -268,9 +295,29 @@ int main(int /* argc */, char ** /* argv */) {
 
         /* scoped variables */ {
             nanogui::ref<ExampleApplication> app = new ExampleApplication();
+
+            /* Rasterize the glyphs of the previous session before the first frame */
+            nanogui::ref<nanogui::GlyphCache> glyphs = new nanogui::GlyphCache();
+            std::string glyphFile = nanogui::GlyphCache::defaultFileName();
+            if (!glyphFile.empty())
+                glyphs->load(glyphFile);
+            for (const char *font : { "sans", "sans-bold" }) {
+                glyphs->addRange(font, app->theme()->mStandardFontSize, 32, 126);
+                glyphs->addRange(font, app->theme()->mButtonFontSize, 32, 126);
+            }
+            glyphs->prewarm(app->nvgContext(), app->pixelRatio());
+
             app->drawAll();
             app->setVisible(true);
             nanogui::mainloop();
+
+            glyphs->learn();
+            try {
+                if (!glyphFile.empty())
+                    glyphs->save(glyphFile);
+            } catch (const std::runtime_error &e) {
+                std::cerr << e.what() << std::endl;
+            }
         }
 
         nanogui::shutdown();
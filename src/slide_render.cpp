@@ -0,0 +1,324 @@
+/*
+    src/slide_render.cpp -- Renders slide documents to images without an
+    OpenGL context, processing the slides on all cores
+
+    Usage: slide_render [options] <slide files>
+
+      -o <directory>   Output directory (default: current directory)
+      -s <W>x<H>       Resolution (default: 1920x1080)
+      -f tga|raw       Output format (default: tga). Raw files contain
+                       the RGBA8 pixels, top row first
+      -j <threads>     Number of slides rendered at once (default: one
+                       per hardware thread)
+      -m <megabytes>   Budget for the memory of the renderers' pixel
+                       buffers and of the media (decoded images, video
+                       frames, ...) of the slides in flight (default: 512)
+      -p               Publish instead of render: flatten the static items
+                       of each slide into <name>-flat.tga and write the
+                       slide with the remaining live items to <name>.slide
+                       (see SlideCanvas::flatten)
+      -c               With -p, write the flattened image ETC2 compressed
+                       to <name>-flat.ktx (see ETC2Image)
+      --test-deck <n>  Write <n> synthetic slides (and their images) to a
+                       temporary directory and render those
+
+    Slide files are written by SlideCanvas::save().
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/slidecanvas.h>
+#include <nanogui/slideimage.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/serializer/core.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nanogui;
+
+/* Blocks until the requested number of bytes fits into the budget. A
+   request larger than the whole budget is admitted once nothing else is
+   in flight, so that every slide eventually renders. */
+class MemoryBudget {
+public:
+    MemoryBudget(size_t limit) : mLimit(limit), mUsed(0) { }
+
+    void acquire(size_t bytes) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]() { return mUsed == 0 || mUsed + bytes <= mLimit; });
+        mUsed += bytes;
+    }
+
+    void release(size_t bytes) {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mUsed -= bytes;
+        }
+        mCondition.notify_all();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    size_t mLimit, mUsed;
+};
+
+struct Options {
+    std::string outputDirectory = ".";
+    Vector2i resolution = Vector2i(1920, 1080);
+    bool raw = false;
+    bool publish = false;
+    bool compress = false;
+    int threadCount = 0;
+    size_t memoryBudget = (size_t) 512 << 20;
+    int testDeck = 0;
+    std::vector<std::string> files;
+};
+
+static std::string baseName(const std::string &path) {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+/* Bytes the items of a laid out slide allocate while it renders, as
+   estimated by each item from the headers of its files. The pixel buffer
+   of the renderer is not included: every worker owns one for good */
+static size_t estimateMemory(SlideCanvas *canvas) {
+    size_t bytes = 0;
+    for (auto child : canvas->children()) {
+        const MediaItemBase *item = dynamic_cast<const MediaItemBase *>(child);
+        if (item)
+            bytes += item->estimateMemory();
+    }
+    return bytes;
+}
+
+static void writeRaw(const std::string &filename, const SoftwareRenderer *renderer) {
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Could not open \"" + filename + "\"!");
+    const Vector2i &size = renderer->size();
+    size_t bytes = (size_t) size.x() * size.y() * 4;
+    bool ok = fwrite(renderer->data(), 1, bytes, file) == bytes;
+    if (fclose(file) != 0 || !ok)
+        throw std::runtime_error("Could not write \"" + filename + "\"!");
+}
+
+/* Uncompressed 24 bit TGA with a pattern that differs per index */
+static void writeTestImage(const std::string &filename, int index, int w, int h) {
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Could not open \"" + filename + "\"!");
+    uint8_t header[18] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                           (uint8_t) (w & 0xFF), (uint8_t) (w >> 8),
+                           (uint8_t) (h & 0xFF), (uint8_t) (h >> 8), 24, 0 };
+    fwrite(header, sizeof(header), 1, file);
+    std::vector<uint8_t> row(w * 3);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            row[x * 3 + 0] = (uint8_t) (x + index * 7);
+            row[x * 3 + 1] = (uint8_t) (y + index * 13);
+            row[x * 3 + 2] = (uint8_t) ((x ^ y) + index);
+        }
+        fwrite(row.data(), row.size(), 1, file);
+    }
+    fclose(file);
+}
+
+static std::vector<std::string> writeTestDeck(int count) {
+#if defined(_WIN32)
+    std::string directory = ".";
+#else
+    char tmpl[] = "/tmp/nanogui-slides-XXXXXX";
+    std::string directory = mkdtemp(tmpl) ? tmpl : ".";
+#endif
+    const int imageCount = 16;
+    for (int i = 0; i < imageCount; ++i)
+        writeTestImage(directory + "/image" + std::to_string(i) + ".tga", i, 1280, 720);
+
+    std::vector<std::string> files;
+    for (int i = 0; i < count; ++i) {
+        ref<SlideCanvas> canvas = new SlideCanvas(nullptr);
+        int items = 1 + i % 4;
+        for (int j = 0; j < items; ++j) {
+            SlideImage *image = new SlideImage(canvas, directory + "/image" +
+                                               std::to_string((i + j) % imageCount) + ".tga");
+            image->mCanvas = canvas;
+            image->mImageMode = (MediaItemBase::ImageMode) (j % 3);
+            image->mCanvasPos = Vector2f(0.25f + 0.5f * (j % 2), 0.25f + 0.5f * (j / 2));
+            image->mCanvasSize = Vector2f(0.45f, 0.45f);
+        }
+        std::string filename = directory + "/slide" + std::to_string(i) + ".slide";
+        Serializer s(filename, true);
+        canvas->save(s);
+        files.push_back(filename);
+    }
+    std::cout << "Wrote a test deck of " << count << " slides to " << directory << std::endl;
+    return files;
+}
+
+static bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue) {
+            options.outputDirectory = argv[++i];
+        } else if (arg == "-s" && hasValue) {
+            int w, h;
+            if (sscanf(argv[++i], "%ix%i", &w, &h) != 2 || w <= 0 || h <= 0)
+                return false;
+            options.resolution = Vector2i(w, h);
+        } else if (arg == "-f" && hasValue) {
+            std::string format = argv[++i];
+            if (format != "tga" && format != "raw")
+                return false;
+            options.raw = format == "raw";
+        } else if (arg == "-p") {
+            options.publish = true;
+        } else if (arg == "-c") {
+            options.compress = true;
+        } else if (arg == "-j" && hasValue) {
+            options.threadCount = std::max(0, atoi(argv[++i]));
+        } else if (arg == "-m" && hasValue) {
+            options.memoryBudget = (size_t) std::max(1, atoi(argv[++i])) << 20;
+        } else if (arg == "--test-deck" && hasValue) {
+            options.testDeck = std::max(1, atoi(argv[++i]));
+        } else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        } else {
+            options.files.push_back(arg);
+        }
+    }
+    return !options.files.empty() || options.testDeck > 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [-o directory] [-s WxH] [-f tga|raw] "
+                     "[-j threads] [-m megabytes] [-p [-c]] [--test-deck n] <slide files>"
+                  << std::endl;
+        return -1;
+    }
+
+    try {
+        if (options.testDeck > 0) {
+            auto deck = writeTestDeck(options.testDeck);
+            options.files.insert(options.files.end(), deck.begin(), deck.end());
+        }
+
+        int threadCount = options.threadCount > 0 ? options.threadCount
+                                                  : (int) std::thread::hardware_concurrency();
+        threadCount = std::max(1, std::min(threadCount, (int) options.files.size()));
+
+        /* The renderers' pixel buffers are allocated once per worker, so
+           they come off the budget up front; what is left is shared by the
+           slides in flight. Start fewer workers if their buffers alone
+           would take more than half of the budget. */
+        size_t rendererBytes = (size_t) options.resolution.x() * options.resolution.y() * 4;
+        size_t fitting = options.memoryBudget / 2 / rendererBytes;
+        if ((size_t) threadCount > fitting)
+            threadCount = std::max(1, (int) fitting);
+        size_t rendererTotal = rendererBytes * threadCount;
+        MemoryBudget budget(options.memoryBudget > rendererTotal
+                                ? options.memoryBudget - rendererTotal : 0);
+        std::atomic<size_t> next(0);
+        std::atomic<int> rendered(0), failed(0);
+        std::mutex logMutex;
+
+        /* Every worker owns a renderer and renders whole slides on its own;
+           slides are the unit of parallelism, so each renderer uses a single
+           thread for its tiles */
+        auto worker = [&]() {
+            ref<SoftwareRenderer> renderer = new SoftwareRenderer(
+                options.resolution.x(), options.resolution.y(), NVG_ANTIALIAS, 1);
+            ref<Theme> theme = new Theme(renderer->context());
+
+            size_t index;
+            while ((index = next++) < options.files.size()) {
+                const std::string &file = options.files[index];
+                try {
+                    ref<SlideCanvas> canvas = new SlideCanvas(nullptr);
+                    canvas->setTheme(theme);
+                    {
+                        Serializer s(file, false);
+                        if (!canvas->load(s))
+                            throw std::runtime_error("not a slide document");
+                    }
+                    canvas->layoutSlide(options.resolution);
+
+                    size_t bytes = estimateMemory(canvas);
+                    budget.acquire(bytes);
+                    try {
+                        std::string output = options.outputDirectory + "/" + baseName(file);
+                        if (options.publish) {
+                            if (output + ".slide" == file)
+                                throw std::runtime_error("the published slide would replace it");
+                            canvas->flatten(renderer, output + (options.compress ? "-flat.ktx"
+                                                                                 : "-flat.tga"));
+                            canvas->releaseResources();
+                            Serializer s(output + ".slide", true);
+                            canvas->save(s);
+                        } else {
+                            renderer->beginFrame(Color(0, 255));
+                            canvas->drawSlide(renderer->context());
+                            renderer->endFrame();
+                            canvas->releaseResources();
+
+                            if (options.raw)
+                                writeRaw(output + ".raw", renderer);
+                            else
+                                renderer->writeTGA(output + ".tga");
+                        }
+                    } catch (...) {
+                        canvas->releaseResources();
+                        budget.release(bytes);
+                        throw;
+                    }
+                    budget.release(bytes);
+                    rendered++;
+                } catch (const std::exception &e) {
+                    std::lock_guard<std::mutex> guard(logMutex);
+                    std::cerr << "Could not render \"" << file << "\": " << e.what() << std::endl;
+                    failed++;
+                }
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i)
+            threads.emplace_back(worker);
+        for (auto &thread : threads)
+            thread.join();
+        double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+        printf("%s %i slides at %i x %i on %i threads in %.2f s (%.1f slides/s)",
+               options.publish ? "Published" : "Rendered", rendered.load(),
+               options.resolution.x(), options.resolution.y(), threadCount, seconds,
+               rendered / std::max(seconds, 1e-9));
+        if (failed > 0)
+            printf(", %i failed", failed.load());
+        printf("\n");
+        return failed > 0 ? 1 : 0;
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Caught a fatal error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,309 @@
+/*
+    src/slideanimation.cpp -- Animated GIF or PNG on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/slideanimation.h>
+#include <nanogui/screen.h>
+#include <nanogui/imageinfo.h>
+#include <nanogui/opengl.h>
+#include <nanogui/serializer/core.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+NAMESPACE_BEGIN(nanogui)
+
+SlideAnimation::SlideAnimation(Widget *parent, const std::string &fileName)
+    : MediaItemBase(parent), mFileName(fileName), mOpenError(false),
+      mTextureContext(nullptr), mScale(0), mCellSize(0, 0), mAtlas(0), mAtlasColumns(0),
+      mWindowIndex(0), mWindowFrame(-1), mStartTime(-1) {
+    mWindowTextures[0] = mWindowTextures[1] = 0;
+}
+
+SlideAnimation::~SlideAnimation() {
+    cancelCache();
+}
+
+void SlideAnimation::draw(NVGcontext *ctx) {
+    nvgSave(ctx);
+    drawAnimation(ctx);
+    nvgRestore(ctx);
+
+    //Draw handles, borders and what not
+    MediaItemBase::draw(ctx);
+}
+
+void SlideAnimation::drawAnimation(NVGcontext *ctx) {
+    //Slides may also be rendered offscreen, without a parent screen
+    Screen *screen = nullptr;
+    for (Widget *w = this; w && !screen; w = w->parent())
+        screen = dynamic_cast<Screen *>(w);
+
+    if (!mAnimation && !mOpenError) {
+        try {
+            mAnimation = new AnimatedImage(mFileName);
+        } catch (const std::exception &e) {
+            printf("Error opening animation: %s\n", e.what());
+            mOpenError = true;
+        }
+    }
+    if (!mAnimation)
+        return;
+
+    if (ctx != mTextureContext)
+        releaseTextures();
+
+    /* Rebuild when the item was resized a lot, but not on every small change */
+    float scale = targetScale(screen ? screen->pixelRatio() : 1.f);
+    if (!mTextureContext || (scale > mScale * 1.25f && mScale < 1.f) || scale < mScale * 0.5f)
+        buildCache(ctx, screen, scale);
+    collectCache(ctx);
+
+    int frame = 0;
+    bool finished = true;
+    if (screen) {
+        double now = screen->frameTime();
+        if (mStartTime < 0)
+            mStartTime = now;
+        frame = mAnimation->frameAt(now - mStartTime, finished);
+    }
+
+    if (mAtlas) {
+        Vector2i origin((frame % mAtlasColumns) * (mCellSize.x() + 2) + 1,
+                        (frame / mAtlasColumns) * (mCellSize.y() + 2) + 1);
+        drawFittedImage(ctx, mAtlas, origin, mCellSize);
+    } else {
+        showFrame(ctx, frame);
+        drawFittedImage(ctx, mWindowTextures[mWindowIndex]);
+    }
+
+    if (screen && ((!finished && mAnimation->frameCount() > 1) || mBuild.valid()))
+        screen->requestFrame();
+}
+
+float SlideAnimation::targetScale(float pixelRatio) const {
+    float w = (float) mAnimation->width(), h = (float) mAnimation->height();
+    float scale = std::max((mSize.x() - mHandleSize) / w, (mSize.y() - mHandleSize) / h) * pixelRatio;
+    /* Never cache frames larger than the file or than a texture may be */
+    return std::max(std::min({ scale, 1.f, maxAtlasSize / w, maxAtlasSize / h }), 1e-3f);
+}
+
+void SlideAnimation::buildCache(NVGcontext *ctx, Screen *screen, float scale) {
+    releaseTextures();
+    mTextureContext = ctx;
+    mScale = scale;
+    mCellSize = Vector2i(std::max(1, (int) std::round(mAnimation->width() * scale)),
+                         std::max(1, (int) std::round(mAnimation->height() * scale)));
+
+    /* Cells get a one pixel border copied from their edges, so that
+       filtering never picks up the neighbouring frames */
+    int count = mAnimation->frameCount();
+    Vector2i padded = mCellSize + Vector2i(2, 2);
+    int columns = std::min(count, maxAtlasSize / padded.x());
+    int rows = columns > 0 ? (count + columns - 1) / columns : 0;
+    if (!screen || columns == 0 || rows * padded.y() > maxAtlasSize)
+        return;
+
+    /* The worker composites its own copy of the animation, the sliding
+       window keeps playing from mAnimation meanwhile */
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    std::string fileName = mFileName;
+    Vector2i cellSize = mCellSize;
+    mCancelBuild = cancel;
+    mBuild = screen->workerPool()->submit([fileName, cellSize, columns, rows, cancel]() {
+        return composeAtlas(fileName, cellSize, columns, rows, *cancel);
+    });
+}
+
+void SlideAnimation::collectCache(NVGcontext *ctx) {
+    if (!mBuild.valid() ||
+        mBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    Atlas atlas = mBuild.get();
+    mCancelBuild = nullptr;
+    if (atlas.pixels.empty())
+        return;
+
+    mAtlas = nvgCreateImageRGBA(ctx, atlas.size.x(), atlas.size.y(), 0, atlas.pixels.data());
+    trackTexture(ctx, mAtlas);
+    mAtlasColumns = atlas.columns;
+
+    /* The frames are all in the atlas now */
+    for (int i = 0; i < 2; ++i) {
+        if (mWindowTextures[i] > 0)
+            nvgDeleteImage(ctx, mWindowTextures[i]);
+        mWindowTextures[i] = 0;
+    }
+    mWindowIndex = 0;
+    mWindowFrame = -1;
+    mAnimation->rewind();
+    mCell.clear();
+    mCell.shrink_to_fit();
+}
+
+void SlideAnimation::cancelCache() {
+    if (mCancelBuild)
+        *mCancelBuild = true;
+    mBuild = std::future<Atlas>();
+    mCancelBuild = nullptr;
+}
+
+SlideAnimation::Atlas SlideAnimation::composeAtlas(const std::string &fileName,
+                                                   const Vector2i &cellSize, int columns,
+                                                   int rows, const std::atomic<bool> &cancel) {
+    Atlas atlas;
+    ref<AnimatedImage> animation;
+    try {
+        animation = new AnimatedImage(fileName);
+    } catch (const std::exception &) {
+        return atlas;
+    }
+
+    Vector2i padded = cellSize + Vector2i(2, 2);
+    int width = columns * padded.x(), height = rows * padded.y();
+    std::vector<uint8_t> pixels((size_t) width * height * 4, 0), cell;
+    for (int i = 0; i < animation->frameCount(); ++i) {
+        if (cancel)
+            return atlas;
+        animation->nextFrame();
+        scaleFrame(*animation, cellSize, cell);
+        int x0 = (i % columns) * padded.x(), y0 = (i / columns) * padded.y();
+        for (int y = 0; y < padded.y(); ++y) {
+            int sy = std::min(std::max(y - 1, 0), cellSize.y() - 1);
+            const uint8_t *src = cell.data() + (size_t) sy * cellSize.x() * 4;
+            uint8_t *dst = pixels.data() + ((size_t) (y0 + y) * width + x0) * 4;
+            memcpy(dst, src, 4);
+            memcpy(dst + 4, src, (size_t) cellSize.x() * 4);
+            memcpy(dst + (size_t) (padded.x() - 1) * 4, src + (size_t) (cellSize.x() - 1) * 4, 4);
+        }
+    }
+    atlas.pixels.swap(pixels);
+    atlas.size = Vector2i(width, height);
+    atlas.columns = columns;
+    return atlas;
+}
+
+void SlideAnimation::scaleFrame(const AnimatedImage &animation, const Vector2i &cellSize,
+                                std::vector<uint8_t> &cell) {
+    const uint8_t *data = animation.canvas().data();
+    int w = animation.width(), h = animation.height();
+    int width = cellSize.x(), height = cellSize.y();
+    cell.resize((size_t) width * height * 4);
+
+    if (width == w && height == h) {
+        memcpy(cell.data(), data, cell.size());
+        return;
+    }
+
+    /* Box filter, weighting colors by alpha so that transparent pixels do not darken edges */
+    for (int y = 0; y < height; ++y) {
+        int y0 = (int) ((int64_t) y * h / height);
+        int y1 = std::max(y0 + 1, (int) ((int64_t) (y + 1) * h / height));
+        for (int x = 0; x < width; ++x) {
+            int x0 = (int) ((int64_t) x * w / width);
+            int x1 = std::max(x0 + 1, (int) ((int64_t) (x + 1) * w / width));
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+            for (int sy = y0; sy < y1; ++sy) {
+                const uint8_t *src = data + ((size_t) sy * w + x0) * 4;
+                for (int sx = x0; sx < x1; ++sx, src += 4) {
+                    sum[0] += src[0] * src[3]; sum[1] += src[1] * src[3];
+                    sum[2] += src[2] * src[3]; sum[3] += src[3];
+                }
+            }
+            uint32_t count = (uint32_t) ((y1 - y0) * (x1 - x0));
+            uint8_t *dst = cell.data() + ((size_t) y * width + x) * 4;
+            for (int c = 0; c < 3; ++c)
+                dst[c] = sum[3] ? (uint8_t) ((sum[c] + sum[3] / 2) / sum[3]) : 0;
+            dst[3] = (uint8_t) ((sum[3] + count / 2) / count);
+        }
+    }
+}
+
+void SlideAnimation::showFrame(NVGcontext *ctx, int index) {
+    if (index == mWindowFrame)
+        return;
+
+    /* Frames build on each other, so every frame up to 'index' is composited */
+    int count = mAnimation->frameCount();
+    for (int i = 0; i <= count && mAnimation->frameIndex() != index; ++i)
+        mAnimation->nextFrame();
+    scaleFrame(*mAnimation, mCellSize, mCell);
+
+    if (!mWindowTextures[0]) {
+        for (int i = 0; i < 2; ++i) {
+            mWindowTextures[i] = nvgCreateImageRGBA(ctx, mCellSize.x(), mCellSize.y(), 0, mCell.data());
+            trackTexture(ctx, mWindowTextures[i]);
+        }
+        mWindowIndex = 0;
+    } else {
+        mWindowIndex ^= 1;
+        nvgUpdateImage(ctx, mWindowTextures[mWindowIndex], mCell.data());
+    }
+    mWindowFrame = index;
+}
+
+void SlideAnimation::releaseTextures() {
+    cancelCache();
+    if (mAtlas > 0)
+        nvgDeleteImage(mTextureContext, mAtlas);
+    for (int i = 0; i < 2; ++i) {
+        if (mWindowTextures[i] > 0)
+            nvgDeleteImage(mTextureContext, mWindowTextures[i]);
+        mWindowTextures[i] = 0;
+    }
+    mAtlas = 0;
+    mAtlasColumns = 0;
+    mWindowIndex = 0;
+    mWindowFrame = -1;
+    mTextureContext = nullptr;
+    mScale = 0;
+    mCellSize = Vector2i(0, 0);
+}
+
+Widget *SlideAnimation::initPropertiesPanel(Window *) {
+    return NULL;
+}
+
+void SlideAnimation::releaseResources() {
+    releaseTextures();
+    mAnimation = nullptr;
+    mCell.clear();
+    mStartTime = -1;
+}
+
+size_t SlideAnimation::estimateMemory() const {
+    ImageInfo info;
+    if (!ImageInfo::probe(mFileName, info))
+        return 0;
+    /* AnimatedImage keeps the canvas, the canvas to restore and the frame
+       being composited, once for the sliding window and once on the worker
+       building the atlas; the frame count is unknown without parsing the
+       file, so assume the atlas is filled */
+    return 6 * info.textureBytes() + (size_t) maxAtlasSize * maxAtlasSize * 4;
+}
+
+void SlideAnimation::save(Serializer &s) const {
+    MediaItemBase::save(s);
+    s.set("fileName", documentPath(s, mFileName));
+    saveImageMode(s);
+}
+
+bool SlideAnimation::load(Serializer &s) {
+    if (!MediaItemBase::load(s)) return false;
+    if (!s.get("fileName", mFileName)) return false;
+    mFileName = resolveDocumentPath(s, mFileName);
+    if (!loadImageMode(s)) return false;
+
+    releaseResources();
+    mOpenError = false;
+    return true;
+}
+
+NAMESPACE_END(nanogui)
@@ -17,6 +17,12 @@
 #include <nanogui/window.h>
 #include <nanogui/serializer/core.h>
 #include <nanogui/mediaitembase.h>
+#include <nanogui/slideimage.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/etc2image.h>
+#include <nanogui/slidevideo.h>
+#include <nanogui/slideanimation.h>
+#include <nanogui/slidetext.h>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -69,6 +75,10 @@ void SlideCanvas::draw(NVGcontext *ctx) {
 
     nvgRestore(ctx);
 
+    drawItems(ctx);
+}
+
+void SlideCanvas::drawItems(NVGcontext *ctx) {
     //Draw child widgets
     nvgSave(ctx);
     nvgTranslate(ctx, mPos.x(), mPos.y());
@@ -152,14 +162,140 @@ void SlideCanvas::refreshRelativePlacement() {
     /* Overridden in \ref Popup */
 }
 
+void SlideCanvas::layoutSlide(const Vector2i &resolution) {
+    mPos = Vector2i::Zero();
+    mSize = resolution;
+    mCanvasPos = Vector2i::Zero();
+    mCanvasSize = resolution;
+    for (auto child : mChildren) {
+        MediaItemBase *item = dynamic_cast<MediaItemBase *>(child);
+        if (item)
+            item->performLayout(nullptr);
+    }
+}
+
+void SlideCanvas::drawSlide(NVGcontext *ctx) {
+    nvgBeginPath(ctx);
+    nvgRect(ctx, mPos.x() + mCanvasPos.x(), mPos.y() + mCanvasPos.y(),
+            mCanvasSize.x(), mCanvasSize.y());
+    nvgFillColor(ctx, NVGcolor({0.0,0.0,0.0,1.0}));
+    nvgFill(ctx);
+
+    drawItems(ctx);
+}
+
+void SlideCanvas::releaseResources() {
+    for (auto child : mChildren) {
+        MediaItemBase *item = dynamic_cast<MediaItemBase *>(child);
+        if (item)
+            item->releaseResources();
+    }
+}
+
+int SlideCanvas::flatten(SoftwareRenderer *renderer, const std::string &imageFileName) {
+    std::vector<MediaItemBase *> flattened, live;
+    for (auto child : mChildren) {
+        MediaItemBase *item = dynamic_cast<MediaItemBase *>(child);
+        if (!item)
+            continue;
+        if (live.empty() && item->isStatic())
+            flattened.push_back(item);
+        else
+            live.push_back(item);
+    }
+    if (flattened.empty())
+        return 0;
+
+    layoutSlide(renderer->size());
+    std::vector<bool> visible;
+    for (auto item : live) {
+        visible.push_back(item->visible());
+        item->setVisible(false);
+    }
+    renderer->beginFrame(Color(0, 255));
+    drawSlide(renderer->context());
+    renderer->endFrame();
+    for (size_t i = 0; i < live.size(); ++i)
+        live[i]->setVisible(visible[i]);
+
+    for (auto item : flattened) {
+        item->releaseResources();
+        if (item == mSelectedImage)
+            mSelectedImage = NULL;
+        removeChild(item);
+    }
+    const std::string ktx = ".ktx";
+    if (imageFileName.size() > ktx.size() &&
+        imageFileName.compare(imageFileName.size() - ktx.size(), ktx.size(), ktx) == 0) {
+        /* The background is opaque, so the alpha channel is not needed */
+        ref<ETC2Image> compressed = new ETC2Image(renderer->data(), renderer->size().x(),
+                                                  renderer->size().y(), ETC2Image::Format::RGB8,
+                                                  renderer->threadCount());
+        compressed->save(imageFileName);
+    } else {
+        renderer->writeTGA(imageFileName);
+    }
+
+    SlideImage *image = new SlideImage(nullptr, imageFileName);
+    image->mCanvas = this;
+    image->mImageMode = MediaItemBase::ImageMode::Stretch; //In case the player's resolution differs
+    image->mCanvasPos = Vector2f(0.5f, 0.5f);
+    image->mCanvasSize = Vector2f(1.f, 1.f);
+    addChild(0, image);
+    image->performLayout(nullptr);
+    return (int) flattened.size();
+}
+
 void SlideCanvas::save(Serializer &s) const {
     Widget::save(s);
+
+    int itemCount = 0;
+    for (auto child : mChildren) {
+        const MediaItemBase *item = dynamic_cast<const MediaItemBase *>(child);
+        if (!item)
+            continue;
+        s.push("item" + std::to_string(itemCount++));
+        s.set("type", item->itemType());
+        item->save(s);
+        s.pop();
+    }
+    s.set("itemCount", itemCount);
 }
 
 bool SlideCanvas::load(Serializer &s) {
     if (!Widget::load(s)) return false;
-//    if (!s.get("title", mTitle)) return false;
-//    if (!s.get("modal", mModal)) return false;
+
+    int itemCount;
+    if (!s.get("itemCount", itemCount)) return false;
+
+    for (int i = childCount() - 1; i >= 0; --i) {
+        if (dynamic_cast<MediaItemBase *>(childAt(i)))
+            removeChild(i);
+    }
+    mSelectedImage = NULL;
+
+    for (int i = 0; i < itemCount; ++i) {
+        s.push("item" + std::to_string(i));
+        std::string type;
+        MediaItemBase *item = nullptr;
+        if (s.get("type", type) && type == "image")
+            item = new SlideImage(this, "");
+        else if (type == "video")
+            item = new SlideVideo(this, "");
+        else if (type == "animation")
+            item = new SlideAnimation(this, "");
+        else if (type == "text")
+            item = new SlideText(this, "");
+        if (item) {
+            item->mCanvas = this;
+            bool loaded = item->load(s);
+            //The selection belongs to the editor session, not to the slide
+            item->setFocused(false);
+            if (!loaded)
+                removeChild(item);
+        }
+        s.pop();
+    }
 
     return true;
 }
@@ -19,7 +19,18 @@
 #include <nanogui/slidecanvas.h>
 #include <nanogui/label.h>
 #include <nanogui/textbox.h>
+#include <nanogui/etc2image.h>
+#include <nanogui/jpegimage.h>
+#include <nanogui/softwarerenderer.h>
 #include <math.h>
+#include <chrono>
+
+/* Needed for nvglCreateImageFromHandleGL3(), the implementation lives in screen.cpp */
+#define NANOVG_GL3
+#include <nanovg_gl.h>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
 
 // Includes for the GLTexture class.
 #include <cstdint>
@@ -30,8 +41,10 @@ NAMESPACE_BEGIN(nanogui)
 
 SlideImage::SlideImage(Widget *parent, const std::string& fileName)
     : MediaItemBase(parent),
-		mImageMode(1), //Image mode to scaling
 		mImageHandle(0), //unloaded state
+		mImageContext(nullptr),
+		mImageReduced(false),
+		mUploadTexture(0),
 		mFileLoadError(false)
 	{
 
@@ -60,6 +73,8 @@ SlideImage::SlideImage(Widget *parent, const std::string& fileName)
 	mImageSize->incRef();
 
 	mFileName = fileName;
+	//Only the header is read, so the item can be laid out before it loads
+	ImageInfo::probe(mFileName, mImageInfo);
 }
 
 SlideImage::~SlideImage()
@@ -68,7 +83,13 @@ SlideImage::~SlideImage()
 	mImageSizeLabel->decRef();
 	mImagePosition->decRef();
 	mImageSize->decRef();
-    //delete texture;
+	if (mUploader)
+		mUploader->cancel(mUploadTexture);
+	//Private images are deleted by the screen's texture registry, only shared ones need releasing here
+	if (mImageGroup && mImageHandle > 0) {
+		untrackTexture(mImageHandle);
+		mImageGroup->releaseImage(mImageContext, mImageHandle);
+	}
 }
 
 
@@ -85,8 +106,83 @@ void SlideImage::draw(NVGcontext *ctx) {
 }
 
 void SlideImage::drawImage(NVGcontext *ctx){
-	if (mImageHandle == 0 && mFileLoadError == false) {
-		mImageHandle = nvgCreateImage(ctx, mFileName.c_str(), 0);
+	//Slides may also be rendered offscreen, without a parent screen
+	Screen *s = nullptr;
+	for (Widget *w = this; w && !s; w = w->parent())
+		s = dynamic_cast<Screen *>(w);
+
+	//A photo decoded at a reduced scale is decoded again once the item outgrows it
+	if (mImageHandle > 0 && mImageReduced) {
+		int w, h;
+		nvgImageSize(ctx, mImageHandle, &w, &h);
+		Vector2i target = targetSize(s);
+		if (target.x() > w || target.y() > h)
+			releaseResources();
+	}
+
+	if (mDecode.valid() && s) {
+		//Still decoding, possibly into a texture that is already allocated
+		if (!streamImage(ctx, s)) {
+			drawPlaceholder(ctx);
+			return;
+		}
+		if (mImageHandle == 0) {
+			printf("Error opening file: %s\n", mFileName.c_str());
+			mFileLoadError = true;
+		}
+	}
+	else if (mImageHandle == 0 && mFileLoadError == false) {
+		//Screens sharing a context group decode each file only once
+		mImageGroup = s ? s->contextGroup() : nullptr;
+		mImageContext = ctx;
+		if (mImageGroup) {
+			//The group decodes on the worker pool, without stalling the other screens
+			int image;
+			try {
+				image = mImageGroup->image(ctx, mFileName, 0, s->workerPool());
+			} catch (const std::exception &e) {
+				printf("Error opening file: %s\n", e.what());
+				mFileLoadError = true;
+				return;
+			}
+			if (image < 0) {
+				s->requestFrame();
+				drawPlaceholder(ctx);
+				return;
+			}
+			mImageHandle = image;
+			trackTexture(ctx, mImageHandle, mImageGroup->textureBytes(ctx, mImageHandle));
+		}
+		else if (ETC2Image::isKTX(mFileName)) {
+			try {
+				mImageHandle = createCompressedImage(ctx);
+			} catch (const std::exception &e) {
+				printf("Error opening file: %s\n", e.what());
+				mFileLoadError = true;
+				return;
+			}
+		}
+		else if (s) {
+			//Large images would block the frame, decode and upload them in the background
+			if (!streamImage(ctx, s)) {
+				drawPlaceholder(ctx);
+				return;
+			}
+		}
+		else {
+			//Large photos only need decoding at the size they are shown at
+			std::vector<uint8_t> rgba;
+			int w, h;
+			Vector2i target = targetSize(s);
+			if (target.x() > 0 && target.y() > 0 &&
+					JPEGImage::loadScaled(mFileName, target.x(), target.y(), rgba, w, h)) {
+				mImageHandle = nvgCreateImageRGBA(ctx, w, h, 0, rgba.data());
+				mImageReduced = true;
+			}
+			else
+				mImageHandle = nvgCreateImage(ctx, mFileName.c_str(), 0);
+			trackTexture(ctx, mImageHandle);
+		}
 		if (mImageHandle == 0) {
 			printf("Error opening file: %s\n", mFileName.c_str());
 			mFileLoadError = true;
@@ -101,63 +197,11 @@ void SlideImage::drawImage(NVGcontext *ctx){
 		return;
 	}
 
-	int w, h;
-
-	nvgImageSize(ctx, mImageHandle, &w, &h);
-
-	float inRatio = ((float)w)/h;
-	float outRatio = ((float)(mSize.x()-mHandleSize))/(mSize.y()-mHandleSize);
-	int maxOutputWidth = mSize.x()-mHandleSize, maxOutputHeight = mSize.y()-mHandleSize;
-	int outputWidth = 0, outputHeight = 0;
-
-	//0=Crop, 1=Scale, 2=Stretch
-	switch(mImageMode)
-	{
-		case 0:
-			if(inRatio > outRatio)
-			{
-				outputHeight = maxOutputHeight;
-				outputWidth = ((float)maxOutputHeight)*inRatio;
-			}else{
-				outputWidth = maxOutputWidth;
-				outputHeight = ((float)maxOutputWidth)/inRatio;
-			}
-			break;
-		case 1:
-			if(inRatio < outRatio)
-			{
-				outputHeight = maxOutputHeight;
-				outputWidth = ((float)maxOutputHeight)*inRatio;
-			}else{
-				outputWidth = maxOutputWidth;
-				outputHeight = ((float)maxOutputWidth)/inRatio;
-			}
-			break;
-		case 2:
-			outputHeight = maxOutputHeight;
-			outputWidth = maxOutputWidth;
-			break;
-		default:
-			printf("Bad image mode, setting to scale\n");
-			mImageMode = 1;
-			break;
-	}
-
-	NVGpaint imgPaint = nvgImagePattern(ctx,
-			mPos.x()+(mSize.x()/2)-outputWidth/2,
-			mPos.y()+(mSize.y()/2)-outputHeight/2,
-			outputWidth,outputHeight,
-			0, mImageHandle, 1);
-
-	nvgBeginPath(ctx);
-
-	if(mImageMode == 1)
-		nvgRect(ctx,
-				mPos.x()+(mSize.x()/2)-outputWidth/2,
-				mPos.y()+(mSize.y()/2)-outputHeight/2,
-				outputWidth,outputHeight);
-	else
-		nvgRect(ctx, mPos.x()+mHandleSize/2,mPos.y()+mHandleSize/2,mSize.x()-mHandleSize,mSize.y()-mHandleSize);
+	//The texture is still streaming in
+	if (!ready()) {
+		drawPlaceholder(ctx);
+		return;
+	}
 
 	//TODO Not the best place for this but it'll work
 	char tempString[200];
@@ -172,10 +216,180 @@ void SlideImage::drawImage(NVGcontext *ctx){
 	(uint32_t)(mCanvasPos.y()*1080));
 	mImagePosition->setValue(std::string(&tempString[0]));
 
-	nvgFillPaint(ctx, imgPaint);
+	drawFittedImage(ctx, mImageHandle);
+}
+
+Vector2i SlideImage::targetSize(const Screen *screen) const {
+	float ratio = screen ? screen->pixelRatio() : 1.f;
+	return Vector2i((int) std::ceil((mSize.x() - mHandleSize) * ratio),
+			(int) std::ceil((mSize.y() - mHandleSize) * ratio));
+}
+
+void SlideImage::drawPlaceholder(NVGcontext *ctx) {
+	//Without a header there is nothing to lay out
+	if (!mImageInfo.valid())
+		return;
+
+	Vector2i size = fittedSize(mImageInfo.size());
+	nvgBeginPath(ctx);
+	if (mImageMode == ImageMode::Scale)
+		nvgRect(ctx,
+				mPos.x()+(mSize.x()/2)-size.x()/2,
+				mPos.y()+(mSize.y()/2)-size.y()/2,
+				size.x(),size.y());
+	else
+		nvgRect(ctx, mPos.x()+mHandleSize/2,mPos.y()+mHandleSize/2,mSize.x()-mHandleSize,mSize.y()-mHandleSize);
+	nvgFillColor(ctx, Color(255, 24));
 	nvgFill(ctx);
 }
 
+Vector2i SlideImage::decodedSize(const Vector2i &target) const {
+	if (!mImageInfo.valid())
+		return Vector2i(0, 0);
+
+	//Mirrors JPEGImage::loadScaled(), which leaves CMYK files to stb_image
+	if (mImageInfo.format == ImageInfo::Format::JPEG && mImageInfo.channels != 4 &&
+			target.x() > 0 && target.y() > 0) {
+		int scale = JPEGImage::scaleFor(mImageInfo.width, mImageInfo.height, target.x(), target.y());
+		return Vector2i(JPEGImage::scaledSize(mImageInfo.width, scale),
+				JPEGImage::scaledSize(mImageInfo.height, scale));
+	}
+	return mImageInfo.size();
+}
+
+bool SlideImage::streamImage(NVGcontext *ctx, Screen *screen) {
+	if (!mDecode.valid()) {
+		std::string fileName = mFileName;
+		Vector2i target = targetSize(screen);
+		auto cancel = std::make_shared<std::atomic<bool>>(false);
+		mCancelDecode = cancel;
+		mDecode = screen->workerPool()->submit([fileName, target, cancel]() {
+			Decoded decoded;
+			if (*cancel)
+				return decoded;
+
+			//Large photos only need decoding at the size they are shown at
+			auto pixels = std::make_shared<std::vector<uint8_t>>();
+			if (target.x() > 0 && target.y() > 0 &&
+					JPEGImage::loadScaled(fileName, target.x(), target.y(), *pixels,
+							decoded.width, decoded.height)) {
+				decoded.rgba = std::shared_ptr<const uint8_t>(pixels, pixels->data());
+				decoded.reduced = true;
+				return decoded;
+			}
+
+			//Decode like nvgCreateImage() so that streamed and other images look the same
+			//(nanogui::init() sets stb_image's flags for that)
+			int n;
+			uint8_t *data = stbi_load(fileName.c_str(), &decoded.width, &decoded.height, &n, 4);
+			if (data)
+				decoded.rgba = std::shared_ptr<const uint8_t>(data, stbi_image_free);
+			return decoded;
+		});
+
+		//Allocate the texture now, so that it counts against the budget while decoding
+		Vector2i size = decodedSize(target);
+		if (size.x() > 0 && size.y() > 0)
+			mImageHandle = createStreamTexture(ctx, size);
+		mUploaded = std::make_shared<bool>(false);
+	}
+	if (mDecode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		screen->requestFrame();
+		return false;
+	}
+	Decoded decoded = mDecode.get();
+	mCancelDecode = nullptr;
+	if (!decoded.rgba) {
+		if (mImageHandle > 0)
+			nvgDeleteImage(ctx, mImageHandle);
+		mImageHandle = 0;
+		mUploadTexture = 0;
+		mUploaded = nullptr;
+		return true;
+	}
+
+	//The prediction fails when e.g. the reduced JPEG decoder gave up on a file
+	if (mImageHandle > 0) {
+		int w, h;
+		nvgImageSize(ctx, mImageHandle, &w, &h);
+		if (w != decoded.width || h != decoded.height) {
+			nvgDeleteImage(ctx, mImageHandle);
+			mImageHandle = 0;
+		}
+	}
+	if (mImageHandle == 0) {
+		mImageHandle = createStreamTexture(ctx, Vector2i(decoded.width, decoded.height));
+		if (mImageHandle == 0) {
+			mUploaded = nullptr;
+			return true;
+		}
+	}
+	mImageReduced = decoded.reduced;
+
+	mUploader = screen->textureUploader();
+	std::shared_ptr<bool> uploaded = mUploaded;
+	mUploader->upload(mUploadTexture, Vector2i(decoded.width, decoded.height), decoded.rgba,
+			[uploaded]() { *uploaded = true; });
+	return true;
+}
+
+int SlideImage::createStreamTexture(NVGcontext *ctx, const Vector2i &size) {
+	//Its pixels arrive over the next frames
+	GLint boundTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x(), size.y(), 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+
+	//NanoVG owns the texture from here on and deletes it with the image
+	int handle = nvglCreateImageFromHandleGL3(ctx, texture, size.x(), size.y(), 0);
+	if (handle == 0) {
+		glDeleteTextures(1, &texture);
+		return 0;
+	}
+	trackTexture(ctx, handle, (size_t) size.x() * size.y() * 4);
+	mUploadTexture = texture;
+	return handle;
+}
+
+int SlideImage::createCompressedImage(NVGcontext *ctx) {
+	//Failures propagate to drawImage()
+	ref<ETC2Image> image = new ETC2Image(mFileName);
+
+	//Software contexts only take pixels
+	if (SoftwareRenderer::isSoftwareContext(ctx)) {
+		std::vector<uint8_t> rgba((size_t) image->width() * image->height() * 4);
+		image->decode(rgba.data());
+		return nvgCreateImageRGBA(ctx, image->width(), image->height(), 0, rgba.data());
+	}
+
+	GLint boundTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	size_t bytes = image->upload();
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+
+	//NanoVG owns the texture from here on and deletes it with the image
+	int handle = nvglCreateImageFromHandleGL3(ctx, texture, image->width(), image->height(), 0);
+	if (handle == 0)
+		glDeleteTextures(1, &texture);
+	trackTexture(ctx, handle, bytes);
+	return handle;
+}
+
 Widget *SlideImage::initPropertiesPanel(Window *parent)
 {
 	parent->addChild(mImagePosLabel);
@@ -189,15 +403,52 @@ Widget *SlideImage::initPropertiesPanel(Window *parent)
 void SlideImage::dispose() {
 }
 
+void SlideImage::releaseResources() {
+	//A decode in flight finishes on the worker pool, a queued one is skipped
+	if (mCancelDecode)
+		*mCancelDecode = true;
+	mCancelDecode = nullptr;
+	mDecode = std::future<Decoded>();
+	if (mUploader) {
+		mUploader->cancel(mUploadTexture);
+		mUploader = nullptr;
+	}
+	mUploadTexture = 0;
+	mUploaded = nullptr;
+	if (mImageHandle > 0) {
+		if (mImageGroup) {
+			untrackTexture(mImageHandle);
+			mImageGroup->releaseImage(mImageContext, mImageHandle);
+		}
+		else
+			nvgDeleteImage(mImageContext, mImageHandle);
+	}
+	mImageHandle = 0;
+	mImageReduced = false;
+	mImageGroup = nullptr;
+	mImageContext = nullptr;
+}
+
+size_t SlideImage::estimateMemory() const {
+	Vector2i size = decodedSize(targetSize(nullptr));
+	return (size_t) size.x() * size.y() * 4;
+}
+
 void SlideImage::save(Serializer &s) const {
-    Widget::save(s);
+    MediaItemBase::save(s);
+    s.set("fileName", documentPath(s, mFileName));
+    saveImageMode(s);
 }
 
 bool SlideImage::load(Serializer &s) {
-    if (!Widget::load(s)) return false;
-//    if (!s.get("title", mTitle)) return false;
-//    if (!s.get("modal", mModal)) return false;
-
+    if (!MediaItemBase::load(s)) return false;
+    if (!s.get("fileName", mFileName)) return false;
+    mFileName = resolveDocumentPath(s, mFileName);
+    if (!loadImageMode(s)) return false;
+
+    releaseResources();
+    ImageInfo::probe(mFileName, mImageInfo);
+    mFileLoadError = false;
     return true;
 }
 
@@ -0,0 +1,268 @@
+/*
+    src/slidetext.cpp -- Text box on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/slidetext.h>
+#include <nanogui/screen.h>
+#include <nanogui/window.h>
+#include <nanogui/label.h>
+#include <nanogui/displaylist.h>
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/serializer/core.h>
+#include <algorithm>
+#include <cmath>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Height of the slide that font sizes are given for */
+static const float referenceHeight = 1080.f;
+
+/* Items rasterize with a renderer of the thread drawing them, so that
+   slides rendered on several threads do not wait for each other; fonts
+   loaded from files stay registered in it. Text boxes are small, so the
+   renderer uses no helper threads, which would live as long as the thread */
+struct TextRenderer {
+    ref<SoftwareRenderer> renderer;
+    ref<Theme> theme;
+
+    TextRenderer() : renderer(new SoftwareRenderer(1, 1, NVG_ANTIALIAS, 1)) {
+        theme = new Theme(renderer->context());
+    }
+};
+
+static SoftwareRenderer *textRenderer() {
+    static thread_local TextRenderer text;
+    return text.renderer;
+}
+
+static int findFont(NVGcontext *ctx, const std::string &font) {
+    int id = nvgFindFont(ctx, font.c_str());
+    if (id < 0 && !font.empty())
+        id = nvgCreateFont(ctx, font.c_str(), font.c_str());
+    if (id < 0) {
+        printf("Error loading font: %s\n", font.c_str());
+        id = nvgFindFont(ctx, "sans");
+    }
+    return id;
+}
+
+SlideText::SlideText(Widget *parent, const std::string &text)
+    : MediaItemBase(parent), mText(text), mFont("sans"), mFontSize(72.f),
+      mColor(255, 255), mAlignment(Alignment::Left),
+      mVerticalAlignment(VerticalAlignment::Top), mWordWrap(true), mAutoFit(false),
+      mTextureContext(nullptr), mTexture(0), mTextureSize(0, 0), mTextureHash(0) {
+
+    mTextLabel = new Label(NULL, "Text:", "sans-bold");
+    mTextLabel->incRef();
+    mTextBox = new TextBox(NULL);
+    mTextBox->setEditable(true);
+    mTextBox->setFixedSize(Vector2i(130, 20));
+    mTextBox->setFontSize(16);
+    mTextBox->setCallback([this](const std::string &value) {
+        mText = value;
+        return true;
+    });
+    mTextBox->incRef();
+
+    mFontSizeLabel = new Label(NULL, "Font size:", "sans-bold");
+    mFontSizeLabel->incRef();
+    mFontSizeBox = new FloatBox<float>(NULL);
+    mFontSizeBox->setEditable(true);
+    mFontSizeBox->setFixedSize(Vector2i(130, 20));
+    mFontSizeBox->setUnits("Px");
+    mFontSizeBox->setFontSize(16);
+    mFontSizeBox->setCallback([this](float value) {
+        mFontSize = std::max(value, 1.f);
+    });
+    mFontSizeBox->incRef();
+}
+
+SlideText::~SlideText() {
+    mTextLabel->decRef();
+    mTextBox->decRef();
+    mFontSizeLabel->decRef();
+    mFontSizeBox->decRef();
+    //On a screen the texture registry deletes the texture, otherwise it dies with its context
+}
+
+void SlideText::draw(NVGcontext *ctx) {
+    Screen *screen = nullptr;
+    for (Widget *w = this; w && !screen; w = w->parent())
+        screen = dynamic_cast<Screen *>(w);
+    float pixelRatio = screen ? screen->pixelRatio() : 1.f;
+
+    Vector2i box = mSize - Vector2i::Constant(mHandleSize);
+    if (box.x() > 0 && box.y() > 0) {
+        /* Rasterize at the resolution of the output */
+        Vector2i size((int) std::ceil(box.x() * pixelRatio), (int) std::ceil(box.y() * pixelRatio));
+        float scale = pixelRatio;
+        if (mCanvas && mCanvas->mCanvasSize.y() > 0)
+            scale *= mCanvas->mCanvasSize.y() / referenceHeight;
+
+        DrawStateHash hash;
+        hash.add(mText).add(mFont).add(mFontSize).add(mColor)
+            .add((int) mAlignment).add((int) mVerticalAlignment)
+            .add(mWordWrap).add(mAutoFit).add(size).add(scale).addPointer(ctx);
+        if (!mTexture || ctx != mTextureContext || hash.value() != mTextureHash) {
+            rasterize(ctx, size, scale);
+            mTextureHash = hash.value();
+        }
+
+        nvgSave(ctx);
+        NVGpaint paint = nvgImagePattern(ctx, mPos.x() + mHandleSize / 2, mPos.y() + mHandleSize / 2,
+                                         box.x(), box.y(), 0, mTexture, 1);
+        nvgBeginPath(ctx);
+        nvgRect(ctx, mPos.x() + mHandleSize / 2, mPos.y() + mHandleSize / 2, box.x(), box.y());
+        nvgFillPaint(ctx, paint);
+        nvgFill(ctx);
+        nvgRestore(ctx);
+    }
+
+    //Draw handles, borders and what not
+    MediaItemBase::draw(ctx);
+}
+
+void SlideText::rasterize(NVGcontext *ctx, const Vector2i &size, float scale) {
+    SoftwareRenderer *renderer = textRenderer();
+    if (renderer->size() != size)
+        renderer->resize(size);
+    NVGcontext *vg = renderer->context();
+    renderer->beginFrame(Color(0, 0));
+    nvgFontFaceId(vg, findFont(vg, mFont));
+
+    /* Break the text into rows; returns the height of the block */
+    const float boxWidth = (float) size.x(), boxHeight = (float) size.y();
+    std::vector<NVGtextRow> rows;
+    float lineHeight = 0, width = 0;
+    auto layout = [&](float fontSize) {
+        nvgFontSize(vg, fontSize);
+        nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        nvgTextMetrics(vg, nullptr, nullptr, &lineHeight);
+        rows.clear();
+        width = 0;
+        const char *start = mText.c_str(), *end = start + mText.size();
+        NVGtextRow buffer[32];
+        int count;
+        while ((count = nvgTextBreakLines(vg, start, end, mWordWrap ? boxWidth : 1e7f,
+                                          buffer, 32)) > 0) {
+            for (int i = 0; i < count; ++i) {
+                rows.push_back(buffer[i]);
+                width = std::max(width, buffer[i].width);
+            }
+            start = buffer[count - 1].next;
+        }
+        return rows.size() * lineHeight;
+    };
+
+    float fontSize = std::max(mFontSize * scale, 1.f);
+    float height = layout(fontSize);
+    if (mAutoFit && (height > boxHeight || width > boxWidth)) {
+        /* Largest size at which the text fits, to within a fraction of a pixel */
+        float low = 1.f, high = fontSize;
+        for (int i = 0; i < 12 && high - low > 0.25f; ++i) {
+            float middle = 0.5f * (low + high);
+            if (layout(middle) <= boxHeight && width <= boxWidth)
+                low = middle;
+            else
+                high = middle;
+        }
+        height = layout(low);
+    }
+
+    float x = 0, y = 0;
+    int align = NVG_ALIGN_TOP;
+    switch (mAlignment) {
+        case Alignment::Left: align |= NVG_ALIGN_LEFT; break;
+        case Alignment::Center: align |= NVG_ALIGN_CENTER; x = boxWidth * 0.5f; break;
+        case Alignment::Right: align |= NVG_ALIGN_RIGHT; x = boxWidth; break;
+    }
+    if (mVerticalAlignment == VerticalAlignment::Middle)
+        y = (boxHeight - height) * 0.5f;
+    else if (mVerticalAlignment == VerticalAlignment::Bottom)
+        y = boxHeight - height;
+
+    nvgTextAlign(vg, align);
+    nvgFillColor(vg, mColor);
+    for (const NVGtextRow &row : rows) {
+        nvgText(vg, x, y, row.start, row.end);
+        y += lineHeight;
+    }
+    renderer->endFrame();
+
+    /* The renderer's pixels are premultiplied */
+    if (mTexture && ctx == mTextureContext && size == mTextureSize) {
+        nvgUpdateImage(ctx, mTexture, renderer->data());
+    } else {
+        releaseResources();
+        mTexture = nvgCreateImageRGBA(ctx, size.x(), size.y(), NVG_IMAGE_PREMULTIPLIED,
+                                      renderer->data());
+        trackTexture(ctx, mTexture);
+        mTextureContext = ctx;
+        mTextureSize = size;
+    }
+}
+
+Widget *SlideText::initPropertiesPanel(Window *parent) {
+    mTextBox->setValue(mText);
+    mFontSizeBox->setValue(mFontSize);
+
+    parent->addChild(mTextLabel);
+    parent->addChild(mTextBox);
+    parent->addChild(mFontSizeLabel);
+    parent->addChild(mFontSizeBox);
+
+    return NULL;
+}
+
+void SlideText::releaseResources() {
+    if (mTexture > 0)
+        nvgDeleteImage(mTextureContext, mTexture);
+    mTexture = 0;
+    mTextureContext = nullptr;
+    mTextureSize = Vector2i(0, 0);
+    mTextureHash = 0;
+}
+
+size_t SlideText::estimateMemory() const {
+    Vector2i box = (mSize - Vector2i::Constant(mHandleSize)).cwiseMax(0);
+    return (size_t) box.x() * box.y() * 4 * 2;
+}
+
+void SlideText::save(Serializer &s) const {
+    MediaItemBase::save(s);
+    s.set("text", mText);
+    s.set("font", mFont);
+    s.set("fontSize", mFontSize);
+    s.set("color", mColor);
+    s.set("alignment", (int) mAlignment);
+    s.set("verticalAlignment", (int) mVerticalAlignment);
+    s.set("wordWrap", mWordWrap);
+    s.set("autoFit", mAutoFit);
+}
+
+bool SlideText::load(Serializer &s) {
+    int alignment, verticalAlignment;
+    if (!MediaItemBase::load(s)) return false;
+    if (!s.get("text", mText)) return false;
+    if (!s.get("font", mFont)) return false;
+    if (!s.get("fontSize", mFontSize)) return false;
+    if (!s.get("color", mColor)) return false;
+    if (!s.get("alignment", alignment)) return false;
+    if (!s.get("verticalAlignment", verticalAlignment)) return false;
+    if (!s.get("wordWrap", mWordWrap)) return false;
+    if (!s.get("autoFit", mAutoFit)) return false;
+    mAlignment = (Alignment) std::min(std::max(alignment, 0), 2);
+    mVerticalAlignment = (VerticalAlignment) std::min(std::max(verticalAlignment, 0), 2);
+
+    releaseResources();
+    return true;
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,174 @@
+/*
+    src/slidevideo.cpp -- Motion-JPEG or image sequence clip on a slide
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/slidevideo.h>
+#include <nanogui/screen.h>
+#include <nanogui/opengl.h>
+#include <nanogui/serializer/core.h>
+#include <cmath>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Playback rate of image sequences without an explicit one */
+static const double defaultFrameRate = 30.0;
+
+SlideVideo::SlideVideo(Widget *parent, const std::string &fileName)
+    : MediaItemBase(parent), mFileName(fileName), mFrameRate(0),
+      mLoop(true), mOpenError(false), mTextureContext(nullptr), mTextureIndex(-1),
+      mTextureWidth(0), mTextureHeight(0), mStartTime(-1) {
+    for (int i = 0; i < textureCount; ++i)
+        mTextures[i] = 0;
+}
+
+void SlideVideo::setLoop(bool loop) {
+    mLoop = loop;
+    if (mDecoder)
+        mDecoder->setLoop(loop);
+}
+
+void SlideVideo::draw(NVGcontext *ctx) {
+    nvgSave(ctx);
+    drawVideo(ctx);
+    nvgRestore(ctx);
+
+    //Draw handles, borders and what not
+    MediaItemBase::draw(ctx);
+}
+
+void SlideVideo::drawVideo(NVGcontext *ctx) {
+    //Slides may also be rendered offscreen, without a parent screen
+    Screen *screen = nullptr;
+    for (Widget *w = this; w && !screen; w = w->parent())
+        screen = dynamic_cast<Screen *>(w);
+
+    if (!mDecoder && !mOpenError) {
+        try {
+            //Offscreen only needs the first frame, so no workers are started
+            mDecoder = new VideoDecoder(mFileName, 6, screen ? 2 : 0);
+            mDecoder->setLoop(mLoop);
+        } catch (const std::exception &e) {
+            printf("Error opening video: %s\n", e.what());
+            mOpenError = true;
+        }
+    }
+    if (!mDecoder)
+        return;
+
+    if (ctx != mTextureContext)
+        releaseTextures();
+
+    int width, height;
+    if (screen) {
+        double rate = mFrameRate > 0 ? mFrameRate : mDecoder->frameRate();
+        if (rate <= 0)
+            rate = defaultFrameRate;
+        int count = mDecoder->frameCount();
+        double now = screen->frameTime();
+        if (mStartTime < 0)
+            mStartTime = now;
+
+        double position = std::floor((now - mStartTime) * rate);
+        int target;
+        if (mLoop)
+            target = (int) std::fmod(position, (double) count);
+        else
+            target = (int) std::min(position, (double) (count - 1));
+
+        if (mDecoder->fetch(target, mFrame, width, height) >= 0)
+            uploadFrame(ctx, width, height);
+
+        //Keep frames coming while the clip plays, even if nothing else changes
+        if (mLoop || target < count - 1 || mTextureIndex < 0)
+            screen->requestFrame();
+    } else if (mTextureIndex < 0) {
+        if (mDecoder->decodeFrame(0, mFrame, width, height))
+            uploadFrame(ctx, width, height);
+    }
+
+    if (mTextureIndex < 0)
+        return;
+    drawFittedImage(ctx, mTextures[mTextureIndex]);
+}
+
+void SlideVideo::uploadFrame(NVGcontext *ctx, int width, int height) {
+    if (width != mTextureWidth || height != mTextureHeight) {
+        releaseTextures();
+        for (int i = 0; i < textureCount; ++i) {
+            mTextures[i] = nvgCreateImageRGBA(ctx, width, height, 0, mFrame.data());
+            trackTexture(ctx, mTextures[i]);
+        }
+        mTextureContext = ctx;
+        mTextureWidth = width;
+        mTextureHeight = height;
+        mTextureIndex = 0;
+        return;
+    }
+    mTextureIndex = (mTextureIndex + 1) % textureCount;
+    nvgUpdateImage(ctx, mTextures[mTextureIndex], mFrame.data());
+}
+
+void SlideVideo::releaseTextures() {
+    for (int i = 0; i < textureCount; ++i) {
+        if (mTextures[i] > 0)
+            nvgDeleteImage(mTextureContext, mTextures[i]);
+        mTextures[i] = 0;
+    }
+    mTextureContext = nullptr;
+    mTextureIndex = -1;
+    mTextureWidth = mTextureHeight = 0;
+}
+
+Widget *SlideVideo::initPropertiesPanel(Window *) {
+    return NULL;
+}
+
+void SlideVideo::releaseResources() {
+    releaseTextures();
+    mDecoder = nullptr;
+    mStartTime = -1;
+}
+
+size_t SlideVideo::estimateMemory() const {
+    int width, height;
+    if (!VideoDecoder::probe(mFileName, width, height))
+        return 0;
+    const Screen *screen = nullptr;
+    for (const Widget *w = this; w && !screen; w = w->parent())
+        screen = dynamic_cast<const Screen *>(w);
+    /* Offscreen, the first frame is decoded once (plus stb_image's copy);
+       on screen, six slots, one frame per worker and the frame exchanged
+       with the item */
+    int frames = screen ? 6 + 2 + 1 : 2;
+    return (size_t) width * height * 4 * frames;
+}
+
+void SlideVideo::save(Serializer &s) const {
+    MediaItemBase::save(s);
+    s.set("fileName", documentPath(s, mFileName));
+    saveImageMode(s);
+    s.set("frameRate", mFrameRate);
+    s.set("loop", mLoop);
+}
+
+bool SlideVideo::load(Serializer &s) {
+    if (!MediaItemBase::load(s)) return false;
+    if (!s.get("fileName", mFileName)) return false;
+    mFileName = resolveDocumentPath(s, mFileName);
+    if (!loadImageMode(s)) return false;
+    if (!s.get("frameRate", mFrameRate)) return false;
+    if (!s.get("loop", mLoop)) return false;
+
+    releaseResources();
+    mOpenError = false;
+    return true;
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,896 @@
+/*
+    src/softwarerenderer.cpp -- NanoVG backend that rasterizes into an
+    RGBA8 buffer on the CPU
+
+    The shading and blending follow NanoVG's GL3 backend (nanovg_gl.h) so
+    that both produce the same images up to rounding.
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/softwarerenderer.h>
+#include <nanogui/textcache.h>
+#include <nanogui/workerpool.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define NANOGUI_SW_SSE2
+#endif
+
+NAMESPACE_BEGIN(nanogui)
+
+namespace {
+
+struct SWTexture {
+    int width, height, type, flags;
+    std::vector<uint8_t> data;
+};
+
+/* Uniforms of the GL3 fragment shader */
+struct SWShader {
+    enum Type { Gradient, Image, Textured };
+
+    int type;
+    float paintMat[6];
+    float scissorMat[6];
+    float scissorExt[2], scissorScale[2];
+    float extent[2], radius, feather, strokeMult;
+    float innerCol[4], outerCol[4];
+    int texType;
+    const SWTexture *texture;
+    bool scissor;
+    bool constant;
+};
+
+struct SWPrimitive {
+    enum Mode { Fan, Strip, List };
+    int mode;
+    size_t first, count;
+};
+
+struct SWCall {
+    enum Type { ConvexFill, StencilFill, Stroke, Triangles };
+
+    int type;
+    SWShader shader;
+    NVGcompositeOperationState blend;
+    /* Primitives: for fills, the fill fans come first, then the fringes */
+    size_t firstFill, fillCount, firstFringe, fringeCount;
+    /* Bounding box in pixels (inclusive min, exclusive max) */
+    int bbox[4];
+};
+
+struct SWContext {
+    bool edgeAA;
+    int threadCount = 0;
+    int tileSize = 64;
+    std::map<int, SWTexture> textures;
+    int nextTexture = 1;
+    float viewWidth = 1, viewHeight = 1;
+    std::vector<SWCall> calls;
+    std::vector<SWPrimitive> primitives;
+    std::vector<NVGvertex> vertices;
+    uint8_t *pixels = nullptr;
+    int width = 0, height = 0;
+    /* Threads helping the flushing thread, kept across frames */
+    ref<WorkerPool> pool;
+};
+
+/* Vertex in pixel coordinates */
+struct SWVertex {
+    float x, y, u, v;
+};
+
+struct SWTile {
+    int x0, y0, x1, y1;
+    int16_t *stencil;
+    uint8_t *pixels;
+    int width;
+};
+
+/* Triangle set up for scan conversion with plane equations for u and v */
+struct SWTriangle {
+    float A[3], B[3], C[3];
+    float dudx, dudy, u0, dvdx, dvdy, v0;
+    float minX, minY, maxX, maxY;
+    int orientation;
+    bool constantUV;
+};
+
+inline float clamp01(float v) { return std::min(std::max(v, 0.f), 1.f); }
+
+inline void premultiply(const NVGcolor &c, float *out) {
+    out[0] = c.r * c.a; out[1] = c.g * c.a; out[2] = c.b * c.a; out[3] = c.a;
+}
+
+inline void transformPoint(const float *m, float x, float y, float &ox, float &oy) {
+    ox = x * m[0] + y * m[2] + m[4];
+    oy = x * m[1] + y * m[3] + m[5];
+}
+
+bool setupTriangle(const SWVertex &a, const SWVertex &b0, const SWVertex &c0, SWTriangle &t) {
+    float area = (b0.x - a.x) * (c0.y - a.y) - (b0.y - a.y) * (c0.x - a.x);
+    if (area == 0 || !std::isfinite(area))
+        return false;
+
+    /* Scan convert counter-clockwise, but remember the orientation for the stencil */
+    const SWVertex &b = area > 0 ? b0 : c0, &c = area > 0 ? c0 : b0;
+    t.orientation = area > 0 ? 1 : -1;
+    area = std::abs(area);
+
+    const SWVertex *v[3] = { &a, &b, &c };
+    for (int i = 0; i < 3; ++i) {
+        const SWVertex &p = *v[i], &q = *v[(i + 1) % 3];
+        t.A[i] = p.y - q.y;
+        t.B[i] = q.x - p.x;
+        t.C[i] = p.x * q.y - p.y * q.x;
+    }
+
+    t.dudx = ((b.u - a.u) * (c.y - a.y) - (c.u - a.u) * (b.y - a.y)) / area;
+    t.dudy = ((c.u - a.u) * (b.x - a.x) - (b.u - a.u) * (c.x - a.x)) / area;
+    t.u0 = a.u - t.dudx * a.x - t.dudy * a.y;
+    t.dvdx = ((b.v - a.v) * (c.y - a.y) - (c.v - a.v) * (b.y - a.y)) / area;
+    t.dvdy = ((c.v - a.v) * (b.x - a.x) - (b.v - a.v) * (c.x - a.x)) / area;
+    t.v0 = a.v - t.dvdx * a.x - t.dvdy * a.y;
+    t.constantUV = a.u == 0.5f && b.u == 0.5f && c.u == 0.5f &&
+                   a.v == 1.f && b.v == 1.f && c.v == 1.f;
+
+    t.minX = std::min(a.x, std::min(b.x, c.x));
+    t.maxX = std::max(a.x, std::max(b.x, c.x));
+    t.minY = std::min(a.y, std::min(b.y, c.y));
+    t.maxY = std::max(a.y, std::max(b.y, c.y));
+    return true;
+}
+
+/* Invoke 'span(y, x0, x1)' for the pixels of the tile whose centers lie in
+   the triangle. Edges shared by two triangles assign each pixel to exactly
+   one of them (like OpenGL), so nothing is blended twice. */
+template <typename Func>
+void forEachSpan(const SWTriangle &t, const SWTile &tile, Func span) {
+    int yStart = std::max(tile.y0, (int) std::floor(t.minY));
+    int yEnd = std::min(tile.y1, (int) std::ceil(t.maxY) + 1);
+    int xMin = std::max(tile.x0, (int) std::floor(t.minX));
+    int xMax = std::min(tile.x1, (int) std::ceil(t.maxX) + 1);
+    if (xMin >= xMax)
+        return;
+
+    for (int y = yStart; y < yEnd; ++y) {
+        float yc = y + 0.5f;
+        int x0 = xMin, x1 = xMax;
+        for (int i = 0; i < 3 && x0 < x1; ++i) {
+            float A = t.A[i], r = t.B[i] * yc + t.C[i];
+            if (A == 0) {
+                if (!(r > 0 || (r == 0 && t.B[i] > 0)))
+                    x1 = x0;
+                continue;
+            }
+            float edge = -r / A - 0.5f;
+            if (!(std::abs(edge) < 1e8f)) {
+                if ((A > 0) != (edge < 0))
+                    x1 = x0;
+                continue;
+            }
+            int bound = (int) std::ceil(edge);
+            if (A > 0)
+                x0 = std::max(x0, bound);
+            else
+                x1 = std::min(x1, bound);
+        }
+        if (x0 < x1)
+            span(y, x0, x1);
+    }
+}
+
+inline float fetch(const SWTexture &tex, int x, int y, int c) {
+    if (tex.type == NVG_TEXTURE_ALPHA)
+        return tex.data[(size_t) y * tex.width + x] * (1.f / 255.f);
+    return tex.data[((size_t) y * tex.width + x) * 4 + c] * (1.f / 255.f);
+}
+
+inline int wrap(int i, int n, bool repeat) {
+    if (repeat) {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+    return std::min(std::max(i, 0), n - 1);
+}
+
+/* Bilinear (or nearest) lookup with the GL texel center convention */
+void sampleTexture(const SWTexture &tex, float u, float v, float *out) {
+    bool repeatX = (tex.flags & NVG_IMAGE_REPEATX) != 0;
+    bool repeatY = (tex.flags & NVG_IMAGE_REPEATY) != 0;
+    int channels = tex.type == NVG_TEXTURE_ALPHA ? 1 : 4;
+
+    if (tex.flags & NVG_IMAGE_NEAREST) {
+        int x = wrap((int) std::floor(u * tex.width), tex.width, repeatX);
+        int y = wrap((int) std::floor(v * tex.height), tex.height, repeatY);
+        for (int c = 0; c < channels; ++c)
+            out[c] = fetch(tex, x, y, c);
+    } else {
+        float fx = u * tex.width - 0.5f, fy = v * tex.height - 0.5f;
+        float flx = std::floor(fx), fly = std::floor(fy);
+        float tx = fx - flx, ty = fy - fly;
+        int x0 = wrap((int) flx, tex.width, repeatX), x1 = wrap((int) flx + 1, tex.width, repeatX);
+        int y0 = wrap((int) fly, tex.height, repeatY), y1 = wrap((int) fly + 1, tex.height, repeatY);
+        for (int c = 0; c < channels; ++c) {
+            float top = fetch(tex, x0, y0, c) * (1 - tx) + fetch(tex, x1, y0, c) * tx;
+            float bot = fetch(tex, x0, y1, c) * (1 - tx) + fetch(tex, x1, y1, c) * tx;
+            out[c] = top * (1 - ty) + bot * ty;
+        }
+    }
+
+    if (channels == 1)
+        out[1] = out[2] = out[3] = out[0];
+}
+
+float sdroundrect(float px, float py, float ex, float ey, float rad) {
+    float dx = std::abs(px) - (ex - rad), dy = std::abs(py) - (ey - rad);
+    float mx = std::max(dx, 0.f), my = std::max(dy, 0.f);
+    return std::min(std::max(dx, dy), 0.f) + std::sqrt(mx * mx + my * my) - rad;
+}
+
+/* The GL3 fragment shader; (x, y) is in logical units and (u, v) is the
+   interpolated texture/antialiasing coordinate */
+inline void shade(const SWShader &s, bool edgeAA, float x, float y, float u, float v,
+                  float *color) {
+    float scissor = 1.f;
+    if (s.scissor) {
+        float sx, sy;
+        transformPoint(s.scissorMat, x, y, sx, sy);
+        sx = 0.5f - (std::abs(sx) - s.scissorExt[0]) * s.scissorScale[0];
+        sy = 0.5f - (std::abs(sy) - s.scissorExt[1]) * s.scissorScale[1];
+        scissor = clamp01(sx) * clamp01(sy);
+    }
+
+    if (s.type == SWShader::Textured) {
+        sampleTexture(*s.texture, u, v, color);
+        if (s.texType == 1)
+            for (int c = 0; c < 3; ++c) color[c] *= color[3];
+        for (int c = 0; c < 4; ++c)
+            color[c] *= scissor * s.innerCol[c];
+        return;
+    }
+
+    float strokeAlpha = 1.f;
+    if (edgeAA)
+        strokeAlpha = std::min(1.f, (1.f - std::abs(u * 2.f - 1.f)) * s.strokeMult) *
+                      std::min(1.f, v);
+
+    float px, py;
+    transformPoint(s.paintMat, x, y, px, py);
+    if (s.type == SWShader::Gradient) {
+        float d = 0.f;
+        if (!s.constant)
+            d = clamp01((sdroundrect(px, py, s.extent[0], s.extent[1], s.radius) +
+                         s.feather * 0.5f) / s.feather);
+        for (int c = 0; c < 4; ++c)
+            color[c] = s.innerCol[c] + (s.outerCol[c] - s.innerCol[c]) * d;
+    } else {
+        sampleTexture(*s.texture, px / s.extent[0], py / s.extent[1], color);
+        if (s.texType == 1)
+            for (int c = 0; c < 3; ++c) color[c] *= color[3];
+        for (int c = 0; c < 4; ++c)
+            color[c] *= s.innerCol[c];
+    }
+    for (int c = 0; c < 4; ++c)
+        color[c] *= strokeAlpha * scissor;
+}
+
+inline bool isSourceOver(const NVGcompositeOperationState &op) {
+    return op.srcRGB == NVG_ONE && op.srcAlpha == NVG_ONE &&
+           op.dstRGB == NVG_ONE_MINUS_SRC_ALPHA && op.dstAlpha == NVG_ONE_MINUS_SRC_ALPHA;
+}
+
+inline float blendFactor(int factor, const float *s, const float *d, int c) {
+    switch (factor) {
+        case NVG_ZERO: return 0.f;
+        case NVG_ONE: return 1.f;
+        case NVG_SRC_COLOR: return s[c];
+        case NVG_ONE_MINUS_SRC_COLOR: return 1.f - s[c];
+        case NVG_DST_COLOR: return d[c];
+        case NVG_ONE_MINUS_DST_COLOR: return 1.f - d[c];
+        case NVG_SRC_ALPHA: return s[3];
+        case NVG_ONE_MINUS_SRC_ALPHA: return 1.f - s[3];
+        case NVG_DST_ALPHA: return d[3];
+        case NVG_ONE_MINUS_DST_ALPHA: return 1.f - d[3];
+        case NVG_SRC_ALPHA_SATURATE: return c == 3 ? 1.f : std::min(s[3], 1.f - d[3]);
+        default: return 0.f;
+    }
+}
+
+/* Blend one shaded (premultiplied) pixel into the buffer */
+inline void blendPixel(uint8_t *dst, const float *src, const NVGcompositeOperationState &op,
+                       bool sourceOver) {
+    if (sourceOver) {
+#if defined(NANOGUI_SW_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        int packed;
+        memcpy(&packed, dst, 4);
+        __m128i d32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+        __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(d32), _mm_set1_ps(1.f / 255.f));
+        __m128 s = _mm_loadu_ps(src);
+        __m128 r = _mm_add_ps(s, _mm_mul_ps(d, _mm_set1_ps(1.f - src[3])));
+        r = _mm_min_ps(_mm_max_ps(r, _mm_setzero_ps()), _mm_set1_ps(1.f));
+        __m128i ri = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+        ri = _mm_packs_epi32(ri, ri);
+        packed = _mm_cvtsi128_si32(_mm_packus_epi16(ri, ri));
+        memcpy(dst, &packed, 4);
+#else
+        for (int c = 0; c < 4; ++c)
+            dst[c] = (uint8_t) (clamp01(src[c] + dst[c] * (1.f / 255.f) * (1.f - src[3])) * 255.f + 0.5f);
+#endif
+        return;
+    }
+
+    float d[4] = { dst[0] * (1.f / 255.f), dst[1] * (1.f / 255.f),
+                   dst[2] * (1.f / 255.f), dst[3] * (1.f / 255.f) };
+    for (int c = 0; c < 4; ++c) {
+        int sf = c < 3 ? op.srcRGB : op.srcAlpha, df = c < 3 ? op.dstRGB : op.dstAlpha;
+        float r = src[c] * blendFactor(sf, src, d, c) + d[c] * blendFactor(df, src, d, c);
+        dst[c] = (uint8_t) (clamp01(r) * 255.f + 0.5f);
+    }
+}
+
+/* Source-over blend of a constant premultiplied color over 'count' pixels */
+void blendSpanConstant(uint8_t *dst, int count, const float *color) {
+    uint8_t s[4];
+    for (int c = 0; c < 4; ++c)
+        s[c] = (uint8_t) (clamp01(color[c]) * 255.f + 0.5f);
+    int inv = 255 - s[3];
+    int i = 0;
+
+    if (inv == 0) {
+        for (; i < count; ++i)
+            memcpy(dst + 4 * i, s, 4);
+        return;
+    }
+
+#if defined(NANOGUI_SW_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i src16 = _mm_set_epi16(s[3], s[2], s[1], s[0], s[3], s[2], s[1], s[0]);
+    const __m128i inv16 = _mm_set1_epi16((short) inv);
+    const __m128i bias = _mm_set1_epi16(128);
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + 4 * i));
+        __m128i lo = _mm_unpacklo_epi8(d, zero), hi = _mm_unpackhi_epi8(d, zero);
+        /* x / 255 computed as (x + 128 + ((x + 128) >> 8)) >> 8 */
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, inv16), bias);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, inv16), bias);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        lo = _mm_add_epi16(lo, src16);
+        hi = _mm_add_epi16(hi, src16);
+        _mm_storeu_si128((__m128i *) (dst + 4 * i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        uint8_t *p = dst + 4 * i;
+        for (int c = 0; c < 4; ++c) {
+            int x = p[c] * inv + 128;
+            p[c] = (uint8_t) std::min(255, s[c] + ((x + (x >> 8)) >> 8));
+        }
+    }
+}
+
+enum class StencilTest { None, EqualZero };
+
+/* Shade and blend the pixels of a triangle within the tile */
+void drawTriangle(const SWContext *sw, const SWCall &call, const SWTriangle &t,
+                  const SWTile &tile, StencilTest test, float scaleX, float scaleY) {
+    const SWShader &s = call.shader;
+    bool sourceOver = isSourceOver(call.blend);
+    bool constant = s.constant && !s.scissor && (t.constantUV || !sw->edgeAA) &&
+                    sourceOver && test == StencilTest::None;
+
+    forEachSpan(t, tile, [&](int y, int x0, int x1) {
+        uint8_t *row = tile.pixels + ((size_t) y * tile.width) * 4;
+        if (constant) {
+            blendSpanConstant(row + x0 * 4, x1 - x0, s.innerCol);
+            return;
+        }
+        const int16_t *stencil = tile.stencil + (y - tile.y0) * sw->tileSize - tile.x0;
+        float yc = y + 0.5f, color[4];
+        for (int x = x0; x < x1; ++x) {
+            if (test == StencilTest::EqualZero && stencil[x] != 0)
+                continue;
+            float xc = x + 0.5f;
+            float u = t.u0 + t.dudx * xc + t.dudy * yc;
+            float v = t.v0 + t.dvdx * xc + t.dvdy * yc;
+            shade(s, sw->edgeAA, xc / scaleX, yc / scaleY, u, v, color);
+            blendPixel(row + x * 4, color, call.blend, sourceOver);
+        }
+    });
+}
+
+/* Call 'func' for every triangle of a primitive */
+template <typename Func>
+void forEachTriangle(const SWContext *sw, const SWPrimitive &prim, float scaleX,
+                     float scaleY, Func func) {
+    const NVGvertex *v = sw->vertices.data() + prim.first;
+    auto px = [&](size_t i) {
+        return SWVertex { v[i].x * scaleX, v[i].y * scaleY, v[i].u, v[i].v };
+    };
+    SWTriangle t;
+    if (prim.mode == SWPrimitive::List) {
+        for (size_t i = 0; i + 2 < prim.count; i += 3)
+            if (setupTriangle(px(i), px(i + 1), px(i + 2), t))
+                func(t);
+    } else if (prim.mode == SWPrimitive::Fan) {
+        for (size_t i = 1; i + 1 < prim.count; ++i)
+            if (setupTriangle(px(0), px(i), px(i + 1), t))
+                func(t);
+    } else {
+        /* Triangle strips alternate their winding */
+        for (size_t i = 0; i + 2 < prim.count; ++i) {
+            bool odd = (i & 1) != 0;
+            if (setupTriangle(px(i), px(odd ? i + 2 : i + 1), px(odd ? i + 1 : i + 2), t))
+                func(t);
+        }
+    }
+}
+
+void renderTile(const SWContext *sw, SWTile &tile) {
+    float scaleX = sw->width / sw->viewWidth, scaleY = sw->height / sw->viewHeight;
+
+    for (const SWCall &call : sw->calls) {
+        if (call.bbox[0] >= tile.x1 || call.bbox[2] <= tile.x0 ||
+            call.bbox[1] >= tile.y1 || call.bbox[3] <= tile.y0)
+            continue;
+
+        auto draw = [&](size_t first, size_t count, StencilTest test) {
+            for (size_t i = first; i < first + count; ++i)
+                forEachTriangle(sw, sw->primitives[i], scaleX, scaleY, [&](const SWTriangle &t) {
+                    drawTriangle(sw, call, t, tile, test, scaleX, scaleY);
+                });
+        };
+
+        if (call.type != SWCall::StencilFill) {
+            draw(call.firstFill, call.fillCount, StencilTest::None);
+            draw(call.firstFringe, call.fringeCount, StencilTest::None);
+            continue;
+        }
+
+        /* Non-zero winding: count the fill fans into the stencil buffer */
+        for (size_t i = call.firstFill; i < call.firstFill + call.fillCount; ++i) {
+            forEachTriangle(sw, sw->primitives[i], scaleX, scaleY, [&](const SWTriangle &t) {
+                forEachSpan(t, tile, [&](int y, int x0, int x1) {
+                    int16_t *stencil = tile.stencil + (y - tile.y0) * sw->tileSize - tile.x0;
+                    for (int x = x0; x < x1; ++x)
+                        stencil[x] = (int16_t) (stencil[x] + t.orientation);
+                });
+            });
+        }
+
+        /* Antialiased fringes outside of the shape */
+        draw(call.firstFringe, call.fringeCount, StencilTest::EqualZero);
+
+        /* Cover the shape and reset the stencil buffer */
+        const SWShader &s = call.shader;
+        bool sourceOver = isSourceOver(call.blend);
+        bool constant = s.constant && !s.scissor && sourceOver;
+        int x0 = std::max(call.bbox[0], tile.x0), x1 = std::min(call.bbox[2], tile.x1);
+        int y0 = std::max(call.bbox[1], tile.y0), y1 = std::min(call.bbox[3], tile.y1);
+        float color[4];
+        for (int y = y0; y < y1; ++y) {
+            int16_t *stencil = tile.stencil + (y - tile.y0) * sw->tileSize - tile.x0;
+            uint8_t *row = tile.pixels + ((size_t) y * tile.width) * 4;
+            for (int x = x0; x < x1; ++x) {
+                if (stencil[x] == 0)
+                    continue;
+                if (constant) {
+                    int end = x;
+                    while (end < x1 && stencil[end] != 0)
+                        stencil[end++] = 0;
+                    blendSpanConstant(row + x * 4, end - x, s.innerCol);
+                    x = end - 1;
+                    continue;
+                }
+                stencil[x] = 0;
+                shade(s, sw->edgeAA, (x + 0.5f) / scaleX, (y + 0.5f) / scaleY, 0.5f, 1.f, color);
+                blendPixel(row + x * 4, color, call.blend, sourceOver);
+            }
+        }
+    }
+}
+
+/* Port of glnvg__convertPaint() */
+bool convertPaint(SWContext *sw, SWShader &s, const NVGpaint *paint,
+                  const NVGscissor *scissor, float width, float fringe) {
+    memset(&s, 0, sizeof(SWShader));
+    premultiply(paint->innerColor, s.innerCol);
+    premultiply(paint->outerColor, s.outerCol);
+
+    if (scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f) {
+        s.scissor = false;
+    } else {
+        s.scissor = true;
+        nvgTransformInverse(s.scissorMat, scissor->xform);
+        s.scissorExt[0] = scissor->extent[0];
+        s.scissorExt[1] = scissor->extent[1];
+        const float *x = scissor->xform;
+        s.scissorScale[0] = std::sqrt(x[0] * x[0] + x[2] * x[2]) / fringe;
+        s.scissorScale[1] = std::sqrt(x[1] * x[1] + x[3] * x[3]) / fringe;
+    }
+
+    s.extent[0] = paint->extent[0];
+    s.extent[1] = paint->extent[1];
+    s.strokeMult = (width * 0.5f + fringe * 0.5f) / fringe;
+
+    if (paint->image != 0) {
+        auto it = sw->textures.find(paint->image);
+        if (it == sw->textures.end())
+            return false;
+        const SWTexture &tex = it->second;
+        if (tex.flags & NVG_IMAGE_FLIPY) {
+            float m1[6], m2[6];
+            nvgTransformTranslate(m1, 0.0f, s.extent[1] * 0.5f);
+            nvgTransformMultiply(m1, paint->xform);
+            nvgTransformScale(m2, 1.0f, -1.0f);
+            nvgTransformMultiply(m2, m1);
+            nvgTransformTranslate(m1, 0.0f, -s.extent[1] * 0.5f);
+            nvgTransformMultiply(m1, m2);
+            nvgTransformInverse(s.paintMat, m1);
+        } else {
+            nvgTransformInverse(s.paintMat, paint->xform);
+        }
+        s.type = SWShader::Image;
+        s.texture = &tex;
+        if (tex.type == NVG_TEXTURE_RGBA)
+            s.texType = (tex.flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
+        else
+            s.texType = 2;
+    } else {
+        s.type = SWShader::Gradient;
+        s.radius = paint->radius;
+        s.feather = std::max(paint->feather, 1e-6f);
+        nvgTransformInverse(s.paintMat, paint->xform);
+        s.constant = memcmp(s.innerCol, s.outerCol, sizeof(s.innerCol)) == 0;
+    }
+    return true;
+}
+
+void addPrimitive(SWContext *sw, int mode, const NVGvertex *verts, int count) {
+    sw->primitives.push_back(SWPrimitive { mode, sw->vertices.size(), (size_t) count });
+    sw->vertices.insert(sw->vertices.end(), verts, verts + count);
+}
+
+/* Compute the pixel bounding box of the vertices added for a call */
+void finishCall(SWContext *sw, SWCall &call, size_t firstVertex) {
+    float scaleX = sw->width / sw->viewWidth, scaleY = sw->height / sw->viewHeight;
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (size_t i = firstVertex; i < sw->vertices.size(); ++i) {
+        const NVGvertex &v = sw->vertices[i];
+        minX = std::min(minX, v.x); maxX = std::max(maxX, v.x);
+        minY = std::min(minY, v.y); maxY = std::max(maxY, v.y);
+    }
+    call.bbox[0] = std::max(0, (int) std::floor(minX * scaleX));
+    call.bbox[1] = std::max(0, (int) std::floor(minY * scaleY));
+    call.bbox[2] = std::min(sw->width, (int) std::ceil(maxX * scaleX) + 1);
+    call.bbox[3] = std::min(sw->height, (int) std::ceil(maxY * scaleY) + 1);
+    if (call.bbox[0] < call.bbox[2] && call.bbox[1] < call.bbox[3])
+        sw->calls.push_back(call);
+}
+
+/* NanoVG backend callbacks */
+
+int swRenderCreate(void *) { return 1; }
+
+int swRenderCreateTexture(void *uptr, int type, int w, int h, int imageFlags,
+                          const unsigned char *data) {
+    SWContext *sw = (SWContext *) uptr;
+    SWTexture tex;
+    tex.width = w;
+    tex.height = h;
+    tex.type = type;
+    tex.flags = imageFlags;
+    size_t bytes = (size_t) w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1);
+    if (data)
+        tex.data.assign(data, data + bytes);
+    else
+        tex.data.assign(bytes, 0);
+    int id = sw->nextTexture++;
+    sw->textures[id] = std::move(tex);
+    return id;
+}
+
+int swRenderDeleteTexture(void *uptr, int image) {
+    SWContext *sw = (SWContext *) uptr;
+    return sw->textures.erase(image) > 0 ? 1 : 0;
+}
+
+int swRenderUpdateTexture(void *uptr, int image, int x, int y, int w, int h,
+                          const unsigned char *data) {
+    SWContext *sw = (SWContext *) uptr;
+    auto it = sw->textures.find(image);
+    if (it == sw->textures.end())
+        return 0;
+    /* Like the GL backend: 'data' points to the whole image, and whole rows are updated */
+    SWTexture &tex = it->second;
+    (void) x; (void) w;
+    size_t rowBytes = (size_t) tex.width * (tex.type == NVG_TEXTURE_RGBA ? 4 : 1);
+    y = std::max(0, y);
+    h = std::min(h, tex.height - y);
+    if (h > 0)
+        memcpy(tex.data.data() + y * rowBytes, data + y * rowBytes, h * rowBytes);
+    return 1;
+}
+
+int swRenderGetTextureSize(void *uptr, int image, int *w, int *h) {
+    SWContext *sw = (SWContext *) uptr;
+    auto it = sw->textures.find(image);
+    if (it == sw->textures.end())
+        return 0;
+    *w = it->second.width;
+    *h = it->second.height;
+    return 1;
+}
+
+void swRenderViewport(void *uptr, float width, float height, float /* devicePixelRatio */) {
+    SWContext *sw = (SWContext *) uptr;
+    sw->viewWidth = std::max(width, 1e-6f);
+    sw->viewHeight = std::max(height, 1e-6f);
+}
+
+void swRenderCancel(void *uptr) {
+    SWContext *sw = (SWContext *) uptr;
+    sw->calls.clear();
+    sw->primitives.clear();
+    sw->vertices.clear();
+}
+
+void swRenderFlush(void *uptr) {
+    SWContext *sw = (SWContext *) uptr;
+    if (sw->pixels && !sw->calls.empty()) {
+        int ts = sw->tileSize;
+        int tilesX = (sw->width + ts - 1) / ts, tilesY = (sw->height + ts - 1) / ts;
+        int tileCount = tilesX * tilesY;
+        std::atomic<int> next(0);
+
+        auto worker = [&]() {
+            std::vector<int16_t> stencil((size_t) ts * ts, 0);
+            int index;
+            while ((index = next++) < tileCount) {
+                SWTile tile;
+                tile.x0 = (index % tilesX) * ts;
+                tile.y0 = (index / tilesX) * ts;
+                tile.x1 = std::min(tile.x0 + ts, sw->width);
+                tile.y1 = std::min(tile.y0 + ts, sw->height);
+                tile.stencil = stencil.data();
+                tile.pixels = sw->pixels;
+                tile.width = sw->width;
+                renderTile(sw, tile);
+            }
+        };
+
+        int threadCount = sw->threadCount > 0 ? sw->threadCount
+                                              : (int) std::thread::hardware_concurrency();
+        threadCount = std::max(1, std::min(threadCount, tileCount));
+        if (threadCount > 1 && (!sw->pool || sw->pool->threadCount() < threadCount - 1))
+            sw->pool = new WorkerPool(threadCount - 1);
+        std::vector<std::future<void>> helpers;
+        for (int i = 1; i < threadCount; ++i)
+            helpers.push_back(sw->pool->submit(worker));
+        worker();
+        for (auto &helper : helpers)
+            helper.wait();
+    }
+    swRenderCancel(uptr);
+}
+
+void swRenderFill(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                  NVGscissor *scissor, float fringe, const float *bounds,
+                  const NVGpath *paths, int npaths) {
+    SWContext *sw = (SWContext *) uptr;
+    SWCall call;
+    if (!convertPaint(sw, call.shader, paint, scissor, fringe, fringe))
+        return;
+    call.type = (npaths == 1 && paths[0].convex) ? SWCall::ConvexFill : SWCall::StencilFill;
+    call.blend = compositeOperation;
+
+    size_t firstVertex = sw->vertices.size();
+    call.firstFill = sw->primitives.size();
+    for (int i = 0; i < npaths; ++i)
+        if (paths[i].nfill > 0)
+            addPrimitive(sw, SWPrimitive::Fan, paths[i].fill, paths[i].nfill);
+    call.fillCount = sw->primitives.size() - call.firstFill;
+    call.firstFringe = sw->primitives.size();
+    for (int i = 0; i < npaths; ++i)
+        if (paths[i].nstroke > 0)
+            addPrimitive(sw, SWPrimitive::Strip, paths[i].stroke, paths[i].nstroke);
+    call.fringeCount = sw->primitives.size() - call.firstFringe;
+
+    /* The cover quad of the stencil fill spans the path bounds */
+    if (call.type == SWCall::StencilFill) {
+        NVGvertex quad[2] = { { bounds[0], bounds[1], 0.5f, 1.f },
+                              { bounds[2], bounds[3], 0.5f, 1.f } };
+        sw->vertices.insert(sw->vertices.end(), quad, quad + 2);
+    }
+    finishCall(sw, call, firstVertex);
+}
+
+void swRenderStroke(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                    NVGscissor *scissor, float fringe, float strokeWidth,
+                    const NVGpath *paths, int npaths) {
+    SWContext *sw = (SWContext *) uptr;
+    SWCall call;
+    if (!convertPaint(sw, call.shader, paint, scissor, strokeWidth, fringe))
+        return;
+    call.type = SWCall::Stroke;
+    call.blend = compositeOperation;
+
+    size_t firstVertex = sw->vertices.size();
+    call.firstFill = sw->primitives.size();
+    for (int i = 0; i < npaths; ++i)
+        if (paths[i].nstroke > 0)
+            addPrimitive(sw, SWPrimitive::Strip, paths[i].stroke, paths[i].nstroke);
+    call.fillCount = sw->primitives.size() - call.firstFill;
+    call.firstFringe = sw->primitives.size();
+    call.fringeCount = 0;
+    finishCall(sw, call, firstVertex);
+}
+
+void swRenderTriangles(void *uptr, NVGpaint *paint, NVGcompositeOperationState compositeOperation,
+                       NVGscissor *scissor, const NVGvertex *verts, int nverts) {
+    SWContext *sw = (SWContext *) uptr;
+    SWCall call;
+    if (!convertPaint(sw, call.shader, paint, scissor, 1.f, 1.f) || !call.shader.texture)
+        return;
+    call.shader.type = SWShader::Textured;
+    call.type = SWCall::Triangles;
+    call.blend = compositeOperation;
+
+    size_t firstVertex = sw->vertices.size();
+    call.firstFill = sw->primitives.size();
+    addPrimitive(sw, SWPrimitive::List, verts, nverts);
+    call.fillCount = 1;
+    call.firstFringe = sw->primitives.size();
+    call.fringeCount = 0;
+    finishCall(sw, call, firstVertex);
+}
+
+void swRenderDelete(void *uptr) {
+    delete (SWContext *) uptr;
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, int flags, int threadCount)
+    : mContext(nullptr), mBackend(nullptr), mSize(width, height) {
+    SWContext *sw = new SWContext();
+    sw->edgeAA = (flags & NVG_ANTIALIAS) != 0;
+    sw->threadCount = threadCount;
+
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.userPtr = sw;
+    params.edgeAntiAlias = sw->edgeAA ? 1 : 0;
+    params.renderCreate = swRenderCreate;
+    params.renderCreateTexture = swRenderCreateTexture;
+    params.renderDeleteTexture = swRenderDeleteTexture;
+    params.renderUpdateTexture = swRenderUpdateTexture;
+    params.renderGetTextureSize = swRenderGetTextureSize;
+    params.renderViewport = swRenderViewport;
+    params.renderCancel = swRenderCancel;
+    params.renderFlush = swRenderFlush;
+    params.renderFill = swRenderFill;
+    params.renderStroke = swRenderStroke;
+    params.renderTriangles = swRenderTriangles;
+    params.renderDelete = swRenderDelete;
+
+    /* nvgCreateInternal() releases the backend through renderDelete on failure */
+    mContext = nvgCreateInternal(&params);
+    if (mContext == nullptr)
+        throw std::runtime_error("Could not initialize the software renderer!");
+    mBackend = sw;
+    resize(mSize);
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+    __nanogui_release_images(mContext);
+    releaseTextCache(mContext);
+    nvgDeleteInternal(mContext);
+}
+
+void SoftwareRenderer::resize(const Vector2i &size) {
+    mSize = size.cwiseMax(1);
+    mPixels.resize((size_t) mSize.x() * mSize.y() * 4);
+    SWContext *sw = (SWContext *) mBackend;
+    sw->pixels = mPixels.data();
+    sw->width = mSize.x();
+    sw->height = mSize.y();
+}
+
+int SoftwareRenderer::threadCount() const {
+    return ((SWContext *) mBackend)->threadCount;
+}
+
+void SoftwareRenderer::setThreadCount(int threadCount) {
+    SWContext *sw = (SWContext *) mBackend;
+    threadCount = std::max(threadCount, 0);
+    if (threadCount != sw->threadCount)
+        sw->pool = nullptr;
+    sw->threadCount = threadCount;
+}
+
+int SoftwareRenderer::tileSize() const {
+    return ((SWContext *) mBackend)->tileSize;
+}
+
+void SoftwareRenderer::setTileSize(int tileSize) {
+    ((SWContext *) mBackend)->tileSize = std::max(tileSize, 8);
+}
+
+void SoftwareRenderer::beginFrame(const Color &background, float pixelRatio) {
+    uint8_t clear[4];
+    for (int c = 0; c < 4; ++c)
+        clear[c] = (uint8_t) (std::min(std::max(background[c], 0.f), 1.f) * 255.f + 0.5f);
+    for (size_t i = 0; i < mPixels.size(); i += 4)
+        memcpy(&mPixels[i], clear, 4);
+
+    nvgBeginFrame(mContext, mSize.x() / pixelRatio, mSize.y() / pixelRatio, pixelRatio);
+    setTextCachePixelRatio(mContext, pixelRatio);
+}
+
+void SoftwareRenderer::endFrame() {
+    nvgEndFrame(mContext);
+}
+
+void SoftwareRenderer::writeTGA(const std::string &filename) const {
+    FILE *tga = fopen(filename.c_str(), "wb");
+    if (tga == nullptr)
+        throw std::runtime_error("SoftwareRenderer::writeTGA(): Could not open output file");
+
+    uint8_t header[18] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                           (uint8_t) (mSize.x() % 256), (uint8_t) (mSize.x() / 256),
+                           (uint8_t) (mSize.y() % 256), (uint8_t) (mSize.y() / 256),
+                           32, 0x20 /* Scan from top left */ };
+    fwrite(header, sizeof(header), 1, tga);
+
+    /* TGA stores BGRA */
+    std::vector<uint8_t> row((size_t) mSize.x() * 4);
+    for (int y = 0; y < mSize.y(); ++y) {
+        const uint8_t *src = mPixels.data() + (size_t) y * row.size();
+        for (size_t i = 0; i < row.size(); i += 4) {
+            row[i] = src[i + 2]; row[i + 1] = src[i + 1];
+            row[i + 2] = src[i]; row[i + 3] = src[i + 3];
+        }
+        fwrite(row.data(), row.size(), 1, tga);
+    }
+    fclose(tga);
+}
+
+bool SoftwareRenderer::isSoftwareContext(NVGcontext *ctx) {
+    return nvgInternalParams(ctx)->renderCreate == swRenderCreate;
+}
+
+void SoftwareRenderer::updateImageRegion(NVGcontext *ctx, int image, int x, int y,
+                                         int w, int h, const uint8_t *rgba) {
+    SWContext *sw = (SWContext *) nvgInternalParams(ctx)->userPtr;
+    auto it = sw->textures.find(image);
+    if (it == sw->textures.end() || it->second.type != NVG_TEXTURE_RGBA)
+        return;
+    SWTexture &tex = it->second;
+    int x0 = std::max(x, 0), x1 = std::min(x + w, tex.width);
+    int y0 = std::max(y, 0), y1 = std::min(y + h, tex.height);
+    for (int row = y0; row < y1; ++row) {
+        if (x1 <= x0)
+            break;
+        memcpy(tex.data.data() + ((size_t) row * tex.width + x0) * 4,
+               rgba + ((size_t) (row - y) * w + (x0 - x)) * 4, (size_t) (x1 - x0) * 4);
+    }
+}
+
+NAMESPACE_END(nanogui)
@@ -14,6 +14,7 @@
 #include <nanogui/tabheader.h>
 #include <nanogui/theme.h>
 #include <nanogui/opengl.h>
+#include <nanogui/textcache.h>
 #include <numeric>
 
 NAMESPACE_BEGIN(nanogui)
@@ -22,9 +23,9 @@ TabHeader::TabButton::TabButton(TabHeader &header, const std::string &label)
     : mHeader(&header), mLabel(label) { }
 
 Vector2i TabHeader::TabButton::preferredSize(NVGcontext *ctx) const {
-    // No need to call nvg font related functions since this is done by the tab header implementation
     float bounds[4];
-    int labelWidth = nvgTextBounds(ctx, 0, 0, mLabel.c_str(), nullptr, bounds);
+    int labelWidth = nvgCachedTextBounds(ctx, mHeader->font(), mHeader->fontSize(),
+                                         NVG_ALIGN_LEFT | NVG_ALIGN_TOP, 0, 0, mLabel, bounds);
     int buttonWidth = labelWidth + 2 * mHeader->theme()->mTabButtonHorizontalPadding;
     int buttonHeight = bounds[3] - bounds[1] + 2 * mHeader->theme()->mTabButtonVerticalPadding;
     return Vector2i(buttonWidth, buttonHeight);
@@ -39,7 +40,8 @@ void TabHeader::TabButton::calculateVisibleString(NVGcontext *ctx) {
     if (displayedText.next[0]) {
         auto truncatedWidth = nvgTextBounds(ctx, 0.0f, 0.0f,
                                             displayedText.start, displayedText.end, nullptr);
-        auto dotsWidth = nvgTextBounds(ctx, 0.0f, 0.0f, dots, nullptr, nullptr);
+        auto dotsWidth = nvgCachedTextBounds(ctx, mHeader->font(), mHeader->fontSize(),
+                                             NVG_ALIGN_LEFT | NVG_ALIGN_TOP, 0.0f, 0.0f, dots);
         while ((truncatedWidth + dotsWidth + mHeader->theme()->mTabButtonHorizontalPadding) > mSize.x()
                 && displayedText.end != displayedText.start) {
             --displayedText.end;
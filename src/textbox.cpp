@@ -16,10 +16,10 @@
 #include <nanogui/screen.h>
 #include <nanogui/textbox.h>
 #include <nanogui/opengl.h>
+#include <nanogui/textureatlas.h>
+#include <nanogui/textcache.h>
 #include <nanogui/theme.h>
 #include <nanogui/serializer/core.h>
-#include <regex>
-#include <iostream>
 
 NAMESPACE_BEGIN(nanogui)
 
@@ -65,18 +65,20 @@ Vector2i TextBox::preferredSize(NVGcontext *ctx) const {
     float uw = 0;
     if (mUnitsImage > 0) {
         int w, h;
-        nvgImageSize(ctx, mUnitsImage, &w, &h);
+        nvgImageIconSize(ctx, mUnitsImage, &w, &h);
         float uh = size(1) * 0.4f;
         uw = w * uh / h;
     } else if (!mUnits.empty()) {
-        uw = nvgTextBounds(ctx, 0, 0, mUnits.c_str(), nullptr, nullptr);
+        uw = nvgCachedTextBounds(ctx, "sans", fontSize(), NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE,
+                                 0, 0, mUnits);
     }
     float sw = 0;
     if (mSpinnable) {
         sw = 14.f;
     }
 
-    float ts = nvgTextBounds(ctx, 0, 0, mValue.c_str(), nullptr, nullptr);
+    float ts = nvgCachedTextBounds(ctx, "sans", fontSize(), NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE,
+                                   0, 0, mValue);
     size(0) = size(1) + ts + uw + sw;
     return size;
 }
@@ -123,12 +125,12 @@ void TextBox::draw(NVGcontext* ctx) {
 
     if (mUnitsImage > 0) {
         int w, h;
-        nvgImageSize(ctx, mUnitsImage, &w, &h);
+        nvgImageIconSize(ctx, mUnitsImage, &w, &h);
         float unitHeight = mSize.y() * 0.4f;
         unitWidth = w * unitHeight / h;
-        NVGpaint imgPaint = nvgImagePattern(
+        NVGpaint imgPaint = nvgImageIconPattern(
             ctx, mPos.x() + mSize.x() - xSpacing - unitWidth,
-            drawPos.y() - unitHeight * 0.5f, unitWidth, unitHeight, 0,
+            drawPos.y() - unitHeight * 0.5f, unitWidth, unitHeight,
             mUnitsImage, mEnabled ? 0.7f : 0.35f);
         nvgBeginPath(ctx);
         nvgRect(ctx, mPos.x() + mSize.x() - xSpacing - unitWidth,
@@ -137,7 +139,8 @@ void TextBox::draw(NVGcontext* ctx) {
         nvgFill(ctx);
         unitWidth += 2;
     } else if (!mUnits.empty()) {
-        unitWidth = nvgTextBounds(ctx, 0, 0, mUnits.c_str(), nullptr, nullptr);
+        unitWidth = nvgCachedTextBounds(ctx, "sans", fontSize(),
+                                        NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE, 0, 0, mUnits);
         nvgFillColor(ctx, Color(255, mEnabled ? 64 : 32));
         nvgTextAlign(ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE);
         nvgText(ctx, mPos.x() + mSize.x() - xSpacing, drawPos.y(),
@@ -179,20 +182,22 @@ void TextBox::draw(NVGcontext* ctx) {
         nvgFontFace(ctx, "sans");
     }
 
+    int align = NVG_ALIGN_MIDDLE;
     switch (mAlignment) {
         case Alignment::Left:
-            nvgTextAlign(ctx, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
+            align |= NVG_ALIGN_LEFT;
             drawPos.x() += xSpacing + spinArrowsWidth;
             break;
         case Alignment::Right:
-            nvgTextAlign(ctx, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE);
+            align |= NVG_ALIGN_RIGHT;
             drawPos.x() += mSize.x() - unitWidth - xSpacing;
             break;
         case Alignment::Center:
-            nvgTextAlign(ctx, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+            align |= NVG_ALIGN_CENTER;
             drawPos.x() += mSize.x() * 0.5f;
             break;
     }
+    nvgTextAlign(ctx, align);
 
     nvgFontSize(ctx, fontSize());
     nvgFillColor(ctx, mEnabled && (!mCommitted || !mValue.empty()) ?
@@ -218,14 +223,14 @@ void TextBox::draw(NVGcontext* ctx) {
         const int maxGlyphs = 1024;
         NVGglyphPosition glyphs[maxGlyphs];
         float textBound[4];
-        nvgTextBounds(ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(),
-                      nullptr, textBound);
+        nvgCachedTextBounds(ctx, "sans", fontSize(), align, drawPos.x(), drawPos.y(),
+                            mValueTemp, textBound);
         float lineh = textBound[3] - textBound[1];
 
         // find cursor positions
         int nglyphs =
-            nvgTextGlyphPositions(ctx, drawPos.x(), drawPos.y(),
-                                  mValueTemp.c_str(), nullptr, glyphs, maxGlyphs);
+            nvgCachedTextGlyphPositions(ctx, "sans", fontSize(), align, drawPos.x(),
+                                        drawPos.y(), mValueTemp, glyphs, maxGlyphs);
         updateCursor(ctx, textBound[2], glyphs, nglyphs);
 
         // compute text offset
@@ -243,12 +248,12 @@ void TextBox::draw(NVGcontext* ctx) {
 
         // draw text with offset
         nvgText(ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(), nullptr);
-        nvgTextBounds(ctx, drawPos.x(), drawPos.y(), mValueTemp.c_str(),
-                      nullptr, textBound);
+        nvgCachedTextBounds(ctx, "sans", fontSize(), align, drawPos.x(), drawPos.y(),
+                            mValueTemp, textBound);
 
         // recompute cursor positions
-        nglyphs = nvgTextGlyphPositions(ctx, drawPos.x(), drawPos.y(),
-                mValueTemp.c_str(), nullptr, glyphs, maxGlyphs);
+        nglyphs = nvgCachedTextGlyphPositions(ctx, "sans", fontSize(), align, drawPos.x(),
+                                              drawPos.y(), mValueTemp, glyphs, maxGlyphs);
 
         if (mCursorPos > -1) {
             if (mSelectionPos > -1) {
@@ -394,7 +399,7 @@ bool TextBox::focusEvent(bool focused) {
             mTextOffset = 0;
         }
 
-        mValidFormat = (mValueTemp == "") || checkFormat(mValueTemp, mFormat);
+        mValidFormat = (mValueTemp == "") || checkFormat(mValueTemp);
     }
 
     return true;
@@ -470,7 +475,7 @@ bool TextBox::keyboardEvent(int key, int /* scancode */, int action, int modifie
             }
 
             mValidFormat =
-                (mValueTemp == "") || checkFormat(mValueTemp, mFormat);
+                (mValueTemp == "") || checkFormat(mValueTemp);
         }
 
         return true;
@@ -488,7 +493,7 @@ bool TextBox::keyboardCharacterEvent(unsigned int codepoint) {
         mValueTemp.insert(mCursorPos, convert.str());
         mCursorPos++;
 
-        mValidFormat = (mValueTemp == "") || checkFormat(mValueTemp, mFormat);
+        mValidFormat = (mValueTemp == "") || checkFormat(mValueTemp);
 
         return true;
     }
@@ -496,20 +501,13 @@ bool TextBox::keyboardCharacterEvent(unsigned int codepoint) {
     return false;
 }
 
-bool TextBox::checkFormat(const std::string &input, const std::string &format) {
-    if (format.empty())
-        return true;
-    try {
-        std::regex regex(format);
-        return regex_match(input, regex);
-    } catch (const std::regex_error &) {
-#if __GNUC__ < 4 || (__GNUC__ == 4 && __GNUC_MINOR__ < 9)
-        std::cerr << "Warning: cannot validate text field due to lacking regular expression support. please compile with GCC >= 4.9" << std::endl;
-        return true;
-#else
-        throw;
-#endif
-    }
+void TextBox::setFormat(const std::string &format) {
+    mFormat = format;
+    mValidator = format.empty() ? nullptr : TextValidator::fromFormat(format);
+}
+
+bool TextBox::checkFormat(const std::string &input) const {
+    return !mValidator || mValidator->validate(input);
 }
 
 bool TextBox::copySelection() {
@@ -657,7 +655,9 @@ bool TextBox::load(Serializer &s) {
     if (!s.get("defaultValue", mDefaultValue)) return false;
     if (!s.get("alignment", mAlignment)) return false;
     if (!s.get("units", mUnits)) return false;
-    if (!s.get("format", mFormat)) return false;
+    std::string format;
+    if (!s.get("format", format)) return false;
+    setFormat(format);
     if (!s.get("unitsImage", mUnitsImage)) return false;
     if (!s.get("validFormat", mValidFormat)) return false;
     if (!s.get("valueTemp", mValueTemp)) return false;
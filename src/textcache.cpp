@@ -0,0 +1,279 @@
+/*
+    src/textcache.cpp -- Shared cache for text measurements
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/textcache.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+NAMESPACE_BEGIN(nanogui)
+
+namespace {
+
+struct TextKey {
+    NVGcontext *ctx;
+    std::string text, font;
+    float size;
+    int align;
+    /* Row width for nvgTextBoxBounds(), or -1 for single-line measurements */
+    float breakRowWidth;
+    /* Scale NanoVG rasterizes the font at: transform scale times pixel ratio */
+    float scale;
+
+    bool operator==(const TextKey &k) const {
+        return ctx == k.ctx && size == k.size && align == k.align &&
+               breakRowWidth == k.breakRowWidth && scale == k.scale &&
+               text == k.text && font == k.font;
+    }
+};
+
+struct TextKeyHash {
+    size_t operator()(const TextKey &k) const {
+        size_t hash = std::hash<std::string>()(k.text);
+        auto combine = [&hash](size_t value) {
+            hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        };
+        combine(std::hash<std::string>()(k.font));
+        combine(std::hash<float>()(k.size));
+        combine(std::hash<int>()(k.align));
+        combine(std::hash<float>()(k.breakRowWidth));
+        combine(std::hash<float>()(k.scale));
+        combine(std::hash<const void *>()(k.ctx));
+        return hash;
+    }
+};
+
+struct TextGlyph {
+    size_t offset;
+    float x, minx, maxx;
+};
+
+struct TextLayout {
+    float advance = 0.f;
+    float bounds[4] = { 0.f, 0.f, 0.f, 0.f };
+    bool hasGlyphs = false;
+    std::vector<TextGlyph> glyphs;
+};
+
+typedef std::list<std::pair<TextKey, TextLayout>> TextLayoutList;
+
+struct TextCache {
+    std::mutex mutex;
+    /* Most recently used entries first */
+    TextLayoutList entries;
+    std::unordered_map<TextKey, TextLayoutList::iterator, TextKeyHash> index;
+    size_t capacity = 4096;
+    size_t hits = 0, misses = 0;
+    /* Device pixel ratio of each context, see setTextCachePixelRatio() */
+    std::unordered_map<NVGcontext *, float> pixelRatios;
+};
+
+TextCache &textCache() {
+    static TextCache cache;
+    return cache;
+}
+
+/* Same as NanoVG's font scale: the average scale of the current transform,
+   quantized to 0.01 and at most 4, times the device pixel ratio */
+float fontScale(TextCache &cache, NVGcontext *ctx) {
+    float t[6];
+    nvgCurrentTransform(ctx, t);
+    float sx = std::sqrt(t[0] * t[0] + t[2] * t[2]);
+    float sy = std::sqrt(t[1] * t[1] + t[3] * t[3]);
+    float scale = std::min(std::floor((sx + sy) * 0.5f / 0.01f + 0.5f) * 0.01f, 4.f);
+
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    auto it = cache.pixelRatios.find(ctx);
+    return scale * (it != cache.pixelRatios.end() ? it->second : 1.f);
+}
+
+void trim(TextCache &cache) {
+    while (cache.entries.size() > std::max(cache.capacity, (size_t) 1)) {
+        cache.index.erase(cache.entries.back().first);
+        cache.entries.pop_back();
+    }
+}
+
+/* Return the layout for 'key', computing bounds and, if requested, glyph
+   positions on a miss. The lock is not held while NanoVG measures. */
+TextLayout lookup(TextCache &cache, TextKey &&key, bool needGlyphs) {
+    {
+        std::lock_guard<std::mutex> guard(cache.mutex);
+        auto it = cache.index.find(key);
+        if (it != cache.index.end()) {
+            cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+            if (!needGlyphs || it->second->second.hasGlyphs) {
+                cache.hits++;
+                return it->second->second;
+            }
+        }
+        cache.misses++;
+    }
+
+    TextLayout layout;
+    const char *str = key.text.c_str(), *end = str + key.text.size();
+    NVGcontext *ctx = key.ctx;
+
+    nvgSave(ctx);
+    nvgFontFace(ctx, key.font.c_str());
+    nvgFontSize(ctx, key.size);
+    nvgTextAlign(ctx, key.align);
+    if (key.breakRowWidth < 0) {
+        layout.advance = nvgTextBounds(ctx, 0, 0, str, end, layout.bounds);
+        if (needGlyphs) {
+            std::vector<NVGglyphPosition> positions(key.text.size());
+            int count = positions.empty() ? 0 :
+                nvgTextGlyphPositions(ctx, 0, 0, str, end, positions.data(),
+                                      (int) positions.size());
+            layout.glyphs.resize(count);
+            for (int i = 0; i < count; ++i)
+                layout.glyphs[i] = TextGlyph { (size_t) (positions[i].str - str),
+                                               positions[i].x, positions[i].minx,
+                                               positions[i].maxx };
+            layout.hasGlyphs = true;
+        }
+    } else {
+        nvgTextBoxBounds(ctx, 0, 0, key.breakRowWidth, str, end, layout.bounds);
+    }
+    nvgRestore(ctx);
+
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+        it->second->second = layout;
+    } else {
+        cache.entries.emplace_front(std::move(key), layout);
+        cache.index[cache.entries.front().first] = cache.entries.begin();
+        trim(cache);
+    }
+    return layout;
+}
+
+void translate(const float *src, float x, float y, float *bounds) {
+    if (!bounds)
+        return;
+    bounds[0] = src[0] + x;
+    bounds[1] = src[1] + y;
+    bounds[2] = src[2] + x;
+    bounds[3] = src[3] + y;
+}
+
+}
+
+float nvgCachedTextBounds(NVGcontext *ctx, const std::string &font, float size,
+                          int align, float x, float y, const std::string &text,
+                          float *bounds) {
+    TextCache &cache = textCache();
+    TextLayout layout = lookup(
+        cache, TextKey { ctx, text, font, size, align, -1.f, fontScale(cache, ctx) }, false);
+    translate(layout.bounds, x, y, bounds);
+    return layout.advance;
+}
+
+void nvgCachedTextBoxBounds(NVGcontext *ctx, const std::string &font, float size,
+                            int align, float x, float y, float breakRowWidth,
+                            const std::string &text, float *bounds) {
+    TextCache &cache = textCache();
+    TextLayout layout = lookup(cache, TextKey { ctx, text, font, size, align,
+                                                std::max(breakRowWidth, 0.f),
+                                                fontScale(cache, ctx) }, false);
+    translate(layout.bounds, x, y, bounds);
+}
+
+int nvgCachedTextGlyphPositions(NVGcontext *ctx, const std::string &font, float size,
+                                int align, float x, float /* y */, const std::string &text,
+                                NVGglyphPosition *positions, int maxPositions) {
+    TextCache &cache = textCache();
+    TextLayout layout = lookup(
+        cache, TextKey { ctx, text, font, size, align, -1.f, fontScale(cache, ctx) }, true);
+
+    int count = std::min((int) layout.glyphs.size(), maxPositions);
+    for (int i = 0; i < count; ++i) {
+        const TextGlyph &glyph = layout.glyphs[i];
+        positions[i].str = text.c_str() + glyph.offset;
+        positions[i].x = glyph.x + x;
+        positions[i].minx = glyph.minx + x;
+        positions[i].maxx = glyph.maxx + x;
+    }
+    return count;
+}
+
+void invalidateTextCache() {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    cache.index.clear();
+    cache.entries.clear();
+}
+
+void setTextCachePixelRatio(NVGcontext *ctx, float pixelRatio) {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    cache.pixelRatios[ctx] = pixelRatio;
+}
+
+void releaseTextCache(NVGcontext *ctx) {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    for (auto it = cache.entries.begin(); it != cache.entries.end();) {
+        if (it->first.ctx == ctx) {
+            cache.index.erase(it->first);
+            it = cache.entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    cache.pixelRatios.erase(ctx);
+}
+
+void setTextCacheCapacity(size_t capacity) {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    cache.capacity = capacity;
+    trim(cache);
+}
+
+void forEachCachedText(
+    const std::function<void(const std::string &, float, const std::string &)> &callback) {
+    std::vector<std::pair<std::string, std::pair<float, std::string>>> entries;
+    {
+        TextCache &cache = textCache();
+        std::lock_guard<std::mutex> guard(cache.mutex);
+        entries.reserve(cache.entries.size());
+        for (const auto &entry : cache.entries)
+            entries.push_back(std::make_pair(
+                entry.first.font, std::make_pair(entry.first.size, entry.first.text)));
+    }
+    /* Invoke the callback without holding the lock */
+    for (const auto &entry : entries)
+        callback(entry.first, entry.second.first, entry.second.second);
+}
+
+TextCacheStats textCacheStats() {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    TextCacheStats stats;
+    stats.hits = cache.hits;
+    stats.misses = cache.misses;
+    stats.entries = cache.entries.size();
+    return stats;
+}
+
+void resetTextCacheStats() {
+    TextCache &cache = textCache();
+    std::lock_guard<std::mutex> guard(cache.mutex);
+    cache.hits = cache.misses = 0;
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,252 @@
+/*
+    src/textureatlas.cpp -- Shelf-packed texture atlas for small images
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/textureatlas.h>
+#include <nanogui/softwarerenderer.h>
+#include <map>
+#include <mutex>
+
+/* Needed for nvglImageHandleGL3(), the implementation lives in screen.cpp */
+#define NANOVG_GL3
+#include <nanovg_gl.h>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+TextureAtlas::TextureAtlas(NVGcontext *ctx, int pageSize, int padding)
+    : mContext(ctx), mPageSize(pageSize), mPadding(std::max(padding, 1)) { }
+
+TextureAtlas::~TextureAtlas() {
+    clear();
+}
+
+void TextureAtlas::clear() {
+    for (auto &page : mPages)
+        nvgDeleteImage(mContext, page.image);
+    mPages.clear();
+}
+
+bool TextureAtlas::allocate(Page &page, int width, int height, Vector2i &pos) {
+    int w = width + mPadding, h = height + mPadding;
+
+    /* Pick the shelf that wastes the least vertical space */
+    Shelf *best = nullptr;
+    for (auto &shelf : page.shelves) {
+        if (shelf.height < h || shelf.x + w > mPageSize)
+            continue;
+        if (!best || shelf.height < best->height)
+            best = &shelf;
+    }
+
+    /* Only open a new shelf if the best existing one is much too tall */
+    if ((!best || best->height > h + h / 2) && page.height + h <= mPageSize) {
+        page.shelves.push_back(Shelf { page.height, h, mPadding });
+        page.height += h;
+        best = &page.shelves.back();
+    }
+
+    if (!best)
+        return false;
+
+    pos = Vector2i(best->x, best->y);
+    best->x += w;
+    return true;
+}
+
+TextureAtlas::Region TextureAtlas::add(int width, int height, const uint8_t *rgba) {
+    Region region = reserve(width, height);
+    if (region.valid())
+        update(region, rgba);
+    return region;
+}
+
+TextureAtlas::Region TextureAtlas::reserve(int width, int height) {
+    Region region;
+    if (width <= 0 || height <= 0 || width + 2 * mPadding > mPageSize ||
+        height + 2 * mPadding > mPageSize)
+        return region;
+
+    Page *page = nullptr;
+    Vector2i pos;
+    for (auto &p : mPages) {
+        if (allocate(p, width, height, pos)) {
+            page = &p;
+            break;
+        }
+    }
+
+    if (!page) {
+        /* Start from a transparent page so that the padding never bleeds */
+        std::vector<uint8_t> zero((size_t) mPageSize * mPageSize * 4, 0);
+        int image = nvgCreateImageRGBA(mContext, mPageSize, mPageSize, 0, zero.data());
+        if (image == 0)
+            return region;
+        mPages.push_back(Page { image, std::vector<Shelf>(), mPadding });
+        page = &mPages.back();
+        if (!allocate(*page, width, height, pos))
+            return region;
+    }
+
+    region.image = page->image;
+    region.pos = pos;
+    region.size = Vector2i(width, height);
+    return region;
+}
+
+void TextureAtlas::update(const Region &region, const uint8_t *rgba) {
+    if (!region.valid())
+        return;
+
+    if (SoftwareRenderer::isSoftwareContext(mContext)) {
+        SoftwareRenderer::updateImageRegion(mContext, region.image, region.pos.x(),
+                                            region.pos.y(), region.size.x(),
+                                            region.size.y(), rgba);
+        return;
+    }
+
+    /* nvgUpdateImage() can only replace an entire page, so upload the
+       sub-rectangle directly while preserving the affected GL state */
+    GLint boundTexture, unpackAlignment, unpackRowLength, unpackSkipPixels, unpackSkipRows;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &unpackRowLength);
+    glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &unpackSkipPixels);
+    glGetIntegerv(GL_UNPACK_SKIP_ROWS, &unpackSkipRows);
+
+    glBindTexture(GL_TEXTURE_2D, nvglImageHandleGL3(mContext, region.image));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.pos.x(), region.pos.y(), region.size.x(),
+                    region.size.y(), GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, unpackRowLength);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, unpackSkipPixels);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, unpackSkipRows);
+    glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+}
+
+NVGpaint TextureAtlas::pattern(const Region &region, float x, float y, float w,
+                               float h, float alpha) const {
+    float sx = w / region.size.x(), sy = h / region.size.y();
+    return nvgImagePattern(mContext, x - region.pos.x() * sx, y - region.pos.y() * sy,
+                           mPageSize * sx, mPageSize * sy, 0, region.image, alpha);
+}
+
+/* Icons created by nvgImageIcon() are regular NanoVG images, so that every
+   NanoVG function accepts them. Each is also packed into the icon atlas of
+   its context, which nvgImageIconPattern() draws from so that neighbouring
+   icons share fills. The atlas cells are found by the exact handle, so no
+   other image is ever mistaken for an icon. */
+struct IconEntry {
+    TextureAtlas::Region region;
+    /* Size of the atlas page containing the region */
+    Vector2i imageSize;
+};
+
+struct IconContext {
+    ref<TextureAtlas> atlas;
+    /* Icon name -> NanoVG image */
+    std::map<std::string, int> images;
+    /* NanoVG image -> atlas cell, for the icons that fit into the atlas */
+    std::map<int, IconEntry> entries;
+};
+
+static std::mutex iconMutex;
+static std::map<NVGcontext *, IconContext> iconContexts;
+
+static bool iconEntry(NVGcontext *ctx, int icon, IconEntry &entry) {
+    std::lock_guard<std::mutex> guard(iconMutex);
+    auto it = iconContexts.find(ctx);
+    if (it == iconContexts.end())
+        return false;
+    auto it2 = it->second.entries.find(icon);
+    if (it2 == it->second.entries.end())
+        return false;
+    entry = it2->second;
+    return true;
+}
+
+int __nanogui_get_image(NVGcontext *ctx, const std::string &name, uint8_t *data, uint32_t size) {
+    ref<TextureAtlas> atlas;
+    {
+        std::lock_guard<std::mutex> guard(iconMutex);
+        IconContext &ic = iconContexts[ctx];
+        auto it = ic.images.find(name);
+        if (it != ic.images.end())
+            return it->second;
+        if (!ic.atlas)
+            ic.atlas = new TextureAtlas(ctx, 1024, 2);
+        atlas = ic.atlas;
+    }
+
+    /* A context is only used by one thread, so the lock is not needed while
+       the icon is decoded and uploaded */
+    int w, h, n;
+    uint8_t *rgba = stbi_load_from_memory(data, (int) size, &w, &h, &n, 4);
+    if (!rgba)
+        throw std::runtime_error("Unable to load resource data.");
+    int image = nvgCreateImageRGBA(ctx, w, h, 0, rgba);
+    IconEntry entry;
+    if (image != 0) {
+        entry.region = atlas->add(w, h, rgba);
+        entry.imageSize = Vector2i::Constant(atlas->pageSize());
+    }
+    stbi_image_free(rgba);
+    if (image == 0)
+        throw std::runtime_error("Unable to load resource data.");
+
+    std::lock_guard<std::mutex> guard(iconMutex);
+    IconContext &ic = iconContexts[ctx];
+    ic.images[name] = image;
+    if (entry.region.valid())
+        ic.entries[image] = entry;
+    return image;
+}
+
+void __nanogui_release_images(NVGcontext *ctx) {
+    IconContext ic;
+    {
+        std::lock_guard<std::mutex> guard(iconMutex);
+        auto it = iconContexts.find(ctx);
+        if (it == iconContexts.end())
+            return;
+        ic = it->second;
+        iconContexts.erase(it);
+    }
+    for (const auto &image : ic.images)
+        nvgDeleteImage(ctx, image.second);
+    /* Releasing the last reference deletes the atlas pages */
+    ic.atlas = nullptr;
+}
+
+void nvgImageIconSize(NVGcontext *ctx, int icon, int *w, int *h) {
+    nvgImageSize(ctx, icon, w, h);
+}
+
+NVGpaint nvgImageIconPattern(NVGcontext *ctx, float x, float y, float w, float h,
+                             int icon, float alpha) {
+    IconEntry entry;
+    if (!iconEntry(ctx, icon, entry))
+        return nvgImagePattern(ctx, x, y, w, h, 0, icon, alpha);
+
+    const TextureAtlas::Region &region = entry.region;
+    float sx = w / region.size.x(), sy = h / region.size.y();
+    return nvgImagePattern(ctx, x - region.pos.x() * sx, y - region.pos.y() * sy,
+                           entry.imageSize.x() * sx, entry.imageSize.y() * sy, 0,
+                           region.image, alpha);
+}
+
+NAMESPACE_END(nanogui)
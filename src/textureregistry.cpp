@@ -0,0 +1,302 @@
+/*
+    src/textureregistry.cpp -- Accounting and budget-driven eviction of
+    the NanoVG images of a context
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/textureregistry.h>
+#include <nanogui/mediaitembase.h>
+#include <nanogui/opengl.h>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* The backend callbacks only receive the backend's user pointer, which is
+   used to find the registry and the original callbacks */
+struct TextureRegistryHook {
+    NVGparams original;
+    TextureRegistry *registry;
+};
+
+static std::mutex hookMutex;
+static std::map<void *, TextureRegistryHook> hooks;
+
+static TextureRegistryHook findHook(void *uptr) {
+    std::lock_guard<std::mutex> guard(hookMutex);
+    return hooks.find(uptr)->second;
+}
+
+struct TextureRegistryHooks {
+    static int createTexture(void *uptr, int type, int w, int h, int imageFlags,
+                             const unsigned char *data) {
+        TextureRegistryHook hook = findHook(uptr);
+        int image = hook.original.renderCreateTexture(uptr, type, w, h, imageFlags, data);
+        if (image > 0) {
+            size_t bytes = (size_t) w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1);
+            if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS)
+                bytes = bytes * 4 / 3;
+            hook.registry->add(image, bytes);
+        }
+        return image;
+    }
+
+    static int deleteTexture(void *uptr, int image) {
+        TextureRegistryHook hook = findHook(uptr);
+        TextureRegistry *registry = hook.registry;
+        {
+            std::lock_guard<std::mutex> guard(registry->mMutex);
+            auto it = registry->mTextures.find(image);
+            if (it != registry->mTextures.end()) {
+                registry->mBytes -= it->second.bytes;
+                registry->mTextures.erase(it);
+            }
+        }
+        return hook.original.renderDeleteTexture(uptr, image);
+    }
+};
+
+TextureRegistry::TextureRegistry(NVGcontext *ctx)
+    : mContext(ctx), mFrame(0), mBudget(0), mBytes(0), mEvictionCount(0),
+      mEvictedBytes(0) {
+    NVGparams *params = nvgInternalParams(ctx);
+    std::lock_guard<std::mutex> guard(hookMutex);
+    if (hooks.count(params->userPtr))
+        throw std::runtime_error("TextureRegistry: the context already has a registry!");
+    TextureRegistryHook &hook = hooks[params->userPtr];
+    hook.original = *params;
+    hook.registry = this;
+    params->renderCreateTexture = TextureRegistryHooks::createTexture;
+    params->renderDeleteTexture = TextureRegistryHooks::deleteTexture;
+}
+
+TextureRegistry::~TextureRegistry() {
+    if (mContext)
+        fprintf(stderr, "TextureRegistry::~TextureRegistry(): detach() was not called!\n");
+}
+
+void TextureRegistry::detach() {
+    if (!mContext)
+        return;
+    collectGarbage();
+
+    NVGparams *params = nvgInternalParams(mContext);
+    {
+        std::lock_guard<std::mutex> guard(hookMutex);
+        auto it = hooks.find(params->userPtr);
+        if (it != hooks.end()) {
+            params->renderCreateTexture = it->second.original.renderCreateTexture;
+            params->renderDeleteTexture = it->second.original.renderDeleteTexture;
+            hooks.erase(it);
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    mContext = nullptr;
+    mTextures.clear();
+    mOwners.clear();
+    mRetained.clear();
+    mBytes = 0;
+}
+
+void TextureRegistry::add(int image, size_t bytes) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mTextures.find(image);
+    if (it == mTextures.end()) {
+        Texture texture;
+        texture.image = image;
+        texture.bytes = 0;
+        texture.lastUseFrame = mFrame;
+        it = mTextures.insert(std::make_pair(image, texture)).first;
+    }
+    mBytes = mBytes - it->second.bytes + bytes;
+    it->second.bytes = bytes;
+}
+
+void TextureRegistry::setOwner(int image, MediaItemBase *owner) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mTextures.find(image);
+    if (it == mTextures.end())
+        return;
+    std::vector<MediaItemBase *> &owners = it->second.owners;
+    if (std::find(owners.begin(), owners.end(), owner) == owners.end())
+        owners.push_back(owner);
+    it->second.lastUseFrame = mFrame;
+    mOwners[owner] = mFrame;
+}
+
+void TextureRegistry::disown(int image, const MediaItemBase *owner) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mTextures.find(image);
+    if (it == mTextures.end())
+        return;
+    std::vector<MediaItemBase *> &owners = it->second.owners;
+    owners.erase(std::remove(owners.begin(), owners.end(), owner), owners.end());
+}
+
+void TextureRegistry::releaseOwner(MediaItemBase *owner) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    if (!mOwners.erase(owner))
+        return;
+    for (auto &texture : mTextures) {
+        std::vector<MediaItemBase *> &owners = texture.second.owners;
+        auto it = std::find(owners.begin(), owners.end(), owner);
+        if (it == owners.end())
+            continue;
+        owners.erase(it);
+        if (owners.empty())
+            mGarbage.push_back(texture.first);
+    }
+}
+
+void TextureRegistry::touch(const MediaItemBase *owner) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    auto it = mOwners.find(owner);
+    if (it != mOwners.end())
+        it->second = mFrame;
+}
+
+void TextureRegistry::beginFrame() {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mFrame++;
+    }
+    collectGarbage();
+}
+
+uint64_t TextureRegistry::frame() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mFrame;
+}
+
+size_t TextureRegistry::budget() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mBudget;
+}
+
+void TextureRegistry::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mBudget = bytes;
+}
+
+void TextureRegistry::setRetained(const std::vector<Widget *> &widgets) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mRetained.assign(widgets.begin(), widgets.end());
+}
+
+bool TextureRegistry::retained(const MediaItemBase *owner) const {
+    for (const Widget *w = owner; w; w = w->parent())
+        for (const auto &widget : mRetained)
+            if (widget.get() == w)
+                return true;
+    return false;
+}
+
+size_t TextureRegistry::enforceBudget() {
+    std::vector<MediaItemBase *> victims;
+    size_t before;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (mBudget == 0 || mBytes <= mBudget)
+            return 0;
+
+        /* Shared images are split between their owners, as only evicting
+           all of them frees one */
+        std::map<MediaItemBase *, size_t> ownerBytes;
+        for (const auto &texture : mTextures)
+            for (MediaItemBase *owner : texture.second.owners)
+                ownerBytes[owner] += texture.second.bytes / texture.second.owners.size();
+
+        /* Least recently drawn first; what is on screen or retained stays */
+        std::vector<std::pair<uint64_t, MediaItemBase *>> candidates;
+        for (const auto &owner : ownerBytes) {
+            uint64_t lastUse = mOwners[owner.first];
+            if (lastUse < mFrame && !retained(owner.first))
+                candidates.push_back(std::make_pair(lastUse, owner.first));
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        size_t excess = mBytes - mBudget, planned = 0;
+        for (const auto &candidate : candidates) {
+            if (planned >= excess)
+                break;
+            victims.push_back(candidate.second);
+            planned += ownerBytes[candidate.second];
+        }
+        before = mBytes;
+    }
+
+    /* Releasing deletes the images, which calls back into the registry */
+    for (MediaItemBase *owner : victims)
+        owner->releaseResources();
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    size_t freed = before > mBytes ? before - mBytes : 0;
+    mEvictionCount += (int) victims.size();
+    mEvictedBytes += freed;
+    return freed;
+}
+
+size_t TextureRegistry::memoryUsage() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mBytes;
+}
+
+size_t TextureRegistry::ownedMemoryUsage() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    size_t bytes = 0;
+    for (const auto &texture : mTextures)
+        if (!texture.second.owners.empty())
+            bytes += texture.second.bytes;
+    return bytes;
+}
+
+int TextureRegistry::textureCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return (int) mTextures.size();
+}
+
+int TextureRegistry::evictionCount() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mEvictionCount;
+}
+
+size_t TextureRegistry::evictedBytes() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mEvictedBytes;
+}
+
+std::vector<TextureRegistry::Texture> TextureRegistry::textures() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    std::vector<Texture> result;
+    for (const auto &texture : mTextures) {
+        result.push_back(texture.second);
+        for (MediaItemBase *owner : texture.second.owners)
+            result.back().lastUseFrame = std::max(result.back().lastUseFrame,
+                                                  mOwners.find(owner)->second);
+    }
+    return result;
+}
+
+void TextureRegistry::collectGarbage() {
+    std::vector<int> garbage;
+    NVGcontext *ctx;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        garbage.swap(mGarbage);
+        ctx = mContext;
+    }
+    /* Deleting calls back into the registry, so the lock is not held */
+    if (ctx)
+        for (int image : garbage)
+            nvgDeleteImage(ctx, image);
+}
+
+NAMESPACE_END(nanogui)
@@ -0,0 +1,169 @@
+/*
+    src/textvalidator.cpp -- Input validators for TextBox
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/textvalidator.h>
+#include <functional>
+#include <iostream>
+#include <map>
+
+NAMESPACE_BEGIN(nanogui)
+
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+/* Characters matched by '\s' in an ECMAScript regular expression (ASCII only) */
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static std::map<std::string, ref<TextValidator>> &registeredFormats() {
+    static std::map<std::string, ref<TextValidator>> formats;
+    return formats;
+}
+
+/* Expressions used by NanoGUI and PiSignage, without anchors */
+static const std::map<std::string, std::function<TextValidator *()>> &builtinFormats() {
+    static const std::map<std::string, std::function<TextValidator *()>> formats = {
+        { "[0-9]*",      []() { return new IntegerValidator(false); } },
+        { "[-]?[0-9]*",  []() { return new IntegerValidator(true); } },
+        { "[1-9][0-9]*", []() { return new IntegerValidator(false, true, false); } },
+        { "[0-9]*\\.?[0-9]+", []() { return new NumberValidator(); } },
+        { "[-]?[0-9]*\\.?[0-9]+", []() { return new NumberValidator("-"); } },
+        { "[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?",
+          []() { return new NumberValidator("-+", true); } },
+        { "[0-9]{1,4}\\s*[x]\\s*[0-9]{1,4}", []() { return new PairValidator('x'); } },
+        { "[0-9]{1,4}\\s*[,]\\s*[0-9]{1,4}", []() { return new PairValidator(','); } }
+    };
+    return formats;
+}
+
+ref<TextValidator> TextValidator::fromFormat(const std::string &format) {
+    auto &registered = registeredFormats();
+    auto it = registered.find(format);
+    if (it != registered.end())
+        return it->second;
+
+    std::string key = format;
+    if (key.size() >= 2 && key.front() == '^' && key.back() == '$' &&
+        key[key.size() - 2] != '\\')
+        key = key.substr(1, key.size() - 2);
+
+    it = registered.find(key);
+    if (it != registered.end())
+        return it->second;
+
+    auto &builtin = builtinFormats();
+    auto it2 = builtin.find(key);
+    if (it2 != builtin.end())
+        return it2->second();
+
+    return new RegexValidator(format);
+}
+
+void TextValidator::registerFormat(const std::string &format, TextValidator *validator) {
+    if (validator)
+        registeredFormats()[format] = validator;
+    else
+        registeredFormats().erase(format);
+}
+
+RegexValidator::RegexValidator(const std::string &format) : mValid(true) {
+    try {
+        mRegex = std::regex(format);
+    } catch (const std::regex_error &) {
+#if __GNUC__ < 4 || (__GNUC__ == 4 && __GNUC_MINOR__ < 9)
+        std::cerr << "Warning: cannot validate text field due to lacking regular expression support. please compile with GCC >= 4.9" << std::endl;
+        mValid = false;
+#else
+        throw;
+#endif
+    }
+}
+
+bool RegexValidator::validate(const std::string &input) const {
+    return !mValid || std::regex_match(input, mRegex);
+}
+
+bool IntegerValidator::validate(const std::string &input) const {
+    const char *c = input.c_str(), *end = c + input.size();
+    if (mAllowNegative && c != end && *c == '-')
+        ++c;
+    if (c == end)
+        return !mRequireDigits;
+    if (!mAllowLeadingZero && *c == '0')
+        return false;
+    for (; c != end; ++c) {
+        if (!isDigit(*c))
+            return false;
+    }
+    return true;
+}
+
+bool NumberValidator::validate(const std::string &input) const {
+    const char *c = input.c_str(), *end = c + input.size();
+    if (c != end && mSigns.find(*c) != std::string::npos)
+        ++c;
+
+    /* [0-9]*\.?[0-9]+ : digits before an optional point, at least one after it */
+    int intDigits = 0, fracDigits = 0;
+    while (c != end && isDigit(*c)) { ++c; ++intDigits; }
+    if (c != end && *c == '.') {
+        ++c;
+        while (c != end && isDigit(*c)) { ++c; ++fracDigits; }
+        if (fracDigits == 0)
+            return false;
+    } else if (intDigits == 0) {
+        return false;
+    }
+
+    if (mAllowExponent && c != end && (*c == 'e' || *c == 'E')) {
+        ++c;
+        if (c != end && (*c == '-' || *c == '+'))
+            ++c;
+        int expDigits = 0;
+        while (c != end && isDigit(*c)) { ++c; ++expDigits; }
+        if (expDigits == 0)
+            return false;
+    }
+
+    return c == end;
+}
+
+bool PairValidator::validate(const std::string &input) const {
+    int first, second;
+    return parse(input, first, second);
+}
+
+bool PairValidator::parse(const std::string &input, int &first, int &second) const {
+    const char *c = input.c_str(), *end = c + input.size();
+
+    auto number = [&](int &value) {
+        int digits = 0;
+        value = 0;
+        while (c != end && isDigit(*c) && digits < mMaxDigits) {
+            value = value * 10 + (*c - '0');
+            ++c; ++digits;
+        }
+        return digits > 0;
+    };
+
+    if (!number(first))
+        return false;
+    while (c != end && isSpace(*c))
+        ++c;
+    if (c == end || *c != mSeparator)
+        return false;
+    ++c;
+    while (c != end && isSpace(*c))
+        ++c;
+    return number(second) && c == end;
+}
+
+NAMESPACE_END(nanogui)
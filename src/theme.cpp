@@ -14,6 +14,7 @@
 #include <nanogui/theme.h>
 #include <nanogui/opengl.h>
 #include <nanogui/entypo.h>
+#include <nanogui/textcache.h>
 #include <nanogui_resources.h>
 
 NAMESPACE_BEGIN(nanogui)
@@ -88,6 +89,9 @@ Theme::Theme(NVGcontext *ctx) {
                                   entypo_ttf_size, 0);
     if (mFontNormal == -1 || mFontBold == -1 || mFontIcons == -1)
         throw std::runtime_error("Could not load fonts!");
+
+    /* Fonts may have been replaced, forget all previous measurements */
+    invalidateTextCache();
 }
 
 NAMESPACE_END(nanogui)
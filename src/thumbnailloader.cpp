@@ -0,0 +1,314 @@
+/*
+    src/thumbnailloader.cpp -- Background decoder and on-disk cache for
+    ImagePanel thumbnails
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/thumbnailloader.h>
+#include <nanogui/jpegimage.h>
+#include <nanogui/opengl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+static const uint32_t THUMBNAIL_CACHE_MAGIC = 0x4254474e; /* "NGTB" */
+
+ThumbnailLoader::ThumbnailLoader(int thumbSize, const std::string &cacheDirectory,
+                                 int threadCount)
+    : mThumbSize(thumbSize), mCacheDirectory(cacheDirectory), mInFlight(0),
+      mGeneration(0), mVisibleFirst(0), mVisibleLast(0), mPrefetch(-1), mShutdown(false) {
+    if (threadCount <= 0)
+        threadCount = std::max(1, (int) std::thread::hardware_concurrency() - 1);
+    for (int i = 0; i < threadCount; ++i)
+        mThreads.emplace_back([this]() { workerThread(); });
+}
+
+ThumbnailLoader::~ThumbnailLoader() {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mShutdown = true;
+    }
+    mCondition.notify_all();
+    for (auto &thread : mThreads)
+        thread.join();
+}
+
+void ThumbnailLoader::setFiles(const std::vector<std::string> &files) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mFiles = files;
+        mGeneration++;
+        mQueue.clear();
+        mResults.clear();
+        for (int i = 0; i < (int) mFiles.size(); ++i)
+            mQueue.insert(mQueue.end(), i);
+        mVisibleFirst = mVisibleLast = 0;
+    }
+    mCondition.notify_all();
+}
+
+void ThumbnailLoader::setVisibleRange(int first, int last) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        last = std::max(first, last);
+        if (mVisibleFirst == first && mVisibleLast == last)
+            return;
+        mVisibleFirst = first;
+        mVisibleLast = last;
+    }
+    /* Queued files may have moved into the prefetch window */
+    mCondition.notify_all();
+}
+
+void ThumbnailLoader::setPrefetch(int count) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mPrefetch = count;
+    }
+    mCondition.notify_all();
+}
+
+void ThumbnailLoader::request(int index) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (index < 0 || index >= (int) mFiles.size())
+            return;
+        mQueue.insert(index);
+    }
+    mCondition.notify_one();
+}
+
+int ThumbnailLoader::pending() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return (int) (mQueue.size() + mResults.size()) + mInFlight;
+}
+
+std::set<int>::iterator ThumbnailLoader::closestTask() {
+    if (mQueue.empty())
+        return mQueue.end();
+
+    /* Pick the queued index closest to the visible range */
+    auto it = mQueue.lower_bound(mVisibleFirst);
+    if (it == mQueue.end() || *it > mVisibleLast) {
+        if (it == mQueue.begin()) {
+            /* Everything left is below the visible range */
+        } else if (it == mQueue.end() ||
+                   mVisibleFirst - *std::prev(it) < *it - mVisibleLast) {
+            it = std::prev(it);
+        }
+    }
+
+    int distance = std::max(std::max(mVisibleFirst - *it, *it - mVisibleLast), 0);
+    if (mPrefetch >= 0 && distance > mPrefetch)
+        return mQueue.end();
+    return it;
+}
+
+bool ThumbnailLoader::nextTask(int &index, std::string &filename, uint32_t &generation) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    std::set<int>::iterator it;
+    mCondition.wait(lock, [&]() {
+        return mShutdown || (it = closestTask()) != mQueue.end();
+    });
+    if (mShutdown)
+        return false;
+
+    index = *it;
+    mQueue.erase(it);
+    filename = mFiles[index];
+    generation = mGeneration;
+    mInFlight++;
+    return true;
+}
+
+void ThumbnailLoader::workerThread() {
+    int index;
+    std::string filename;
+    uint32_t generation;
+
+    while (nextTask(index, filename, generation)) {
+        Thumbnail result;
+        result.index = index;
+        result.width = result.height = 0;
+
+        std::string cacheFile = cacheFilename(filename);
+        if (cacheFile.empty() || !readCache(cacheFile, result)) {
+            if (decode(filename, mThumbSize, result.rgba, result.width, result.height)) {
+                if (!cacheFile.empty())
+                    writeCache(cacheFile, result);
+            } else {
+                result.width = result.height = 0;
+                result.rgba.clear();
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(mMutex);
+        mInFlight--;
+        if (generation == mGeneration)
+            mResults.push_back(std::move(result));
+    }
+}
+
+int ThumbnailLoader::fetch(std::vector<Thumbnail> &thumbnails, int maxCount) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    size_t count = std::min(mResults.size(), (size_t) std::max(maxCount, 0));
+    for (size_t i = mResults.size() - count; i < mResults.size(); ++i)
+        thumbnails.push_back(std::move(mResults[i]));
+    mResults.resize(mResults.size() - count);
+    return (int) count;
+}
+
+int ThumbnailLoader::upload(NVGcontext *ctx, std::vector<std::pair<int, int>> &loaded,
+                            int maxUploads) {
+    std::vector<Thumbnail> thumbnails;
+    fetch(thumbnails, maxUploads);
+
+    for (auto &thumbnail : thumbnails) {
+        int image = -1;
+        if (thumbnail.width > 0 && thumbnail.height > 0) {
+            image = nvgCreateImageRGBA(ctx, thumbnail.width, thumbnail.height, 0,
+                                       thumbnail.rgba.data());
+            if (image == 0)
+                image = -1;
+        }
+        loaded.push_back(std::make_pair(thumbnail.index, image));
+    }
+
+    return (int) thumbnails.size();
+}
+
+bool ThumbnailLoader::decode(const std::string &filename, int thumbSize,
+                             std::vector<uint8_t> &rgba, int &width, int &height) {
+    /* Photos are decoded straight to a reduced size that still covers the thumbnail */
+    std::vector<uint8_t> scaled;
+    uint8_t *decoded = nullptr;
+    int w, h, n;
+    if (!JPEGImage::loadScaled(filename, thumbSize, thumbSize, scaled, w, h)) {
+        decoded = stbi_load(filename.c_str(), &w, &h, &n, 4);
+        if (!decoded)
+            return false;
+    }
+    const uint8_t *data = decoded ? decoded : scaled.data();
+
+    /* Box-filter the image so that its shorter side matches 'thumbSize' */
+    float scale = std::min(1.f, thumbSize / (float) std::min(w, h));
+    width = std::max(1, (int) std::round(w * scale));
+    height = std::max(1, (int) std::round(h * scale));
+    rgba.resize((size_t) width * height * 4);
+
+    if (width == w && height == h) {
+        memcpy(rgba.data(), data, rgba.size());
+    } else {
+        for (int y = 0; y < height; ++y) {
+            int y0 = (int) ((int64_t) y * h / height);
+            int y1 = std::max(y0 + 1, (int) ((int64_t) (y + 1) * h / height));
+            for (int x = 0; x < width; ++x) {
+                int x0 = (int) ((int64_t) x * w / width);
+                int x1 = std::max(x0 + 1, (int) ((int64_t) (x + 1) * w / width));
+                uint32_t sum[4] = { 0, 0, 0, 0 };
+                for (int sy = y0; sy < y1; ++sy) {
+                    const uint8_t *src = data + ((size_t) sy * w + x0) * 4;
+                    for (int sx = x0; sx < x1; ++sx, src += 4) {
+                        sum[0] += src[0]; sum[1] += src[1];
+                        sum[2] += src[2]; sum[3] += src[3];
+                    }
+                }
+                uint32_t count = (uint32_t) ((y1 - y0) * (x1 - x0));
+                uint8_t *dst = rgba.data() + ((size_t) y * width + x) * 4;
+                for (int c = 0; c < 4; ++c)
+                    dst[c] = (uint8_t) ((sum[c] + count / 2) / count);
+            }
+        }
+    }
+
+    if (decoded)
+        stbi_image_free(decoded);
+    return true;
+}
+
+std::string ThumbnailLoader::cacheFilename(const std::string &filename) const {
+    if (mCacheDirectory.empty())
+        return "";
+
+    struct stat sb;
+    if (stat(filename.c_str(), &sb) != 0)
+        return "";
+
+    /* FNV-1a hash of the path, file size, modification time and thumbnail size */
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void *ptr, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= ((const uint8_t *) ptr)[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+    int64_t size = (int64_t) sb.st_size, mtime = (int64_t) sb.st_mtime;
+    mix(filename.data(), filename.size());
+    mix(&size, sizeof(size));
+    mix(&mtime, sizeof(mtime));
+    mix(&mThumbSize, sizeof(mThumbSize));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.thumb", (unsigned long long) hash);
+    return mCacheDirectory + "/" + name;
+}
+
+bool ThumbnailLoader::readCache(const std::string &cacheFile, Thumbnail &result) const {
+    FILE *file = fopen(cacheFile.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint32_t header[3];
+    bool success = fread(header, sizeof(header), 1, file) == 1 &&
+                   header[0] == THUMBNAIL_CACHE_MAGIC &&
+                   header[1] > 0 && header[1] <= (uint32_t) mThumbSize * 64 &&
+                   header[2] > 0 && header[2] <= (uint32_t) mThumbSize * 64;
+    if (success) {
+        result.width = (int) header[1];
+        result.height = (int) header[2];
+        result.rgba.resize((size_t) result.width * result.height * 4);
+        success = fread(result.rgba.data(), result.rgba.size(), 1, file) == 1;
+    }
+    fclose(file);
+
+    if (!success) {
+        result.width = result.height = 0;
+        result.rgba.clear();
+    }
+    return success;
+}
+
+void ThumbnailLoader::writeCache(const std::string &cacheFile, const Thumbnail &result) const {
+    /* Write to a temporary file first so that readers never see partial data */
+    std::string tmpFile = cacheFile + ".tmp" +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE *file = fopen(tmpFile.c_str(), "wb");
+    if (!file)
+        return;
+
+    uint32_t header[3] = { THUMBNAIL_CACHE_MAGIC, (uint32_t) result.width,
+                           (uint32_t) result.height };
+    bool success = fwrite(header, sizeof(header), 1, file) == 1 &&
+                   fwrite(result.rgba.data(), result.rgba.size(), 1, file) == 1;
+    success &= fclose(file) == 0;
+
+    if (!success || rename(tmpFile.c_str(), cacheFile.c_str()) != 0)
+        remove(tmpFile.c_str());
+}
+
+NAMESPACE_END(nanogui)
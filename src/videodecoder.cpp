@@ -0,0 +1,566 @@
+/*
+    src/videodecoder.cpp -- Streaming decoder for Motion-JPEG AVI files
+    and image sequences
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/videodecoder.h>
+#include <nanogui/imageinfo.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+/* The implementation is compiled into the library as part of nanovg.c */
+#include <stb_image.h>
+
+NAMESPACE_BEGIN(nanogui)
+
+/* Every n-th frame of an AVI file remembers its idx1 entry */
+static const int aviCheckpointInterval = 1024;
+
+/* idx1 entries read at once */
+static const size_t aviIndexBlock = 256;
+
+static uint32_t fourcc(const char *s) {
+    return (uint32_t) (uint8_t) s[0] | ((uint32_t) (uint8_t) s[1] << 8) |
+           ((uint32_t) (uint8_t) s[2] << 16) | ((uint32_t) (uint8_t) s[3] << 24);
+}
+
+static bool readAt(FILE *file, uint64_t offset, void *data, size_t size) {
+#if defined(_WIN32)
+    if (_fseeki64(file, (__int64) offset, SEEK_SET) != 0)
+        return false;
+#else
+    if (fseeko(file, (off_t) offset, SEEK_SET) != 0)
+        return false;
+#endif
+    return fread(data, size, 1, file) == 1;
+}
+
+/* The Huffman tables of section K.3 of the JPEG specification, which Motion-JPEG
+   frames without a DHT segment implicitly use */
+static const uint8_t standardHuffmanTables[] = {
+    0xFF, 0xC4, 0x01, 0xA2,
+    /* Luminance DC */
+    0x00, 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    /* Chrominance DC */
+    0x01, 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    /* Luminance AC */
+    0x10, 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d,
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+    /* Chrominance AC */
+    0x11, 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static_assert(sizeof(standardHuffmanTables) == 0x1A2 + 2, "Unexpected DHT segment size");
+
+/* Insert the standard Huffman tables before the scan if a JPEG stream has none */
+static void addMissingHuffmanTables(std::vector<uint8_t> &jpeg) {
+    if (jpeg.size() < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+        return;
+    size_t pos = 2;
+    while (pos + 4 <= jpeg.size() && jpeg[pos] == 0xFF) {
+        uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xFF) {
+            pos++; /* Fill byte */
+        } else if (marker == 0xC4) {
+            return;
+        } else if (marker == 0xDA) {
+            jpeg.insert(jpeg.begin() + pos, standardHuffmanTables,
+                        standardHuffmanTables + sizeof(standardHuffmanTables));
+            return;
+        } else if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+        } else {
+            pos += 2 + (((size_t) jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+        }
+    }
+}
+
+static bool decodeImage(std::vector<uint8_t> &data, std::vector<uint8_t> &rgba,
+                        int &width, int &height) {
+    addMissingHuffmanTables(data);
+    int n;
+    uint8_t *pixels = stbi_load_from_memory(data.data(), (int) data.size(),
+                                            &width, &height, &n, 4);
+    if (!pixels)
+        return false;
+    rgba.resize((size_t) width * height * 4);
+    memcpy(rgba.data(), pixels, rgba.size());
+    stbi_image_free(pixels);
+    return true;
+}
+
+VideoDecoder::VideoDecoder(const std::string &path, int slotCount, int threadCount)
+    : mPath(path), mFrameCount(0), mFrameRate(0), mFile(nullptr), mMoviOffset(0),
+      mIndexOffset(0), mIndexCount(0), mIndexAbsolute(false), mCursorFrame(-1),
+      mCursorEntry(0), mSequenceStart(0), mNextDecode(0), mLastFetched(-1),
+      mScanned(true), mScanning(false), mDropped(0), mLoop(true), mShutdown(false) {
+    mVideoChunk[0] = mVideoChunk[1] = 0;
+
+    try {
+        if (path.find('%') != std::string::npos)
+            openSequence(threadCount <= 0);
+        else
+            openAvi();
+    } catch (...) {
+        if (mFile)
+            fclose(mFile);
+        throw;
+    }
+
+    mSlots.resize((size_t) std::max(slotCount, 2));
+    for (int i = 0; i < threadCount; ++i)
+        mThreads.emplace_back([this]() { workerThread(); });
+}
+
+VideoDecoder::~VideoDecoder() {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mShutdown = true;
+    }
+    mCondition.notify_all();
+    for (auto &thread : mThreads)
+        thread.join();
+    if (mFile)
+        fclose(mFile);
+}
+
+void VideoDecoder::openAvi() {
+    mFile = fopen(mPath.c_str(), "rb");
+    if (!mFile)
+        throw std::runtime_error("VideoDecoder: could not open \"" + mPath + "\"!");
+
+    uint32_t header[3];
+    if (!readAt(mFile, 0, header, sizeof(header)) || header[0] != fourcc("RIFF") ||
+        header[2] != fourcc("AVI "))
+        throw std::runtime_error("VideoDecoder: \"" + mPath + "\" is not an AVI file!");
+    uint64_t end = 8 + (uint64_t) header[1];
+
+    /* Walk the top level chunks and the header list */
+    int streamCount = 0, videoStream = -1;
+    uint32_t microSecPerFrame = 0;
+    uint64_t pos = 12;
+    while (pos + 8 <= end) {
+        uint32_t chunk[3];
+        if (!readAt(mFile, pos, chunk, sizeof(chunk)))
+            break;
+        uint64_t next = pos + 8 + chunk[1] + (chunk[1] & 1);
+
+        if (chunk[0] == fourcc("LIST") && (chunk[2] == fourcc("hdrl") || chunk[2] == fourcc("strl"))) {
+            /* Descend into the list; its end is where the next sibling starts */
+            if (chunk[2] == fourcc("strl"))
+                streamCount++;
+            pos += 12;
+            continue;
+        } else if (chunk[0] == fourcc("LIST") && chunk[2] == fourcc("movi")) {
+            mMoviOffset = pos + 8;
+        } else if (chunk[0] == fourcc("avih")) {
+            microSecPerFrame = chunk[2];
+        } else if (chunk[0] == fourcc("strh") && chunk[2] == fourcc("vids") && videoStream < 0) {
+            uint32_t strh[6]; /* fccType, fccHandler, flags, priority/language, initialFrames, scale */
+            uint32_t rate;
+            if (readAt(mFile, pos + 8, strh, sizeof(strh)) &&
+                readAt(mFile, pos + 8 + sizeof(strh), &rate, sizeof(rate)) && strh[5] > 0)
+                mFrameRate = (double) rate / strh[5];
+            videoStream = streamCount - 1;
+        } else if (chunk[0] == fourcc("idx1")) {
+            mIndexOffset = pos + 8;
+            mIndexCount = chunk[1] / 16;
+        }
+
+        pos = next;
+    }
+
+    if (videoStream < 0 || videoStream > 99 || mMoviOffset == 0)
+        throw std::runtime_error("VideoDecoder: \"" + mPath + "\" has no video stream!");
+    if (mIndexCount == 0)
+        throw std::runtime_error("VideoDecoder: \"" + mPath + "\" has no idx1 index!");
+    if (mFrameRate <= 0)
+        mFrameRate = microSecPerFrame > 0 ? 1e6 / microSecPerFrame : 25.0;
+
+    char id[5];
+    snprintf(id, sizeof(id), "%02ddc", videoStream);
+    mVideoChunk[0] = fourcc(id);
+    snprintf(id, sizeof(id), "%02ddb", videoStream);
+    mVideoChunk[1] = fourcc(id);
+
+    /* Count the frames; placeholders of dropped frames (size 0) are skipped */
+    uint32_t entries[aviIndexBlock * 4];
+    bool checkedOffsets = false;
+    for (uint32_t first = 0; first < mIndexCount; first += aviIndexBlock) {
+        uint32_t count = std::min((uint32_t) aviIndexBlock, mIndexCount - first);
+        if (!readAt(mFile, mIndexOffset + (uint64_t) first * 16, entries, count * 16))
+            break;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t *entry = entries + i * 4;
+            if ((entry[0] != mVideoChunk[0] && entry[0] != mVideoChunk[1]) || entry[3] == 0)
+                continue;
+            if (!checkedOffsets) {
+                /* Offsets are relative to the "movi" list, but some writers store file offsets */
+                uint32_t id;
+                mIndexAbsolute = !(readAt(mFile, mMoviOffset + entry[2], &id, 4) && id == entry[0]);
+                checkedOffsets = true;
+            }
+            if (mFrameCount % aviCheckpointInterval == 0)
+                mIndexCheckpoints.push_back(first + i);
+            mFrameCount++;
+        }
+    }
+
+    if (mFrameCount == 0)
+        throw std::runtime_error("VideoDecoder: \"" + mPath + "\" contains no frames!");
+}
+
+void VideoDecoder::openSequence(bool scan) {
+    bool found = false;
+    for (int start = 0; start <= 1 && !found; ++start) {
+        mSequenceStart = start;
+        FILE *file = fopen(sequenceFilename(0).c_str(), "rb");
+        if (file) {
+            fclose(file);
+            found = true;
+        }
+    }
+    if (!found)
+        throw std::runtime_error("VideoDecoder: no images match \"" + mPath + "\"!");
+
+    /* Otherwise the first worker counts the images */
+    mScanned = scan;
+    mFrameCount = scan ? scanSequence() : 1;
+}
+
+int VideoDecoder::scanSequence() const {
+    int count = 0;
+    while (true) {
+        FILE *file = fopen(sequenceFilename(count).c_str(), "rb");
+        if (!file)
+            break;
+        fclose(file);
+        count++;
+    }
+    return count;
+}
+
+bool VideoDecoder::probe(const std::string &path, int &width, int &height) {
+    if (path.find('%') != std::string::npos) {
+        /* The first image of the sequence, numbered from 0 or 1 */
+        std::vector<char> name(path.size() + 32);
+        for (int start = 0; start <= 1; ++start) {
+            snprintf(name.data(), name.size(), path.c_str(), start);
+            ImageInfo info;
+            if (ImageInfo::probe(name.data(), info)) {
+                width = info.width;
+                height = info.height;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    bool found = false;
+    uint32_t header[3];
+    if (readAt(file, 0, header, sizeof(header)) && header[0] == fourcc("RIFF") &&
+        header[2] == fourcc("AVI ")) {
+        /* The main header sits at the start of the "hdrl" list */
+        uint64_t end = 8 + (uint64_t) header[1], pos = 12;
+        while (!found && pos + 8 <= end) {
+            uint32_t chunk[3];
+            if (!readAt(file, pos, chunk, sizeof(chunk)))
+                break;
+            if (chunk[0] == fourcc("LIST") && chunk[2] == fourcc("hdrl")) {
+                pos += 12;
+                continue;
+            }
+            if (chunk[0] == fourcc("avih")) {
+                uint32_t avih[10]; /* ..., dwSuggestedBufferSize, dwWidth, dwHeight */
+                found = chunk[1] >= sizeof(avih) && readAt(file, pos + 8, avih, sizeof(avih)) &&
+                        avih[8] > 0 && avih[9] > 0 && avih[8] <= 16384 && avih[9] <= 16384;
+                if (found) {
+                    width = (int) avih[8];
+                    height = (int) avih[9];
+                }
+                break;
+            }
+            pos += 8 + chunk[1] + (chunk[1] & 1);
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+std::string VideoDecoder::sequenceFilename(int index) const {
+    std::vector<char> name(mPath.size() + 32);
+    snprintf(name.data(), name.size(), mPath.c_str(), mSequenceStart + index);
+    return std::string(name.data());
+}
+
+bool VideoDecoder::findAviFrame(int index, uint64_t &offset, uint32_t &size) {
+    int checkpoint = index / aviCheckpointInterval;
+    if (checkpoint >= (int) mIndexCheckpoints.size())
+        return false;
+
+    int frame = checkpoint * aviCheckpointInterval;
+    uint32_t entryIndex = mIndexCheckpoints[checkpoint];
+    if (mCursorFrame >= frame && mCursorFrame <= index) {
+        frame = mCursorFrame;
+        entryIndex = mCursorEntry;
+    }
+
+    uint32_t entries[aviIndexBlock * 4];
+    while (entryIndex < mIndexCount) {
+        uint32_t count = std::min((uint32_t) aviIndexBlock, mIndexCount - entryIndex);
+        if (!readAt(mFile, mIndexOffset + (uint64_t) entryIndex * 16, entries, count * 16))
+            return false;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t *entry = entries + i * 4;
+            if ((entry[0] != mVideoChunk[0] && entry[0] != mVideoChunk[1]) || entry[3] == 0)
+                continue;
+            if (frame == index) {
+                /* Skip the chunk header */
+                offset = (mIndexAbsolute ? 0 : mMoviOffset) + entry[2] + 8;
+                size = entry[3];
+                mCursorFrame = index;
+                mCursorEntry = entryIndex + i;
+                return true;
+            }
+            frame++;
+        }
+        entryIndex += count;
+    }
+    return false;
+}
+
+bool VideoDecoder::readFrame(int index, std::vector<uint8_t> &data) {
+    if (index < 0 || index >= mFrameCount)
+        return false;
+
+    if (mFile) {
+        std::lock_guard<std::mutex> guard(mFileMutex);
+        uint64_t offset;
+        uint32_t size;
+        if (!findAviFrame(index, offset, size))
+            return false;
+        data.resize(size);
+        return readAt(mFile, offset, data.data(), size);
+    }
+
+    FILE *file = fopen(sequenceFilename(index).c_str(), "rb");
+    if (!file)
+        return false;
+    bool success = fseek(file, 0, SEEK_END) == 0;
+    long size = success ? ftell(file) : -1;
+    success = size > 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (success) {
+        data.resize((size_t) size);
+        success = fread(data.data(), data.size(), 1, file) == 1;
+    }
+    fclose(file);
+    return success;
+}
+
+bool VideoDecoder::decodeFrame(int index, std::vector<uint8_t> &rgba, int &width, int &height) {
+    std::vector<uint8_t> data;
+    return readFrame(index, data) && decodeImage(data, rgba, width, height);
+}
+
+int VideoDecoder::distance(int from, int to) const {
+    if (!mLoop)
+        return to - from;
+    return ((to - from) % mFrameCount + mFrameCount) % mFrameCount;
+}
+
+void VideoDecoder::setLoop(bool loop) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mLoop = loop;
+        if (loop && mNextDecode < 0)
+            mNextDecode = 0;
+    }
+    mCondition.notify_all();
+}
+
+int VideoDecoder::droppedFrames() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mDropped;
+}
+
+bool VideoDecoder::keepsAllFrames() const {
+    return mScanned && mFrameCount <= (int) mSlots.size();
+}
+
+void VideoDecoder::workerThread() {
+    std::vector<uint8_t> data, rgba;
+
+    bool scan;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        scan = !mScanned && !mScanning;
+        mScanning = mScanning || scan;
+    }
+    if (scan) {
+        int count = scanSequence();
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mFrameCount = std::max(count, 1);
+            mScanned = true;
+        }
+        mCondition.notify_all();
+    }
+
+    while (true) {
+        Slot *slot = nullptr;
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [&]() {
+                if (mShutdown)
+                    return true;
+                if (mNextDecode < 0 || !mScanned)
+                    return false;
+                for (auto &s : mSlots) {
+                    if (s.state == Slot::Free) {
+                        slot = &s;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (mShutdown)
+                return;
+
+            index = mNextDecode++;
+            if (mNextDecode >= mFrameCount)
+                mNextDecode = mLoop ? 0 : -1;
+            slot->state = Slot::Decoding;
+            slot->index = index;
+            rgba.swap(slot->rgba);
+        }
+
+        int width = 0, height = 0;
+        bool success = readFrame(index, data) && decodeImage(data, rgba, width, height);
+
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            rgba.swap(slot->rgba);
+            slot->width = width;
+            slot->height = height;
+            if (success) {
+                slot->state = Slot::Ready;
+            } else {
+                slot->state = Slot::Free;
+                mDropped++;
+            }
+        }
+        mCondition.notify_all();
+    }
+}
+
+int VideoDecoder::fetch(int target, std::vector<uint8_t> &rgba, int &width, int &height) {
+    int result = -1;
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (!mScanned)
+            return -1;
+        target = std::max(0, std::min(target, mFrameCount - 1));
+
+        /* Frames up to half the clip before the target are late, when looping */
+        int late = mLoop ? std::max(1, mFrameCount / 2) : INT_MAX;
+        int window = 2 * (int) mSlots.size();
+        bool keep = keepsAllFrames();
+
+        Slot *best = nullptr;
+        for (auto &slot : mSlots) {
+            if (slot.state != Slot::Ready)
+                continue;
+            int behind = distance(slot.index, target);
+            if (behind >= 0 && behind < late) {
+                if (!best || behind < distance(best->index, target))
+                    best = &slot;
+            }
+        }
+
+        if (keep) {
+            /* The whole clip fits: slots (duplicates included) stay decoded
+               and the workers go idle once all are filled */
+            if (best && best->index != mLastFetched) {
+                result = mLastFetched = best->index;
+                width = best->width;
+                height = best->height;
+                rgba = best->rgba;
+            }
+            return result;
+        }
+
+        for (auto &slot : mSlots) {
+            if (slot.state != Slot::Ready || &slot == best)
+                continue;
+            int behind = distance(slot.index, target);
+            int ahead = distance(target, slot.index);
+            if (behind >= 0 && behind < late) {
+                /* Superseded by a newer frame */
+                slot.state = Slot::Free;
+                mDropped++;
+            } else if (ahead > window) {
+                /* Left over from before a jump */
+                slot.state = Slot::Free;
+            }
+        }
+
+        /* Skip frames that would be late when decoded, and restart after jumps */
+        int head = mNextDecode < 0 ? mFrameCount.load() : mNextDecode;
+        int lateBy = distance(head, target);
+        int ahead = distance(target, head);
+        if (lateBy > 0 && lateBy < late) {
+            mDropped += lateBy;
+            mNextDecode = target;
+        } else if (ahead > window) {
+            mNextDecode = target;
+        }
+
+        if (best) {
+            result = mLastFetched = best->index;
+            width = best->width;
+            height = best->height;
+            rgba.swap(best->rgba);
+            best->state = Slot::Free;
+        }
+    }
+    mCondition.notify_all();
+    return result;
+}
+
+NAMESPACE_END(nanogui)
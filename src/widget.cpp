@@ -14,6 +14,7 @@
 #include <nanogui/theme.h>
 #include <nanogui/window.h>
 #include <nanogui/opengl.h>
+#include <nanogui/textcache.h>
 #include <nanogui/screen.h>
 #include <nanogui/serializer/core.h>
 
@@ -39,6 +40,9 @@ Widget::~Widget() {
 void Widget::setTheme(Theme *theme) {
     if (mTheme.get() == theme)
         return;
+    /* Only the root of the tree needs to drop measurements made with the old theme */
+    if (mTheme && (!mParent || mParent->theme() != theme))
+        invalidateTextCache();
     mTheme = theme;
     for (auto child : mChildren)
         child->setTheme(theme);
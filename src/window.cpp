@@ -72,6 +72,15 @@ void Window::draw(NVGcontext *ctx) {
 		mStaleLayout = false;
 	}
 
+    /* The frame and header only change with the window's state */
+    DrawStateHash hash(this);
+    hash.add(mTitle).add(mMouseFocus);
+    if (mDisplayList.replay(ctx, hash.value())) {
+        Widget::draw(ctx);
+        return;
+    }
+    mDisplayList.begin(ctx, hash.value());
+
     /* Draw window */
     nvgSave(ctx);
     nvgBeginPath(ctx);
@@ -143,6 +152,8 @@ void Window::draw(NVGcontext *ctx) {
     }
 
     nvgRestore(ctx);
+    mDisplayList.end(ctx);
+
     Widget::draw(ctx);
 }
 
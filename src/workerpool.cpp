@@ -0,0 +1,65 @@
+/*
+    src/workerpool.cpp -- Fixed set of threads running queued tasks
+
+    NanoGUI was developed by Wenzel Jakob <wenzel.jakob@epfl.ch>.
+    The widget drawing code is based on the NanoVG demo application
+    by Mikko Mononen.
+
+    All rights reserved. Use of this source code is governed by a
+    BSD-style license that can be found in the LICENSE.txt file.
+*/
+
+#include <nanogui/workerpool.h>
+#include <algorithm>
+
+NAMESPACE_BEGIN(nanogui)
+
+WorkerPool::WorkerPool(int threadCount) : mShutdown(false) {
+    if (threadCount <= 0)
+        threadCount = std::max(1, (int) std::thread::hardware_concurrency() - 1);
+    for (int i = 0; i < threadCount; ++i)
+        mThreads.emplace_back([this]() { workerThread(); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mShutdown = true;
+        /* Their futures report std::future_errc::broken_promise */
+        mQueue.clear();
+    }
+    mCondition.notify_all();
+    for (auto &thread : mThreads)
+        thread.join();
+}
+
+int WorkerPool::pending() const {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return (int) mQueue.size();
+}
+
+void WorkerPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mQueue.push_back(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+void WorkerPool::workerThread() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [&]() { return mShutdown || !mQueue.empty(); });
+            if (mShutdown)
+                return;
+            task = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+        /* Exceptions end up in the task's future */
+        task();
+    }
+}
+
+NAMESPACE_END(nanogui)